@@ -36,12 +36,14 @@
 
 #include "parser_factory.hxx"
 #include "custom_parser.hxx"
+#include "stats.hxx"
 
 const char g_default_parser[] = "crf_seg";
 const char g_default_config[] = "";
 const char g_default_file[] = "-";
 const char *g_config = g_default_config, *g_file = g_default_file, *g_parser = g_default_parser;
 bool g_verbose = false;
+bool g_stats = false;
 
 std::vector<std::string> g_override;
 
@@ -51,7 +53,9 @@ static void _help_message()
 				 "OPTIONS:\n"
 				 "        -c|--config           configuration\n"
 				 "        -h|--help             help message\n"
-				 "        -p|--parser           parser, default: crf_seg\n"
+				 "        -p|--parser           parser, default: crf_seg, or custom\n"
+				 "                              to run the process_chain of bamboo.cfg\n"
+				 "        -S|--stats            print processor and lexicon metrics\n"
 				 "        -v|--verbose          verbose\n"
 				 "\n"
 				 "Report bugs to detrox@gmail.com\n"
@@ -129,6 +133,12 @@ static int _do()
 	}
 
 	std::cerr << "consumed time: " << static_cast<double>(consume / 1000)<< " ms" << std::endl;
+	if (g_stats) {
+		std::string stats;
+
+		bamboo::Stats::get_instance()->dump(stats);
+		std::cerr << stats;
+	}
 	return 0;
 }
 
@@ -144,11 +154,12 @@ int main(int argc, char *argv[])
 			{"parser", required_argument, 0, 'p'},
 			{"verbose", required_argument, 0, 'v'},
 			{"set", required_argument, 0, 's'},
+			{"stats", no_argument, 0, 'S'},
 			{0, 0, 0, 0}
 		};
 		int option_index;
 		
-		c = getopt_long(argc, argv, "c:hp:s:v", long_options, &option_index);
+		c = getopt_long(argc, argv, "c:hp:s:Sv", long_options, &option_index);
 		if (c == -1) break;
 
 		switch(c) {
@@ -164,6 +175,10 @@ int main(int argc, char *argv[])
 			case 's':
 				g_override.push_back(optarg);
 				break;
+			case 'S':
+				g_stats = true;
+				bamboo::Stats::enable(true);
+				break;
 			case 'v':
 				g_verbose = true;
 				std::cerr << "verbose on" << std::endl;
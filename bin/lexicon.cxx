@@ -27,10 +27,15 @@
  */
 
 #include <getopt.h>
+#include <unistd.h>
+#include <cstdlib>
 #include <iostream>
 #include <stdexcept>
+#include <vector>
 
 #include "lexicon_factory.hxx"
+#include "ac_automaton.hxx"
+#include "record_lexicon.hxx"
 
 
 static void _info(const char *index)
@@ -56,6 +61,21 @@ static void _query(const char *index, const char *query)
 	std::cout << query << " = " << dc->search(query) << std::endl;
 }
 
+static void _on_suggestion(const char *key, int val, void *arg)
+{
+	std::cout << val << " " << key << std::endl;
+}
+
+static void _predict(const char *index, const char *prefix, size_t limit)
+{
+	bamboo::ILexicon *dc;
+
+	assert(prefix); assert(index);
+	dc = bamboo::LexiconFactory::load(index);
+	if (dc == NULL) throw std::runtime_error("can not load lexicon");
+	dc->predictive_search(prefix, limit, _on_suggestion, NULL);
+}
+
 static void _dump(const char *index, const char *target)
 {
 	bamboo::ILexicon *dc;
@@ -66,15 +86,122 @@ static void _dump(const char *index, const char *target)
 	dc->write_to_text(target);
 }
 
-static void _build(const char *source, const char *index, const char *type, bool verbose)
+/*
+ * The key filter beside a freshly saved index, with bits bits per key;
+ * no bits removes a filter left from an earlier build instead.
+ */
+static void _save_filter(bamboo::ILexicon *dc, const char *index, int bits, bool verbose)
+{
+	if (bits <= 0) {
+		unlink(bamboo::LexiconFactory::filter_path(index).c_str());
+		return;
+	}
+	if (verbose)
+		std::clog << "making key filter" << std::endl;
+	bamboo::LexiconFactory::save_filter(dc, index, bits);
+}
+
+/*
+ * The links of an Aho-Corasick automaton beside a freshly saved datrie
+ * index, for ac_match; links left from an earlier build are removed
+ * first, they may be mapped by the automaton while it is made.
+ */
+static void _save_automaton(const char *index, bool ac, bool verbose)
+{
+	std::string path = bamboo::ACAutomaton::path(index);
+
+	unlink(path.c_str());
+	if (!ac) return;
+	if (verbose)
+		std::clog << "making ac automaton" << std::endl;
+	bamboo::ACAutomaton automaton(index);
+	automaton.save(path.c_str());
+}
+
+static void _build(const char *source, const char *index, const char *type,
+		int filter, bool ac, bool verbose)
 {
 	bamboo::ILexicon *dc;
 
 	assert(source); assert(index);
-	dc = bamboo::LexiconFactory::create(type);
+	dc = bamboo::LexiconFactory::create(type, source);
 	if (dc == NULL) throw std::runtime_error("can not create lexicon");
 	dc->read_from_text(source, verbose);
 	dc->save(index);
+	_save_filter(dc, index, filter, verbose);
+	_save_automaton(index, ac, verbose);
+}
+
+/*
+ * Same input as read_from_text(), "VALUE KEY" per line, but the keys are
+ * sorted first and the index built from them in one pass.
+ */
+static void _build_bulk(const char *source, const char *index, const char *type,
+		size_t memory, int filter, bool ac, bool verbose)
+{
+	bamboo::ILexicon *dc;
+	bamboo::KeySorter keys(memory);
+	char line[8192], *p, *key;
+	size_t n;
+	FILE *fp;
+	int val;
+
+	assert(source); assert(index);
+	dc = bamboo::LexiconFactory::create(type, source);
+	if (dc == NULL) throw std::runtime_error("can not create lexicon");
+	fp = fopen(source, "r");
+	if (fp == NULL) throw std::runtime_error(std::string("can not open ") + source);
+	while (fgets(line, sizeof(line), fp)) {
+		val = strtol(line, &p, 10);
+		if (p == line) continue;
+		for (key = p; *key == ' ' || *key == '\t'; key++) ;
+		n = strcspn(key, "\r\n");
+		if (n == 0) continue;
+		key[(n < 4096)?n:4096] = '\0';
+		keys.add(key, val);
+		if (verbose && keys.size() % 100000 == 0)
+			std::clog << "\r\t\t" << keys.size() << " items read.";
+	}
+	fclose(fp);
+	if (verbose)
+		std::clog << "\r\t\t" << keys.size() << " items read, building" << std::endl;
+	dc->build(keys);
+	dc->save(index);
+	_save_filter(dc, index, filter, verbose);
+	_save_automaton(index, ac, verbose);
+}
+
+/*
+ * A record lexicon at index from sources, FIELD=FILE each, its keys in
+ * an index of type beside it, which the key filter is made for; lambda
+ * is the ele_lambda of the estimates in it.
+ */
+static void _build_records(const std::vector<const char *> &sources, const char *index,
+		const char *type, size_t memory, int filter, double lambda, bool verbose)
+{
+	bamboo::RecordLexiconBuilder builder(lambda);
+	std::string keys = bamboo::RecordLexicon::keys_path(index);
+	bamboo::ILexicon *dc;
+	const char *p;
+	size_t i;
+	int field;
+
+	assert(index);
+	for (i = 0; i < sources.size(); i++) {
+		p = strchr(sources[i], '=');
+		field = (p)?bamboo::RecordLexicon::field(std::string(sources[i], p - sources[i]).c_str()):-1;
+		if (field < 0)
+			throw std::runtime_error(std::string("not a FIELD=FILE source: ") + sources[i]);
+		if (verbose)
+			std::clog << "reading " << p + 1 << std::endl;
+		builder.add(field, p + 1, verbose);
+	}
+	builder.save(index, type, memory, verbose);
+	unlink(bamboo::LexiconFactory::filter_path(keys.c_str()).c_str());
+	if (filter <= 0) return;
+	dc = bamboo::LexiconFactory::load(keys.c_str());
+	_save_filter(dc, keys.c_str(), filter, verbose);
+	delete dc;
 }
 
 static void _help_message()
@@ -85,9 +212,36 @@ static void _help_message()
 				 "        -i|--index            index file\n"
 				 "        -s|--source           source file\n"
 				 "        -b|--build            build index, needs -i and -s\n"
+				 "        -B|--bulk             with -b, sort the keys and build in one pass\n"
+				 "        -M|--memory MB        with --bulk, memory before spilling, default 64\n"
+				 "        -f|--filter           with -b, also save a key filter as INDEX.filter,\n"
+				 "                              answering most missing keys without the trie\n"
+				 "        -F|--filter-bits N    with --filter, bits per key, default 10\n"
+				 "        -u|--unify FIELD=FILE with -b, build a record lexicon merging the\n"
+				 "                              sources of its fields instead of -s, the keys\n"
+				 "                              saved as INDEX.keys; FIELD is one of freq, pos,\n"
+				 "                              combine, trailing, filter, break, id or df,\n"
+				 "                              FILE has \"VALUE KEY\" lines, or \"TAGS KEY\"\n"
+				 "                              for pos, such as \"n,vn KEY\"; repeatable.\n"
+				 "                              Load a field as INDEX:FIELD\n"
+				 "        -L|--lambda LAMBDA    with --unify, the ele_lambda of ugm_seg,\n"
+				 "                              which finds its estimates in the records\n"
+				 "                              built with the same one, default 0.5\n"
+				 "        -a|--ac               with -b and -t datrie, also save the links of\n"
+				 "                              an Aho-Corasick automaton as INDEX.ac, for\n"
+				 "                              the ac_match processor\n"
 				 "        -d|--dump             dump index, needs -i\n"
 				 "        -q|--query QUERY      query index, needs -i\n"
-				 "        -t|--type TYPE        index type, default = DATrie\n"
+				 "        -p|--predict PREFIX   keys starting with PREFIX, highest values\n"
+				 "                              first, needs -i\n"
+				 "        -l|--limit N          with --predict, at most N keys, default 10\n"
+				 "        -t|--type TYPE        index type: compact_trie (v2, default),\n"
+				 "                              codepoint_trie (v2, a transition per\n"
+				 "                              character, for CJK keys),\n"
+				 "                              succinct (v2, read-only, a few times\n"
+				 "                              smaller, slower lookups),\n"
+				 "                              datrie or double_array (v1, in\n"
+				 "                              64 bits when the source needs it)\n"
 				 "        -n|--info             index information, needs -i\n"
 				 "        -v|--verbose          verbose\n"
 				 "\n"
@@ -98,15 +252,21 @@ static void _help_message()
 int main(int argc, char *argv[])
 {
 	int c;
-	const char default_type[] = "datrie";
+	const char default_type[] = "compact_trie";
 	const char *index = NULL, *source = NULL, *query = NULL, *type = default_type, *dump = NULL;
-	bool verbose = false;
+	const char *prefix = NULL;
+	bool verbose = false, bulk = false, filter = false, ac = false;
+	std::vector<const char *> sources;
+	size_t memory = 64, limit = 10;
+	int filter_bits = 10;
+	double lambda = 0.5;
 	enum action_t {
 		ACTION_NO = 0,
 		ACTION_BUILD = 1,
 		ACTION_DUMP = 2,
 		ACTION_QUERY = 3,
-		ACTION_INFO = 4
+		ACTION_INFO = 4,
+		ACTION_PREDICT = 5
 	} action = ACTION_NO;
 	
 	while (true) {
@@ -114,8 +274,17 @@ int main(int argc, char *argv[])
 		{
 			{"help", no_argument, 0, 'h'},
 			{"build", no_argument, 0, 'b'},
+			{"bulk", no_argument, 0, 'B'},
+			{"memory", required_argument, 0, 'M'},
+			{"filter", no_argument, 0, 'f'},
+			{"filter-bits", required_argument, 0, 'F'},
+			{"ac", no_argument, 0, 'a'},
+			{"unify", required_argument, 0, 'u'},
+			{"lambda", required_argument, 0, 'L'},
 			{"dump", required_argument, 0, 'd'},
 			{"query", required_argument, 0, 'q'},
+			{"predict", required_argument, 0, 'p'},
+			{"limit", required_argument, 0, 'l'},
 			{"index", required_argument, 0, 'i'},
 			{"source", required_argument, 0, 's'},
 			{"type", required_argument, 0, 't'},
@@ -125,7 +294,7 @@ int main(int argc, char *argv[])
 		};
 		int option_index;
 		
-		c = getopt_long(argc, argv, "hbd:q:i:s:t:nv", long_options, &option_index);
+		c = getopt_long(argc, argv, "hbBM:fF:au:L:d:q:p:l:i:s:t:nv", long_options, &option_index);
 		if (c == -1) break;
 
 		switch(c) {
@@ -135,6 +304,27 @@ int main(int argc, char *argv[])
 			case 'b':
 				action = ACTION_BUILD;
 				break;
+			case 'B':
+				bulk = true;
+				break;
+			case 'M':
+				memory = atoi(optarg);
+				break;
+			case 'f':
+				filter = true;
+				break;
+			case 'F':
+				filter_bits = atoi(optarg);
+				break;
+			case 'a':
+				ac = true;
+				break;
+			case 'u':
+				sources.push_back(optarg);
+				break;
+			case 'L':
+				lambda = atof(optarg);
+				break;
 			case 'd':
 				action = ACTION_DUMP;
 				dump = optarg;
@@ -146,6 +336,13 @@ int main(int argc, char *argv[])
 				action = ACTION_QUERY;
 				query = optarg;
 				break;
+			case 'p':
+				action = ACTION_PREDICT;
+				prefix = optarg;
+				break;
+			case 'l':
+				limit = atoi(optarg);
+				break;
 			case 'i':
 				index = optarg;
 				break;
@@ -162,10 +359,16 @@ int main(int argc, char *argv[])
 
 	}
 
-	if (action == ACTION_BUILD && index && source && type) {
-		_build(source, index, type, verbose);
+	if (action == ACTION_BUILD && index && type && !sources.empty()) {
+		_build_records(sources, index, type, memory << 20, (filter)?filter_bits:0, lambda, verbose);
+	} else if (action == ACTION_BUILD && index && source && type && bulk) {
+		_build_bulk(source, index, type, memory << 20, (filter)?filter_bits:0, ac, verbose);
+	} else if (action == ACTION_BUILD && index && source && type) {
+		_build(source, index, type, (filter)?filter_bits:0, ac, verbose);
 	} else if (action == ACTION_QUERY && index && query) {
 		_query(index, query);
+	} else if (action == ACTION_PREDICT && index && prefix) {
+		_predict(index, prefix, limit);
 	} else if (action == ACTION_DUMP && index && dump) {
 		_dump(index, dump);
 	} else if (action == ACTION_INFO && index) {
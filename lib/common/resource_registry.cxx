@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2008, detrox@gmail.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <organization> nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY detrox@gmail.com ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL detrox@gmail.com BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <limits.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#include "resource_registry.hxx"
+
+namespace bamboo {
+
+ResourceRegistry	*ResourceRegistry::_instance = NULL;
+pthread_mutex_t		ResourceRegistry::_instance_lock = PTHREAD_MUTEX_INITIALIZER;
+
+ResourceRegistry::ResourceRegistry()
+{
+	pthread_mutexattr_t attr;
+
+	/* recursive: a loader may acquire the resources its own is made of */
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(&_lock, &attr);
+	pthread_mutexattr_destroy(&attr);
+}
+
+ResourceRegistry *ResourceRegistry::get_instance()
+{
+	pthread_mutex_lock(&_instance_lock);
+	if (_instance == NULL)
+		_instance = new ResourceRegistry();
+	pthread_mutex_unlock(&_instance_lock);
+
+	return _instance;
+}
+
+void *ResourceRegistry::acquire(const char *kind, const char *filename, const char *arg,
+		loader_t load, unloader_t unload)
+{
+	char path[PATH_MAX], mtime[32];
+	struct stat buf;
+	std::string key;
+	std::map<std::string, _entry_t *>::iterator it;
+	_entry_t *entry;
+	void *resource;
+
+	if (filename == NULL)
+		throw std::runtime_error("no resource specified");
+	if (stat(filename, &buf) != 0 || realpath(filename, path) == NULL)
+		throw std::runtime_error(std::string("can not load ") + filename + ": " + strerror(errno));
+	snprintf(mtime, sizeof(mtime), "%ld", (long)buf.st_mtime);
+
+	key.append(kind).append(1, '\0');
+	key.append(path).append(1, '\0');
+	key.append(mtime).append(1, '\0');
+	if (arg) key.append(arg);
+
+	pthread_mutex_lock(&_lock);
+	it = _by_key.find(key);
+	if (it != _by_key.end()) {
+		it->second->refcount++;
+		resource = it->second->resource;
+		pthread_mutex_unlock(&_lock);
+		return resource;
+	}
+
+	/* load under the lock, so racing callers never load the same file twice */
+	try {
+		resource = load(path, arg);
+	} catch (...) {
+		pthread_mutex_unlock(&_lock);
+		throw;
+	}
+	if (resource == NULL) {
+		pthread_mutex_unlock(&_lock);
+		throw std::runtime_error(std::string("can not load ") + filename);
+	}
+
+	entry = new _entry_t;
+	entry->key = key;
+	entry->resource = resource;
+	entry->unload = unload;
+	entry->refcount = 1;
+	_by_key[key] = entry;
+	_by_resource[resource] = entry;
+	pthread_mutex_unlock(&_lock);
+
+	return resource;
+}
+
+void ResourceRegistry::retain(void *resource)
+{
+	std::map<void *, _entry_t *>::iterator it;
+
+	pthread_mutex_lock(&_lock);
+	it = _by_resource.find(resource);
+	if (it != _by_resource.end())
+		it->second->refcount++;
+	pthread_mutex_unlock(&_lock);
+}
+
+void ResourceRegistry::release(void *resource)
+{
+	std::map<void *, _entry_t *>::iterator it;
+	_entry_t *entry = NULL;
+
+	if (resource == NULL) return;
+	pthread_mutex_lock(&_lock);
+	it = _by_resource.find(resource);
+	if (it != _by_resource.end() && --(it->second->refcount) == 0) {
+		entry = it->second;
+		_by_resource.erase(it);
+		_by_key.erase(entry->key);
+	}
+	pthread_mutex_unlock(&_lock);
+
+	if (entry) {
+		entry->unload(entry->resource);
+		delete entry;
+	}
+}
+
+size_t ResourceRegistry::size()
+{
+	size_t n;
+
+	pthread_mutex_lock(&_lock);
+	n = _by_key.size();
+	pthread_mutex_unlock(&_lock);
+
+	return n;
+}
+
+} /* namespace bamboo */
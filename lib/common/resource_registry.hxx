@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2008, detrox@gmail.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <organization> nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY detrox@gmail.com ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL detrox@gmail.com BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef RESOURCE_REGISTRY_HXX
+#define RESOURCE_REGISTRY_HXX
+
+#include <pthread.h>
+#include <map>
+#include <string>
+
+namespace bamboo {
+
+/*
+ * Process-wide table of read-only resources loaded from files (lexicons,
+ * CRF models). Resources are keyed by kind, canonical path and mtime, so
+ * every user of the same file shares one loaded copy until the last
+ * reference is released. A file replaced on disk gets a new entry while
+ * holders of the old one keep using it.
+ */
+class ResourceRegistry
+{
+public:
+	typedef void *(*loader_t)(const char *filename, const char *arg);
+	typedef void (*unloader_t)(void *resource);
+
+	static ResourceRegistry *get_instance();
+
+	void *acquire(const char *kind, const char *filename, const char *arg,
+			loader_t load, unloader_t unload);
+	void retain(void *resource);
+	void release(void *resource);
+	size_t size();
+
+private:
+	struct _entry_t {
+		std::string key;
+		void *resource;
+		unloader_t unload;
+		size_t refcount;
+	};
+
+	static ResourceRegistry		*_instance;
+	static pthread_mutex_t		_instance_lock;
+
+	pthread_mutex_t _lock;
+	std::map<std::string, _entry_t *> _by_key;
+	std::map<void *, _entry_t *> _by_resource;
+
+	ResourceRegistry();
+	ResourceRegistry(const ResourceRegistry &);
+	ResourceRegistry& operator= (const ResourceRegistry &);
+};
+
+} /* namespace bamboo */
+
+#endif /* RESOURCE_REGISTRY_HXX */
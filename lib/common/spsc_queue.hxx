@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2008, detrox@gmail.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <organization> nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY detrox@gmail.com ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL detrox@gmail.com BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef SPSC_QUEUE_HXX
+#define SPSC_QUEUE_HXX
+
+#include <pthread.h>
+#include <cstddef>
+
+namespace bamboo {
+
+/*
+ * Bounded lock-free queue between exactly one producer thread and one
+ * consumer thread. push() and pop() spin a little while the queue is
+ * full or empty, then sleep until the other side makes room or hands
+ * over a value, which throttles a fast producer to its consumer.
+ */
+template <class T>
+class SPSCQueue
+{
+public:
+	SPSCQueue(size_t capacity)
+	:_size(capacity + 1), _head(0), _tail(0), _sleepers(0)
+	{
+		_ring = new T[_size];
+		pthread_mutex_init(&_lock, NULL);
+		pthread_cond_init(&_cond, NULL);
+	}
+
+	~SPSCQueue()
+	{
+		pthread_cond_destroy(&_cond);
+		pthread_mutex_destroy(&_lock);
+		delete [] _ring;
+	}
+
+	bool try_push(const T &val)
+	{
+		size_t tail = _tail, next = (tail + 1) % _size;
+
+		if (next == __atomic_load_n(&_head, __ATOMIC_ACQUIRE)) return false;
+		_ring[tail] = val;
+		__atomic_store_n(&_tail, next, __ATOMIC_RELEASE);
+		return true;
+	}
+
+	bool try_pop(T &val)
+	{
+		size_t head = _head;
+
+		if (head == __atomic_load_n(&_tail, __ATOMIC_ACQUIRE)) return false;
+		val = _ring[head];
+		__atomic_store_n(&_head, (head + 1) % _size, __ATOMIC_RELEASE);
+		return true;
+	}
+
+	void push(const T &val)
+	{
+		size_t spins;
+
+		for (spins = 0; !try_push(val); spins++) {
+			if (spins < _spins) continue;
+			pthread_mutex_lock(&_lock);
+			__atomic_add_fetch(&_sleepers, 1, __ATOMIC_SEQ_CST);
+			while (!try_push(val))
+				pthread_cond_wait(&_cond, &_lock);
+			__atomic_sub_fetch(&_sleepers, 1, __ATOMIC_SEQ_CST);
+			pthread_mutex_unlock(&_lock);
+			break;
+		}
+		_wake();
+	}
+
+	void pop(T &val)
+	{
+		size_t spins;
+
+		for (spins = 0; !try_pop(val); spins++) {
+			if (spins < _spins) continue;
+			pthread_mutex_lock(&_lock);
+			__atomic_add_fetch(&_sleepers, 1, __ATOMIC_SEQ_CST);
+			while (!try_pop(val))
+				pthread_cond_wait(&_cond, &_lock);
+			__atomic_sub_fetch(&_sleepers, 1, __ATOMIC_SEQ_CST);
+			pthread_mutex_unlock(&_lock);
+			break;
+		}
+		_wake();
+	}
+
+private:
+	static const size_t _cache_line = 64;
+	static const size_t _spins = 256;
+
+	T *_ring;
+	size_t _size;
+	char _pad0[_cache_line];
+	size_t _head;
+	char _pad1[_cache_line];
+	size_t _tail;
+	char _pad2[_cache_line];
+	/* threads asleep in push() or pop(), woken by the other side */
+	size_t _sleepers;
+	pthread_mutex_t _lock;
+	pthread_cond_t _cond;
+
+	/* the head or tail just moved: wake the other side if it sleeps */
+	void _wake()
+	{
+		__atomic_thread_fence(__ATOMIC_SEQ_CST);
+		if (__atomic_load_n(&_sleepers, __ATOMIC_RELAXED) == 0) return;
+		pthread_mutex_lock(&_lock);
+		pthread_cond_broadcast(&_cond);
+		pthread_mutex_unlock(&_lock);
+	}
+
+	SPSCQueue(const SPSCQueue &);
+	SPSCQueue& operator= (const SPSCQueue &);
+};
+
+} /* namespace bamboo */
+
+#endif /* SPSC_QUEUE_HXX */
@@ -0,0 +1,178 @@
+/*
+ * Copyright (c) 2008, detrox@gmail.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <organization> nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY detrox@gmail.com ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL detrox@gmail.com BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <sys/time.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+#include "stats.hxx"
+
+namespace bamboo {
+
+Stats			*Stats::_instance = NULL;
+pthread_mutex_t	Stats::_instance_lock = PTHREAD_MUTEX_INITIALIZER;
+volatile bool	Stats::_enabled = (getenv("BAMBOO_STATS") != NULL);
+
+Stats::Stats()
+{
+	pthread_mutex_init(&_lock, NULL);
+}
+
+Stats *Stats::get_instance()
+{
+	pthread_mutex_lock(&_instance_lock);
+	if (_instance == NULL)
+		_instance = new Stats();
+	pthread_mutex_unlock(&_instance_lock);
+
+	return _instance;
+}
+
+size_t Stats::now()
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return (size_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+void Stats::add(latency_t *latency, size_t usec)
+{
+	size_t i;
+
+	for (i = 0; i < num_buckets - 1 && usec >= ((size_t)1 << i); i++);
+	__sync_fetch_and_add(&latency->calls, 1);
+	__sync_fetch_and_add(&latency->usec, usec);
+	__sync_fetch_and_add(&latency->buckets[i], 1);
+}
+
+/* map nodes never move, so the returned pointers stay valid */
+size_t *Stats::counter(const std::string &name)
+{
+	size_t *p;
+
+	pthread_mutex_lock(&_lock);
+	p = &_counters[name];
+	pthread_mutex_unlock(&_lock);
+
+	return p;
+}
+
+Stats::latency_t *Stats::latency(const std::string &name)
+{
+	std::map<std::string, latency_t>::iterator it;
+	latency_t *p;
+
+	pthread_mutex_lock(&_lock);
+	it = _latencies.find(name);
+	if (it == _latencies.end()) {
+		it = _latencies.insert(std::make_pair(name, latency_t())).first;
+		memset(&it->second, 0, sizeof(latency_t));
+	}
+	p = &it->second;
+	pthread_mutex_unlock(&_lock);
+
+	return p;
+}
+
+static size_t _percentile(const Stats::latency_t &latency, size_t pct)
+{
+	size_t i, n = 0, rank = (latency.calls * pct + 99) / 100;
+
+	for (i = 0; i < Stats::num_buckets - 1; i++) {
+		n += latency.buckets[i];
+		if (n >= rank) break;
+	}
+	return (size_t)1 << i;
+}
+
+/*
+ * One metric per line: "name value" for counters, with a hit_rate line
+ * derived from every name.lookups and name.hits pair; for latencies the
+ * call count, total and the bucket bounds of the 50th and 99th
+ * percentiles in microseconds, then the non-empty buckets as
+ * bound:count. Latencies never recorded are left out.
+ */
+void Stats::dump(std::string &out)
+{
+	std::map<std::string, size_t>::iterator it, hits;
+	std::map<std::string, latency_t>::iterator lt;
+	std::ostringstream oss;
+	std::string prefix;
+	size_t i, lookups, suffix = strlen(".lookups");
+	char rate[32];
+
+	pthread_mutex_lock(&_lock);
+	for (it = _counters.begin(); it != _counters.end(); it++) {
+		oss << it->first << " " << it->second << std::endl;
+		if (it->first.size() <= suffix
+				|| it->first.compare(it->first.size() - suffix, suffix, ".lookups") != 0)
+			continue;
+		prefix = it->first.substr(0, it->first.size() - suffix);
+		hits = _counters.find(prefix + ".hits");
+		lookups = it->second;
+		if (hits == _counters.end() || lookups == 0) continue;
+		snprintf(rate, sizeof(rate), "%.4f", (double)hits->second / lookups);
+		oss << prefix << ".hit_rate " << rate << std::endl;
+	}
+	for (lt = _latencies.begin(); lt != _latencies.end(); lt++) {
+		const latency_t &latency = lt->second;
+
+		if (latency.calls == 0) continue;
+		oss << lt->first << " calls=" << latency.calls << " usec=" << latency.usec
+			<< " p50<" << _percentile(latency, 50) << " p99<" << _percentile(latency, 99);
+		for (i = 0; i < num_buckets; i++) {
+			if (latency.buckets[i] == 0) continue;
+			if (i < num_buckets - 1)
+				oss << " " << ((size_t)1 << i) << ":" << latency.buckets[i];
+			else
+				oss << " inf:" << latency.buckets[i];
+		}
+		oss << std::endl;
+	}
+	pthread_mutex_unlock(&_lock);
+
+	out = oss.str();
+}
+
+void Stats::reset()
+{
+	std::map<std::string, size_t>::iterator it;
+	std::map<std::string, latency_t>::iterator lt;
+
+	pthread_mutex_lock(&_lock);
+	for (it = _counters.begin(); it != _counters.end(); it++)
+		it->second = 0;
+	for (lt = _latencies.begin(); lt != _latencies.end(); lt++)
+		memset(&lt->second, 0, sizeof(latency_t));
+	pthread_mutex_unlock(&_lock);
+}
+
+} /* namespace bamboo */
@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2008, detrox@gmail.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <organization> nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY detrox@gmail.com ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL detrox@gmail.com BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef STATS_HXX
+#define STATS_HXX
+
+#include <pthread.h>
+#include <map>
+#include <string>
+
+namespace bamboo {
+
+/*
+ * Process-wide runtime metrics: named counters and latency histograms,
+ * updated from any thread. Users look their metrics up once and keep
+ * the pointers; recording costs a test of enabled() while switched off.
+ * Set the BAMBOO_STATS environment variable to switch them on at start.
+ */
+class Stats
+{
+public:
+	/* bucket i counts calls under 2^i microseconds, the last one the rest */
+	static const size_t num_buckets = 24;
+
+	typedef struct {
+		size_t calls, usec;
+		size_t buckets[num_buckets];
+	} latency_t;
+
+	static Stats *get_instance();
+
+	static bool enabled()
+	{
+		return _enabled;
+	}
+
+	static void enable(bool on)
+	{
+		_enabled = on;
+	}
+
+	static size_t now();
+
+	static void add(size_t *counter, size_t n)
+	{
+		__sync_fetch_and_add(counter, n);
+	}
+
+	static void add(latency_t *latency, size_t usec);
+
+	size_t *counter(const std::string &name);
+	latency_t *latency(const std::string &name);
+	void dump(std::string &out);
+	void reset();
+
+private:
+	static Stats			*_instance;
+	static pthread_mutex_t	_instance_lock;
+	static volatile bool	_enabled;
+
+	pthread_mutex_t _lock;
+	std::map<std::string, size_t> _counters;
+	std::map<std::string, latency_t> _latencies;
+
+	Stats();
+	Stats(const Stats &);
+	Stats& operator= (const Stats &);
+};
+
+/* records the lifetime of a scope into a latency, when stats are on */
+class StatsTimer
+{
+public:
+	StatsTimer(Stats::latency_t *latency)
+	:_latency((Stats::enabled())?latency:NULL), _start((_latency)?Stats::now():0)
+	{
+	}
+
+	~StatsTimer()
+	{
+		if (_latency) Stats::add(_latency, Stats::now() - _start);
+	}
+
+private:
+	Stats::latency_t *_latency;
+	size_t _start;
+};
+
+} /* namespace bamboo */
+
+#endif /* STATS_HXX */
@@ -1,6 +1,8 @@
 #ifndef TOKEN_HXX
 #define TOKEN_HXX
 
+#include <cstddef>
+
 namespace bamboo {
 
 class Token {
@@ -10,6 +12,13 @@ public:
 	Token& operator=(const Token &rhs);
 	virtual const char *get_orig_token() const = 0; 
 	virtual unsigned short get_pos() const = 0;
+	virtual int get_attr() const = 0;
+	/* byte and character offsets of the token in the parsed text,
+	 * end excluded */
+	virtual size_t get_begin() const = 0;
+	virtual size_t get_end() const = 0;
+	virtual size_t get_char_begin() const = 0;
+	virtual size_t get_char_end() const = 0;
 	virtual ~Token() {};
 };
 
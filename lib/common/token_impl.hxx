@@ -33,11 +33,59 @@
 #include <cstring>
 
 #include "token.hxx"
+#include "token_pool.hxx"
 #include "utf8.hxx"
 
 namespace bamboo {
 
+class RecordLexicon;
+
 class TokenImpl:public Token {
+public:
+	/* where a token came from: [begin, end) in bytes and in characters
+	 * of the parsed text */
+	class span_t {
+	public:
+		size_t begin, end;
+		size_t char_begin, char_end;
+
+		span_t():begin(0), end(0), char_begin(0), char_end(0) {}
+		span_t(size_t b, size_t e, size_t cb, size_t ce)
+			:begin(b), end(e), char_begin(cb), char_end(ce) {}
+		bool empty() const
+		{
+			return end == begin;
+		}
+		void clear()
+		{
+			begin = end = char_begin = char_end = 0;
+		}
+		/* grow to cover rhs as well, used when tokens are merged */
+		void join(const span_t &rhs)
+		{
+			if (empty()) {
+				*this = rhs;
+			} else {
+				if (rhs.begin < begin) {
+					begin = rhs.begin;
+					char_begin = rhs.char_begin;
+				}
+				if (rhs.end > end) {
+					end = rhs.end;
+					char_end = rhs.char_end;
+				}
+			}
+		}
+		/* the span of length characters from start of text, which is
+		 * the text covered by this span */
+		span_t sub(const char *text, size_t start, size_t length) const
+		{
+			size_t b = utf8::locate(text, start);
+			size_t e = b + utf8::locate(text + b, length);
+			return span_t(begin + b, begin + e, char_begin + start, char_begin + start + length);
+		}
+	};
+
 protected:
 	char *_orig_token, *_token;
 	int _attr;
@@ -45,6 +93,9 @@ protected:
 	size_t _bytes, _orig_bytes;
 	unsigned short _pos;
 	size_t refcount;
+	span_t _span;
+	const RecordLexicon *_records;
+	int _record;
 public:
 	enum attr_t {
 		attr_unknow = 0,
@@ -56,19 +107,22 @@ public:
 	};
 	TokenImpl()
 		:_orig_token(NULL), _token(NULL), _attr(attr_unknow), _length(0), 
-		_orig_length(0), _bytes(0), _orig_bytes(0), _pos(0), refcount(0)
+		_orig_length(0), _bytes(0), _orig_bytes(0), _pos(0), refcount(0),
+		_records(NULL), _record(0)
 	{
 	}
 	TokenImpl(const char *s, const char *os, int attr = attr_unknow)
 		:_orig_token(NULL), _token(NULL), _attr(attr), _length(0), 
-		_orig_length(0), _bytes(0), _orig_bytes(0), _pos(0), refcount(0)
+		_orig_length(0), _bytes(0), _orig_bytes(0), _pos(0), refcount(0),
+		_records(NULL), _record(0)
 	{
 		set_token(s);
 		set_orig_token(os);
 	}
 	TokenImpl(const char *s, int attr = attr_unknow)
 		:_orig_token(NULL),_token(NULL),  _attr(attr), _length(0), 
-		_orig_length(0), _bytes(0), _orig_bytes(0), _pos(0), refcount(0)
+		_orig_length(0), _bytes(0), _orig_bytes(0), _pos(0), refcount(0),
+		_records(NULL), _record(0)
 	{
 		set_token(s);
 	}
@@ -83,19 +137,30 @@ public:
 		_orig_length = rhs._orig_length;
 		_bytes = rhs._bytes;
 		_orig_bytes = rhs._orig_bytes;
+		_span = rhs._span;
+		_records = rhs._records;
+		_record = rhs._record;
 	}
 
 	~TokenImpl()
 	{
 		if (_token) {
-			free(_token);
+			TokenPool::free(_token);
 			_token = NULL;
 		}
 		if(_orig_token) {
-			free(_orig_token);
+			TokenPool::free(_orig_token);
 			_orig_token = NULL;
 		}
 	}
+	static void *operator new(size_t size)
+	{
+		return TokenPool::alloc(size);
+	}
+	static void operator delete(void *p)
+	{
+		TokenPool::free(p);
+	}
 	int get_attr() const 
 	{
 		return _attr;
@@ -109,10 +174,9 @@ public:
 		assert(s);
 		
 		if (_token) 
-			free(_token);
-		_token = strdup(s);
-		if (!_token)
-			throw std::bad_alloc();
+			TokenPool::free(_token);
+		_token = TokenPool::strdup(s);
+		_records = NULL;
 	}
 	const char *get_orig_token() const
 	{
@@ -123,10 +187,8 @@ public:
 		assert(s);
 
 		if (_orig_token) 
-			free(_orig_token);
-		_orig_token = strdup(s);
-		if (!_orig_token)
-			throw std::bad_alloc();
+			TokenPool::free(_orig_token);
+		_orig_token = TokenPool::strdup(s);
 	}
 	void set_attr(int attr) 
 	{
@@ -182,6 +244,52 @@ public:
 	{
 		return _pos;
 	}
+	const span_t &get_span() const
+	{
+		return _span;
+	}
+	void set_span(const span_t &span)
+	{
+		_span = span;
+	}
+	/* span of length characters of token, starting at character start */
+	void set_span(const TokenImpl *token, size_t start, size_t length)
+	{
+		_span = token->_span.sub(token->get_orig_token(), start, length);
+	}
+	size_t get_begin() const
+	{
+		return _span.begin;
+	}
+	size_t get_end() const
+	{
+		return _span.end;
+	}
+	size_t get_char_begin() const
+	{
+		return _span.char_begin;
+	}
+	size_t get_char_end() const
+	{
+		return _span.char_end;
+	}
+	/* the record lexicon get_token() was looked up in, see
+	 * RecordLexicon::resolve(), or NULL */
+	const RecordLexicon *get_records() const
+	{
+		return _records;
+	}
+	/* the number of its record in records, 0 if it has none, or -1 if
+	 * it was not looked up there */
+	int get_record(const RecordLexicon *records) const
+	{
+		return (records && records == _records)?_record:-1;
+	}
+	void set_record(const RecordLexicon *records, int id)
+	{
+		_records = records;
+		_record = id;
+	}
 	size_t incref()
 	{
 		return ++refcount;
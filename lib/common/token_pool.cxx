@@ -0,0 +1,246 @@
+/*
+ * Copyright (c) 2008, detrox@gmail.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <organization> nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY detrox@gmail.com ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL detrox@gmail.com BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <pthread.h>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include "token_pool.hxx"
+
+namespace bamboo {
+
+/* classes of 16, 32, ..., max_size bytes */
+static const size_t _num_classes = 13;
+static const size_t _chunks_per_block = 64;
+static const size_t _block_size = 32768;
+
+typedef struct _pool _pool_t;
+
+typedef struct _chunk {
+	union {
+		struct _chunk *next;	/* while free */
+		_pool_t *owner;		/* while in use */
+		double align;
+	};
+	size_t cls;
+} _chunk_t;
+
+/*
+ * The free lists of a thread. Chunks freed by other threads are pushed
+ * onto the remote list of the pool they came from and taken back by its
+ * thread when a list runs dry. A pool outlives its thread: its lists go
+ * to the orphans shared by all threads, and the pool itself waits for
+ * the next thread to start, taking in the chunks still freed to it.
+ */
+struct _pool {
+	_chunk_t *free_list[_num_classes];
+	_chunk_t *remote;
+	_pool_t *next;
+};
+
+static __thread _pool_t *_pool;
+
+static _pool_t *_idle_pools;
+static _chunk_t *_orphans[_num_classes];
+static pthread_mutex_t _orphans_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t _thread_key;
+static pthread_once_t _thread_key_once = PTHREAD_ONCE_INIT;
+static size_t _allocations;
+
+static size_t _class_size(size_t cls)
+{
+	return (size_t)16 << cls;
+}
+
+static size_t _size_class(size_t size)
+{
+	size_t cls = 0;
+
+	while (_class_size(cls) < size) cls++;
+	return cls;
+}
+
+/* take back the chunks other threads freed */
+static void _drain(_pool_t *pool)
+{
+	_chunk_t *p, *next;
+
+	p = __sync_lock_test_and_set(&pool->remote, (_chunk_t *)NULL);
+	for (; p; p = next) {
+		next = p->next;
+		p->next = pool->free_list[p->cls];
+		pool->free_list[p->cls] = p;
+	}
+}
+
+/* hand the free lists of an exiting thread over to the next threads */
+static void _on_thread_exit(void *arg)
+{
+	_pool_t *pool = (_pool_t *)arg;
+	_chunk_t *p;
+	size_t cls;
+
+	_pool = NULL;
+	_drain(pool);
+	pthread_mutex_lock(&_orphans_lock);
+	for (cls = 0; cls < _num_classes; cls++) {
+		while ((p = pool->free_list[cls]) != NULL) {
+			pool->free_list[cls] = p->next;
+			p->next = _orphans[cls];
+			_orphans[cls] = p;
+		}
+	}
+	pool->next = _idle_pools;
+	_idle_pools = pool;
+	pthread_mutex_unlock(&_orphans_lock);
+}
+
+static void _create_thread_key()
+{
+	pthread_key_create(&_thread_key, _on_thread_exit);
+}
+
+static _pool_t *_this_pool()
+{
+	if (_pool) return _pool;
+
+	pthread_once(&_thread_key_once, _create_thread_key);
+	pthread_mutex_lock(&_orphans_lock);
+	if (_idle_pools) {
+		_pool = _idle_pools;
+		_idle_pools = _pool->next;
+	}
+	pthread_mutex_unlock(&_orphans_lock);
+
+	if (_pool == NULL) {
+		_pool = (_pool_t *)calloc(1, sizeof(_pool_t));
+		if (_pool == NULL) throw std::bad_alloc();
+		__sync_fetch_and_add(&_allocations, 1);
+	}
+	pthread_setspecific(_thread_key, _pool);
+	return _pool;
+}
+
+static void _refill(_pool_t *pool, size_t cls)
+{
+	size_t i, n, stride = sizeof(_chunk_t) + _class_size(cls);
+	char *block;
+	_chunk_t *p;
+
+	_drain(pool);
+	if (pool->free_list[cls]) return;
+
+	n = _block_size / stride;
+	if (n > _chunks_per_block) n = _chunks_per_block;
+	if (n < 1) n = 1;
+
+	/* a block's worth of orphans, so that the other threads get some too */
+	pthread_mutex_lock(&_orphans_lock);
+	for (i = 0; i < n && (p = _orphans[cls]) != NULL; i++) {
+		_orphans[cls] = p->next;
+		p->next = pool->free_list[cls];
+		pool->free_list[cls] = p;
+	}
+	pthread_mutex_unlock(&_orphans_lock);
+	if (pool->free_list[cls]) return;
+
+	block = (char *)malloc(stride * n);
+	if (block == NULL) throw std::bad_alloc();
+	__sync_fetch_and_add(&_allocations, 1);
+	for (i = 0; i < n; i++) {
+		p = (_chunk_t *)(block + i * stride);
+		p->cls = cls;
+		p->next = pool->free_list[cls];
+		pool->free_list[cls] = p;
+	}
+}
+
+void *TokenPool::alloc(size_t size)
+{
+	_pool_t *pool;
+	_chunk_t *p;
+	size_t cls;
+
+	if (size > max_size) {
+		p = (_chunk_t *)malloc(sizeof(_chunk_t) + size);
+		if (p == NULL) throw std::bad_alloc();
+		__sync_fetch_and_add(&_allocations, 1);
+		p->owner = NULL;
+		p->cls = _num_classes;
+		return p + 1;
+	}
+
+	pool = _this_pool();
+	cls = _size_class(size);
+	if (pool->free_list[cls] == NULL) _refill(pool, cls);
+	p = pool->free_list[cls];
+	pool->free_list[cls] = p->next;
+	p->owner = pool;
+	return p + 1;
+}
+
+void TokenPool::free(void *ptr)
+{
+	_pool_t *owner;
+	_chunk_t *p, *head;
+
+	if (ptr == NULL) return;
+	p = (_chunk_t *)ptr - 1;
+	if (p->cls == _num_classes) {
+		::free(p);
+		return;
+	}
+
+	owner = p->owner;
+	if (owner == _pool) {
+		p->next = owner->free_list[p->cls];
+		owner->free_list[p->cls] = p;
+		return;
+	}
+	do {
+		head = __atomic_load_n(&owner->remote, __ATOMIC_RELAXED);
+		p->next = head;
+	} while (!__sync_bool_compare_and_swap(&owner->remote, head, p));
+}
+
+char *TokenPool::strdup(const char *s)
+{
+	size_t size = strlen(s) + 1;
+	char *p = (char *)alloc(size);
+
+	memcpy(p, s, size);
+	return p;
+}
+
+size_t TokenPool::allocations()
+{
+	return __sync_fetch_and_add(&_allocations, 0);
+}
+
+} /* namespace bamboo */
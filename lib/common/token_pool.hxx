@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2008, detrox@gmail.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <organization> nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY detrox@gmail.com ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL detrox@gmail.com BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef TOKEN_POOL_HXX
+#define TOKEN_POOL_HXX
+
+#include <cstddef>
+
+namespace bamboo {
+
+/*
+ * Size-class free lists for tokens and their strings. Every thread
+ * keeps its own lists, and a chunk freed by another thread goes back
+ * to the lists it came from, so a warmed-up parser allocates nothing
+ * from the heap per parse, even when its tokens are freed by another
+ * thread; lists of exiting threads wait for the next threads. Blocks
+ * over max_size go to malloc().
+ */
+class TokenPool
+{
+public:
+	static const size_t max_size = 65536;
+
+	static void *alloc(size_t size);
+	static void free(void *p);
+	static char *strdup(const char *s);
+	/* number of heap allocations made so far, by all threads, malloc()
+	 * of blocks over max_size included */
+	static size_t allocations();
+
+private:
+	TokenPool();
+};
+
+} /* namespace bamboo */
+
+#endif /* TOKEN_POOL_HXX */
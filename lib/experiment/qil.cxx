@@ -26,12 +26,14 @@
  * 
  */
 
+#include <sys/stat.h>
 #include <string>
 #include <fstream>
 #include <iostream>
 #include <getopt.h>
 
 #include "datrie.hxx"
+#include "datrie_builder.hxx"
 
 class QueryInLog {
 protected:
@@ -56,12 +58,14 @@ protected:
 				  << std::endl;
 	}
 
+	template<class Trie, class Builder>
 	void _build()
 	{
 		std::fstream fs;
 		std::string s;
-		int val;
-		DATrie trie;
+		Trie trie;
+		/* repeated queries add up while sorting */
+		bamboo::KeySorter queries(64 << 20, 0, true);
 
 		if (_verbose)
 			std::cerr << "Building " << _index << " from " << _query_log << std::endl;
@@ -69,24 +73,32 @@ protected:
 		fs.open(_query_log.c_str(), std::fstream::in);
 		while (!fs.eof()) {
 			std::getline(fs, s);
-			if (!s.empty()) {
-				if ((val = trie.search(s.c_str())) > 0) {
-					trie.insert(s.c_str(), val + 1);
-				} else {
-					trie.insert(s.c_str(), 1);
-				}
-			}
+			if (!s.empty())
+				queries.add(s.c_str(), 1);
 		}
 		fs.close();
+		Builder(&trie).build(queries);
 		trie.save(_index.c_str());
 	}
 
+	/* a month of logs may outgrow the 32-bit format */
+	void _build()
+	{
+		struct stat buf;
+
+		if (stat(_query_log.c_str(), &buf) == 0 && bamboo::trie_needs_64(buf.st_size))
+			_build<bamboo::DATrie64, bamboo::DATrieBuilder64>();
+		else
+			_build<bamboo::DATrie, bamboo::DATrieBuilder>();
+	}
+
+	template<class Trie>
 	void _analyze()
 	{
 		std::fstream fs;
 		std::string s;
-		int val;
-		DATrie trie(_index.c_str());
+		long long val;
+		Trie trie(_index.c_str());
 
 		if (_verbose)
 			std::cerr << "Analyze " << _index << " by " << _query_file << std::endl;
@@ -103,6 +115,19 @@ protected:
 		fs.close();
 	}
 
+	/* the index tells its width by its magic */
+	void _analyze()
+	{
+		char magic[bamboo::DATrie::magic_size] = {0};
+		std::ifstream ifs(_index.c_str(), std::ios::binary);
+
+		ifs.read(magic, sizeof(magic));
+		if (bamboo::DATrie::wide(magic))
+			_analyze<bamboo::DATrie64>();
+		else
+			_analyze<bamboo::DATrie>();
+	}
+
 public:
 	QueryInLog(int argc, char *argv[])
 		:_verbose(false)
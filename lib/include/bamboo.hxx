@@ -1,6 +1,8 @@
 #ifndef BAMBOO_HXX
 #define BAMBOO_HXX
 
+#include <stddef.h>
+#include <sys/types.h>
 #include "bamboo_defs.h"
 
 #ifdef __cplusplus
@@ -12,12 +14,77 @@
 #ifdef __cplusplus
 extern "C" {
 #endif
+typedef struct bamboo_model bamboo_model_t;
+
+typedef struct {
+	size_t offset;			/* byte offset of the token in the text */
+	size_t length;			/* length of the token in bytes */
+	size_t char_offset;		/* the same in characters */
+	size_t char_length;
+	unsigned short pos;		/* part of speech, 0 if none */
+	unsigned short attr;	/* enum bamboo_attr */
+} bamboo_span_t;
+
 void *bamboo_init(const char *parser, const char *cfg);
 void bamboo_clean(void *handle);
 char *bamboo_parse(void *handle);
+
+/*
+ * Parse len bytes of text, which needs no NUL terminator, and describe
+ * each token by a span into it instead of copying the token out. At
+ * most cap spans are written to out. Returns the number of tokens,
+ * which is larger than cap when out was too small, or -1 on error.
+ */
+ssize_t bamboo_parse_spans(void *handle, const char *text, size_t len,
+		bamboo_span_t *out, size_t cap);
 const char *bamboo_strerror();
 const void *bamboo_getopt(void *handle, enum bamboo_option option);
 void bamboo_setopt(void *handle, enum bamboo_option option, void *arg);
+
+/*
+ * Streaming: text of any size is given in pieces to bamboo_stream_feed()
+ * and cb is called once per token as soon as the sentence holding it
+ * is complete; bamboo_stream_flush() parses whatever is left. Offsets
+ * in the spans count from the start of the stream. The stream uses the
+ * parser handle, which must not parse anything else until the stream
+ * is freed.
+ */
+typedef void (*bamboo_token_cb)(const char *token, const bamboo_span_t *span, void *arg);
+void *bamboo_stream_new(void *handle, bamboo_token_cb cb, void *arg);
+int bamboo_stream_feed(void *stream, const char *data, size_t len);
+int bamboo_stream_flush(void *stream);
+void bamboo_stream_free(void *stream);
+
+/*
+ * Parse n texts in parallel, results[i] receives what bamboo_parse()
+ * would return for texts[i] and must be freed by the caller. The pool
+ * size is set with BAMBOO_OPTION_THREADS (an int, 0 for one thread per
+ * online CPU). Returns 0, or -1 with every results[i] NULL on error.
+ */
+int bamboo_parse_batch(void *handle, const char **texts, size_t n, char **results);
+
+/*
+ * Shared models: bamboo_model_load() loads the lexicons and CRF models
+ * of a parser once, bamboo_session_new() returns a handle for
+ * bamboo_setopt(), bamboo_parse() and bamboo_clean() that reuses them.
+ * Sessions of one model may parse on different threads at the same
+ * time, one session per thread. Clean every session before
+ * bamboo_model_free().
+ */
+bamboo_model_t *bamboo_model_load(const char *parser, const char *cfg);
+void *bamboo_session_new(bamboo_model_t *model);
+void bamboo_model_free(bamboo_model_t *model);
+
+/*
+ * Runtime metrics: per processor latency histograms, tokens in and out
+ * and bytes, CRF tagging time and lexicon lookups and hit rates. They
+ * are off unless switched on here or by setting the BAMBOO_STATS
+ * environment variable. bamboo_getstats() returns them as text, one
+ * metric per line, to be freed by the caller.
+ */
+void bamboo_enable_stats(int on);
+char *bamboo_getstats();
+void bamboo_resetstats();
 #ifdef __cplusplus
 }
 #endif
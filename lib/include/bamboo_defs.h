@@ -3,7 +3,18 @@
 
 enum bamboo_option {
 	BAMBOO_OPTION_TEXT = 0,
-	BAMBOO_OPTION_TITLE
+	BAMBOO_OPTION_TITLE,
+	BAMBOO_OPTION_THREADS
+};
+
+/* same values as TokenImpl::attr_t */
+enum bamboo_attr {
+	BAMBOO_ATTR_UNKNOWN = 0,
+	BAMBOO_ATTR_NUMBER,
+	BAMBOO_ATTR_ALPHA,
+	BAMBOO_ATTR_CWORD,
+	BAMBOO_ATTR_PUNCT,
+	BAMBOO_ATTR_WHITESPACE
 };
 
 
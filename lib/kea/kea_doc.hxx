@@ -7,17 +7,23 @@
 #include <map>
 #include <set>
 
-namespace bamboo { namespace kea {
+namespace bamboo {
+
+class RecordLexicon;
+
+namespace kea {
 
 class YCToken {
 protected:
 	char * _token;
 	int _pos;
 	int _tok_id;
+	const RecordLexicon * _records;
+	int _record;
 
 public:
 	YCToken(const char * s = NULL, int p = 0, int tok = 0)
-		:_token(NULL),_pos(0),_tok_id(0)
+		:_token(NULL),_pos(0),_tok_id(0),_records(NULL),_record(0)
 	{
 		if(s) _token = strdup(s);
 		_pos = p;
@@ -31,7 +37,7 @@ public:
 	}
 
 	YCToken(const YCToken& t)
-		:_token(NULL),_pos(0),_tok_id(0)
+		:_token(NULL),_pos(0),_tok_id(0),_records(t._records),_record(t._record)
 	{
 		if(t._token) _token = strdup(t._token);
 		_pos = t._pos;
@@ -47,6 +53,7 @@ public:
 		if(_token) free(_token);
 		if(s) _token = strdup(s);
 		else _token = NULL;
+		_records = NULL;
 	}
 
 	void set_pos(int p) {
@@ -69,6 +76,16 @@ public:
 		return _tok_id;
 	}
 
+	//the record of the token in records, as TokenImpl::get_record()
+	int get_record(const RecordLexicon * records) const {
+		return (records && records == _records) ? _record : -1;
+	}
+
+	void set_record(const RecordLexicon * records, int id) {
+		_records = records;
+		_record = id;
+	}
+
 };
 
 class YCSentence {
@@ -102,6 +119,7 @@ public:
 
 	std::vector<YCSentence *> sent_list;
 	std::map<int, char *> token_id_map;
+	std::map<int, double> token_idf;
 	std::set<int> token_in_title;
 	std::set<int> token_ner;
 	oov_map oov_token;
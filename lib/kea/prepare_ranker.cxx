@@ -31,14 +31,32 @@ void PrepareRanker::rank(YCDoc & doc, std::map<int, double> & token_rank, int to
 	std::map<int, int>::iterator iter;
 	int total_occ = 0;
 
+	//the ids and dfs of the whole document, looked up as one batch
+	std::vector<YCToken *> tokens;
+	std::vector<int> ids, dfs;
 	std::vector<YCSentence *>::iterator ycs_it
 		= doc.sent_list.begin();
 	for(; ycs_it != doc.sent_list.end(); ++ycs_it) {
+		std::vector<YCToken *>::iterator yct_it
+			= (*ycs_it)->token_list.begin();
+		for(; yct_it != (*ycs_it)->token_list.end(); ++yct_it) {
+			tokens.push_back(*yct_it);
+		}
+	}
+	ids.resize(tokens.size());
+	dfs.resize(tokens.size());
+	if(!tokens.empty()) {
+		_token_dict->get_ids(&tokens[0], tokens.size(), &ids[0], &dfs[0]);
+	}
+
+	size_t tok_idx = 0;
+	for(ycs_it = doc.sent_list.begin(); ycs_it != doc.sent_list.end(); ++ycs_it) {
 		std::vector<YCToken *>::iterator yct_it
 			= (*ycs_it)->token_list.begin();
 		for(; yct_it != (*ycs_it)->token_list.end(); ++yct_it) {
 			tok = *yct_it;
-			int tok_id = _token_dict->get_id(tok->get_token());
+			int df = dfs[tok_idx];
+			int tok_id = ids[tok_idx++];
 			if(tok_id == 0) {
 				YCDoc::oov_map::iterator om_it
 					= oov_token.lower_bound(tok->get_token());
@@ -59,6 +77,7 @@ void PrepareRanker::rank(YCDoc & doc, std::map<int, double> & token_rank, int to
 				|| tim_it->first != tok_id) {
 				token_id_map.insert(tim_it,
 					std::make_pair(tok_id, tok->get_token()));
+				doc.token_idf[tok_id] = _token_dict->get_idf_by_df(df);
 			}
 
 			token_num_occ[tok_id] += 1;
@@ -92,6 +111,7 @@ void PrepareRanker::rank(YCDoc & doc, std::map<int, double> & token_rank, int to
 
 	int tok_id, num_occ, first_occ;
 	double weight;
+
 	for(iter = token_num_occ.begin();
 			iter != token_num_occ.end(); ++iter) {
 
@@ -114,7 +134,7 @@ void PrepareRanker::rank(YCDoc & doc, std::map<int, double> & token_rank, int to
 		if(doc.token_ner.count(tok_id) > 0)
 			weight += _ner_weight;
 
-		weight *= _token_dict->get_idf(doc.token_id_map[tok_id]);
+		weight *= doc.token_idf[tok_id];
 
 		token_rank[tok_id] = weight;
 	}
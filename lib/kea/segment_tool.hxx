@@ -127,7 +127,7 @@ protected:
 		length = _procs.size();
 		for (i = 0; i < length; i++) {
 			_out->clear();
-			_procs[i]->process(*_in, *_out);
+			_procs[i]->run(*_in, *_out);
 			/* switch in & out queue */
 			_swap = _out;
 			_out = _in;
@@ -140,8 +140,12 @@ protected:
 		out.reserve(length);
 
 		for(i=0; i<length; ++i) {
-			out.push_back(new YCToken((*_in)[i]->get_orig_token(), (*_in)[i]->get_pos()));
-			delete (*_in)[i];
+			TokenImpl * token = (*_in)[i];
+			out.push_back(new YCToken(token->get_orig_token(), token->get_pos()));
+			//the record the chain found for the token is that of the original
+			if(token->get_records() && strcmp(token->get_token(), token->get_orig_token()) == 0)
+				out.back()->set_record(token->get_records(), token->get_record(token->get_records()));
+			delete token;
 		}
 
 		return _in->size();
@@ -51,7 +51,9 @@ int TextParser::_split_line(const char * text, std::vector<char *> & blocks)  {
 
 int TextParser::_split_sentence(std::vector<YCToken *> &token_list, YCDoc & doc) {
 	size_t i, len;
+	std::vector<bool> filter;
 	len = token_list.size();
+	_is_filter_word(token_list, filter);
 	YCSentence * sent = new YCSentence();
 	for(i=0; i<len; i++) {
 		char * token = token_list[i]->get_token();
@@ -61,7 +63,7 @@ int TextParser::_split_sentence(std::vector<YCToken *> &token_list, YCDoc & doc)
 				sent = new YCSentence();
 			}
 			delete token_list[i];
-		} else if(_is_filter_word(token_list[i])) {
+		} else if(filter[i]) {
 			delete token_list[i];
 		}else {
 			sent->token_list.push_back(token_list[i]);
@@ -75,8 +77,8 @@ int TextParser::_split_sentence(std::vector<YCToken *> &token_list, YCDoc & doc)
 	return 0;
 }
 
-bool TextParser::_is_filter_word(YCToken * token) {
-	return _token_filter->is_filter_word(token);
+void TextParser::_is_filter_word(std::vector<YCToken *> & tokens, std::vector<bool> & filter) {
+	_token_filter->is_filter_word(tokens, filter);
 }
 
 int TextParser::parse_text(const char * text, YCDoc & doc) {
@@ -89,9 +91,11 @@ int TextParser::parse_text(const char * title, const char * text, YCDoc & doc) {
 		YCSentence * sent = new YCSentence();
 		sent->is_title = true;
 		_segment_tool->segment(title, tokens);
+		std::vector<bool> filter;
+		_is_filter_word(tokens, filter);
 		size_t i, size = tokens.size();
 		for(i=0; i<size; ++i) {
-			if(_is_filter_word(tokens[i])) {
+			if(filter[i]) {
 				delete tokens[i];
 			} else {
 				sent->token_list.push_back(tokens[i]);
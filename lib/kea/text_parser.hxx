@@ -16,7 +16,7 @@ protected:
 	SegmentTool *_segment_tool;
 	TokenFilter *_token_filter;
 
-	bool _is_filter_word(YCToken * token);
+	void _is_filter_word(std::vector<YCToken *> & tokens, std::vector<bool> & filter);
 
 protected:
 	int _feature_min_length;
@@ -5,7 +5,9 @@
 #include "config_factory.hxx"
 #include "ilexicon.hxx"
 #include "datrie.hxx"
+#include "kea_doc.hxx"
 #include <cmath>
+#include <vector>
 
 namespace bamboo { namespace kea {
 
@@ -18,6 +20,9 @@ protected:
 
 	bamboo::ILexicon * _token_id;
 	bamboo::ILexicon * _token_df;
+	//the record lexicon both dicts are fields of, if they are of one
+	bamboo::RecordLexicon * _records;
+	int _id_field, _df_field;
 
 	int _df_avg;
 	double _idf_t;
@@ -35,6 +40,18 @@ protected:
 		return df;
 	}
 
+	double _get_idf(int df) {
+		if(df <= 0) {
+			df = _df_avg;
+		}
+		float idf = 1;
+		int d = _get_total_docs();
+		if(df>0 && d>0) {
+			idf = _idf_t + _idf_w * log(d/df); 
+		}
+		return idf;
+	}
+
 	int _get_total_docs() {
 		if(_D==0 && _token_df) {
 			_D = _token_df->max_value() + 1;
@@ -43,12 +60,10 @@ protected:
 	}
 
 public:
-	TokenDict():_D(0),_max_id(0),_is_init(false),_token_id(NULL),_token_df(NULL),_df_avg(0),_idf_t(1),_idf_w(1) {}
+	TokenDict():_D(0),_max_id(0),_is_init(false),_token_id(NULL),_token_df(NULL),_records(NULL),_id_field(-1),_df_field(-1),_df_avg(0),_idf_t(1),_idf_w(1) {}
 	~TokenDict() {
-		if(_token_id)
-			delete _token_id;
-		if(_token_df)
-			delete _token_df;
+		LexiconFactory::release(_token_id);
+		LexiconFactory::release(_token_df);
 	}
 
 	int init(IConfig * config) {
@@ -57,12 +72,16 @@ public:
 		if(*s == 0) {
 			throw std::runtime_error("ke_token_id_dict is null");
 		}
-		_token_id = LexiconFactory::load(s);
+		LexiconFactory::release(_token_id);
+		_token_id = LexiconFactory::acquire(s);
 		config->get_value("ke_token_df_dict", s);
 		if(*s == 0) {
 			throw std::runtime_error("ke_token_df_dict is null");
 		}
-		_token_df = LexiconFactory::load(s);
+		LexiconFactory::release(_token_df);
+		_token_df = LexiconFactory::acquire(s);
+		_records = _token_id->records(_id_field);
+		if(_records != _token_df->records(_df_field)) _records = NULL;
 		
 		config->get_value("ke_idf_w", _idf_w);
 		config->get_value("ke_idf_t", _idf_t);
@@ -95,6 +114,45 @@ public:
 		return id;
 	}
 
+	//get_id() and the df of tokens[0, n) into ids and dfs; when both dicts
+	//are fields of one record lexicon, each token is looked up once for
+	//both, or not at all if the segmenter looked it up there
+	void get_ids(YCToken ** tokens, size_t n, int * ids, int * dfs) {
+		size_t i;
+		if(n == 0) return;
+		if(_records) {
+			std::vector<const RecordLexicon::record_t *> records(n);
+			_records->resolve_batch(tokens, n, &records[0]);
+			for(i=0; i<n; i++) {
+				ids[i] = records[i] ? RecordLexicon::value(records[i], _id_field) : 0;
+				dfs[i] = records[i] ? RecordLexicon::value(records[i], _df_field) : 0;
+			}
+		} else {
+			std::vector<const char *> words(n);
+			for(i=0; i<n; i++) words[i] = tokens[i]->get_token();
+			get_ids(&words[0], n, ids);
+			for(i=0; i<n; i++) dfs[i] = 0;
+			if(_token_df) _token_df->search_batch(&words[0], n, dfs);
+		}
+		for(i=0; i<n; i++) {
+			if(ids[i] <= 0) ids[i] = 0;
+			if(dfs[i] <= 0) dfs[i] = 0;
+		}
+	}
+
+	//get_id() of tokens[0, n) into ids, looked up as one batch
+	void get_ids(const char ** tokens, size_t n, int * ids) {
+		size_t i;
+		if(!_token_id) {
+			for(i=0; i<n; i++) ids[i] = 0;
+			return;
+		}
+		_token_id->search_batch(tokens, n, ids);
+		for(i=0; i<n; i++) {
+			if(ids[i] <= 0) ids[i] = 0;
+		}
+	}
+
 	int get_max_id() {
 		if(_max_id==0 && _token_id) {
 			_max_id = _token_id->max_value();
@@ -103,16 +161,24 @@ public:
 	}
 
 	double get_idf(const char * token) {
-		int df = _get_df(token);
-		if(df == 0) {
-			df = _df_avg;
+		return _get_idf(_get_df(token));
+	}
+
+	//the idf of a token found in df documents, as get_ids() gives it
+	double get_idf_by_df(int df) {
+		return _get_idf(df);
+	}
+
+	//get_idf() of tokens[0, n) into idfs, looked up as one batch
+	void get_idfs(const char ** tokens, size_t n, double * idfs) {
+		std::vector<int> df(n, 0);
+		size_t i;
+		if(_token_df && n > 0) {
+			_token_df->search_batch(tokens, n, &df[0]);
 		}
-		float idf = 1;
-		int d = _get_total_docs();
-		if(df>0 && d>0) {
-			idf = _idf_t + _idf_w * log(d/df); 
+		for(i=0; i<n; i++) {
+			idfs[i] = _get_idf(df[i]);
 		}
-		return idf;
 	}
 };
 
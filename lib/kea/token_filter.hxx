@@ -14,6 +14,9 @@ namespace bamboo { namespace kea {
 class TokenFilter {
 protected:
 	bamboo::ILexicon * _filter_dict;
+	//the record lexicon the dict is a field of, if any
+	bamboo::RecordLexicon * _records;
+	int _field;
 	bool _is_init;
 
 protected:
@@ -21,9 +24,9 @@ protected:
 	int _feature_min_utf8_length;
 
 public:
-	TokenFilter():_filter_dict(NULL),_is_init(false) {}
+	TokenFilter():_filter_dict(NULL),_records(NULL),_field(-1),_is_init(false) {}
 	~TokenFilter() {
-		if(_filter_dict) delete _filter_dict;
+		LexiconFactory::release(_filter_dict);
 	}
 
 	int init(IConfig * config) {
@@ -32,7 +35,9 @@ public:
 		if(*s == 0) {
 			throw std::runtime_error("ke_filter_dict is null");
 		}
-		_filter_dict = LexiconFactory::load(s);
+		LexiconFactory::release(_filter_dict);
+		_filter_dict = LexiconFactory::acquire(s);
+		_records = _filter_dict->records(_field);
 
 		config->get_value("ke_feature_min_length", _feature_min_length);
 		config->get_value("ke_feature_min_utf8_length", _feature_min_utf8_length);
@@ -61,7 +66,13 @@ public:
 			return false;
 		}
 
-		int val = _filter_dict->search(word);
+		int val;
+		if(_records) {
+			const RecordLexicon::record_t * record = _records->resolve(token);
+			val = record ? RecordLexicon::value(record, _field) : 0;
+		} else {
+			val = _filter_dict->search(word);
+		}
 
 		if(val > 0)
 			return true;
@@ -69,6 +80,47 @@ public:
 		return false;
 	}
 
+	//is_filter_word() of each of tokens into filter, the dict looked up as one batch
+	void is_filter_word(std::vector<YCToken *> & tokens, std::vector<bool> & filter) {
+		std::vector<const char *> words;
+		std::vector<YCToken *> rest;
+		std::vector<size_t> index;
+		std::vector<int> val;
+		size_t i;
+
+		filter.assign(tokens.size(), false);
+		for(i=0; i<tokens.size(); i++) {
+			const char * word = tokens[i]->get_token();
+			if(tokens[i]->get_pos() == 0 && _rule_filter(word)) {
+				filter[i] = true;
+			} else {
+				words.push_back(word);
+				rest.push_back(tokens[i]);
+				index.push_back(i);
+			}
+		}
+
+		if(!_is_init || !_filter_dict || words.empty()) {
+			return;
+		}
+
+		val.resize(words.size());
+		if(_records) {
+			//the tokens the segmenter looked up in the same records are not looked up again
+			std::vector<const RecordLexicon::record_t *> records(rest.size());
+			_records->resolve_batch(&rest[0], rest.size(), &records[0]);
+			for(i=0; i<rest.size(); i++) {
+				val[i] = records[i] ? RecordLexicon::value(records[i], _field) : 0;
+			}
+		} else {
+			_filter_dict->search_batch(&words[0], words.size(), &val[0]);
+		}
+		for(i=0; i<words.size(); i++) {
+			if(val[i] > 0)
+				filter[index[i]] = true;
+		}
+	}
+
 protected:
 	bool _rule_filter(const char *token) {
 		if((int)strlen(token) < _feature_min_length)
@@ -31,33 +31,145 @@
 
 #include <cassert>
 #include <cstdio>
+#include <string>
+
+#include "double_array.hxx"
+#include "key_sorter.hxx"
+#include "key_filter.hxx"
+#include "stats.hxx"
 
 namespace bamboo {
 
 
+class RecordLexicon;
+
 class ILexicon {
 protected:
+	size_t *_stat_lookups, *_stat_hits;
+	KeyFilter *_filter;
+
 	static void _export(const char *s, int val, void *arg) 
 	{
 		FILE *fp = (FILE *)arg;
 		fprintf(fp, "%d %s\n", val, s);
 	}
+
+	/* counts a search() returning val, when stats are on */
+	int _count(int val)
+	{
+		if (Stats::enabled() && _stat_lookups) {
+			Stats::add(_stat_lookups, 1);
+			if (val > 0) Stats::add(_stat_hits, 1);
+		}
+		return val;
+	}
+
+	/* counts a search_batch() of n keys into values */
+	void _count_batch(const int *values, size_t n)
+	{
+		size_t i, hits;
+
+		if (Stats::enabled() && _stat_lookups) {
+			for (i = 0, hits = 0; i < n; i++)
+				if (values[i] > 0) hits++;
+			Stats::add(_stat_lookups, n);
+			Stats::add(_stat_hits, hits);
+		}
+	}
+
+	/* counts a common_prefix_search() finding n keys */
+	size_t _count_prefix(size_t n)
+	{
+		if (Stats::enabled() && _stat_lookups) {
+			Stats::add(_stat_lookups, 1);
+			if (n > 0) Stats::add(_stat_hits, 1);
+		}
+		return n;
+	}
 public:
-	ILexicon() {};
-	ILexicon(int size) {};
-	ILexicon(const char *filename) {};
+	ILexicon():_stat_lookups(NULL), _stat_hits(NULL), _filter(NULL) {};
+	ILexicon(int size):_stat_lookups(NULL), _stat_hits(NULL), _filter(NULL) {};
+	ILexicon(const char *filename):_stat_lookups(NULL), _stat_hits(NULL), _filter(NULL) {};
+
+	/* registers the metrics of this lexicon as lexicon.<name>.* */
+	void set_name(const char *name)
+	{
+		Stats *stats = Stats::get_instance();
+		std::string prefix = std::string("lexicon.") + name;
+
+		_stat_lookups = stats->counter(prefix + ".lookups");
+		_stat_hits = stats->counter(prefix + ".hits");
+	}
+
+	/*
+	 * Lets search() and search_batch() answer 0 at once for the keys
+	 * filter rules out. The lexicon owns the filter, and drops it on
+	 * the first insert() or build(), which it would not know about.
+	 */
+	void set_filter(KeyFilter *filter)
+	{
+		delete _filter;
+		_filter = filter;
+	}
+
+	bool has_filter()
+	{
+		return _filter != NULL;
+	}
+
+	/* false when the filter rules key out, so that no walk can find it */
+	bool may_contain(const char *key)
+	{
+		return _filter == NULL || _filter->contains(key);
+	}
 
 	virtual void insert(const char*, int val) = 0;
 	virtual int search(const char *) = 0;
+	/*
+	 * search() of each of keys[0, n) into values, the walks of several
+	 * keys interleaved so that their cache misses overlap; worth it for
+	 * many keys at once, such as the vocabulary of a whole document
+	 */
+	virtual void search_batch(const char **keys, size_t n, int *values) = 0;
+	/* the keys that are prefixes of s[0, len), shortest first, at most size */
+	virtual size_t common_prefix_search(const char *s, size_t len,
+			trie_match_t *matches, size_t size) = 0;
+	/* the keys starting with prefix, highest values first, at most limit */
+	virtual size_t predictive_search(const char *prefix, size_t limit,
+			on_explore_finish_t cb, void *arg) = 0;
+	/* see DoubleArray::Cursor; value() is counted as a lookup */
+	class Cursor {
+	public:
+		virtual ~Cursor() {};
+		virtual void reset() = 0;
+		virtual bool advance(const char *s, size_t len) = 0;
+		virtual int value() = 0;
+	};
+
+	/* a new cursor at the root, to be deleted by the caller */
+	virtual Cursor *cursor() = 0;
 	virtual int operator[](const char *) = 0;
 	virtual void save(const char *filename) = 0;
 	virtual void read_from_text(const char *filename, bool verbose) = 0;
+	/* replaces the content by the sorted keys, in one pass where the type can */
+	virtual void build(KeySorter &keys) = 0;
 	virtual void write_to_text(const char *filename) = 0;
+	virtual void explore(on_explore_finish_t cb, void *arg) = 0;
 	virtual int max_value() = 0;
 	virtual int min_value() = 0;
 	virtual int sum_value() = 0;
 	virtual int num_insert() = 0;
-	virtual ~ILexicon() {};
+	/* the record lexicon this lexicon serves field of, see
+	 * RecordFieldLexicon, or NULL */
+	virtual RecordLexicon *records(int &field)
+	{
+		return NULL;
+	}
+
+	virtual ~ILexicon()
+	{
+		delete _filter;
+	}
 };
 
 } //namespace bamboo
@@ -29,12 +29,16 @@
 #ifndef LEXICON_FACTORY_HXX
 #define LEXICON_FACTORY_HXX
 
+#include <sys/stat.h>
 #include <cstring>
+#include <string>
 #include <exception>
 #include <stdexcept>
 
 #include "ilexicon.hxx"
 #include "trie_lexicon.hxx"
+#include "record_lexicon.hxx"
+#include "resource_registry.hxx"
 
 namespace bamboo {
 
@@ -51,6 +55,16 @@ public:
 			dc = new TrieLexicon<DATrie>(1024);
 		} else if (strcmp(type, "double_array") == 0) {
 			dc = new TrieLexicon<DoubleArray>(1024);
+		} else if (strcmp(type, "datrie64") == 0) {
+			dc = new TrieLexicon<DATrie64>(1024);
+		} else if (strcmp(type, "double_array64") == 0) {
+			dc = new TrieLexicon<DoubleArray64>(1024);
+		} else if (strcmp(type, "compact_trie") == 0) {
+			dc = new TrieLexicon<CompactTrie>(1024);
+		} else if (strcmp(type, "codepoint_trie") == 0) {
+			dc = new TrieLexicon<CodePointTrie>(1024);
+		} else if (strcmp(type, "succinct") == 0) {
+			dc = new TrieLexicon<SuccinctTrie>(1024);
 		} else {
 			throw std::runtime_error("unknow lexicon type " + std::string(type));
 		}
@@ -58,23 +72,162 @@ public:
 		return dc;
 	}
 
+	/*
+	 * create(type) for the keys of source: a datrie or double_array goes
+	 * to the 64-bit format when they are too many for the 32-bit one,
+	 * see trie_needs_64().
+	 */
+	static ILexicon *create(const char *type, const char *source)
+	{
+		struct stat buf;
+
+		if (type && source && (strcmp(type, "datrie") == 0 || strcmp(type, "double_array") == 0)
+				&& stat(source, &buf) == 0 && trie_needs_64(buf.st_size))
+			return create((std::string(type) + "64").c_str());
+		return create(type);
+	}
+
+	/*
+	 * The file format is told by its magic: v1 datrie or double_array, in
+	 * 32 or 64 bits, or v2 compact_trie, codepoint_trie or succinct. A
+	 * field of a record lexicon is loaded as FILE:FIELD, see RecordLexicon.
+	 */
 	static ILexicon *load(const char *filename)
 	{
+		ILexicon *lexicon = NULL;
+		std::string path;
 		FILE *fp = NULL;
 		char magic[32];
+		int field;
 
 		if (filename == NULL) return NULL;
+		if (RecordLexicon::split(filename, path, field))
+			return _load_field(path.c_str(), field);
 		fp = fopen(filename, "r");
 		if (fp == NULL) throw std::runtime_error("can not open lexicon: " + std::string(filename));
 		fread(magic, sizeof(magic), 1, fp);
 		fclose(fp);
 
 		if (strcmp(magic, "datrie") == 0) {
-			return new TrieLexicon<DATrie>(filename);
+			lexicon = new TrieLexicon<DATrie>(filename);
 		} else if (strcmp(magic, "double_array") == 0) {
-			return new TrieLexicon<DoubleArray>(filename);
+			lexicon = new TrieLexicon<DoubleArray>(filename);
+		} else if (strcmp(magic, "datrie64") == 0) {
+			lexicon = new TrieLexicon<DATrie64>(filename);
+		} else if (strcmp(magic, "double_array64") == 0) {
+			lexicon = new TrieLexicon<DoubleArray64>(filename);
+		} else if (strcmp(magic, "compact_trie") == 0) {
+			lexicon = new TrieLexicon<CompactTrie>(filename);
+		} else if (strcmp(magic, "codepoint_trie") == 0) {
+			lexicon = new TrieLexicon<CodePointTrie>(filename);
+		} else if (strcmp(magic, "succinct") == 0) {
+			lexicon = new TrieLexicon<SuccinctTrie>(filename);
+		} else if (strcmp(magic, "record_lexicon") == 0) {
+			throw std::runtime_error("a record lexicon is loaded by field, as "
+					+ std::string(filename) + ":FIELD");
 		}
-		return NULL;
+		if (lexicon) _load_filter(lexicon, filename);
+		return lexicon;
+	}
+
+	/* where the key filter of an index is saved, see KeyFilter */
+	static std::string filter_path(const char *filename)
+	{
+		return std::string(filename) + ".filter";
+	}
+
+	/* saves a filter of the keys of lexicon, saved to filename, beside it */
+	static void save_filter(ILexicon *lexicon, const char *filename, int bits_per_key)
+	{
+		KeyFilter filter(lexicon->num_insert(), bits_per_key);
+		struct stat buf;
+
+		if (stat(filename, &buf) != 0)
+			throw std::runtime_error("can not stat lexicon: " + std::string(filename));
+		lexicon->explore(_insert_filter, &filter);
+		filter.stamp(buf.st_size, lexicon->num_insert(), lexicon->sum_value());
+		filter.save(filter_path(filename).c_str());
+	}
+
+	/*
+	 * Shared, refcounted variant of load(): every caller asking for the
+	 * same file gets the same lexicon, and the fields of a record lexicon
+	 * the same records. Give it back with release().
+	 */
+	static ILexicon *acquire(const char *filename)
+	{
+		std::string path;
+		int field;
+
+		if (filename && RecordLexicon::split(filename, path, field))
+			return (ILexicon *)ResourceRegistry::get_instance()->acquire("lexicon",
+					path.c_str(), RecordLexicon::field_name(field), _load, _unload);
+		return (ILexicon *)ResourceRegistry::get_instance()->acquire(
+				"lexicon", filename, NULL, _load, _unload);
+	}
+
+	static void retain(ILexicon *lexicon)
+	{
+		ResourceRegistry::get_instance()->retain(lexicon);
+	}
+
+	static void release(ILexicon *lexicon)
+	{
+		ResourceRegistry::get_instance()->release(lexicon);
+	}
+
+private:
+	static void _insert_filter(const char *key, int val, void *arg)
+	{
+		((KeyFilter *)arg)->insert(key);
+	}
+
+	/* a filter left from an older build of the index is ignored */
+	static void _load_filter(ILexicon *lexicon, const char *filename)
+	{
+		std::string path = filter_path(filename);
+		struct stat buf;
+		KeyFilter *filter;
+
+		if (stat(path.c_str(), &buf) != 0 || stat(filename, &buf) != 0) return;
+		try {
+			filter = new KeyFilter(path.c_str());
+		} catch (...) {
+			delete lexicon;
+			throw;
+		}
+		if (filter->stamped(buf.st_size, lexicon->num_insert(), lexicon->sum_value()))
+			lexicon->set_filter(filter);
+		else
+			delete filter;
+	}
+
+	static ILexicon *_load_field(const char *filename, int field)
+	{
+		RecordLexicon *records = RecordLexicon::acquire(filename);
+
+		return new RecordFieldLexicon(records, field);
+	}
+
+	/* arg is the field of a record lexicon, if any */
+	static void *_load(const char *filename, const char *arg)
+	{
+		std::string path(filename);
+		ILexicon *lexicon;
+		const char *name;
+
+		if (arg) path.append(":").append(arg);
+		lexicon = load(path.c_str());
+		if (lexicon == NULL)
+			throw std::runtime_error("unknow lexicon format " + std::string(filename));
+		name = strrchr(path.c_str(), '/');
+		lexicon->set_name((name)?name + 1:path.c_str());
+		return lexicon;
+	}
+
+	static void _unload(void *lexicon)
+	{
+		delete (ILexicon *)lexicon;
 	}
 };
 
@@ -0,0 +1,253 @@
+/*
+ * Copyright (c) 2008, detrox@gmail.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <organization> nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY detrox@gmail.com ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL detrox@gmail.com BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include "resource_registry.hxx"
+#include "lexicon_factory.hxx"
+#include "record_lexicon.hxx"
+
+namespace bamboo {
+
+
+static const char *_field_names[RecordLexicon::num_fields] = {
+	"freq", "pos", "combine", "trailing", "filter", "break", "id", "df"
+};
+
+RecordLexicon::RecordLexicon(const char *filename)
+	:_header(NULL), _records(NULL), _mmap(NULL), _keys(NULL)
+{
+	_mmap = new MMap(filename);
+	_header = (_header_t *)_mmap->start();
+	if (_mmap->size() < sizeof(_header_t) || strcmp(_header->magic, "record_lexicon") != 0
+			|| _header->version != version || _header->num < 0
+			|| _mmap->size() != sizeof(_header_t) + (size_t)_header->num * sizeof(record_t)) {
+		delete _mmap;
+		throw std::runtime_error(std::string("unsupported record lexicon: ") + filename);
+	}
+	_records = (record_t *)_mmap->start(sizeof(_header_t));
+	try {
+		_keys = LexiconFactory::load(keys_path(filename).c_str());
+	} catch (...) {
+		delete _mmap;
+		throw;
+	}
+	if (_keys == NULL || _keys->num_insert() != _header->num) {
+		delete _keys;
+		delete _mmap;
+		throw std::runtime_error(std::string("keys of another record lexicon: ") + filename);
+	}
+}
+
+RecordLexicon::~RecordLexicon()
+{
+	delete _keys;
+	delete _mmap;
+}
+
+int RecordLexicon::field(const char *name)
+{
+	int i;
+
+	for (i = 0; i < num_fields; i++)
+		if (strcmp(name, _field_names[i]) == 0) return i;
+	return -1;
+}
+
+const char *RecordLexicon::field_name(int field)
+{
+	return (field >= 0 && field < num_fields)?_field_names[field]:NULL;
+}
+
+bool RecordLexicon::split(const char *name, std::string &filename, int &field)
+{
+	const char *p = strrchr(name, ':');
+
+	if (p == NULL || (field = RecordLexicon::field(p + 1)) < 0) return false;
+	filename.assign(name, p - name);
+	return true;
+}
+
+uint32_t RecordLexicon::pos_mask(const char *tags)
+{
+	uint32_t mask = 0;
+	const char *p;
+
+	for (p = tags; *p; p++) {
+		if (*p == ',') continue;
+		if (*p >= 'a' && *p <= 'z') mask |= 1U << (*p - 'a');
+		/* skip the rest of the tag */
+		while (p[1] && p[1] != ',') p++;
+	}
+	return mask;
+}
+
+void RecordLexicon::lookup_batch(const char **keys, size_t n, const record_t **records)
+{
+	std::vector<int> ids(n);
+	size_t i;
+
+	if (n == 0) return;
+	_keys->search_batch(keys, n, &ids[0]);
+	for (i = 0; i < n; i++)
+		records[i] = record(ids[i]);
+}
+
+static void *_load_records(const char *filename, const char *)
+{
+	return new RecordLexicon(filename);
+}
+
+static void _unload_records(void *lexicon)
+{
+	delete (RecordLexicon *)lexicon;
+}
+
+RecordLexicon *RecordLexicon::acquire(const char *filename)
+{
+	return (RecordLexicon *)ResourceRegistry::get_instance()->acquire(
+			"record_lexicon", filename, NULL, _load_records, _unload_records);
+}
+
+void RecordLexicon::release(RecordLexicon *lexicon)
+{
+	ResourceRegistry::get_instance()->release(lexicon);
+}
+
+void RecordLexiconBuilder::add(int field, const char *filename, bool verbose)
+{
+	char line[8192], *p, *key;
+	RecordLexicon::record_t *record;
+	size_t n, i;
+	FILE *fp;
+	int val;
+
+	if (RecordLexicon::field_name(field) == NULL)
+		throw std::runtime_error("unknow record lexicon field");
+	fp = fopen(filename, "r");
+	if (fp == NULL) throw std::runtime_error(std::string("can not open ") + filename);
+	for (i = 0; fgets(line, sizeof(line), fp); i++) {
+		p = line + strcspn(line, " \t\r\n");
+		if (p == line || (*p != ' ' && *p != '\t')) continue;
+		*p++ = '\0';
+		for (key = p; *key == ' ' || *key == '\t'; key++) ;
+		n = strcspn(key, "\r\n");
+		if (n == 0) continue;
+		key[(n < 4096)?n:4096] = '\0';
+		if (field == RecordLexicon::field_pos) {
+			val = RecordLexicon::pos_mask(line);
+		} else {
+			val = strtol(line, &p, 10);
+			if (*p != '\0') continue;
+		}
+
+		record = &_records[key];
+		switch (field) {
+			case RecordLexicon::field_freq: record->freq = val; break;
+			case RecordLexicon::field_pos: record->pos |= val; break;
+			case RecordLexicon::field_combine:
+				if (val) record->flags |= RecordLexicon::flag_combine;
+				break;
+			case RecordLexicon::field_trailing:
+				if (val) record->flags |= RecordLexicon::flag_trailing;
+				break;
+			case RecordLexicon::field_filter:
+				if (val) record->flags |= RecordLexicon::flag_filter;
+				break;
+			case RecordLexicon::field_break: record->breaks = val; break;
+			case RecordLexicon::field_id: record->id = val; break;
+			case RecordLexicon::field_df: record->df = val; break;
+		}
+		if (verbose && i % 100000 == 0)
+			std::clog << "\r\t\t" << _records.size() << " keys read.";
+	}
+	fclose(fp);
+	if (verbose)
+		std::clog << "\r\t\t" << _records.size() << " keys read." << std::endl;
+}
+
+void RecordLexiconBuilder::save(const char *filename, const char *type, size_t memory, bool verbose)
+{
+	std::map<std::string, RecordLexicon::record_t>::iterator it;
+	RecordLexicon::_header_t header;
+	RecordLexicon::_stats_t *stats;
+	KeySorter keys(memory);
+	ILexicon *dc;
+	FILE *fp;
+	int i, id, val;
+
+	memset(&header, 0, sizeof(header));
+	strcpy(header.magic, "record_lexicon");
+	header.version = RecordLexicon::version;
+	header.num = _records.size();
+	header.lambda = _lambda;
+	for (it = _records.begin(); it != _records.end(); ++it) {
+		for (i = 0; i < RecordLexicon::num_fields; i++) {
+			if ((val = RecordLexicon::value(&it->second, i)) == 0) continue;
+			stats = &header.stats[i];
+			if (stats->num == 0 || val > stats->max) stats->max = val;
+			if (stats->num == 0 || val < stats->min) stats->min = val;
+			stats->sum += val;
+			stats->num++;
+		}
+	}
+	/* what UnigramProcessor::_ele_estimate() gives of the freq field */
+	stats = &header.stats[RecordLexicon::field_freq];
+	for (it = _records.begin(); it != _records.end(); ++it)
+		it->second.logp = log(it->second.freq + _lambda)
+			- log((int)stats->sum + stats->num * _lambda);
+
+	fp = fopen(filename, "w+");
+	if (fp == NULL)
+		throw std::runtime_error("Can not write to file");
+	fwrite(&header, sizeof(header), 1, fp);
+	for (it = _records.begin(); it != _records.end(); ++it)
+		fwrite(&it->second, sizeof(RecordLexicon::record_t), 1, fp);
+	fclose(fp);
+
+	if (verbose)
+		std::clog << "making index of " << _records.size() << " keys" << std::endl;
+	for (id = 1, it = _records.begin(); it != _records.end(); ++it, id++)
+		keys.add(it->first.c_str(), id);
+	dc = LexiconFactory::create(type);
+	try {
+		dc->build(keys);
+		dc->save(RecordLexicon::keys_path(filename).c_str());
+	} catch (...) {
+		delete dc;
+		throw;
+	}
+	delete dc;
+}
+
+} //namespace bamboo
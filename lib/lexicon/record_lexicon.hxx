@@ -0,0 +1,474 @@
+/*
+ * Copyright (c) 2008, detrox@gmail.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <organization> nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY detrox@gmail.com ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL detrox@gmail.com BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#ifndef RECORD_LEXICON_HXX
+#define RECORD_LEXICON_HXX
+
+#include <stdint.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+#include "ilexicon.hxx"
+#include "mmap.hxx"
+
+namespace bamboo {
+
+
+/*
+ * A lexicon whose value is a record of every attribute the processors
+ * look a word up for, so that a single walk of a single trie answers
+ * what took one in unigram.idx, user_combine.idx, number_trailing.idx,
+ * break.idx and the KEA dictionaries each. The file holds the records,
+ * numbered from 1, and the keys are a trie beside it, keys_path(), with
+ * the record number as value. RecordFieldLexicon serves one attribute
+ * as an ILexicon, so that every *_lexicon setting can name a field of
+ * the same file as FILE:FIELD, all of them sharing its trie.
+ *
+ * resolve() keeps the number of the record of a token on the token, so
+ * that the processors after the one which looked it up, or which cut
+ * it out of a walk, read its record without another walk.
+ */
+class RecordLexicon {
+public:
+	static const int magic_size = 32;
+	static const int version = 2;
+
+	enum {
+		field_freq = 0,		/* unigram frequency */
+		field_pos,		/* POS bitmask, see pos_mask() */
+		field_combine,		/* a user combination, as 0 or 1 */
+		field_trailing,		/* a number trailing, as 0 or 1 */
+		field_filter,		/* a word KEA filters out, as 0 or 1 */
+		field_break,		/* the break bitmap, see BreakProcessor */
+		field_id,		/* KEA token id */
+		field_df,		/* KEA document frequency */
+		num_fields
+	};
+
+	enum {
+		flag_combine = 1,
+		flag_trailing = 2,
+		flag_filter = 4
+	};
+
+	#pragma pack(push, 4)
+	typedef struct {
+		double logp;		/* the ELE estimate of freq, see lambda(),
+					 * first to be aligned in the mapping */
+		int32_t freq;
+		uint32_t pos;
+		uint32_t flags;
+		int32_t breaks;
+		int32_t id;
+		int32_t df;
+	} record_t;
+	#pragma pack(pop)
+
+	RecordLexicon(const char *filename);
+	~RecordLexicon();
+
+	/* where the keys of a record lexicon are saved */
+	static std::string keys_path(const char *filename)
+	{
+		return std::string(filename) + ".keys";
+	}
+
+	/* the field called name, or -1 */
+	static int field(const char *name);
+	static const char *field_name(int field);
+
+	/* splits name, FILE:FIELD, into the file and the field */
+	static bool split(const char *name, std::string &filename, int &field);
+
+	/* bit t - 'a' for each tag of tags, a list such as "n,vn": the
+	 * first letter of a tag is its major category */
+	static uint32_t pos_mask(const char *tags);
+
+	/* the value of field in record */
+	static int value(const record_t *record, int field)
+	{
+		switch (field) {
+			case field_freq: return record->freq;
+			case field_pos: return record->pos;
+			case field_combine: return (record->flags & flag_combine) != 0;
+			case field_trailing: return (record->flags & flag_trailing) != 0;
+			case field_filter: return (record->flags & flag_filter) != 0;
+			case field_break: return record->breaks;
+			case field_id: return record->id;
+			case field_df: return record->df;
+		}
+		return 0;
+	}
+
+	/* the record numbered id, as the keys give it, or NULL */
+	const record_t *record(int id)
+	{
+		return (id > 0 && id <= _header->num)?_records + id - 1:NULL;
+	}
+
+	/* the record of key, or NULL, from one walk */
+	const record_t *lookup(const char *key)
+	{
+		return record(_keys->search(key));
+	}
+
+	/* lookup() of each of keys[0, n) into records, see search_batch() */
+	void lookup_batch(const char **keys, size_t n, const record_t **records);
+
+	/* the record of the token, a TokenImpl or kea::YCToken, looked up
+	 * by its get_token() unless an earlier resolve() kept it there */
+	template <class T>
+	const record_t *resolve(T *token)
+	{
+		const record_t *found;
+		int id;
+
+		if ((id = token->get_record(this)) >= 0) return record(id);
+		found = lookup(token->get_token());
+		token->set_record(this, (found)?(int)(found - _records) + 1:0);
+		return found;
+	}
+
+	/* resolve() of each of tokens[0, n) into records, those not yet
+	 * resolved looked up as one batch */
+	template <class T>
+	void resolve_batch(T **tokens, size_t n, const record_t **records)
+	{
+		std::vector<const char *> keys;
+		std::vector<size_t> index;
+		std::vector<const record_t *> found;
+		size_t i;
+		int id;
+
+		for (i = 0; i < n; i++) {
+			if ((id = tokens[i]->get_record(this)) >= 0) {
+				records[i] = record(id);
+			} else {
+				keys.push_back(tokens[i]->get_token());
+				index.push_back(i);
+			}
+		}
+		if (keys.empty()) return;
+		found.resize(keys.size());
+		lookup_batch(&keys[0], keys.size(), &found[0]);
+		for (i = 0; i < keys.size(); i++) {
+			records[index[i]] = found[i];
+			tokens[index[i]]->set_record(this, (found[i])?(int)(found[i] - _records) + 1:0);
+		}
+	}
+
+	ILexicon *keys()
+	{
+		return _keys;
+	}
+
+	/* the lambda of the estimate in logp */
+	double lambda()
+	{
+		return _header->lambda;
+	}
+
+	/* statistics of field over the records where it is not 0 */
+	int max_value(int field)
+	{
+		return _header->stats[field].max;
+	}
+
+	int min_value(int field)
+	{
+		return _header->stats[field].min;
+	}
+
+	long long sum_value(int field)
+	{
+		return _header->stats[field].sum;
+	}
+
+	int num_insert(int field)
+	{
+		return _header->stats[field].num;
+	}
+
+	/* shared, refcounted, see LexiconFactory::acquire() */
+	static RecordLexicon *acquire(const char *filename);
+	static void release(RecordLexicon *lexicon);
+
+protected:
+	friend class RecordLexiconBuilder;
+
+	#pragma pack(push, 4)
+	typedef struct {
+		int max, min;
+		long long sum;
+		int num;
+	} _stats_t;
+
+	typedef struct {
+		char magic[magic_size];
+		int version;
+		int num;
+		double lambda;
+		_stats_t stats[num_fields];
+	} _header_t;
+	#pragma pack(pop)
+
+	_header_t *_header;
+	record_t *_records;
+	MMap *_mmap;
+	ILexicon *_keys;
+
+private:
+	RecordLexicon(RecordLexicon &) {}
+};
+
+/*
+ * Merges the text sources of the fields into a record lexicon: "VALUE
+ * KEY" per line as read_from_text() takes them, or "TAGS KEY" for the
+ * POS field; a flag is set by any value but 0. The records are kept in
+ * memory until save(), which estimates logp with lambda as ugm_seg does
+ * with its ele_lambda.
+ */
+class RecordLexiconBuilder {
+public:
+	RecordLexiconBuilder(double lambda = 0.5)
+		:_lambda(lambda) {}
+
+
+	void add(int field, const char *filename, bool verbose);
+
+	size_t size()
+	{
+		return _records.size();
+	}
+
+	/* saves the records to filename and their keys beside it, in an
+	 * index of type built with memory bytes to sort them */
+	void save(const char *filename, const char *type, size_t memory, bool verbose);
+
+protected:
+	double _lambda;
+	std::map<std::string, RecordLexicon::record_t> _records;
+};
+
+/*
+ * One field of a record lexicon as a read-only ILexicon: the keys where
+ * the field is 0 are missing from it, and the statistics are those of
+ * the field. It holds a reference to the records, given back on delete.
+ */
+class RecordFieldLexicon: public ILexicon {
+protected:
+	static const size_t _prefix_buffer_size = 64;
+
+	RecordLexicon *_records;
+	int _field;
+
+	typedef struct {
+		RecordFieldLexicon *lexicon;
+		on_explore_finish_t cb;
+		void *arg;
+		std::vector<std::pair<int, std::string> > *found;
+	} _explore_t;
+
+	int _value(int id)
+	{
+		const RecordLexicon::record_t *record = _records->record(id);
+
+		return (record)?RecordLexicon::value(record, _field):0;
+	}
+
+	static void _explore_field(const char *key, int id, void *arg)
+	{
+		_explore_t *explore = (_explore_t *)arg;
+		int val = explore->lexicon->_value(id);
+
+		if (val == 0) return;
+		if (explore->found)
+			explore->found->push_back(std::make_pair(-val, std::string(key)));
+		else
+			explore->cb(key, val, explore->arg);
+	}
+
+	void _read_only()
+	{
+		throw std::runtime_error("a field of a record lexicon is read-only, build it with lexicon -u");
+	}
+
+public:
+	RecordFieldLexicon(RecordLexicon *records, int field)
+		:_records(records), _field(field) {}
+
+	~RecordFieldLexicon()
+	{
+		RecordLexicon::release(_records);
+	}
+
+	RecordLexicon *records(int &field)
+	{
+		field = _field;
+		return _records;
+	}
+
+	void insert(const char *, int)
+	{
+		_read_only();
+	}
+
+	int search(const char *s)
+	{
+		return _count(_value(_records->keys()->search(s)));
+	}
+
+	void search_batch(const char **keys, size_t n, int *values)
+	{
+		size_t i;
+
+		_records->keys()->search_batch(keys, n, values);
+		for (i = 0; i < n; i++)
+			values[i] = _value(values[i]);
+		_count_batch(values, n);
+	}
+
+	/* the keys where the field is 0 are dropped after the walk, so the
+	 * walk takes every prefix of s, at most len of them */
+	size_t common_prefix_search(const char *s, size_t len, trie_match_t *matches, size_t size)
+	{
+		trie_match_t stack[_prefix_buffer_size], *found = stack;
+		std::vector<trie_match_t> heap;
+		size_t i, n, num;
+		int val;
+
+		if (len > _prefix_buffer_size) {
+			heap.resize(len);
+			found = &heap[0];
+		}
+		num = _records->keys()->common_prefix_search(s, len, found, std::max(len, (size_t)1));
+		for (i = 0, n = 0; i < num && n < size; i++) {
+			if ((val = _value(found[i].value)) == 0) continue;
+			matches[n].length = found[i].length;
+			matches[n++].value = val;
+		}
+		return _count_prefix(n);
+	}
+
+	/* ranks every key below prefix, the trie knowing only the order of
+	 * the record numbers */
+	size_t predictive_search(const char *prefix, size_t limit, on_explore_finish_t cb, void *arg)
+	{
+		std::vector<std::pair<int, std::string> > found;
+		_explore_t explore = {this, NULL, NULL, &found};
+		size_t i;
+
+		_records->keys()->predictive_search(prefix, (size_t)-1, _explore_field, &explore);
+		std::sort(found.begin(), found.end());
+		for (i = 0; i < found.size() && i < limit; i++)
+			cb(found[i].second.c_str(), -found[i].first, arg);
+		return _count_prefix(i);
+	}
+
+	class Cursor: public ILexicon::Cursor {
+	private:
+		RecordFieldLexicon *_lexicon;
+		ILexicon::Cursor *_cursor;
+	public:
+		Cursor(RecordFieldLexicon *lexicon)
+			:_lexicon(lexicon), _cursor(lexicon->_records->keys()->cursor()) {};
+		~Cursor() {delete _cursor;}
+		void reset() {_cursor->reset();}
+		bool advance(const char *s, size_t len) {return _cursor->advance(s, len);}
+		int value() {return _lexicon->_count(_lexicon->_value(_cursor->value()));}
+	};
+
+	ILexicon::Cursor *cursor()
+	{
+		return new Cursor(this);
+	}
+
+	int operator[](const char *s)
+	{
+		return search(s);
+	}
+
+	void save(const char *)
+	{
+		_read_only();
+	}
+
+	void read_from_text(const char *, bool)
+	{
+		_read_only();
+	}
+
+	void build(KeySorter &)
+	{
+		_read_only();
+	}
+
+	void write_to_text(const char *filename)
+	{
+		FILE *fp;
+
+		assert(filename);
+		fp = fopen(filename, "w+");
+		explore(_export, fp);
+		fclose(fp);
+	}
+
+	void explore(on_explore_finish_t cb, void *arg)
+	{
+		_explore_t explore = {this, cb, arg, NULL};
+
+		_records->keys()->explore(_explore_field, &explore);
+	}
+
+	int max_value()
+	{
+		return _records->max_value(_field);
+	}
+
+	int min_value()
+	{
+		return _records->min_value(_field);
+	}
+
+	int sum_value()
+	{
+		return _records->sum_value(_field);
+	}
+
+	int num_insert()
+	{
+		return _records->num_insert(_field);
+	}
+};
+
+} //namespace bamboo
+
+#endif // RECORD_LEXICON_HXX
@@ -30,8 +30,13 @@
 #define TRIE_LEXICON_HXX
 
 #include <cstdio>
+#include <vector>
 
 #include "datrie.hxx"
+#include "compact_trie.hxx"
+#include "codepoint_trie.hxx"
+#include "succinct_trie.hxx"
+#include "datrie_builder.hxx"
 
 namespace bamboo {
 
@@ -41,6 +46,11 @@ class TrieLexicon:public ILexicon {
 	friend class TrieDebugger;
 protected:
 	TrieLexicon();
+
+	static void _insert(const char *s, int val, void *arg)
+	{
+		((TrieLexicon *)arg)->insert(s, val);
+	}
 public:
 	TrieType *_trie;
 	TrieLexicon(int size)
@@ -61,12 +71,69 @@ public:
 	
 	void insert(const char *s, int val)
 	{
+		set_filter(NULL);
 		_trie->insert(s, val);
 	}
 
 	int search(const char *s)
 	{
-		return _trie->search(s);
+		if (_filter && !_filter->contains(s)) return _count(0);
+		return _count(_trie->search(s));
+	}
+
+	void search_batch(const char **keys, size_t n, int *values)
+	{
+		std::vector<const char *> pass;
+		std::vector<size_t> index;
+		std::vector<int> found;
+		size_t i;
+
+		if (_filter == NULL) {
+			_trie->search_batch(keys, n, values);
+			_count_batch(values, n);
+			return;
+		}
+		/* only the keys passing the filter walk the trie */
+		for (i = 0; i < n; i++) {
+			values[i] = 0;
+			if (_filter->contains(keys[i])) {
+				pass.push_back(keys[i]);
+				index.push_back(i);
+			}
+		}
+		if (!pass.empty()) {
+			found.resize(pass.size());
+			_trie->search_batch(&pass[0], pass.size(), &found[0]);
+			for (i = 0; i < pass.size(); i++)
+				values[index[i]] = found[i];
+		}
+		_count_batch(values, n);
+	}
+
+	size_t common_prefix_search(const char *s, size_t len, trie_match_t *matches, size_t size)
+	{
+		return _count_prefix(_trie->common_prefix_search(s, len, matches, size));
+	}
+	
+	size_t predictive_search(const char *prefix, size_t limit, on_explore_finish_t cb, void *arg)
+	{
+		return _count_prefix(_trie->predictive_search(prefix, limit, cb, arg));
+	}
+	
+	class Cursor: public ILexicon::Cursor {
+	private:
+		TrieLexicon *_lexicon;
+		typename TrieType::Cursor _cursor;
+	public:
+		Cursor(TrieLexicon *lexicon):_lexicon(lexicon), _cursor(lexicon->_trie) {};
+		void reset() {_cursor.reset();}
+		bool advance(const char *s, size_t len) {return _cursor.advance(s, len);}
+		int value() {return _lexicon->_count(_cursor.value());}
+	};
+
+	ILexicon::Cursor *cursor()
+	{
+		return new Cursor(this);
 	}
 	
 	int operator[](const char *s)
@@ -106,6 +173,12 @@ public:
 			std::clog << "\r\t\t" << i << " items processed." << std::endl;
 	}
 
+	void build(KeySorter &keys)
+	{
+		set_filter(NULL);
+		keys.merge(_insert, this);
+	}
+
 	void write_to_text(const char *filename)
 	{
 		FILE *fp;
@@ -140,6 +213,21 @@ public:
 	//void write_to_text(const char *filename);
 };
 
+/* datrie lexicons are built in one pass rather than key by key */
+template<>
+inline void TrieLexicon<DATrie>::build(KeySorter &keys)
+{
+	set_filter(NULL);
+	DATrieBuilder(_trie).build(keys);
+}
+
+template<>
+inline void TrieLexicon<DATrie64>::build(KeySorter &keys)
+{
+	set_filter(NULL);
+	DATrieBuilder64(_trie).build(keys);
+}
+
 } //namespace bamboo
 
 #endif // TRIE_LEXICON_HXX
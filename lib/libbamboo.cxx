@@ -2,15 +2,19 @@
 #include <cstring>
 #include <iostream>
 #include <vector>
+#include <string>
 #include <stdexcept>
 #include <stdio.h>
 
 #include "bamboo.hxx"
+#include "stream_parser.hxx"
+#include "stats.hxx"
 
 #define ERROR_BUFFER_SIZE 1024
-#define set_error(F,...) snprintf(error_buffer, ERROR_BUFFER_SIZE, "%s: ", __VA_ARGS__)
+#define set_error(F,...) snprintf(error_buffer, ERROR_BUFFER_SIZE, F, __VA_ARGS__)
 
-static char error_buffer[ERROR_BUFFER_SIZE];
+/* per thread, so that sessions on different threads keep their own errors */
+static __thread char error_buffer[ERROR_BUFFER_SIZE];
 
 
 const char *bamboo_strerror()
@@ -33,6 +37,44 @@ void *bamboo_init(const char *parser, const char *cfg)
 	}
 }
 
+bamboo_model_t *bamboo_model_load(const char *parser, const char *cfg)
+{
+	bamboo::ParserFactory *factory;
+	bamboo::Parser *prototype;
+
+	try {
+		if (parser == NULL)
+			throw std::runtime_error("invalid parameters");
+
+		factory = bamboo::ParserFactory::get_instance();
+		prototype = factory->create(parser, cfg);
+		if (prototype == NULL)
+			throw std::runtime_error(std::string("parser can not be found: ") + parser);
+		return reinterpret_cast<bamboo_model_t *>(prototype);
+	} catch(std::exception &e) {
+		set_error("%s", e.what());
+		return NULL;
+	}
+}
+
+void *bamboo_session_new(bamboo_model_t *model)
+{
+	try {
+		if (model == NULL)
+			throw std::runtime_error("invalid parameters");
+
+		return reinterpret_cast<bamboo::Parser *>(model)->spawn();
+	} catch(std::exception &e) {
+		set_error("%s", e.what());
+		return NULL;
+	}
+}
+
+void bamboo_model_free(bamboo_model_t *model)
+{
+	delete reinterpret_cast<bamboo::Parser *>(model);
+}
+
 void bamboo_setopt(void *handle, enum bamboo_option option, void *arg)
 {
 	bamboo::Parser *parser = static_cast<bamboo::Parser *>(handle);
@@ -45,12 +87,55 @@ const void *bamboo_getopt(void *handle, enum bamboo_option option)
 	return parser->getopt(option);
 }
 
-char *bamboo_parse(void *handle)
+/* join tokens as "token[ pos] ..." and free them */
+static char *_join_tokens(std::vector<bamboo::Token *> &vec, const char *text)
 {
-	std::vector<bamboo::Token *>				vec;
 	std::vector<bamboo::Token *>::iterator		it;
 	char			 							*t;
 	char			 							*p;
+	size_t										size;
+
+	size = (strlen(text) + 1) << 1;
+	t = (char *)malloc(size + 1);
+	p = t;
+	*p = '\0';
+
+	for (it = vec.begin(); it < vec.end(); ++it) {
+		const char 		*token = (*it)->get_orig_token();
+		size_t			len = strlen(token) + 1;
+		unsigned short	pos = (*it)->get_pos();
+
+		if (pos) len += sizeof(unsigned short) + 1;
+
+		if ((size_t)(p - t) + len > size) {
+			/* expand */
+			char *old = t;
+			while ((size_t)(p - old) + len > size)
+				size <<= 1;
+			t = (char *)realloc(t, size + 1);
+			p = t + (p - old);
+		}
+
+		strcpy(p, token);
+		p += strlen(token);
+		if (pos) {
+			const char *ch = (const char *)&pos;
+			*(p++) = ' ';
+			if (*(ch + 1)) *(p++) = *(ch + 1);
+			if (*ch) *(p++) = *ch;
+		}
+		*(p++) = ' ';
+		delete *it;
+	}
+
+	*p = '\0';
+
+	return t;
+}
+
+char *bamboo_parse(void *handle)
+{
+	std::vector<bamboo::Token *>				vec;
 
 	try {
 		if (handle == NULL)
@@ -59,51 +144,192 @@ char *bamboo_parse(void *handle)
 		bamboo::Parser *parser = static_cast<bamboo::Parser *>(handle);
 		parser->parse(vec);
 
-		size_t size = (strlen((const char *)parser->getopt(BAMBOO_OPTION_TEXT)) + 1) << 1;
-		t = (char *)malloc(size + 1);
-		p = t;
-		*p = '\0';
-
-		for (it = vec.begin(); it < vec.end(); ++it) {
-			const char 		*token = (*it)->get_orig_token();
-			ssize_t			len = strlen(token);
-			unsigned short	pos = (*it)->get_pos();
-
-			if (pos) len += sizeof(unsigned short) + 1;
-
-			if (p - t <= len) {
-				/* expand */
-				char *old = t;
-				while (size + t < p + len)
-					size <<= 1;
-				t = (char *)realloc(t, size);
-				p = t + (p - old);
-			}
-
-			strcpy(p, (*it)->get_orig_token());
-			p += strlen((*it)->get_orig_token());
-			if (pos) {
-				const char *ch = (const char *)&pos;
-				*(p++) = ' ';
-				if (*(ch + 1)) *(p++) = *(ch + 1);
-				if (*ch) *(p++) = *ch;
-			}
-			*(p++) = ' ';
-			delete *it;
+		return _join_tokens(vec, (const char *)parser->getopt(BAMBOO_OPTION_TEXT));
+
+	} catch(std::exception &e) {
+		set_error("%s", e.what());
+		return NULL;
+	}
+}
+
+static void _to_span(bamboo::Token *token, bamboo_span_t *span)
+{
+	span->offset = token->get_begin();
+	span->length = token->get_end() - token->get_begin();
+	span->char_offset = token->get_char_begin();
+	span->char_length = token->get_char_end() - token->get_char_begin();
+	span->pos = token->get_pos();
+	span->attr = token->get_attr();
+}
+
+ssize_t bamboo_parse_spans(void *handle, const char *text, size_t len,
+		bamboo_span_t *out, size_t cap)
+{
+	std::vector<bamboo::Token *>				vec;
+	size_t										i;
+
+	try {
+		if (handle == NULL || (text == NULL && len) || (out == NULL && cap))
+			throw std::runtime_error("invalid parameters");
+
+		bamboo::Parser *parser = static_cast<bamboo::Parser *>(handle);
+		parser->set_text(text, len);
+		parser->parse(vec);
+
+		for (i = 0; i < vec.size(); i++) {
+			if (i < cap) _to_span(vec[i], &out[i]);
+			delete vec[i];
 		}
 
-		*p = '\0';
-		
-		return t;
+		return vec.size();
 
+	} catch(std::exception &e) {
+		for (i = 0; i < vec.size(); i++)
+			delete vec[i];
+		set_error("%s", e.what());
+		return -1;
+	}
+}
+
+typedef struct {
+	bamboo::StreamParser *parser;
+	bamboo_token_cb cb;
+	void *arg;
+} _stream_t;
+
+static void _on_stream_tokens(std::vector<bamboo::Token *> &tokens, void *arg)
+{
+	_stream_t *stream = (_stream_t *)arg;
+	bamboo_span_t span;
+	size_t i;
+
+	for (i = 0; i < tokens.size(); i++) {
+		_to_span(tokens[i], &span);
+		stream->cb(tokens[i]->get_orig_token(), &span, stream->arg);
+		delete tokens[i];
+	}
+	tokens.clear();
+}
+
+void *bamboo_stream_new(void *handle, bamboo_token_cb cb, void *arg)
+{
+	_stream_t *stream;
+
+	try {
+		if (handle == NULL || cb == NULL)
+			throw std::runtime_error("invalid parameters");
+
+		stream = new _stream_t;
+		stream->cb = cb;
+		stream->arg = arg;
+		stream->parser = new bamboo::StreamParser(static_cast<bamboo::Parser *>(handle),
+				_on_stream_tokens, stream);
+		return stream;
 	} catch(std::exception &e) {
 		set_error("%s", e.what());
 		return NULL;
 	}
 }
 
+int bamboo_stream_feed(void *stream, const char *data, size_t len)
+{
+	try {
+		if (stream == NULL || (data == NULL && len))
+			throw std::runtime_error("invalid parameters");
+
+		static_cast<_stream_t *>(stream)->parser->feed(data, len);
+		return 0;
+	} catch(std::exception &e) {
+		set_error("%s", e.what());
+		return -1;
+	}
+}
+
+int bamboo_stream_flush(void *stream)
+{
+	try {
+		if (stream == NULL)
+			throw std::runtime_error("invalid parameters");
+
+		static_cast<_stream_t *>(stream)->parser->flush();
+		return 0;
+	} catch(std::exception &e) {
+		set_error("%s", e.what());
+		return -1;
+	}
+}
+
+void bamboo_stream_free(void *stream)
+{
+	if (stream == NULL) return;
+	delete static_cast<_stream_t *>(stream)->parser;
+	delete static_cast<_stream_t *>(stream);
+}
+
+typedef struct {
+	const char **texts;
+	char **results;
+} _batch_arg_t;
+
+static void _on_batch_result(size_t i, std::vector<bamboo::Token *> &tokens, void *arg)
+{
+	_batch_arg_t *batch = (_batch_arg_t *)arg;
+	batch->results[i] = _join_tokens(tokens, batch->texts[i]);
+}
+
+int bamboo_parse_batch(void *handle, const char **texts, size_t n, char **results)
+{
+	_batch_arg_t batch;
+	size_t i;
+
+	try {
+		if (handle == NULL || (n && (texts == NULL || results == NULL)))
+			throw std::runtime_error("invalid parameters");
+
+		for (i = 0; i < n; i++)
+			results[i] = NULL;
+		batch.texts = texts;
+		batch.results = results;
+		static_cast<bamboo::Parser *>(handle)->parse_batch(texts, n, _on_batch_result, &batch);
+		return 0;
+
+	} catch(std::exception &e) {
+		for (i = 0; i < n; i++) {
+			free(results[i]);
+			results[i] = NULL;
+		}
+		set_error("%s", e.what());
+		return -1;
+	}
+}
+
 void bamboo_clean(void *handle)
 {
 	delete static_cast<bamboo::Parser *>(handle);
 }
 
+void bamboo_enable_stats(int on)
+{
+	bamboo::Stats::enable(on != 0);
+}
+
+char *bamboo_getstats()
+{
+	std::string s;
+	char *p;
+
+	bamboo::Stats::get_instance()->dump(s);
+	p = (char *)malloc(s.size() + 1);
+	if (p == NULL) {
+		set_error("%s", "out of memory");
+		return NULL;
+	}
+	memcpy(p, s.c_str(), s.size() + 1);
+	return p;
+}
+
+void bamboo_resetstats()
+{
+	bamboo::Stats::get_instance()->reset();
+}
+
@@ -75,6 +75,10 @@ public:
 	{
 		return (void *)((char *)_start + off);
 	}
+	size_t size()
+	{
+		return _size;
+	}
 	bool is_mapped()
 	{
 		return !(_start == NULL);
@@ -63,6 +63,15 @@ CRFNPParser::CRFNPParser(const char *file, bool verbose)
 	_config->get_value("ner_output_type", _output_type);
 }
 
+CRFNPParser::CRFNPParser(const CRFNPParser &rhs)
+:_verbose(rhs._verbose), _config(NULL), _in(&_token_fifo[0]), _out(&_token_fifo[1]), _output_type(rhs._output_type)
+{
+	size_t i;
+
+	for (i = 0; i < rhs._procs.size(); i++)
+		_procs.push_back(rhs._procs[i]->spawn());
+}
+
 CRFNPParser::~CRFNPParser()
 {
 	size_t i;
@@ -90,7 +99,7 @@ CRFNPParser::parse(std::vector<Token *> &out)
 	length = _procs.size();
 	for (i = 0; i < length; i++) {
 		_out->clear();
-		_procs[i]->process(*_in, *_out);
+		_procs[i]->run(*_in, *_out);
 		/* switch in & out queue */
 		_swap = _out;
 		_out = _in;
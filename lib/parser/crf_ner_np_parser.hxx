@@ -45,6 +45,8 @@ namespace bamboo {
 class CRFNPParser:public Parser {
 public:
 	CRFNPParser(const char *file, bool verbose);
+	CRFNPParser(const CRFNPParser &rhs);
+	Parser *spawn() {return new CRFNPParser(*this);}
 	~CRFNPParser();
 	int parse(std::vector<Token *> &out);
 protected:
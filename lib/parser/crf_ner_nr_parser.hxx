@@ -45,6 +45,8 @@ namespace bamboo {
 class CRFNRParser:public Parser {
 public:
 	CRFNRParser(const char *file, bool verbose);
+	CRFNRParser(const CRFNRParser &rhs);
+	Parser *spawn() {return new CRFNRParser(*this);}
 	~CRFNRParser();
 	int parse(std::vector<Token *> &out);
 protected:
@@ -45,6 +45,8 @@ namespace bamboo {
 class CRFNSParser:public Parser {
 public:
 	CRFNSParser(const char *file, bool verbose);
+	CRFNSParser(const CRFNSParser &rhs);
+	Parser *spawn() {return new CRFNSParser(*this);}
 	~CRFNSParser();
 	int parse(std::vector<Token *> &out);
 protected:
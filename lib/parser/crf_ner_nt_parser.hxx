@@ -45,6 +45,8 @@ namespace bamboo {
 class CRFNTParser:public Parser {
 public:
 	CRFNTParser(const char *file, bool verbose);
+	CRFNTParser(const CRFNTParser &rhs);
+	Parser *spawn() {return new CRFNTParser(*this);}
 	~CRFNTParser();
 	int parse(std::vector<Token *> &out);
 protected:
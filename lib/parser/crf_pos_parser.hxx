@@ -45,6 +45,8 @@ namespace bamboo {
 class CRFPosParser:public Parser {
 public:
 	CRFPosParser(const char *file, bool verbose);
+	CRFPosParser(const CRFPosParser &rhs);
+	Parser *spawn() {return new CRFPosParser(*this);}
 	~CRFPosParser();
 	int parse(std::vector<Token *> &out);
 protected:
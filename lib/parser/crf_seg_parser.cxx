@@ -65,6 +65,16 @@ CRFSegParser::CRFSegParser(const char *file, bool verbose)
 		_procs.push_back(factory->create("break"));
 }
 
+CRFSegParser::CRFSegParser(const CRFSegParser &rhs)
+:_verbose(rhs._verbose), _use_break(rhs._use_break), _use_single_combine(rhs._use_single_combine),
+ _config(NULL), _in(&_token_fifo[0]), _out(&_token_fifo[1])
+{
+	size_t i;
+
+	for (i = 0; i < rhs._procs.size(); i++)
+		_procs.push_back(rhs._procs[i]->spawn());
+}
+
 CRFSegParser::~CRFSegParser()
 {
 	size_t i;
@@ -93,7 +103,7 @@ CRFSegParser::parse(std::vector<Token *> &out)
 	length = _procs.size();
 	for (i = 0; i < length; i++) {
 		_out->clear();
-		_procs[i]->process(*_in, *_out);
+		_procs[i]->run(*_in, *_out);
 		/* switch in & out queue */
 		_swap = _out;
 		_out = _in;
@@ -45,6 +45,8 @@ namespace bamboo {
 class CRFSegParser:public Parser {
 public:
 	CRFSegParser(const char *file, bool verbose);
+	CRFSegParser(const CRFSegParser &rhs);
+	Parser *spawn() {return new CRFSegParser(*this);}
 	~CRFSegParser();
 	int parse(std::vector<Token *> &out);
 protected:
@@ -30,6 +30,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#include <pthread.h>
 #include <iostream>
 #include <stdexcept>
 
@@ -39,32 +40,49 @@ namespace bamboo {
 
 
 CustomParser::CustomParser(const char *file, bool verbose)
-:_verbose(0), _config(NULL), _in(&_token_fifo[0]), _out(&_token_fifo[1])
+:_verbose(0), _config(NULL), _in(&_token_fifo[0]), _out(&_token_fifo[1]),
+ _pipeline_chunk(0), _pipeline_threads(0)
 {
+	_pipeline_init();
 	_lazy_create_config(file);
 	_init();
-#ifdef TIMING
-	memset(_timing_process, 0, sizeof(size_t) * 128);
-#endif
+}
+
+CustomParser::CustomParser(const CustomParser &rhs)
+:_verbose(rhs._verbose), _config(NULL), _process_chain(rhs._process_chain),
+ _in(&_token_fifo[0]), _out(&_token_fifo[1]), _pipeline_chunk(rhs._pipeline_chunk),
+ _pipeline_threads(rhs._pipeline_threads)
+{
+	size_t i;
+
+	_pipeline_init();
+	for (i = 0; i < rhs._processors.size(); i++)
+		_processors.push_back(rhs._processors[i]->spawn());
 }
 
 CustomParser::~CustomParser()
 {
 	_fini();
 	delete _config;
-#ifdef TIMING
-	size_t i;
+	pthread_cond_destroy(&_pipeline_cond);
+	pthread_mutex_destroy(&_pipeline_lock);
+}
 
-	i = _processors.size();
-	while(i--)
-		std::cerr << "processor" << i << " consume: " << static_cast<double>(_timing_process[i] / 1000)<< "ms" << std::endl;
-#endif
+void CustomParser::_pipeline_init()
+{
+	pthread_mutex_init(&_pipeline_lock, NULL);
+	pthread_cond_init(&_pipeline_cond, NULL);
+	_pipeline_round = 0;
+	_pipeline_done = 0;
+	_pipeline_exit = false;
+	_pipeline_result = NULL;
 }
 
 void CustomParser::_fini()
 {
 	size_t i;
 
+	_pipeline_stop();
 	i = _processors.size();
 	while(i--) delete _processors[i];
 	_processors.clear();
@@ -77,6 +95,8 @@ void CustomParser::_init()
 
 	_config->get_value("verbose", _verbose);
 	_config->get_value("process_chain", _process_chain);
+	_config->get_value("pipeline_chunk", _pipeline_chunk);
+	_config->get_value("pipeline_threads", _pipeline_threads);
 
 	factory = ProcessorFactory::get_instance();
 	factory->set_config(_config);
@@ -84,6 +104,8 @@ void CustomParser::_init()
 	for (it = _process_chain.begin(); it != _process_chain.end(); it++) {
 		Processor *processor = NULL;
 		processor = factory->create(it->c_str(),_verbose);
+		if (processor == NULL)
+			throw std::runtime_error(std::string("processor can not be found: ") + *it);
 		_processors.push_back(processor);
 	}
 }
@@ -118,40 +140,378 @@ void CustomParser::_lazy_create_config(const char *custom)
 		throw std::runtime_error("can not find configuration");
 }
 
+void CustomParser::_run(size_t i, std::vector<TokenImpl *> &in, std::vector<TokenImpl *> &out)
+{
+	_processors[i]->run(in, out);
+}
+
+/* end of the segment of s starting at begin: just past a whitespace after _prepare_segment bytes */
+size_t CustomParser::_segment_end(const char *s, size_t begin, size_t size)
+{
+	size_t end;
+
+	if (size - begin <= _prepare_segment)
+		return size;
+	for (end = begin + _prepare_segment; end < size; end++) {
+		if (s[end] == ' ' || s[end] == '\t' || s[end] == '\n' || s[end] == '\r')
+			return end + 1;
+	}
+	return size;
+}
+
+/*
+ * Depth-first execution of the chain: prepare runs over the text a
+ * segment at a time, cut after a whitespace where it splits the text the
+ * same way as whole, and its tokens are handed down pipeline_chunk at a
+ * time, to the stage threads or through every stage in turn. Only a few
+ * chunks of tokens are in flight besides the result, and every stage
+ * works on a few sentences still in cache.
+ */
+void CustomParser::_pipeline(const char *s, bool threaded, std::vector<TokenImpl *> &out)
+{
+	std::vector<TokenImpl *> segment, prepared;
+	size_t i, begin, end, size, chars, from = 0;
+	TokenImpl *token;
+	bool flushed = false;
+
+	size = strlen(s);
+	chars = 0;
+	try {
+		for (begin = 0; !flushed; begin = end) {
+			end = _segment_end(s, begin, size);
+			token = new TokenImpl(std::string(s + begin, end - begin).c_str());
+			token->set_span(TokenImpl::span_t(begin, end, chars, chars + token->get_length()));
+			chars += token->get_length();
+			segment.push_back(token);
+			_run(0, segment, prepared);
+			segment.clear();
+
+			for (from = 0; prepared.size() - from >= (size_t)_pipeline_chunk; from += _pipeline_chunk)
+				_pipeline_feed(prepared, from, from + _pipeline_chunk, threaded, false, out);
+			if (end == size) {
+				_pipeline_feed(prepared, from, prepared.size(), threaded, true, out);
+				from = prepared.size();
+				flushed = true;
+			}
+			prepared.erase(prepared.begin(), prepared.begin() + from);
+		}
+	} catch (...) {
+		/* the token of the segment is prepare's to delete */
+		for (i = from; i < prepared.size(); i++)
+			delete prepared[i];
+		if (threaded && !flushed)
+			_queues[1]->push(NULL);
+		throw;
+	}
+}
+
+/* hands tokens[begin, end) to the stages after prepare, flushing them after the last ones */
+void CustomParser::_pipeline_feed(std::vector<TokenImpl *> &tokens, size_t begin, size_t end,
+		bool threaded, bool flush, std::vector<TokenImpl *> &out)
+{
+	size_t i, from, next_from, length;
+
+	if (threaded) {
+		if (end > begin)
+			_queues[1]->push(new std::vector<TokenImpl *>(tokens.begin() + begin, tokens.begin() + end));
+		/* a NULL batch flushes the stages */
+		if (flush)
+			_queues[1]->push(NULL);
+		return;
+	}
+
+	length = _processors.size();
+	from = _pending[1].size();
+	_pending[1].insert(_pending[1].end(), tokens.begin() + begin, tokens.begin() + end);
+	for (i = 1; i < length; i++) {
+		std::vector<TokenImpl *> &next = (i + 1 < length)?_pending[i + 1]:out;
+
+		next_from = next.size();
+		_pipeline_stage(i, from, flush, next);
+		from = next_from;
+	}
+}
+
+/*
+ * Run processor i over the head of its pending tokens which it can split
+ * from the rest; the tail waits for the following chunk unless flushing.
+ * Pairs of tokens before from were already refused by the processor.
+ */
+void CustomParser::_pipeline_stage(size_t i, size_t from, bool flush, std::vector<TokenImpl *> &out)
+{
+	std::vector<TokenImpl *> &in = _pending[i], &carry = _carry[i];
+	size_t cut, j;
+
+	if (in.empty()) return;
+	if (flush) {
+		cut = in.size();
+	} else {
+		for (cut = 0, j = in.size() - 1; j > 0 && j >= from; j--) {
+			if (_processors[i]->can_split(in[j - 1], in[j])) {
+				cut = j;
+				break;
+			}
+		}
+		if (cut == 0) return;
+	}
+
+	carry.assign(in.begin() + cut, in.end());
+	in.resize(cut);
+	try {
+		_run(i, in, out);
+	} catch (...) {
+		/* the head is the failed processor's, which already deleted or passed on some of it */
+		in.swap(carry);
+		carry.clear();
+		throw;
+	}
+	in.swap(carry);
+	carry.clear();
+}
+
+/* deletes the tokens held by stage i after it failed, those it made for the next stage included */
+void CustomParser::_pipeline_drop(size_t i, std::vector<TokenImpl *> *next)
+{
+	size_t j;
+
+	for (j = 0; j < _pending[i].size(); j++)
+		delete _pending[i][j];
+	_pending[i].clear();
+	for (j = 0; j < _carry[i].size(); j++)
+		delete _carry[i][j];
+	_carry[i].clear();
+	if (next && next != _pipeline_result) {
+		for (j = 0; j < next->size(); j++)
+			delete (*next)[j];
+		delete next;
+	}
+}
+
+struct CustomParser::_stage_t {
+	CustomParser *parser;
+	size_t i;
+	_batch_queue_t *in, *out;
+	unsigned long round;
+	std::string error;
+	bool failed;
+};
+
+/*
+ * Thread of stage i >= 1 in pipeline_threads mode, living as long as
+ * the chain: sleeps until a parse starts a new round, then takes batches
+ * of tokens from the previous stage until a NULL batch ends the text,
+ * and passes what its processor made of them on to the next stage, or
+ * to the result for the last one.
+ */
+void *CustomParser::_stage_work(void *arg)
+{
+	_stage_t *stage = (_stage_t *)arg;
+	CustomParser *parser = stage->parser;
+	std::vector<TokenImpl *> *batch, *next;
+	size_t j, from;
+	bool stop;
+
+	for (;;) {
+		pthread_mutex_lock(&parser->_pipeline_lock);
+		while (stage->round == parser->_pipeline_round && !parser->_pipeline_exit)
+			pthread_cond_wait(&parser->_pipeline_cond, &parser->_pipeline_lock);
+		stage->round = parser->_pipeline_round;
+		stop = parser->_pipeline_exit;
+		pthread_mutex_unlock(&parser->_pipeline_lock);
+		if (stop) break;
+
+		do {
+			stage->in->pop(batch);
+			if (stage->failed) {
+				/* drain the text so that earlier stages never block */
+				if (batch) {
+					for (j = 0; j < batch->size(); j++)
+						delete (*batch)[j];
+					delete batch;
+				}
+				continue;
+			}
+			next = NULL;
+			try {
+				from = parser->_pending[stage->i].size();
+				if (batch) {
+					parser->_pending[stage->i].insert(parser->_pending[stage->i].end(),
+							batch->begin(), batch->end());
+					delete batch;
+				}
+				next = (stage->out)?new std::vector<TokenImpl *>:parser->_pipeline_result;
+				parser->_pipeline_stage(stage->i, from, batch == NULL, *next);
+				if (stage->out && next->empty())
+					delete next;
+				else if (stage->out)
+					stage->out->push(next);
+			} catch (std::exception &e) {
+				stage->error = e.what();
+				stage->failed = true;
+				parser->_pipeline_drop(stage->i, next);
+			}
+		} while (batch);
+		if (stage->out) stage->out->push(NULL);
+
+		pthread_mutex_lock(&parser->_pipeline_lock);
+		parser->_pipeline_done++;
+		pthread_cond_broadcast(&parser->_pipeline_cond);
+		pthread_mutex_unlock(&parser->_pipeline_lock);
+	}
+	return NULL;
+}
+
+/* starts a thread for every stage after prepare, false if one can not be */
+bool CustomParser::_pipeline_start()
+{
+	size_t i, length;
+	pthread_t thread;
+
+	length = _processors.size();
+	_queues.resize(length + 1, NULL);
+	_stages.resize(length, NULL);
+	for (i = 1; i < length; i++)
+		_queues[i] = new _batch_queue_t(_pipeline_queue_size);
+	for (i = 1; i < length; i++) {
+		_stages[i] = new _stage_t;
+		_stages[i]->parser = this;
+		_stages[i]->i = i;
+		_stages[i]->in = _queues[i];
+		_stages[i]->out = _queues[i + 1];
+		_stages[i]->round = _pipeline_round;
+		_stages[i]->failed = false;
+	}
+	for (i = 1; i < length; i++) {
+		if (pthread_create(&thread, NULL, _stage_work, _stages[i]) != 0) {
+			_pipeline_stop();
+			return false;
+		}
+		_threads.push_back(thread);
+	}
+	return true;
+}
+
+void CustomParser::_pipeline_stop()
+{
+	size_t i;
+
+	pthread_mutex_lock(&_pipeline_lock);
+	_pipeline_exit = true;
+	pthread_cond_broadcast(&_pipeline_cond);
+	pthread_mutex_unlock(&_pipeline_lock);
+	for (i = 0; i < _threads.size(); i++)
+		pthread_join(_threads[i], NULL);
+	for (i = 0; i < _stages.size(); i++) {
+		delete _stages[i];
+		delete _queues[i];
+	}
+	_threads.clear();
+	_stages.clear();
+	_queues.clear();
+	_pipeline_exit = false;
+}
+
+/*
+ * Pipeline-parallel execution of the chain after prepare: every later
+ * processor runs on its own thread, fed through bounded queues of
+ * pipeline_chunk token batches. The threads are started by the first
+ * parse and kept for the following ones. Starts a round whose result
+ * goes to out, or returns false when the threads can not be started.
+ */
+bool CustomParser::_pipeline_begin(std::vector<TokenImpl *> &out)
+{
+	size_t i, length;
+
+	length = _processors.size();
+	if (_threads.empty() && !_pipeline_start())
+		return false;
+
+	/* the stages sleep between rounds, so their state is ours to reset */
+	for (i = 1; i < length; i++) {
+		_stages[i]->failed = false;
+		_stages[i]->error.clear();
+	}
+	pthread_mutex_lock(&_pipeline_lock);
+	_pipeline_result = &out;
+	_pipeline_done = 0;
+	_pipeline_round++;
+	pthread_cond_broadcast(&_pipeline_cond);
+	pthread_mutex_unlock(&_pipeline_lock);
+	return true;
+}
+
+/* waits for the stages to flush the round, throws the error of a failed one */
+void CustomParser::_pipeline_wait(std::vector<TokenImpl *> &out)
+{
+	size_t i, length;
+	std::string error;
+
+	length = _processors.size();
+	pthread_mutex_lock(&_pipeline_lock);
+	while (_pipeline_done < length - 1)
+		pthread_cond_wait(&_pipeline_cond, &_pipeline_lock);
+	pthread_mutex_unlock(&_pipeline_lock);
+
+	for (i = 1; i < length; i++) {
+		if (_stages[i]->failed && error.empty())
+			error = _stages[i]->error;
+	}
+	if (!error.empty()) {
+		for (i = 0; i < out.size(); i++)
+			delete out[i];
+		out.clear();
+		throw std::runtime_error(error);
+	}
+}
+
 int
 CustomParser::parse(std::vector<Token *> &out)
 {
-#ifdef TIMING	
-	struct timeval tv[2];
-	struct timezone tz;
-#endif
-	size_t i, length, space_cnt = 0;
+	size_t i, length, chars, space_cnt = 0;
 	const char *s;
+	bool threaded;
 
 	s = (const char *)getopt(BAMBOO_OPTION_TEXT);
 
-	length = utf8::length(s);
+	chars = utf8::length(s);
 	_in->clear();
-	if (length > _in->capacity()) {
-		_in->reserve(length << 1);
-		_out->reserve(length << 1);
-	}
-	_in->push_back(new TokenImpl(s));
+	if (chars > _in->capacity())
+		_in->reserve(chars << 1);
 	length = _processors.size();
-	for (i = 0; i < length; i++) {
-		_out->clear();
-#ifdef TIMING		
-		gettimeofday(&tv[0], &tz);
-#endif
-		_processors[i]->process(*_in, *_out);
-#ifdef TIMING
-		gettimeofday(&tv[1], &tz);
-		_timing_process[i] += (tv[1].tv_sec - tv[0].tv_sec) * 1000000 + (tv[1].tv_usec - tv[0].tv_usec);
-#endif
-		/* switch in & out queue */
-		_swap = _out;
-		_out = _in;
-		_in = _swap;
+	if (_pipeline_chunk > 0 && length > 1) {
+		_pending.resize(length);
+		_carry.resize(length);
+		for (i = 0; i < length; i++)
+			_pending[i].clear();
+		threaded = _pipeline_threads && _pipeline_begin(*_in);
+		try {
+			_pipeline(s, threaded, *_in);
+		} catch (...) {
+			if (threaded) {
+				try {
+					_pipeline_wait(*_in);
+				} catch (std::runtime_error &) {
+				}
+				for (i = 0; i < _in->size(); i++)
+					delete (*_in)[i];
+				_in->clear();
+			}
+			throw;
+		}
+		if (threaded)
+			_pipeline_wait(*_in);
+	} else {
+		if (chars > _out->capacity())
+			_out->reserve(chars << 1);
+		_in->push_back(new TokenImpl(s));
+		for (i = 0; i < length; i++) {
+			_out->clear();
+			_run(i, *_in, *_out);
+			/* switch in & out queue */
+			_swap = _out;
+			_out = _in;
+			_in = _swap;
+		}
 	}
 
 	length = _in->size();
@@ -169,16 +529,22 @@ CustomParser::parse(std::vector<Token *> &out)
 
 void CustomParser::set(std::string s) 
 {
+	if (_config == NULL)
+		throw std::runtime_error("spawned parser can not be reconfigured");
 	(*_config) << s;
 }
 
 void CustomParser::set(std::string key, std::string val) 
 {
+	if (_config == NULL)
+		throw std::runtime_error("spawned parser can not be reconfigured");
 	(*_config)[key] = val;
 }
 
 void CustomParser::reload() 
 {
+	if (_config == NULL)
+		throw std::runtime_error("spawned parser can not be reloaded");
 	_fini();
 	_init();
 }
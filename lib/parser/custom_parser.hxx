@@ -29,6 +29,7 @@
 #ifndef CUSTOM_PARSER_HXX
 #define CUSTOM_PARSER_HXX
 
+#include <pthread.h>
 #include <stdexcept>
 #include <cstring>
 #include <vector>
@@ -38,6 +39,7 @@
 #include "processor_factory.hxx"
 #include "token_impl.hxx"
 #include "parser.hxx"
+#include "spsc_queue.hxx"
 
 namespace bamboo {
 
@@ -45,6 +47,8 @@ namespace bamboo {
 class CustomParser:public Parser {
 public:
 	CustomParser(const char *file, bool verbose);
+	CustomParser(const CustomParser &rhs);
+	Parser *spawn() {return new CustomParser(*this);}
 	int parse(std::vector<Token *> &out);
 	void reload();
 	void set(std::string key, std::string val); 
@@ -57,13 +61,41 @@ protected:
 	std::vector<TokenImpl *> _token_fifo[2];
 	std::vector<TokenImpl *> *_in, *_out, *_swap;
 	std::vector<Processor *> _processors;
+	int _pipeline_chunk, _pipeline_threads;
+	std::vector<std::vector<TokenImpl *> > _pending, _carry;
+
+	typedef SPSCQueue<std::vector<TokenImpl *> *> _batch_queue_t;
+	struct _stage_t;
+	static const size_t _pipeline_queue_size = 16;
+	/* bytes of text prepared at a time in pipeline mode */
+	static const size_t _prepare_segment = 4096;
+	/* the stage threads of pipeline_threads mode, started by the first parse */
+	std::vector<_stage_t *> _stages;
+	std::vector<_batch_queue_t *> _queues;
+	std::vector<pthread_t> _threads;
+	pthread_mutex_t _pipeline_lock;
+	pthread_cond_t _pipeline_cond;
+	unsigned long _pipeline_round;
+	size_t _pipeline_done;
+	bool _pipeline_exit;
+	std::vector<TokenImpl *> *_pipeline_result;
 
 	void _init();
 	void _fini();
+	inline void _run(size_t i, std::vector<TokenImpl *> &in, std::vector<TokenImpl *> &out);
+	static size_t _segment_end(const char *s, size_t begin, size_t size);
+	void _pipeline(const char *s, bool threaded, std::vector<TokenImpl *> &out);
+	void _pipeline_feed(std::vector<TokenImpl *> &tokens, size_t begin, size_t end,
+			bool threaded, bool flush, std::vector<TokenImpl *> &out);
+	void _pipeline_stage(size_t i, size_t from, bool flush, std::vector<TokenImpl *> &out);
+	void _pipeline_drop(size_t i, std::vector<TokenImpl *> *next);
+	bool _pipeline_begin(std::vector<TokenImpl *> &out);
+	void _pipeline_wait(std::vector<TokenImpl *> &out);
+	bool _pipeline_start();
+	void _pipeline_stop();
+	void _pipeline_init();
+	static void *_stage_work(void *arg);
 	inline void _lazy_create_config(const char *);
-#ifdef TIMING
-	size_t _timing_process[128];
-#endif
 };
 
 } //namespace bamboo
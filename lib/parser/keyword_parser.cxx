@@ -28,6 +28,7 @@
 
 #include <sys/time.h>
 #include <sys/types.h>
+#include <pthread.h>
 #include <sys/stat.h>
 #include <unistd.h>
 #include <iostream>
@@ -39,8 +40,11 @@
 
 namespace bamboo {
 
+/* kea keeps its dictionaries and segmenter in process-wide singletons */
+static pthread_mutex_t _kea_lock = PTHREAD_MUTEX_INITIALIZER;
+
 KeywordParser::KeywordParser(const char *file, bool verbose)
-:_verbose(verbose), _config(NULL), _ke(NULL)
+:_verbose(verbose), _config(NULL), _ke(NULL), _spawned(false)
 {
 	ConfigFinder * finder;
 
@@ -52,8 +56,13 @@ KeywordParser::KeywordParser(const char *file, bool verbose)
 	_ke = new bamboo::kea::KeywordExtractor(_config);
 }
 
+KeywordParser::KeywordParser(const KeywordParser &rhs)
+:_verbose(rhs._verbose), _config(NULL), _ke(rhs._ke), _spawned(true)
+{
+}
+
 KeywordParser::~KeywordParser() {
-	if(_ke) {
+	if(_ke && !_spawned) {
 		delete _ke;
 	}
 }
@@ -67,7 +76,14 @@ int KeywordParser::parse(std::vector<Token *> &out) {
 
 	std::vector<std::string> res;
 	res.reserve(_ke->max_keywords());
-	_ke->get_keyword(title, text, res);
+	pthread_mutex_lock(&_kea_lock);
+	try {
+		_ke->get_keyword(title, text, res);
+	} catch (...) {
+		pthread_mutex_unlock(&_kea_lock);
+		throw;
+	}
+	pthread_mutex_unlock(&_kea_lock);
 	len = res.size();
 	for(i=0; i<len; ++i) {
 		out.push_back(new TokenImpl(res[i].c_str()));
@@ -46,12 +46,15 @@ namespace bamboo {
 class KeywordParser:public Parser {
 public:
 	KeywordParser(const char *file, bool verbose);
+	KeywordParser(const KeywordParser &rhs);
+	Parser *spawn() {return new KeywordParser(*this);}
 	~KeywordParser();
 	int parse(std::vector<Token *> &out);
 protected:
 	int _verbose;
 	IConfig	* _config;
 	bamboo::kea::KeywordExtractor * _ke;
+	bool _spawned;
 };
 
 } //namespace bamboo
@@ -45,6 +45,8 @@ namespace bamboo {
 class MFMSegParser:public Parser {
 public:
 	MFMSegParser(const char *file, bool verbose);
+	MFMSegParser(const MFMSegParser &rhs);
+	Parser *spawn() {return new MFMSegParser(*this);}
 	~MFMSegParser();
 	int parse(std::vector<Token *> &out);
 protected:
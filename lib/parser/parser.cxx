@@ -1,6 +1,106 @@
+#include <pthread.h>
+#include <unistd.h>
 #include "parser.hxx"
 
 namespace bamboo {
+
+/* documents [head, tail) of a batch still owned by one worker */
+typedef struct {
+	pthread_mutex_t lock;
+	size_t head, tail;
+} _batch_queue_t;
+
+typedef struct {
+	const char **texts;
+	Parser::on_batch_result_t cb;
+	void *arg;
+	std::vector<_batch_queue_t> queues;
+	pthread_mutex_t error_lock;
+	std::string error;
+	volatile bool failed;
+} _batch_t;
+
+typedef struct {
+	_batch_t *batch;
+	Parser *parser;
+	size_t id;
+} _batch_worker_t;
+
+static bool _batch_next(_batch_t *batch, size_t id, size_t &doc)
+{
+	_batch_queue_t *q = &batch->queues[id], *victim;
+	size_t i, head, tail, n = batch->queues.size();
+
+	if (batch->failed) return false;
+
+	pthread_mutex_lock(&q->lock);
+	if (q->head < q->tail) {
+		doc = q->head++;
+		pthread_mutex_unlock(&q->lock);
+		return true;
+	}
+	pthread_mutex_unlock(&q->lock);
+
+	/* own queue is drained: steal the back half of the next busy one */
+	for (i = 1; i < n; i++) {
+		victim = &batch->queues[(id + i) % n];
+		pthread_mutex_lock(&victim->lock);
+		tail = victim->tail;
+		head = victim->head + ((victim->tail - victim->head) >> 1);
+		victim->tail = head;
+		pthread_mutex_unlock(&victim->lock);
+		if (head < tail) {
+			pthread_mutex_lock(&q->lock);
+			q->head = head + 1;
+			q->tail = tail;
+			pthread_mutex_unlock(&q->lock);
+			doc = head;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void *_batch_work(void *arg)
+{
+	_batch_worker_t *worker = (_batch_worker_t *)arg;
+	_batch_t *batch = worker->batch;
+	std::vector<Token *> tokens;
+	size_t doc, i;
+
+	try {
+		while (_batch_next(batch, worker->id, doc)) {
+			tokens.clear();
+			worker->parser->setopt(BAMBOO_OPTION_TEXT, batch->texts[doc]);
+			worker->parser->parse(tokens);
+			batch->cb(doc, tokens, batch->arg);
+		}
+	} catch (std::exception &e) {
+		for (i = 0; i < tokens.size(); i++)
+			delete tokens[i];
+		pthread_mutex_lock(&batch->error_lock);
+		if (!batch->failed) batch->error = e.what();
+		batch->failed = true;
+		pthread_mutex_unlock(&batch->error_lock);
+	}
+
+	return NULL;
+}
+
+static void _batch_collect(size_t i, std::vector<Token *> &tokens, void *arg)
+{
+	(*(std::vector<std::vector<Token *> > *)arg)[i].swap(tokens);
+}
+
+Parser::~Parser()
+{
+	size_t i;
+
+	for (i = 0; i < _workers.size(); i++)
+		delete _workers[i];
+}
+
 void Parser::setopt(enum bamboo_option option, const void *arg)
 {
 	switch (option) {
@@ -10,6 +110,9 @@ void Parser::setopt(enum bamboo_option option, const void *arg)
 		case BAMBOO_OPTION_TITLE:
 			_options["title"] = arg;
 			break;
+		case BAMBOO_OPTION_THREADS:
+			_num_threads = *(const int *)arg;
+			break;
 	}
 }
 
@@ -20,9 +123,112 @@ const void *Parser::getopt(enum bamboo_option option)
 			return _options["text"];
 		case BAMBOO_OPTION_TITLE:
 			return _options["title"];
+		case BAMBOO_OPTION_THREADS:
+			return &_num_threads;
 	}
 
 	return NULL;
 }
 
+void Parser::set_text(const char *text, size_t len)
+{
+	_text.assign(text, len);
+	setopt(BAMBOO_OPTION_TEXT, _text.c_str());
+}
+
+int Parser::parse_batch(const char **texts, size_t n, std::vector<std::vector<Token *> > &out)
+{
+	size_t i, j;
+
+	out.clear();
+	out.resize(n);
+	try {
+		return parse_batch(texts, n, _batch_collect, &out);
+	} catch (...) {
+		for (i = 0; i < out.size(); i++)
+			for (j = 0; j < out[i].size(); j++)
+				delete out[i][j];
+		out.clear();
+		throw;
+	}
+}
+
+int Parser::parse_batch(const char **texts, size_t n, on_batch_result_t cb, void *arg)
+{
+	std::vector<_batch_worker_t> workers;
+	std::vector<pthread_t> threads;
+	std::vector<bool> started;
+	std::vector<Token *> tokens;
+	const void *text;
+	size_t i, num_threads;
+	_batch_t batch;
+
+	if (n == 0) return 0;
+	num_threads = (_num_threads > 0)?_num_threads:sysconf(_SC_NPROCESSORS_ONLN);
+	if (num_threads > n) num_threads = n;
+	if (num_threads < 1) num_threads = 1;
+
+	/* spawned chains are kept for the next batch */
+	try {
+		while (num_threads > 1 && _workers.size() < num_threads)
+			_workers.push_back(spawn());
+	} catch (std::runtime_error &e) {
+		if (_workers.size() < num_threads)
+			num_threads = _workers.size();
+	}
+
+	if (num_threads <= 1) {
+		text = getopt(BAMBOO_OPTION_TEXT);
+		try {
+			for (i = 0; i < n; i++) {
+				tokens.clear();
+				setopt(BAMBOO_OPTION_TEXT, texts[i]);
+				parse(tokens);
+				cb(i, tokens, arg);
+			}
+		} catch (...) {
+			setopt(BAMBOO_OPTION_TEXT, text);
+			throw;
+		}
+		setopt(BAMBOO_OPTION_TEXT, text);
+		return 0;
+	}
+
+	batch.texts = texts;
+	batch.cb = cb;
+	batch.arg = arg;
+	batch.failed = false;
+	pthread_mutex_init(&batch.error_lock, NULL);
+	batch.queues.resize(num_threads);
+	workers.resize(num_threads);
+	threads.resize(num_threads);
+	started.resize(num_threads, false);
+	for (i = 0; i < num_threads; i++) {
+		pthread_mutex_init(&batch.queues[i].lock, NULL);
+		batch.queues[i].head = n * i / num_threads;
+		batch.queues[i].tail = n * (i + 1) / num_threads;
+		workers[i].batch = &batch;
+		workers[i].parser = _workers[i];
+		workers[i].id = i;
+		/* the title and the other options of this parser hold for the batch */
+		_workers[i]->_options = _options;
+	}
+
+	/* the calling thread works too; documents of threads failing to
+	 * start are stolen by the others */
+	for (i = 1; i < num_threads; i++)
+		started[i] = (pthread_create(&threads[i], NULL, _batch_work, &workers[i]) == 0);
+	_batch_work(&workers[0]);
+	for (i = 1; i < num_threads; i++)
+		if (started[i]) pthread_join(threads[i], NULL);
+
+	for (i = 0; i < num_threads; i++)
+		pthread_mutex_destroy(&batch.queues[i].lock);
+	pthread_mutex_destroy(&batch.error_lock);
+
+	if (batch.failed)
+		throw std::runtime_error(batch.error);
+	return 0;
+}
+
 };
@@ -4,6 +4,7 @@
 #include <vector>
 #include <string>
 #include <map>
+#include <stdexcept>
 
 #include "bamboo_defs.h"
 #include "token.hxx"
@@ -14,13 +15,44 @@ class Parser {
 private:
 	void *_handle;
 	std::map<std::string, const void *> _options;
+	int _num_threads;
+	std::vector<Parser *> _workers;
+	std::string _text;
 public:
-	Parser () {};
+	typedef void (*on_batch_result_t)(size_t i, std::vector<Token *> &tokens, void *arg);
+
+	Parser ():_num_threads(0) {};
 	Parser (const char *filename);
 	virtual void setopt(enum bamboo_option option, const void *arg);
 	virtual const void *getopt(enum bamboo_option option);
+	/* set BAMBOO_OPTION_TEXT from a text that is not NUL terminated,
+	 * the copy lives in a buffer owned and reused by the parser */
+	void set_text(const char *text, size_t len);
 	virtual int parse(std::vector<Token *> &out)=0;
-	virtual ~Parser() {};
+	/*
+	 * Parse n texts on a pool of spawned copies of this parser, one per
+	 * thread (BAMBOO_OPTION_THREADS, 0 for one per online CPU). Idle
+	 * threads steal documents from busy ones. out[i] receives the tokens
+	 * of texts[i]; the callback form hands them over on the worker thread
+	 * instead. Parsers that can not be spawned parse the batch serially.
+	 * The copies parse with the options of this parser, the title
+	 * included. When a document fails, the batch stops and the error is
+	 * thrown; tokens already in out are deleted first, those already
+	 * handed to the callback are its own.
+	 */
+	int parse_batch(const char **texts, size_t n, std::vector<std::vector<Token *> > &out);
+	int parse_batch(const char **texts, size_t n, on_batch_result_t cb, void *arg);
+	/*
+	 * Create a parser sharing the lexicons and models already loaded
+	 * by this one. Each copy keeps its own options and token buffers,
+	 * so copies may run on different threads at the same time. This
+	 * parser must outlive every copy spawned from it.
+	 */
+	virtual Parser *spawn()
+	{
+		throw std::runtime_error("parser can not be spawned");
+	}
+	virtual ~Parser();
 };
 
 };
@@ -41,6 +41,7 @@ namespace bamboo {
 		register_parser("crf_ner_nt", CRFNTParser);
 		register_parser("crf_ner_np", CRFNPParser);
 		register_parser("keyword", KeywordParser);
+		register_parser("custom", CustomParser);
 #undef register_parser
 		return NULL;
 	}
@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2008, detrox@gmail.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <organization> nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY detrox@gmail.com ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL detrox@gmail.com BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#include <cctype>
+#include <cstring>
+
+#include "stream_parser.hxx"
+#include "token_impl.hxx"
+#include "utf8.hxx"
+
+namespace bamboo {
+
+
+StreamParser::StreamParser(Parser *parser, on_tokens_t cb, void *arg,
+		size_t chunk_size, size_t max_sentence)
+:_parser(parser), _cb(cb), _arg(arg), _chunk_size(chunk_size),
+ _max_sentence(max_sentence), _offset(0), _char_offset(0)
+{
+	if (_max_sentence < _chunk_size)
+		_max_sentence = _chunk_size;
+}
+
+void StreamParser::feed(const char *data, size_t len)
+{
+	size_t n, cut;
+
+	while (len > 0) {
+		n = (len < _chunk_size)?len:_chunk_size;
+		_buffer.append(data, n);
+		data += n;
+		len -= n;
+		if (_buffer.size() < _chunk_size) continue;
+
+		cut = _find_cut();
+		if (cut > 0) _parse(cut);
+	}
+}
+
+void StreamParser::flush()
+{
+	if (!_buffer.empty()) _parse(_buffer.size());
+}
+
+/*
+ * end of the last complete sentence in the buffer, 0 if none. Cuts
+ * after whitespace are preferred, since no processor looks across it.
+ */
+size_t StreamParser::_find_cut()
+{
+	static const char *stops[] = {"。", "！", "？", "；", NULL};
+	const char *s = _buffer.data(), **stop;
+	size_t i;
+
+	for (i = _buffer.size(); i > 0; i--) {
+		if (isspace((unsigned char)s[i - 1])) return i;
+	}
+	for (i = _buffer.size(); i > 0; i--) {
+		if (s[i - 1] == '!' || s[i - 1] == '?' || s[i - 1] == ';') return i;
+		if (i >= 3) {
+			for (stop = stops; *stop; stop++)
+				if (memcmp(s + i - 3, *stop, 3) == 0) return i;
+		}
+	}
+
+	/* no boundary at all: cut a runaway sentence on a character boundary */
+	if (_buffer.size() >= _max_sentence) {
+		i = _buffer.size();
+		while (i > 0 && (s[i - 1] & 0xc0) == 0x80) i--;
+		if (i > 0 && (s[i - 1] & 0x80)) i--;
+		return i;
+	}
+	return 0;
+}
+
+void StreamParser::_parse(size_t cut)
+{
+	size_t i, chars;
+	char saved;
+
+	/* parse the head of the buffer in place */
+	saved = _buffer[cut];
+	_buffer[cut] = '\0';
+	_tokens.clear();
+	try {
+		_parser->setopt(BAMBOO_OPTION_TEXT, _buffer.c_str());
+		_parser->parse(_tokens);
+	} catch (...) {
+		_buffer[cut] = saved;
+		throw;
+	}
+	chars = utf8::length(_buffer.c_str());
+	_buffer[cut] = saved;
+
+	for (i = 0; i < _tokens.size(); i++) {
+		TokenImpl *token = static_cast<TokenImpl *>(_tokens[i]);
+		TokenImpl::span_t span = token->get_span();
+		span.begin += _offset;
+		span.end += _offset;
+		span.char_begin += _char_offset;
+		span.char_end += _char_offset;
+		token->set_span(span);
+	}
+
+	_buffer.erase(0, cut);
+	_offset += cut;
+	_char_offset += chars;
+	_cb(_tokens, _arg);
+}
+
+} //namespace bamboo
@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2008, detrox@gmail.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <organization> nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY detrox@gmail.com ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL detrox@gmail.com BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#ifndef STREAM_PARSER_HXX
+#define STREAM_PARSER_HXX
+
+#include <string>
+#include <vector>
+
+#include "parser.hxx"
+
+namespace bamboo {
+
+
+/*
+ * Feeds a text of any size through a parser piece by piece. Input is
+ * buffered until at least chunk_size bytes are waiting, then parsed up
+ * to the last whitespace, or failing that the last 。！？；!?;, and the
+ * tokens are handed to the callback, which owns them from then on.
+ * Token offsets are relative to the start of the whole stream. A
+ * sentence longer than max_sentence bytes is cut where it stands.
+ */
+class StreamParser {
+public:
+	typedef void (*on_tokens_t)(std::vector<Token *> &tokens, void *arg);
+
+	StreamParser(Parser *parser, on_tokens_t cb, void *arg,
+			size_t chunk_size = 65536, size_t max_sentence = 1 << 20);
+	void feed(const char *data, size_t len);
+	void flush();
+
+protected:
+	Parser *_parser;
+	on_tokens_t _cb;
+	void *_arg;
+	size_t _chunk_size, _max_sentence;
+	std::string _buffer;
+	std::vector<Token *> _tokens;
+	size_t _offset, _char_offset;
+
+	size_t _find_cut();
+	void _parse(size_t cut);
+};
+
+} //namespace bamboo
+
+#endif
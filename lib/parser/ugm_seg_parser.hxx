@@ -45,6 +45,8 @@ namespace bamboo {
 class UGMSegParser:public Parser {
 public:
 	UGMSegParser(const char *file, bool verbose);
+	UGMSegParser(const UGMSegParser &rhs);
+	Parser *spawn() {return new UGMSegParser(*this);}
 	~UGMSegParser();
 	int parse(std::vector<Token *> &out);
 protected:
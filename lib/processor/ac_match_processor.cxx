@@ -0,0 +1,150 @@
+/*
+ * Copyright (c) 2008, detrox@gmail.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <organization> nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY detrox@gmail.com ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL detrox@gmail.com BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#include <cstring>
+#include <stdexcept>
+
+#include "resource_registry.hxx"
+#include "ac_match_processor.hxx"
+
+namespace bamboo {
+
+
+PROCESSOR_MAGIC
+PROCESSOR_MODULE(ACMatchProcessor)
+
+static void *_load_automaton(const char *filename, const char *)
+{
+	return new ACAutomaton(filename);
+}
+
+static void _unload_automaton(void *automaton)
+{
+	delete (ACAutomaton *)automaton;
+}
+
+ACMatchProcessor::ACMatchProcessor(IConfig *config)
+	:_automaton(NULL), _merge(true)
+{
+	const char *s;
+
+	config->get_value("ac_match_pos", s);
+	_pos = s;
+	config->get_value("ac_match_mode", s);
+	if (strcmp(s, "tag") == 0)
+		_merge = false;
+	else if (*s != '\0' && strcmp(s, "merge") != 0)
+		throw std::runtime_error("ac_match_mode must be merge or tag");
+	if (!_merge && _pos.empty())
+		throw std::runtime_error("ac_match_pos is null");
+	config->get_value("ac_match_lexicon", s);
+	if (*s == '\0')
+		throw std::runtime_error("ac_match_lexicon is null");
+	_automaton = (ACAutomaton *)ResourceRegistry::get_instance()->acquire(
+			"ac_automaton", s, NULL, _load_automaton, _unload_automaton);
+}
+
+ACMatchProcessor::ACMatchProcessor(const ACMatchProcessor &rhs)
+	:Processor(rhs), _automaton(rhs._automaton), _pos(rhs._pos), _merge(rhs._merge)
+{
+	ResourceRegistry::get_instance()->retain(_automaton);
+}
+
+ACMatchProcessor::~ACMatchProcessor()
+{
+	ResourceRegistry::get_instance()->release(_automaton);
+}
+
+/* tokens [begin, end) of in, a phrase */
+void ACMatchProcessor::_emit(std::vector<TokenImpl *> &in, size_t begin, size_t end,
+		std::vector<TokenImpl *> &out)
+{
+	std::string token, orig;
+	TokenImpl::span_t span;
+	int attr;
+	size_t i;
+
+	if (!_merge || end - begin == 1) {
+		for (i = begin; i < end; i++) {
+			if (!_pos.empty()) in[i]->set_pos(_pos.c_str());
+			out.push_back(in[i]);
+		}
+		return;
+	}
+	attr = in[begin]->get_attr();
+	for (i = begin; i < end; i++) {
+		token.append(in[i]->get_token());
+		orig.append(in[i]->get_orig_token());
+		span.join(in[i]->get_span());
+		if (in[i]->get_attr() != attr) attr = TokenImpl::attr_cword;
+		delete in[i];
+	}
+	out.push_back(new TokenImpl(token.c_str(), orig.c_str(), attr));
+	out.back()->set_span(span);
+	if (!_pos.empty()) out.back()->set_pos(_pos.c_str());
+}
+
+void ACMatchProcessor::process(std::vector<TokenImpl *> &in, std::vector<TokenImpl *> &out)
+{
+	size_t i, size, off;
+	long begin, end;
+
+	size = in.size();
+	if (size == 0) return;
+
+	/* the text of the tokens, and the token starting at each byte of it */
+	_text.clear();
+	for (i = 0; i < size; i++)
+		_text.append(in[i]->get_token());
+	_token_at.assign(_text.size() + 1, -1);
+	for (i = 0, off = 0; i < size; off += in[i++]->get_bytes())
+		if (_token_at[off] < 0) _token_at[off] = i;
+	if (_token_at[off] < 0) _token_at[off] = size;
+
+	/* the longest phrase on token boundaries starting at each token */
+	_matches.clear();
+	_automaton->match(_text.data(), _text.size(), _matches);
+	_phrase_end.assign(size, 0);
+	for (i = 0; i < _matches.size(); i++) {
+		begin = _token_at[_matches[i].begin];
+		end = _token_at[_matches[i].end];
+		if (begin < 0 || end <= begin || _matches[i].value <= 0) continue;
+		if ((size_t)end > _phrase_end[begin]) _phrase_end[begin] = end;
+	}
+
+	for (i = 0; i < size;) {
+		if (_phrase_end[i] > i) {
+			_emit(in, i, _phrase_end[i], out);
+			i = _phrase_end[i];
+		} else {
+			out.push_back(in[i++]);
+		}
+	}
+}
+
+} //namespace bamboo
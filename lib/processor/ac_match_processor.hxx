@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2008, detrox@gmail.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <organization> nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY detrox@gmail.com ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL detrox@gmail.com BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#ifndef AC_MATCH_PROCESSOR_HXX
+#define AC_MATCH_PROCESSOR_HXX
+
+#include "token_impl.hxx"
+#include "processor.hxx"
+#include "ac_automaton.hxx"
+
+namespace bamboo {
+
+
+/*
+ * Spots the phrases of a datrie lexicon in the tokens, whatever their
+ * number, with an Aho-Corasick automaton walking the text of the tokens
+ * once. Of the phrases starting and ending on token boundaries, the
+ * leftmost longest ones are merged into a token each, or only tagged
+ * with ac_match_pos in "tag" mode.
+ */
+class ACMatchProcessor: public Processor {
+protected:
+	ACAutomaton *_automaton;
+	std::string _pos;
+	bool _merge;
+	std::string _text;
+	std::vector<ACAutomaton::match_t> _matches;
+	std::vector<long> _token_at;
+	std::vector<size_t> _phrase_end;
+
+	ACMatchProcessor();
+	bool _can_process(TokenImpl *token) {return true;}
+	void _process(TokenImpl *token, std::vector<TokenImpl *> &out) {}
+	void _emit(std::vector<TokenImpl *> &in, size_t begin, size_t end, std::vector<TokenImpl *> &out);
+
+public:
+	ACMatchProcessor(IConfig *config);
+	ACMatchProcessor(const ACMatchProcessor &rhs);
+	Processor *spawn() {return new ACMatchProcessor(*this);}
+	/* phrases may span any number of tokens */
+	bool can_split(TokenImpl *left, TokenImpl *right) {return false;}
+	~ACMatchProcessor();
+
+	void process(std::vector<TokenImpl *> &in, std::vector<TokenImpl *> &out);
+};
+
+} //namespace bamboo
+
+#endif // AC_MATCH_PROCESSOR_HXX
@@ -40,7 +40,7 @@ PROCESSOR_MAGIC
 PROCESSOR_MODULE(BreakProcessor)
 
 BreakProcessor::BreakProcessor(IConfig *config)
-	:_split(0)
+	:_field(-1), _split(0)
 {
 	const char *s;
 
@@ -49,18 +49,37 @@ BreakProcessor::BreakProcessor(IConfig *config)
 	config->get_value("break_lexicon", s);
 	if (*s == '\0')
 		throw std::runtime_error("break_lexicon is null");
-	_lexicon = LexiconFactory::load(s);
+	_lexicon = LexiconFactory::acquire(s);
+	_records = _lexicon->records(_field);
 	if (_min_token_length < 2) _min_token_length = 2;
 	if (_max_token_length < 1) throw std::runtime_error("max_token_length must greater than 0");
 	_token = new char[(_max_token_length << 2) + 1]; /* x4 for unicode */
 }
 
+BreakProcessor::BreakProcessor(const BreakProcessor &rhs)
+	:Processor(rhs), _lexicon(rhs._lexicon), _records(rhs._records), _field(rhs._field), _split(0),
+	 _min_token_length(rhs._min_token_length), _max_token_length(rhs._max_token_length)
+{
+	LexiconFactory::retain(_lexicon);
+	_token = new char[(_max_token_length << 2) + 1]; /* x4 for unicode */
+}
+
 BreakProcessor::~BreakProcessor()
 {
-	delete _lexicon;
+	LexiconFactory::release(_lexicon);
 	delete []_token;
 }
 
+/* the break bitmap of token, from the record a processor before may have kept on it */
+int BreakProcessor::_search(TokenImpl *token)
+{
+	const RecordLexicon::record_t *record;
+
+	if (_records == NULL) return _lexicon->search(token->get_token());
+	record = _records->resolve(token);
+	return (record)?RecordLexicon::value(record, _field):0;
+}
+
 /*
  * Break Lexicon Format:
  *                      Bitmap Word
@@ -94,6 +113,7 @@ void BreakProcessor::_process(TokenImpl *token, std::vector<TokenImpl *> &out)
 			if (i - j + 1 > 0) {
 				utf8::sub(_token, s, j, i - j + 1);
 				out.push_back(new TokenImpl(_token, TokenImpl::attr_cword));
+				out.back()->set_span(token, j, i - j + 1);
 			}
 			j = i + 1;
 		}
@@ -101,6 +121,7 @@ void BreakProcessor::_process(TokenImpl *token, std::vector<TokenImpl *> &out)
 	if (length - j > 0) {
 		utf8::sub(_token, s, j, length - j);
 		out.push_back(new TokenImpl(_token, TokenImpl::attr_cword));
+		out.back()->set_span(token, j, length - j);
 	}
 }
 
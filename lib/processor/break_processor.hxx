@@ -39,13 +39,16 @@ namespace bamboo {
 class BreakProcessor: public Processor {
 protected:
 	ILexicon *_lexicon;
+	RecordLexicon *_records;
+	int _field;
 	int _split;
 	char *_token;
 	int _min_token_length, _max_token_length;
 	BreakProcessor();
+	int _search(TokenImpl *token);
 	bool _can_process(TokenImpl *token) 
 	{
-		_split = _lexicon->search(token->get_token());
+		_split = _search(token);
 		if ((token->get_length() >= (size_t)_min_token_length)
 			&& (token->get_length() <= sizeof(size_t) * 8)
 			&& _split)
@@ -56,6 +59,8 @@ protected:
 
 public:
 	BreakProcessor(IConfig *config);
+	BreakProcessor(const BreakProcessor &rhs);
+	Processor *spawn() {return new BreakProcessor(*this);}
 	~BreakProcessor();
 };
 
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2008, detrox@gmail.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <organization> nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY detrox@gmail.com ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL detrox@gmail.com BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#ifndef CRF_MODEL_FACTORY_HXX
+#define CRF_MODEL_FACTORY_HXX
+
+#include <string>
+#include <exception>
+#include <stdexcept>
+#include <crfpp.h>
+
+#include "resource_registry.hxx"
+
+namespace bamboo {
+
+
+/*
+ * Loads CRF++ models through the resource registry, so every processor
+ * using the same model file shares one CRFPP::Model and only creates
+ * its own tagger. option holds extra CRF++ flags such as "-n5".
+ */
+class CRFModelFactory {
+private:
+	CRFModelFactory();
+public:
+	static CRFPP::Model *acquire(const char *filename, const char *option = "")
+	{
+		return (CRFPP::Model *)ResourceRegistry::get_instance()->acquire(
+				"crf_model", filename, option, _load, _unload);
+	}
+
+	static void retain(CRFPP::Model *model)
+	{
+		ResourceRegistry::get_instance()->retain(model);
+	}
+
+	static void release(CRFPP::Model *model)
+	{
+		ResourceRegistry::get_instance()->release(model);
+	}
+
+private:
+	static void *_load(const char *filename, const char *option)
+	{
+		std::string param = std::string("-m ") + filename;
+		if (option && *option) param = std::string(option) + " " + param;
+		CRFPP::Model *model = CRFPP::createModel(param.c_str());
+		if (model == NULL)
+			throw std::runtime_error(std::string("can not load model ") + filename + ": " + CRFPP::getTaggerError());
+		return model;
+	}
+
+	static void _unload(void *model)
+	{
+		delete (CRFPP::Model *)model;
+	}
+};
+
+} //namespace bamboo
+
+#endif // CRF_MODEL_FACTORY_HXX
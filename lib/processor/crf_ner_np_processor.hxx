@@ -49,9 +49,11 @@ protected:
 	};
 
 protected:
+	CRFPP::Model *_model;
 	CRFPP::Tagger *_tagger;
 	std::string _result;
 	std::string _result_orig;
+	TokenImpl::span_t _result_span;
 	int _ner_output_type;
 	
 	CRFNPProcessor();
@@ -67,6 +69,10 @@ protected:
 
 public:
 	CRFNPProcessor(IConfig *config);
+	CRFNPProcessor(const CRFNPProcessor &rhs);
+	Processor *spawn() {return new CRFNPProcessor(*this);}
+	/* tags the whole input as one sequence */
+	bool can_split(TokenImpl *left, TokenImpl *right) {return false;}
 	~CRFNPProcessor();
 
 	void process(std::vector<TokenImpl *> &in, std::vector<TokenImpl *> &out);
@@ -27,6 +27,7 @@
  */
 
 #include "lexicon_factory.hxx"
+#include "crf_model_factory.hxx"
 #include "crf_ner_nr_processor.hxx"
 #include <cassert>
 #include <cstdio>
@@ -49,26 +50,28 @@ CRFNRProcessor::CRFNRProcessor(IConfig *config)
 	:_ner_type("nr"), _ner_output_type(0)
 {
 	const char * model;
-	struct stat buf;
 	config->get_value("crf_ner_nr_model", model);
 
 #ifdef DEBUG
-	std::string model_param = std::string("-n5 -m ") + std::string(model);
+	_model = CRFModelFactory::acquire(model, "-n5");
 #else
-	std::string model_param = std::string("-m ") + std::string(model);
+	_model = CRFModelFactory::acquire(model);
 #endif
-
-	if(stat(model, &buf)==0) {
-		_tagger = CRFPP::createTagger(model_param.c_str());
-	} else {
-		throw std::runtime_error(std::string("can not load model ") + model + ": " + strerror(errno));
-	}
+	_tagger = _model->createTagger();
 	config->get_value("ner_output_type", _ner_output_type);
 
 }
 
+CRFNRProcessor::CRFNRProcessor(const CRFNRProcessor &rhs)
+	:Processor(rhs), _model(rhs._model), _tagger(rhs._model->createTagger()),
+	 _ner_type(rhs._ner_type), _ner_output_type(rhs._ner_output_type)
+{
+	CRFModelFactory::retain(_model);
+}
+
 CRFNRProcessor::~CRFNRProcessor() {
 	delete _tagger;
+	CRFModelFactory::release(_model);
 }
 
 void CRFNRProcessor::process(std::vector<TokenImpl *> &in, std::vector<TokenImpl *> &out) {
@@ -83,9 +86,13 @@ void CRFNRProcessor::process(std::vector<TokenImpl *> &in, std::vector<TokenImpl
 		max_token_size += token->get_bytes();
 	}
 
-	if (!_tagger->parse()) throw std::runtime_error("crf parse failed!");
+	{
+		StatsTimer timer(_stat_crf);
+		if (!_tagger->parse()) throw std::runtime_error("crf parse failed!");
+	}
 
 	std::string ner_str(""), ner_str_orig("");
+	TokenImpl::span_t ner_str_span;
 	ner_str.reserve(max_token_size);
 	ner_str_orig.reserve(max_token_size);
 	assert(in.size() == _tagger->size());
@@ -96,29 +103,36 @@ void CRFNRProcessor::process(std::vector<TokenImpl *> &in, std::vector<TokenImpl
 		if(*tag == 'O') {
 			if(ner_str.size() > 0) {
 				out.push_back(new TokenImpl(ner_str.c_str(), ner_str_orig.c_str()));
+				out.back()->set_span(ner_str_span);
 				out.back()->set_pos(_ner_type);
 				ner_str.clear();
 				ner_str_orig.clear();
+				ner_str_span.clear();
 			}
 			if(_ner_output_type==1)
 				out.push_back(new TokenImpl(*token));
 		} else {
 			ner_str += token->get_token();
 			ner_str_orig += token->get_orig_token();
+			ner_str_span.join(token->get_span());
 			if( (*tag=='E'||*tag=='S') && ner_str.size()>0) {
 				out.push_back(new TokenImpl(ner_str.c_str(), ner_str_orig.c_str()));
+				out.back()->set_span(ner_str_span);
 				out.back()->set_pos(_ner_type);
 				ner_str.clear();
 				ner_str_orig.clear();
+				ner_str_span.clear();
 			}
 		}
 		delete token;
 	}
 	if(ner_str.size() > 0) {
 		out.push_back(new TokenImpl(ner_str.c_str(), ner_str_orig.c_str()));
+		out.back()->set_span(ner_str_span);
 		out.back()->set_pos(_ner_type);
 		ner_str.clear();
 		ner_str_orig.clear();
+		ner_str_span.clear();
 	}
 }
 
@@ -40,6 +40,7 @@ namespace bamboo {
 
 class CRFNRProcessor: public Processor {
 protected:
+	CRFPP::Model *_model;
 	CRFPP::Tagger *_tagger;
 	const char * _ner_type;
 	int _ner_output_type;
@@ -50,6 +51,10 @@ protected:
 
 public:
 	CRFNRProcessor(IConfig *config);
+	CRFNRProcessor(const CRFNRProcessor &rhs);
+	Processor *spawn() {return new CRFNRProcessor(*this);}
+	/* tags the whole input as one sequence */
+	bool can_split(TokenImpl *left, TokenImpl *right) {return false;}
 	~CRFNRProcessor();
 
 	void process(std::vector<TokenImpl *> &in, std::vector<TokenImpl *> &out);
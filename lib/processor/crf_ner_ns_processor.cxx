@@ -27,6 +27,7 @@
  */
 
 #include "lexicon_factory.hxx"
+#include "crf_model_factory.hxx"
 #include "crf_ner_ns_processor.hxx"
 #include <cassert>
 #include <cstdio>
@@ -46,29 +47,34 @@ PROCESSOR_MAGIC
 PROCESSOR_MODULE(CRFNSProcessor)
 
 CRFNSProcessor::CRFNSProcessor(IConfig *config)
-	:_tagger(NULL), _ner_type("ns"), _suffix_dict(NULL), _ner_output_type(0)
+	:_model(NULL), _tagger(NULL), _ner_type("ns"), _suffix_dict(NULL), _ner_output_type(0)
 {
 	const char * model;
-	struct stat buf;
 	config->get_value("crf_ner_ns_model", model);
 
-	std::string model_param = std::string("-m ") + std::string(model);
-	if(stat(model, &buf)==0) {
-		_tagger = CRFPP::createTagger(model_param.c_str());
-	} else {
-		throw std::runtime_error(std::string("can not load model ") + model + ": " + strerror(errno));
-	}
+	_model = CRFModelFactory::acquire(model);
+	_tagger = _model->createTagger();
 
 	config->get_value("crf_ner_ns_suffix", model);
 	if (*model == '\0')
 		throw std::runtime_error("crf_ner_ns_suffix is null");
-	_suffix_dict = LexiconFactory::load(model);
+	_suffix_dict = LexiconFactory::acquire(model);
 	config->get_value("ner_output_type", _ner_output_type);
 }
 
+CRFNSProcessor::CRFNSProcessor(const CRFNSProcessor &rhs)
+	:Processor(rhs), _model(rhs._model), _tagger(rhs._model->createTagger()),
+	 _ner_type(rhs._ner_type), _suffix_dict(rhs._suffix_dict),
+	 _ner_output_type(rhs._ner_output_type)
+{
+	CRFModelFactory::retain(_model);
+	LexiconFactory::retain(_suffix_dict);
+}
+
 CRFNSProcessor::~CRFNSProcessor() {
 	if(_tagger) delete _tagger;
-	if(_suffix_dict) delete _suffix_dict;
+	LexiconFactory::release(_suffix_dict);
+	CRFModelFactory::release(_model);
 }
 
 const char * CRFNSProcessor::_get_label(const char * token) {
@@ -137,11 +143,15 @@ void CRFNSProcessor::process(std::vector<TokenImpl *> &in, std::vector<TokenImpl
 void CRFNSProcessor::_process_ner(std::vector<TokenImpl *> &in, size_t offset, std::vector<TokenImpl *> &out) {
 	size_t i, size = _tagger->size();
 
-	if (!_tagger->parse()) throw std::runtime_error("crf parse failed!");
+	{
+		StatsTimer timer(_stat_crf);
+		if (!_tagger->parse()) throw std::runtime_error("crf parse failed!");
+	}
 
 	enum { begin_ner, end_ner, non_ner } state;
 	TokenImpl *token;
 	std::string seg_res, seg_res_orig;
+	TokenImpl::span_t seg_res_span;
 	for(i=0; i<size; ++i) {
 		token = in[offset + i];
 		const char *ner_tag = _tagger->y2(i);
@@ -163,31 +173,39 @@ void CRFNSProcessor::_process_ner(std::vector<TokenImpl *> &in, size_t offset, s
 			if(_ner_output_type==1) {
 				seg_res.clear();
 				seg_res_orig.clear();
+				seg_res_span.clear();
 			}
 			_result.append(token->get_token());
 			_result_orig.append(token->get_orig_token());
+			_result_span.join(token->get_span());
 
 			if(attr==TokenImpl::attr_unknow) attr = TokenImpl::attr_cword;
 			if(attr==TokenImpl::attr_alpha || attr==TokenImpl::attr_number || attr==TokenImpl::attr_punct)	seg_tag = "S";
 			if(*ner_tag=='S' || *ner_tag=='E') {
 				out.push_back(new TokenImpl(_result.c_str(), _result_orig.c_str(), attr));
+				out.back()->set_span(_result_span);
 				out.back()->set_pos(_ner_type);
 				_result.clear();
 				_result_orig.clear();
+				_result_span.clear();
 			}
 		} else {
 			_result.clear();
 			_result_orig.clear();
+			_result_span.clear();
 			if(_ner_output_type==1) {
 				seg_res.append(token->get_token());
 				seg_res_orig.append(token->get_orig_token());
+				seg_res_span.join(token->get_span());
 
 				if(*seg_tag=='S'||*seg_tag=='E') {
 					out.push_back(new TokenImpl(seg_res.c_str(), seg_res_orig.c_str()));
+					out.back()->set_span(seg_res_span);
 					if(token->get_pos()/256 == 'n')
 						out.back()->set_pos(token->get_pos());
 					seg_res.clear();
 					seg_res_orig.clear();
+					seg_res_span.clear();
 				}
 			}
 		}
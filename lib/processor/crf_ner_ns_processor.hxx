@@ -57,10 +57,12 @@ static const char * loc_label[] = {
 
 class CRFNSProcessor: public Processor {
 protected:
+	CRFPP::Model *_model;
 	CRFPP::Tagger *_tagger;
 	const char * _ner_type;
 	std::string _result;
 	std::string _result_orig;
+	TokenImpl::span_t _result_span;
 	bamboo::ILexicon * _suffix_dict;
 	int _ner_output_type;
 	
@@ -72,6 +74,10 @@ protected:
 
 public:
 	CRFNSProcessor(IConfig *config);
+	CRFNSProcessor(const CRFNSProcessor &rhs);
+	Processor *spawn() {return new CRFNSProcessor(*this);}
+	/* tags the whole input as one sequence */
+	bool can_split(TokenImpl *left, TokenImpl *right) {return false;}
 	~CRFNSProcessor();
 
 	void process(std::vector<TokenImpl *> &in, std::vector<TokenImpl *> &out);
@@ -40,10 +40,12 @@ namespace bamboo {
 
 class CRFNTProcessor: public Processor {
 protected:
+	CRFPP::Model *_model;
 	CRFPP::Tagger *_tagger;
 	const char * _ner_type;
 	std::string _result;
 	std::string _result_orig;
+	TokenImpl::span_t _result_span;
 	int _ner_output_type;
 	
 	CRFNTProcessor();
@@ -53,6 +55,10 @@ protected:
 
 public:
 	CRFNTProcessor(IConfig *config);
+	CRFNTProcessor(const CRFNTProcessor &rhs);
+	Processor *spawn() {return new CRFNTProcessor(*this);}
+	/* tags the whole input as one sequence */
+	bool can_split(TokenImpl *left, TokenImpl *right) {return false;}
 	~CRFNTProcessor();
 
 	void process(std::vector<TokenImpl *> &in, std::vector<TokenImpl *> &out);
@@ -27,6 +27,7 @@
  */
 
 #include "lexicon_factory.hxx"
+#include "crf_model_factory.hxx"
 #include "crf_pos_processor.hxx"
 #include <cassert>
 #include <cstdio>
@@ -43,22 +44,24 @@ PROCESSOR_MODULE(CRFPosProcessor)
 
 CRFPosProcessor::CRFPosProcessor(IConfig *config) {
 	const char *s;
-	struct stat buf;
 
 	config->get_value("crf_pos_model", s);
 	if (*s == '\0')
 		throw std::runtime_error("crf_pos_model is null");
 
-	std::string model_param = std::string("-m ") + std::string(s);
-	if(stat(s, &buf)==0) {
-		_tagger = CRFPP::createTagger(model_param.c_str());
-	} else {
-		throw std::runtime_error(std::string("can not load model ") + s + ": " + strerror(errno));
-	}
+	_model = CRFModelFactory::acquire(s);
+	_tagger = _model->createTagger();
+}
+
+CRFPosProcessor::CRFPosProcessor(const CRFPosProcessor &rhs)
+	:Processor(rhs), _model(rhs._model), _tagger(rhs._model->createTagger())
+{
+	CRFModelFactory::retain(_model);
 }
 
 CRFPosProcessor::~CRFPosProcessor() {
 	delete _tagger;
+	CRFModelFactory::release(_model);
 }
 
 void CRFPosProcessor::process(std::vector<TokenImpl *> &in, std::vector<TokenImpl *> &out) {
@@ -72,17 +75,10 @@ void CRFPosProcessor::process(std::vector<TokenImpl *> &in, std::vector<TokenImp
 		_tagger->add(1, &str); 
 	}
 
-#ifdef TIMING	
-	static double t = 0;
-	struct timeval tv1, tv2;
-	gettimeofday(&tv1, 0);
-#endif
-	if (!_tagger->parse()) throw std::runtime_error("crf parse failed!");
-#ifdef TIMING	
-	gettimeofday(&tv2, 0);
-	t += (tv2.tv_sec - tv1.tv_sec)*1000000 + tv2.tv_usec - tv1.tv_usec;
-	std::cerr<<"pos processor consumed: "<< t/1000 << std::endl;
-#endif
+	{
+		StatsTimer timer(_stat_crf);
+		if (!_tagger->parse()) throw std::runtime_error("crf parse failed!");
+	}
 
 	assert(size==_tagger->size());
 	for(i=0; i<size; ++i) {
@@ -40,6 +40,7 @@ namespace bamboo {
 
 class CRFPosProcessor: public Processor {
 protected:
+	CRFPP::Model *_model;
 	CRFPP::Tagger *_tagger;
 	
 	CRFPosProcessor();
@@ -48,6 +49,10 @@ protected:
 
 public:
 	CRFPosProcessor(IConfig *config);
+	CRFPosProcessor(const CRFPosProcessor &rhs);
+	Processor *spawn() {return new CRFPosProcessor(*this);}
+	/* tags the whole input as one sequence */
+	bool can_split(TokenImpl *left, TokenImpl *right) {return false;}
 	~CRFPosProcessor();
 
 	void process(std::vector<TokenImpl *> &in, std::vector<TokenImpl *> &out);
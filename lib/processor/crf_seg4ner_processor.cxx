@@ -27,6 +27,7 @@
  */
 
 #include "lexicon_factory.hxx"
+#include "crf_model_factory.hxx"
 #include "crf_seg4ner_processor.hxx"
 #include "utf8.hxx"
 #include <cassert>
@@ -44,21 +45,15 @@ CRFSeg4nerProcessor::CRFSeg4nerProcessor(IConfig *config)
 {
 	const char *s;
 	_token = new char[8];
-	struct stat st;
 
 	config->get_value("crf_seg_model", s);
 
-	std::string model;
 #ifdef DEBUG
-	model = std::string("-n5 -m ") + std::string(s);
+	_model = CRFModelFactory::acquire(s, "-n5");
 #else
-	model = std::string("-m ") + std::string(s);
+	_model = CRFModelFactory::acquire(s);
 #endif
-	if (stat(s, &st) == 0) {
-		_tagger = CRFPP::createTagger(model.c_str());
-	} else {
-		throw std::runtime_error(std::string("can not load model ") + s + ": " + strerror(errno));
-	}
+	_tagger = _model->createTagger();
 }
 
 void CRFSeg4nerProcessor::init(const char *type) {
@@ -68,10 +63,18 @@ void CRFSeg4nerProcessor::init(const char *type) {
 		_output_type = 0;
 }
 
+CRFSeg4nerProcessor::CRFSeg4nerProcessor(const CRFSeg4nerProcessor &rhs)
+	:Processor(rhs), _model(rhs._model), _tagger(rhs._model->createTagger()),
+	 _token(new char[8]), _output_type(rhs._output_type)
+{
+	CRFModelFactory::retain(_model);
+}
+
 CRFSeg4nerProcessor::~CRFSeg4nerProcessor()
 {
 	delete []_token;
 	delete _tagger;
+	CRFModelFactory::release(_model);
 }
 
 inline const char *CRFSeg4nerProcessor::_get_crf2_tag(int attr) {
@@ -88,6 +91,17 @@ inline const char *CRFSeg4nerProcessor::_get_crf2_tag(int attr) {
 	}
 }
 
+bool CRFSeg4nerProcessor::can_split(TokenImpl *left, TokenImpl *right)
+{
+	const char *s;
+
+	/* the tagger sequence is flushed at tagged tokens and after sentence ends */
+	if (left->get_pos() != 0 || right->get_pos() != 0)
+		return true;
+	s = (left->get_attr() == TokenImpl::attr_punct)?left->get_orig_token():left->get_token();
+	return *s == '!' || *s == '?' || *s == ';' || !strcmp(s, "。");
+}
+
 void CRFSeg4nerProcessor::process(std::vector<TokenImpl *> &in, std::vector<TokenImpl *> &out) {
 	size_t i, offset, size = in.size();
 
@@ -124,10 +138,14 @@ void CRFSeg4nerProcessor::process(std::vector<TokenImpl *> &in, std::vector<Toke
 
 void CRFSeg4nerProcessor::_crf2_tagger(std::vector<TokenImpl *> &in, size_t offset, std::vector<TokenImpl *> &out) {
 	if(_tagger->size()==0) return;
-	if (!_tagger->parse()) throw std::runtime_error("crf parse failed!");
+	{
+		StatsTimer timer(_stat_crf);
+		if (!_tagger->parse()) throw std::runtime_error("crf parse failed!");
+	}
 
 	_result.clear();
 	_result_orig.clear();
+	_result_span.clear();
 
 	for (size_t i = 0; i < _tagger->size(); ++i) {
 		TokenImpl *cur_tok = in[offset+i];
@@ -138,13 +156,16 @@ void CRFSeg4nerProcessor::_crf2_tagger(std::vector<TokenImpl *> &in, size_t offs
 		} else {
 			_result.append(_tagger->x(i, 0));
 			_result_orig.append(cur_tok->get_orig_token());
+			_result_span.join(cur_tok->get_span());
 			int attr = cur_tok->get_attr();
 			if(attr==TokenImpl::attr_unknow) attr = TokenImpl::attr_cword;
 			if(attr==TokenImpl::attr_alpha || attr==TokenImpl::attr_number || attr==TokenImpl::attr_punct)	tag = "S";
 			if (*tag=='S' || *tag=='E') {
 				out.push_back(new TokenImpl(_result.c_str(), _result_orig.c_str(), attr));
+				out.back()->set_span(_result_span);
 				_result.clear();
 				_result_orig.clear();
+				_result_span.clear();
 			}
 			delete cur_tok;
 		}
@@ -40,10 +40,12 @@ namespace bamboo {
 
 class CRFSeg4nerProcessor: public Processor {
 protected:
+	CRFPP::Model *_model;
 	CRFPP::Tagger *_tagger;
 	char *_token;
 	std::string _result;
 	std::string _result_orig;
+	TokenImpl::span_t _result_span;
 	int _output_type;
 
 	inline const char *_get_crf2_tag(int attr);
@@ -56,6 +58,9 @@ protected:
 
 public:
 	CRFSeg4nerProcessor(IConfig *config);
+	CRFSeg4nerProcessor(const CRFSeg4nerProcessor &rhs);
+	Processor *spawn() {return new CRFSeg4nerProcessor(*this);}
+	bool can_split(TokenImpl *left, TokenImpl *right);
 	virtual ~CRFSeg4nerProcessor();
 
 	void process(std::vector<TokenImpl *> &in, std::vector<TokenImpl *> &out);
@@ -27,6 +27,7 @@
  */
 
 #include "lexicon_factory.hxx"
+#include "crf_model_factory.hxx"
 #include "crf_seg_processor.hxx"
 #include "utf8.hxx"
 #include "prepare_processor.hxx"
@@ -45,21 +46,15 @@ CRFSegProcessor::CRFSegProcessor(IConfig *config)
 {
 	const char *s;
 	_token = new char[8];
-	struct stat st;
 
 	config->get_value("crf_seg_model", s);
 
-	std::string model;
 #ifdef DEBUG
-	model = std::string("-n5 -m ") + std::string(s);
+	_model = CRFModelFactory::acquire(s, "-n5");
 #else
-	model = std::string("-m ") + std::string(s);
+	_model = CRFModelFactory::acquire(s);
 #endif
-	if (stat(s, &st) == 0) {
-		_tagger = CRFPP::createTagger(model.c_str());
-	} else {
-		throw std::runtime_error(std::string("can not load model ") + s + ": " + strerror(errno));
-	}
+	_tagger = _model->createTagger();
 }
 
 void CRFSegProcessor::init(const char *type) {
@@ -69,10 +64,26 @@ void CRFSegProcessor::init(const char *type) {
 		_output_type = 0;
 }
 
+CRFSegProcessor::CRFSegProcessor(const CRFSegProcessor &rhs)
+	:Processor(rhs), _model(rhs._model), _tagger(rhs._model->createTagger()),
+	 _token(new char[8]), _output_type(rhs._output_type)
+{
+	CRFModelFactory::retain(_model);
+}
+
 CRFSegProcessor::~CRFSegProcessor()
 {
 	delete []_token;
 	delete _tagger;
+	CRFModelFactory::release(_model);
+}
+
+bool CRFSegProcessor::can_split(TokenImpl *left, TokenImpl *right)
+{
+	/* the tagger sequence is flushed at whitespace and tagged tokens */
+	return left->get_attr() == TokenImpl::attr_whitespace
+		|| right->get_attr() == TokenImpl::attr_whitespace
+		|| left->get_pos() != 0 || right->get_pos() != 0;
 }
 
 void CRFSegProcessor::process(std::vector<TokenImpl *> &in, std::vector<TokenImpl *> &out) {
@@ -103,6 +114,7 @@ void CRFSegProcessor::process(std::vector<TokenImpl *> &in, std::vector<TokenImp
 			offset = i - _tagger->size();
 			_crf2_tagger(in, offset, out);
 			_tagger->clear();
+			delete cur_tok;
 		}
 	}
 	offset = i - _tagger->size();
@@ -111,10 +123,14 @@ void CRFSegProcessor::process(std::vector<TokenImpl *> &in, std::vector<TokenImp
 
 void CRFSegProcessor::_crf2_tagger(std::vector<TokenImpl *> &in, size_t offset, std::vector<TokenImpl *> &out) {
 	if(_tagger->size()==0) return;
-	if (!_tagger->parse()) throw std::runtime_error("crf parse failed!");
+	{
+		StatsTimer timer(_stat_crf);
+		if (!_tagger->parse()) throw std::runtime_error("crf parse failed!");
+	}
 
 	_result.clear();
 	_result_orig.clear();
+	_result_span.clear();
 
 	int attr;
 	for (size_t i = 0; i < _tagger->size(); ++i) {
@@ -132,25 +148,31 @@ void CRFSegProcessor::_crf2_tagger(std::vector<TokenImpl *> &in, size_t offset,
 			}
 			if (*tag == 'S' && _result_orig.size() > 0) {
 				out.push_back(new TokenImpl(_result.c_str(), _result_orig.c_str(), attr));
+				out.back()->set_span(_result_span);
 				_result.clear();
 				_result_orig.clear();
+				_result_span.clear();
 			}
 			_result.append(_tagger->x(i, 0));
 			_result_orig.append(cur_tok->get_orig_token());
+			_result_span.join(cur_tok->get_span());
 			attr = cur_tok->get_attr();
 			if (attr == TokenImpl::attr_unknow) {
 				attr = TokenImpl::attr_cword;
 			}
 			if (*tag == 'S' || *tag == 'E') {
 				out.push_back(new TokenImpl(_result.c_str(), _result_orig.c_str(), attr));
+				out.back()->set_span(_result_span);
 				_result.clear();
 				_result_orig.clear();
+				_result_span.clear();
 			}
 			delete cur_tok;
 		}
 	}
 	if (_result_orig.size() > 0) {
 		out.push_back(new TokenImpl(_result.c_str(), _result_orig.c_str(), attr));
+		out.back()->set_span(_result_span);
 	}
 
 #ifdef DEBUG
@@ -40,7 +40,7 @@ PROCESSOR_MAGIC
 PROCESSOR_MODULE(MaxforwardCombineProcessor)
 
 MaxforwardCombineProcessor::MaxforwardCombineProcessor(IConfig *config)
-	 :_token(NULL), _min_token_length(1), _max_token_length(8), _combine_maxforward(0)
+	 :_token(NULL), _matches(NULL), _min_token_length(1), _max_token_length(8), _combine_maxforward(0)
 {
 	const char *s;
 
@@ -49,37 +49,60 @@ MaxforwardCombineProcessor::MaxforwardCombineProcessor(IConfig *config)
 	config->get_value("maxforward_combination_lexicon", s);
 	if (*s == '\0')
 		throw std::runtime_error("maxforward_combination_lexicon is null");
-	_lexicon = LexiconFactory::load(s);
+	_lexicon = LexiconFactory::acquire(s);
 	_token = new char[(_max_token_length << 2) + 1]; /* x4 for unicode */
+	_matches = new trie_match_t[(_max_token_length << 2) + 1];
 
 	if (_min_token_length < 1) _min_token_length = 1;
 }
 
+MaxforwardCombineProcessor::MaxforwardCombineProcessor(const MaxforwardCombineProcessor &rhs)
+	:Processor(rhs), _lexicon(rhs._lexicon), _token(NULL), _matches(NULL),
+	 _min_token_length(rhs._min_token_length), _max_token_length(rhs._max_token_length),
+	 _combine_maxforward(rhs._combine_maxforward)
+{
+	LexiconFactory::retain(_lexicon);
+	_token = new char[(_max_token_length << 2) + 1]; /* x4 for unicode */
+	_matches = new trie_match_t[(_max_token_length << 2) + 1];
+}
+
 MaxforwardCombineProcessor::~MaxforwardCombineProcessor()
 {
-	delete _lexicon;
+	LexiconFactory::release(_lexicon);
 	delete []_token;
+	delete []_matches;
 }
 
 void MaxforwardCombineProcessor::_tokenize(std::vector<TokenImpl *> &out)
 {
-	size_t length, max_token_length, i, j, k;
+	size_t length, max_token_length, i, j, k, m, n, *offsets;
 	const char *s;
 
 	s = _combine.c_str();
 	length = utf8::length(s);
+	_offsets.resize(_combine.size() + 1);
+	offsets = &_offsets[0];
+	offsets[utf8::index(s, offsets)] = _combine.size();
 
 	for (i = 0; i < length; i++) {
 		max_token_length = ((unsigned int)_max_token_length + i< length)?_max_token_length:length - i;
-		for (k = 0, j = max_token_length; j > 0; j--) {
-			k = utf8::sub(_token, s, i, j);
-			if (_lexicon->search(_token) > 0) break;
+		/* the longest word starting here, from one trie walk */
+		n = _lexicon->common_prefix_search(s + offsets[i],
+				offsets[i + max_token_length] - offsets[i], _matches,
+				(_max_token_length << 2) + 1);
+		for (k = 0, j = 1, m = 0; m < n; m++) {
+			while (j < max_token_length && offsets[i + j] - offsets[i] < _matches[m].length) j++;
+			if (offsets[i + j] - offsets[i] == _matches[m].length && _matches[m].value > 0) k = j;
 		}
-		if (j == 0) {j = 1;}
+		j = (k == 0)?1:k;
+		memcpy(_token, s + offsets[i], offsets[i + j] - offsets[i]);
+		_token[offsets[i + j] - offsets[i]] = '\0';
 		out.push_back(new TokenImpl(_token, TokenImpl::attr_cword));
+		out.back()->set_span(_combine_span.sub(s, i, j));
 		i = i + j - 1;
 	}
 	_combine.erase();
+	_combine_span.clear();
 }
 
 void MaxforwardCombineProcessor::process(std::vector<TokenImpl *> &in, std::vector<TokenImpl *> &out)
@@ -93,9 +116,11 @@ void MaxforwardCombineProcessor::process(std::vector<TokenImpl *> &in, std::vect
 
 	size = in.size();
 	_combine.erase();
+	_combine_span.clear();
 	for (i = 0, state = PS_UNKNOW; i < size; i++) {
 		if (i < size - 1 && in[i]->get_length() <= (size_t)_min_token_length) {
 			_combine.append(in[i]->get_orig_token());
+			_combine_span.join(in[i]->get_span());
 			delete in[i];
 			state = PS_SINGLE;
 		} else {
@@ -41,8 +41,11 @@ class MaxforwardCombineProcessor: public Processor {
 protected:
 	ILexicon *_lexicon;
 	std::string _combine;
+	TokenImpl::span_t _combine_span;
 	MaxforwardCombineProcessor();
 	char *_token;
+	trie_match_t *_matches;
+	std::vector<size_t> _offsets;
 	int _min_token_length, _max_token_length, _combine_maxforward;
 	bool _can_process(TokenImpl *token) {return true;}
 	void _process(TokenImpl *token, std::vector<TokenImpl *> &out) {};
@@ -50,6 +53,12 @@ protected:
 public:
 	void process(std::vector<TokenImpl *> &in, std::vector<TokenImpl *> &out);
 	MaxforwardCombineProcessor(IConfig *config);
+	MaxforwardCombineProcessor(const MaxforwardCombineProcessor &rhs);
+	Processor *spawn() {return new MaxforwardCombineProcessor(*this);}
+	bool can_split(TokenImpl *left, TokenImpl *right)
+	{
+		return left->get_length() > (size_t)_min_token_length;
+	}
 	~MaxforwardCombineProcessor();
 };
 
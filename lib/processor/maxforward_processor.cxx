@@ -39,7 +39,7 @@ PROCESSOR_MAGIC
 PROCESSOR_MODULE(MaxforwardProcessor)
 
 MaxforwardProcessor::MaxforwardProcessor(IConfig *config)
-	:_token(NULL)
+	:_token(NULL), _matches(NULL)
 {
 	const char *s;
 
@@ -47,32 +47,53 @@ MaxforwardProcessor::MaxforwardProcessor(IConfig *config)
 	if (*s == '\0')
 		throw std::runtime_error("unigram_lexicon is null");
 	config->get_value("max_token_length", _max_token_length);
-	_lexicon = LexiconFactory::load(s);
+	_lexicon = LexiconFactory::acquire(s);
 
 	_token = new char[(_max_token_length << 2) + 1]; /* x4 for unicode */
+	_matches = new trie_match_t[(_max_token_length << 2) + 1];
+}
+
+MaxforwardProcessor::MaxforwardProcessor(const MaxforwardProcessor &rhs)
+	:Processor(rhs), _lexicon(rhs._lexicon), _max_token_length(rhs._max_token_length)
+{
+	LexiconFactory::retain(_lexicon);
+	_token = new char[(_max_token_length << 2) + 1]; /* x4 for unicode */
+	_matches = new trie_match_t[(_max_token_length << 2) + 1];
 }
 
 MaxforwardProcessor::~MaxforwardProcessor()
 {
 	delete []_token;
-	delete _lexicon;
+	delete []_matches;
+	LexiconFactory::release(_lexicon);
 }
 
 void MaxforwardProcessor::_process(TokenImpl *token, std::vector<TokenImpl *> &out)
 {
-	size_t length, max_token_length, i, j, k;
+	size_t length, max_token_length, i, j, k, m, n, *offsets;
 	const char *s;
 
 	s = token->get_token();
 	length = token->get_length();
+	_offsets.resize(token->get_bytes() + 1);
+	offsets = &_offsets[0];
+	offsets[utf8::index(s, offsets)] = token->get_bytes();
+
 	for (i = 0; i < length; i++) {
 		max_token_length = ((unsigned int)_max_token_length + i< length)?_max_token_length:length - i;
-		for (k = 0, j = max_token_length; j > 0; j--) {
-			k = utf8::sub(_token, s, i, j);
-			if (_lexicon->search(_token) > 0) break;
+		/* the longest word starting here, from one trie walk */
+		n = _lexicon->common_prefix_search(s + offsets[i],
+				offsets[i + max_token_length] - offsets[i], _matches,
+				(_max_token_length << 2) + 1);
+		for (k = 0, j = 1, m = 0; m < n; m++) {
+			while (j < max_token_length && offsets[i + j] - offsets[i] < _matches[m].length) j++;
+			if (offsets[i + j] - offsets[i] == _matches[m].length && _matches[m].value > 0) k = j;
 		}
-		if (j == 0) {j = 1;}
+		j = (k == 0)?1:k;
+		memcpy(_token, s + offsets[i], offsets[i + j] - offsets[i]);
+		_token[offsets[i + j] - offsets[i]] = '\0';
 		out.push_back(new TokenImpl(_token, TokenImpl::attr_cword));
+		out.back()->set_span(token, i, j);
 		i = i + j - 1;
 	}
 }
@@ -41,6 +41,8 @@ protected:
 	ILexicon *_lexicon;
 	int _max_token_length;
 	char *_token;
+	trie_match_t *_matches;
+	std::vector<size_t> _offsets;
 
 	MaxforwardProcessor();
 	bool _can_process(TokenImpl *token) 
@@ -51,6 +53,8 @@ protected:
 
 public:
 	MaxforwardProcessor(IConfig *config);
+	MaxforwardProcessor(const MaxforwardProcessor &rhs);
+	Processor *spawn() {return new MaxforwardProcessor(*this);}
 	~MaxforwardProcessor();
 };
 
@@ -47,10 +47,12 @@ PrepareProcessor::PrepareProcessor(IConfig *config)
 
 void PrepareProcessor::_process(TokenImpl *token, std::vector<TokenImpl *> &out)
 {
-	const char *s;
+	const char *s, *start;
 	char uch[8], cch;
-	size_t step;
+	size_t step, chars, char_start;
 	TokenImpl::attr_t attr;
+	TokenImpl *neo;
+	const TokenImpl::span_t &span = token->get_span();
 	enum {
 		PS_UNKNOW = 0,
 		PS_ALPHA,
@@ -72,8 +74,10 @@ void PrepareProcessor::_process(TokenImpl *token, std::vector<TokenImpl *> &out)
 	dbc.top = dbc.base;
 	sbc.base = new char [token->get_bytes() + 1];
 	sbc.top = sbc.base;
+	start = s;
+	chars = char_start = 0;
 
-    	for (last_state = PS_BEGIN; ; s += step) {
+    	for (last_state = PS_BEGIN; ; s += step, ++chars) {
 		step = utf8::first(s, uch);
 		cch = utf8::dbc2sbc(uch, step);
 
@@ -113,12 +117,19 @@ void PrepareProcessor::_process(TokenImpl *token, std::vector<TokenImpl *> &out)
 				*(dbc.top) = '\0';
 				*(sbc.top) = '\0';
 				if (sbc.top > sbc.base)
-					out.push_back(new TokenImpl(sbc.base, dbc.base, attr));
+					neo = new TokenImpl(sbc.base, dbc.base, attr);
 				else
-					out.push_back(new TokenImpl(dbc.base, attr));
+					neo = new TokenImpl(dbc.base, attr);
+				neo->set_span(TokenImpl::span_t(
+						span.begin + (start - token->get_token()),
+						span.begin + (s - token->get_token()),
+						span.char_begin + char_start, span.char_begin + chars));
+				out.push_back(neo);
                 
 				dbc.top = dbc.base;
 				sbc.top = sbc.base;
+				start = s;
+				char_start = chars;
 			}
 			if (state == PS_END) break;
 		}
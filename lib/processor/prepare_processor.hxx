@@ -52,6 +52,7 @@ protected:
 public:
 	PrepareProcessor(IConfig *config);
 	~PrepareProcessor() {};
+	Processor *spawn() {return new PrepareProcessor(*this);}
 	static const char *get_crf2_tag(const TokenImpl *token) {
 		switch(token->get_attr()) {
 		case TokenImpl::attr_number:
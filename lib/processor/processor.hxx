@@ -31,9 +31,12 @@
 
 
 #include <sys/time.h>
+#include <string>
 #include <vector>
+#include <stdexcept>
 #include "config_factory.hxx"
 #include "token_impl.hxx"
+#include "stats.hxx"
 
 namespace bamboo {
 
@@ -43,14 +46,75 @@ namespace bamboo {
 
 class Processor {
 protected:
+	Stats::latency_t *_stat_latency, *_stat_crf;
+	size_t *_stat_tokens_in, *_stat_tokens_out, *_stat_bytes;
+
 	virtual bool _can_process(TokenImpl *) = 0;
 	virtual void _process(TokenImpl *token, std::vector<TokenImpl *> &out) = 0;
 public:
-	Processor() {};
-	Processor(IConfig *_config) {};
+	Processor()
+	:_stat_latency(NULL), _stat_crf(NULL), _stat_tokens_in(NULL),
+	 _stat_tokens_out(NULL), _stat_bytes(NULL) {};
+	Processor(IConfig *_config)
+	:_stat_latency(NULL), _stat_crf(NULL), _stat_tokens_in(NULL),
+	 _stat_tokens_out(NULL), _stat_bytes(NULL) {};
 	virtual ~Processor() {};
 
+	/* registers the metrics of this processor as processor.<name>.* */
+	void set_name(const char *name)
+	{
+		Stats *stats = Stats::get_instance();
+		std::string prefix = std::string("processor.") + name;
+
+		_stat_latency = stats->latency(prefix + ".latency");
+		_stat_crf = stats->latency(prefix + ".crf_parse");
+		_stat_tokens_in = stats->counter(prefix + ".tokens_in");
+		_stat_tokens_out = stats->counter(prefix + ".tokens_out");
+		_stat_bytes = stats->counter(prefix + ".bytes");
+	}
+
+	/* process(), recording the metrics of the call when stats are on */
+	void run(std::vector<TokenImpl *> &in, std::vector<TokenImpl *> &out)
+	{
+		size_t i, start, size, bytes = 0;
+
+		if (!Stats::enabled() || _stat_latency == NULL) {
+			process(in, out);
+			return;
+		}
+		for (i = 0; i < in.size(); i++)
+			if (in[i]) bytes += in[i]->get_bytes();
+		size = out.size();
+		start = Stats::now();
+		process(in, out);
+		Stats::add(_stat_latency, Stats::now() - start);
+		Stats::add(_stat_tokens_in, in.size());
+		Stats::add(_stat_tokens_out, out.size() - size);
+		Stats::add(_stat_bytes, bytes);
+	}
+
 	virtual void init(const char *parameter) {};
+
+	/*
+	 * Create a processor sharing the read-only resources of this one
+	 * with its own scratch state, so that each thread can run its own
+	 * copy. Shared lexicons and models are refcounted by the
+	 * ResourceRegistry, so the prototype may be freed first.
+	 */
+	virtual Processor *spawn()
+	{
+		throw std::runtime_error("processor can not be spawned");
+	}
+
+	/*
+	 * Whether the token stream may be cut between left and right and
+	 * each side processed alone with the same result. Processors looking
+	 * across tokens in process() must override this.
+	 */
+	virtual bool can_split(TokenImpl *left, TokenImpl *right)
+	{
+		return true;
+	}
 	virtual void process(std::vector<TokenImpl *> &in, std::vector<TokenImpl *> &out)
 	{
 		size_t i, length;
@@ -4,6 +4,7 @@
 #include "processor.hxx"
 #include "iconfig.hxx"
 
+#include "ac_match_processor.hxx"
 #include "break_processor.hxx"
 #include "crf_ner_np_processor.hxx"
 #include "crf_ner_nr_processor.hxx"
@@ -23,12 +24,15 @@ namespace bamboo {
 	ProcessorFactory* ProcessorFactory::_instance = NULL;
     Processor *ProcessorFactory::create(const char *name, bool verbose)
 	{		
+		Processor *processor = NULL;
+
         if (_config == NULL)
 			throw std::runtime_error(std::string("no configuration specified"));
 		if (name == NULL)
 			throw std::runtime_error(std::string("no name specified"));
 
-#define register_processor(N, C) if (strcmp(name, (N)) == 0) return new (C)(_config)
+#define register_processor(N, C) if (processor == NULL && strcmp(name, (N)) == 0) processor = new C(_config)
+        register_processor("ac_match", ACMatchProcessor);
         register_processor("break", BreakProcessor);
         register_processor("crf_ner_np", CRFNPProcessor);
         register_processor("crf_ner_nr", CRFNRProcessor);
@@ -42,7 +46,9 @@ namespace bamboo {
         register_processor("prepare", PrepareProcessor);
         register_processor("single_combine", SingleCombineProcessor);
         register_processor("ugm_seg", UnigramProcessor);  
-#undef register_parser
-        return NULL;
+#undef register_processor
+		if (processor)
+			processor->set_name(name);
+		return processor;
 	}
 }
@@ -40,8 +40,8 @@ PROCESSOR_MAGIC
 PROCESSOR_MODULE(SingleCombineProcessor)
 
 SingleCombineProcessor::SingleCombineProcessor(IConfig *config)
-	:_combine_koko(0), _combine_forward(0), _combine_backward(0),
-	 _combine_neighbor(0)
+	:_field_combine(-1), _field_number_trailing(-1), _cursor_id(-1), _combine_id(-1),
+	 _combine_koko(0), _combine_forward(0), _combine_backward(0), _combine_neighbor(0)
 {
 	const char *s;
 
@@ -52,17 +52,36 @@ SingleCombineProcessor::SingleCombineProcessor(IConfig *config)
 	config->get_value("single_combination_lexicon", s);
 	if (*s == '\0')
 		throw std::runtime_error("single_combination_lexicon is null");
-	_lexicon_combine = LexiconFactory::load(s);
+	_lexicon_combine = LexiconFactory::acquire(s);
 	config->get_value("number_trailing_lexicon", s);
 	if (*s == '\0')
 		throw std::runtime_error("number_trailing_lexicon is null");
-	_lexicon_number_trailing = LexiconFactory::load(s);
+	_lexicon_number_trailing = LexiconFactory::acquire(s);
+	_records_combine = _lexicon_combine->records(_field_combine);
+	_records_number_trailing = _lexicon_number_trailing->records(_field_number_trailing);
+	_walked = (_records_combine)?_records_combine->keys():_lexicon_combine;
+	_cursor = _walked->cursor();
+}
+
+SingleCombineProcessor::SingleCombineProcessor(const SingleCombineProcessor &rhs)
+	:Processor(rhs), _lexicon_combine(rhs._lexicon_combine),
+	 _lexicon_number_trailing(rhs._lexicon_number_trailing),
+	 _records_combine(rhs._records_combine), _records_number_trailing(rhs._records_number_trailing),
+	 _field_combine(rhs._field_combine), _field_number_trailing(rhs._field_number_trailing),
+	 _walked(rhs._walked), _cursor_id(-1), _combine_id(-1),
+	 _combine_koko(rhs._combine_koko), _combine_forward(rhs._combine_forward),
+	 _combine_backward(rhs._combine_backward), _combine_neighbor(rhs._combine_neighbor)
+{
+	LexiconFactory::retain(_lexicon_combine);
+	LexiconFactory::retain(_lexicon_number_trailing);
+	_cursor = _walked->cursor();
 }
 
 SingleCombineProcessor::~SingleCombineProcessor()
 {
-	delete _lexicon_combine;
-	delete _lexicon_number_trailing;
+	delete _cursor;
+	LexiconFactory::release(_lexicon_combine);
+	LexiconFactory::release(_lexicon_number_trailing);
 }
 
 void SingleCombineProcessor::_make_combine(std::vector<TokenImpl *> &in, int i, int with)
@@ -72,29 +91,77 @@ void SingleCombineProcessor::_make_combine(std::vector<TokenImpl *> &in, int i,
 	 * position:  ^(i-1)   ^(i)   ^(i + 1)
 	 * */
 	_combine.erase();
-	if (with & 4) _combine.append(in[i - 1]->get_orig_token());
-	if (with & 2) _combine.append(in[i]->get_orig_token());
-	if (with & 1) _combine.append(in[i + 1]->get_orig_token());
+	_combine_span.clear();
+	if (with & 4) {
+		_combine.append(in[i - 1]->get_orig_token());
+		_combine_span.join(in[i - 1]->get_span());
+	}
+	if (with & 2) {
+		_combine.append(in[i]->get_orig_token());
+		_combine_span.join(in[i]->get_span());
+	}
+	if (with & 1) {
+		_combine.append(in[i + 1]->get_orig_token());
+		_combine_span.join(in[i + 1]->get_span());
+	}
+}
+
+/* whether the combination may be in the lexicon, the walk is skipped if its filter says no */
+bool SingleCombineProcessor::_may_combine(std::vector<TokenImpl *> &in, int i, int with)
+{
+	if (!_walked->has_filter()) return true;
+	_make_combine(in, i, with);
+	return _walked->may_contain(_combine.c_str());
+}
+
+/* whether token trails a number, from the record a processor before may have kept on it */
+bool SingleCombineProcessor::_number_trailing(TokenImpl *token)
+{
+	const RecordLexicon::record_t *record;
+
+	if (_records_number_trailing == NULL)
+		return _lexicon_number_trailing->search(token->get_token()) != 0;
+	record = _records_number_trailing->resolve(token);
+	return record && RecordLexicon::value(record, _field_number_trailing) != 0;
 }
 
 int SingleCombineProcessor::_single_combine(size_t i, size_t size, 
 		std::vector<TokenImpl *> &in, std::vector<TokenImpl *> &out)
 {
-	int match = 0;
-
-	if (_combine_neighbor && !match && i > 0 && i + 1 < size 
-		&& in[i - 1] && in[i + 1]) {
-		_make_combine(in, i, 7);
-		if (_lexicon_combine->search(_combine.c_str()) > 0) match = 7; 
-	}
-	if (_combine_forward && !match && i > 0 && in[i - 1]) {
-		_make_combine(in, i, 6);
-		if (_lexicon_combine->search(_combine.c_str()) > 0) match = 6;
+	int match = 0, forward = 0, forward_id = -1;
+	bool try_forward, try_neighbor;
+
+	/* neighbor and forward share the walk over in[i - 1] in[i] */
+	_combine_id = -1;
+	if (i > 0 && in[i - 1]) {
+		try_forward = _combine_forward && _may_combine(in, i, 6);
+		try_neighbor = _combine_neighbor && i + 1 < size && in[i + 1] && _may_combine(in, i, 7);
+		if (try_forward || try_neighbor) {
+			_cursor->reset();
+			if (_advance(in[i - 1]) && _advance(in[i])) {
+				if (try_forward) {
+					forward = _cursor_value();
+					forward_id = _cursor_id;
+				}
+				if (try_neighbor && _advance(in[i + 1]) && _cursor_value() > 0) {
+					match = 7;
+					_combine_id = _cursor_id;
+				}
+			}
+			if (!match && forward > 0) {
+				match = 6;
+				_combine_id = forward_id;
+			}
+		}
 	}
-	if (_combine_backward && !match && i + 1 < size && in[i + 1]) {
-		_make_combine(in, i, 3);
-		if (_lexicon_combine->search(_combine.c_str()) > 0) match = 3;
+	if (_combine_backward && !match && i + 1 < size && in[i + 1] && _may_combine(in, i, 3)) {
+		_cursor->reset();
+		if (_advance(in[i]) && _advance(in[i + 1]) && _cursor_value() > 0) {
+			match = 3;
+			_combine_id = _cursor_id;
+		}
 	}
+	if (match) _make_combine(in, i, match);
 	if (_combine_koko && !match && i > 0 && in[i - 1] && in[i - 1]->get_length() == 1
 		&& strcmp(in[i]->get_token(), in[i - 1]->get_token()) == 0) {
 		_make_combine(in, i, 6);
@@ -107,9 +174,11 @@ int SingleCombineProcessor::_number_trailing_combine(size_t i, size_t size,
 		std::vector<TokenImpl *> &in, std::vector<TokenImpl *> &out)
 {
 	int match = 0;
+
+	_combine_id = -1;
 	if (i + 1 < size && in[i + 1]
 			  && in[i]->get_attr() == TokenImpl::attr_number 
-			  && _lexicon_number_trailing->search(in[i + 1]->get_token()))
+			  && _number_trailing(in[i + 1]))
 	{
 		_make_combine(in, i, 3);
 		match = 3;
@@ -117,6 +186,14 @@ int SingleCombineProcessor::_number_trailing_combine(size_t i, size_t size,
 	return match;
 }
 
+bool SingleCombineProcessor::can_split(TokenImpl *left, TokenImpl *right)
+{
+	/* combinations never span two tokens both longer than 2 characters,
+	 * unless the first is a number taking a trailing */
+	return left->get_length() > 2 && right->get_length() > 2
+		&& left->get_attr() != TokenImpl::attr_number;
+}
+
 void SingleCombineProcessor::process(std::vector<TokenImpl *> &in, std::vector<TokenImpl *> &out)
 {
 	size_t i, size, length, match;
@@ -150,6 +227,9 @@ void SingleCombineProcessor::process(std::vector<TokenImpl *> &in, std::vector<T
 				in[i + 1] = NULL;
 			}
 			out.push_back(new TokenImpl(_combine.c_str(), attr));
+			out.back()->set_span(_combine_span);
+			/* the walk which found the combination found its record too */
+			if (_combine_id >= 0) out.back()->set_record(_records_combine, _combine_id);
 		} else {
 			out.push_back(in[i]);
 		}
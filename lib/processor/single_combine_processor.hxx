@@ -40,7 +40,15 @@ namespace bamboo {
 class SingleCombineProcessor: public Processor {
 protected:
 	ILexicon *_lexicon_combine, *_lexicon_number_trailing;
+	/* the record lexicons the two are fields of, if any, whose keys
+	 * are walked for the combinations */
+	RecordLexicon *_records_combine, *_records_number_trailing;
+	int _field_combine, _field_number_trailing;
+	ILexicon *_walked;
+	ILexicon::Cursor *_cursor;
+	int _cursor_id, _combine_id;
 	std::string _combine;
+	TokenImpl::span_t _combine_span;
 	SingleCombineProcessor();
 	int _combine_koko, _combine_forward, _combine_backward, _combine_neighbor;
 	bool _can_process(TokenImpl *token) {return true;}
@@ -50,9 +58,29 @@ protected:
 	inline int _single_combine
 		(size_t i, size_t size, std::vector<TokenImpl *> &in, std::vector<TokenImpl *> &out);
 	inline void _make_combine(std::vector<TokenImpl *> &in, int i, int with);
+	inline bool _may_combine(std::vector<TokenImpl *> &in, int i, int with);
+	inline bool _number_trailing(TokenImpl *token);
+	bool _advance(TokenImpl *token)
+	{
+		const char *s = token->get_orig_token();
+		return _cursor->advance(s, strlen(s));
+	}
+	/* the value of the combination the cursor is at, its record
+	 * number kept in _cursor_id */
+	int _cursor_value()
+	{
+		const RecordLexicon::record_t *record;
+
+		if (_records_combine == NULL) return _cursor->value();
+		record = _records_combine->record(_cursor_id = _cursor->value());
+		return (record)?RecordLexicon::value(record, _field_combine):0;
+	}
 public:
 	void process(std::vector<TokenImpl *> &in, std::vector<TokenImpl *> &out);
 	SingleCombineProcessor(IConfig *config);
+	SingleCombineProcessor(const SingleCombineProcessor &rhs);
+	Processor *spawn() {return new SingleCombineProcessor(*this);}
+	bool can_split(TokenImpl *left, TokenImpl *right);
 	~SingleCombineProcessor();
 };
 
@@ -41,56 +41,101 @@ PROCESSOR_MODULE(UnigramProcessor)
 UnigramProcessor::UnigramProcessor(IConfig *config)
 {
 	const char *s;
+	int field = -1;
 
 	config->get_value("ele_lambda", _lambda);
 	config->get_value("unigram_lexicon", s);
 	if (*s == '\0')
 		throw std::runtime_error("unigram_lexicon is null");
 	config->get_value("max_token_length", _max_token_length);
-	_lexicon = LexiconFactory::load(s);
+	_lexicon = LexiconFactory::acquire(s);
+	/* the freq field of a record lexicon is walked as its keys */
+	_records = _lexicon->records(field);
+	if (_records && field != RecordLexicon::field_freq) _records = NULL;
 
 	_token = new char[(_max_token_length << 2) + 1]; /* x4 for unicode */
+	_matches = new trie_match_t[(_max_token_length << 2) + 1];
+}
+
+UnigramProcessor::UnigramProcessor(const UnigramProcessor &rhs)
+	:Processor(rhs), _lexicon(rhs._lexicon), _records(rhs._records), _lambda(rhs._lambda),
+	 _max_token_length(rhs._max_token_length)
+{
+	LexiconFactory::retain(_lexicon);
+	_token = new char[(_max_token_length << 2) + 1]; /* x4 for unicode */
+	_matches = new trie_match_t[(_max_token_length << 2) + 1];
 }
 
 UnigramProcessor::~UnigramProcessor()
 {
 	delete []_token;
-	delete _lexicon;
+	delete []_matches;
+	LexiconFactory::release(_lexicon);
 }
 
+/*
+ * With the freq field of a record lexicon, the walk gives the records
+ * of the words, whose logp is the estimate when it was made with this
+ * lambda, and every token cut keeps its record for the processors after.
+ */
 void UnigramProcessor::_process(TokenImpl *token, std::vector<TokenImpl *> &out)
 {
-	size_t i, j, k, length, max_token_length, *backref;
+	size_t i, j, k, m, n, length, max_token_length, *backref, *offsets;
 	double *score, lp;
 	size_t num_terms, num_types;
+	const RecordLexicon::record_t *record;
+	ILexicon *walked;
+	int *ids, single;
+	bool logp;
 	const char *s;
 
 	s = token->get_token();
 	num_terms = _lexicon->sum_value();
 	num_types = _lexicon->num_insert();
+	walked = (_records)?_records->keys():_lexicon;
+	logp = _records && _records->lambda() == _lambda;
 
 	length = token->get_length();
 	score = new double[length + 1];
 	backref = new size_t[length + 1];
 
+	/* byte offset of every character, as utf8::sub() steps */
+	_offsets.resize(token->get_bytes() + 1);
+	offsets = &_offsets[0];
+	offsets[utf8::index(s, offsets)] = token->get_bytes();
+
+	_ids.resize(length + 1);
+	ids = &_ids[0];
 	for (i = 0; i <= length; i++) {
 		score[i] = -1e300;
 		backref[i] = 0;
+		ids[i] = 0;
 	}
 
-	/* Calculate score using DP */
+	/* Calculate score using DP, one trie walk per start position */
 	score[0] = 0;
 	for (i = 0; i < length; i++) {
 		max_token_length = (_max_token_length  + i < length)?_max_token_length:length - i;
+		n = walked->common_prefix_search(s + offsets[i],
+				offsets[i + max_token_length] - offsets[i], _matches,
+				(_max_token_length << 2) + 1);
 		bool found = false;
-		for (j = 1; j <= max_token_length; j++) {
-			k = utf8::sub(_token, s, i, j);
-			int v = _lexicon->search(_token);
+		for (m = 0, j = 1, single = 0; m < n; m++) {
+			while (j < max_token_length && offsets[i + j] - offsets[i] < _matches[m].length) j++;
+			if (offsets[i + j] - offsets[i] != _matches[m].length) continue;
+			int v = _matches[m].value;
+			record = NULL;
+			if (_records) {
+				if (j == 1) single = v;
+				record = _records->record(v);
+				v = (record)?record->freq:0;
+			}
 			if (v > 0) {
-				lp = _ele_estimate(v, num_terms, num_types);
+				lp = (logp)?record->logp:_ele_estimate(v, num_terms, num_types);
 				if (score[i + j] < score[i] + lp) {
 					score[i + j] = score[i] + lp;
 					backref[i + j] = i;
+					ids[i + j] = _matches[m].value;
 					found = true;
 				}
 			}
@@ -102,14 +147,19 @@ void UnigramProcessor::_process(TokenImpl *token, std::vector<TokenImpl *> &out)
 			if (score[i + j] < score[i] + lp) {
 				score[i + j] = score[i] + lp;
 				backref[i + j] = i;
+				ids[i + j] = single;
 			}
 		}
 	}
 
 	assert(stack.empty() == true);
 	for (k = 0, i = length; i > 0;) {
-		k = utf8::sub(_token, s, backref[i], i - backref[i]);
+		k = offsets[i] - offsets[backref[i]];
+		memcpy(_token, s + offsets[backref[i]], k);
+		_token[k] = '\0';
 		stack.push(new TokenImpl(_token, TokenImpl::attr_cword));
+		stack.top()->set_span(token, backref[i], i - backref[i]);
+		if (_records) stack.top()->set_record(_records, ids[i]);
 		i = backref[i];
 	}
 	while(!stack.empty()) {
@@ -120,6 +170,5 @@ void UnigramProcessor::_process(TokenImpl *token, std::vector<TokenImpl *> &out)
 	delete []backref;
 }
 
-
 } //namespace bamboo
 
@@ -41,9 +41,13 @@ namespace bamboo {
 class UnigramProcessor: public Processor {
 protected:
 	ILexicon *_lexicon;
+	RecordLexicon *_records;
 	double _lambda;
 	int _max_token_length;
 	char *_token;
+	trie_match_t *_matches;
+	std::vector<size_t> _offsets;
+	std::vector<int> _ids;
 	std::stack<TokenImpl *> stack;
 
 	UnigramProcessor();
@@ -60,6 +64,8 @@ protected:
 
 public:
 	UnigramProcessor(IConfig *config);
+	UnigramProcessor(const UnigramProcessor &rhs);
+	Processor *spawn() {return new UnigramProcessor(*this);}
 	~UnigramProcessor();
 };
 
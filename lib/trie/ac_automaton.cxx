@@ -0,0 +1,199 @@
+/*
+ * Copyright (c) 2008, detrox@gmail.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <organization> nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY detrox@gmail.com ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL detrox@gmail.com BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+
+#include <sys/stat.h>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <limits>
+
+#include "ac_automaton.hxx"
+
+namespace bamboo {
+
+
+ACAutomaton::ACAutomaton(const char *index)
+	:_trie(NULL), _header(NULL), _fail(NULL), _out(NULL), _depth(NULL), _mmap(NULL)
+{
+	std::string filename = path(index);
+	char magic[magic_size];
+	struct stat buf;
+	_header_t *header;
+	FILE *fp;
+
+	fp = fopen(index, "r");
+	if (fp == NULL) throw std::runtime_error("can not open lexicon: " + std::string(index));
+	memset(magic, 0, sizeof(magic));
+	fread(magic, sizeof(magic), 1, fp);
+	fclose(fp);
+	if (strcmp(magic, "datrie") != 0)
+		throw std::runtime_error("an ac automaton needs a datrie index: " + std::string(index));
+	_trie = new DATrie(index);
+
+	/* links left from an older build of the index are built again */
+	if (stat(filename.c_str(), &buf) == 0) {
+		try {
+			_mmap = new MMap(filename.c_str());
+		} catch (...) {
+			delete _trie;
+			throw;
+		}
+		header = (_header_t *)_mmap->start();
+		if (_mmap->size() < sizeof(_header_t) || strcmp(header->magic, "ac_automaton") != 0
+				|| header->version != version || header->num < 0
+				|| _mmap->size() != sizeof(_header_t) + 3 * (size_t)header->num * sizeof(int32_t)) {
+			delete _mmap;
+			delete _trie;
+			throw std::runtime_error("unsupported ac automaton: " + filename);
+		}
+		if (_stamped(header)) {
+			_header = header;
+			_fail = (int32_t *)_mmap->start(sizeof(_header_t));
+			_out = _fail + _header->num;
+			_depth = _out + _header->num;
+			return;
+		}
+		delete _mmap;
+		_mmap = NULL;
+	}
+	try {
+		_build();
+	} catch (...) {
+		delete _header;
+		free(_fail);
+		delete _trie;
+		throw;
+	}
+}
+
+ACAutomaton::~ACAutomaton()
+{
+	if (_mmap) {
+		delete _mmap;
+	} else {
+		delete _header;
+		free(_fail);
+	}
+	delete _trie;
+}
+
+int ACAutomaton::_value(int32_t s)
+{
+	int32_t p = _tail_at(s), t;
+
+	if (p) return _trie->_tail[p + 1];
+	t = _trie->_forward(s, 0);
+	return (_trie->_base(t) < 0)?_trie->_tail[-_trie->_base(t)]:_trie->_base(t);
+}
+
+/*
+ * Breadth first from the root, so that the failure chain of a state is
+ * linked before its children: the failure of t, child of s by ch, is
+ * the child by ch of the nearest state on the chain of s having one.
+ */
+void ACAutomaton::_build()
+{
+	std::vector<int32_t> queue;
+	long long num;
+	int32_t s, t, f, p;
+	size_t i;
+	int ch, last;
+
+	num = (long long)_trie->_header->num + _trie->_extra->num;
+	if (num > std::numeric_limits<int32_t>::max())
+		throw std::runtime_error("trie too large for an ac automaton");
+	_header = new _header_t;
+	memset(_header, 0, sizeof(_header_t));
+	strcpy(_header->magic, "ac_automaton");
+	_header->version = version;
+	_header->num = num;
+	_header->num_state = _trie->_header->num;
+	_header->num_tail = _trie->_extra->num;
+	_header->num_insert = _trie->_header->num_insert;
+	_header->sum = _trie->_header->sum;
+	_fail = (int32_t *)calloc(3 * (size_t)num, sizeof(int32_t));
+	if (_fail == NULL) throw std::bad_alloc();
+	_out = _fail + num;
+	_depth = _out + num;
+
+	for (queue.push_back(1), i = 0; i < queue.size(); i++) {
+		s = queue[i];
+		/* a tail state has a single child, by its next cell */
+		p = _tail_at(s);
+		ch = (p)?_trie->_tail[p]:1;
+		last = (p)?_trie->_tail[p]:255;
+		for (; ch > 0 && ch <= last; ch++) {
+			if ((t = _goto(s, ch)) == 0) continue;
+			for (f = _fail[s]; f && _goto(f, ch) == 0; f = _fail[f]) ;
+			_fail[t] = (f)?_goto(f, ch):1;
+			_depth[t] = _depth[s] + 1;
+			_out[t] = (_ends(t))?t:_out[_fail[t]];
+			queue.push_back(t);
+		}
+	}
+}
+
+size_t ACAutomaton::match(const char *text, size_t len, std::vector<match_t> &matches)
+{
+	const unsigned char *p = (const unsigned char *)text;
+	size_t i, n = matches.size();
+	int32_t s, t, k;
+	match_t m;
+
+	for (i = 0, s = 1; i < len; i++) {
+		if (p[i] == 0) {
+			s = 1;
+			continue;
+		}
+		while ((t = _goto(s, p[i])) == 0 && s != 1) s = _fail[s];
+		s = (t)?t:1;
+		for (k = _out[s]; k; k = _out[_fail[k]]) {
+			m.begin = i + 1 - _depth[k];
+			m.end = i + 1;
+			m.value = _value(k);
+			matches.push_back(m);
+		}
+	}
+	return matches.size() - n;
+}
+
+void ACAutomaton::save(const char *filename)
+{
+	FILE *fp;
+
+	assert(filename);
+	fp = fopen(filename, "w+");
+	if (fp == NULL)
+		throw std::runtime_error("Can not write to file");
+	fwrite(_header, sizeof(_header_t), 1, fp);
+	fwrite(_fail, 3 * (size_t)_header->num * sizeof(int32_t), 1, fp);
+	fclose(fp);
+}
+
+} //namespace bamboo
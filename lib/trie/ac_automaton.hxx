@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2008, detrox@gmail.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <organization> nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY detrox@gmail.com ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL detrox@gmail.com BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#ifndef AC_AUTOMATON_HXX
+#define AC_AUTOMATON_HXX
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "datrie.hxx"
+#include "mmap.hxx"
+
+namespace bamboo {
+
+
+/*
+ * An Aho-Corasick automaton over the keys of a datrie index, finding
+ * every key occurring in a text in one pass over it. The goto function
+ * is the double array itself: its states, plus a state for each cell of
+ * the tail, state num + p standing after the tail cell p - 1 of a leaf.
+ * Only the failure links, the nearest key ending on the failure chain
+ * and the depth of each state are added, built in memory or mapped from
+ * a file saved beside the index. The stamp records the index they were
+ * built for, so that stale links are built again instead of used.
+ */
+class ACAutomaton {
+public:
+	static const int magic_size = 32;
+	static const int version = 1;
+
+	/* a key found in the text: bytes [begin, end) of it, and its value */
+	typedef struct {
+		size_t begin, end;
+		int value;
+	} match_t;
+
+	/* maps index, a 32-bit datrie, and the links saved beside it */
+	ACAutomaton(const char *index);
+	~ACAutomaton();
+
+	/* where the links of an index are saved */
+	static std::string path(const char *index)
+	{
+		return std::string(index) + ".ac";
+	}
+
+	/* whether the links were mapped from path(index) */
+	bool mapped()
+	{
+		return _mmap != NULL;
+	}
+
+	/*
+	 * Appends to matches every occurrence of a key in text[0, len), in
+	 * order of end, then of the longest first for the same end. NUL
+	 * bytes match nothing. The walk costs O(len) plus the matches.
+	 */
+	size_t match(const char *text, size_t len, std::vector<match_t> &matches);
+
+	void save(const char *filename);
+
+protected:
+	#pragma pack(push, 4)
+	typedef struct {
+		char magic[magic_size];
+		int version;
+		int num;		/* states: of the double array, then the tail */
+		int num_state;		/* the stamp of the index */
+		int num_tail;
+		int num_insert;
+		long long sum;
+	} _header_t;
+	#pragma pack(pop)
+
+	DATrie *_trie;
+	_header_t *_header;
+	int32_t *_fail, *_out, *_depth;
+	MMap *_mmap;
+
+	bool _stamped(_header_t *header)
+	{
+		return header->num_state == _trie->_header->num
+			&& header->num_tail == _trie->_extra->num
+			&& header->num_insert == _trie->_header->num_insert
+			&& header->sum == _trie->_header->sum;
+	}
+
+	/* the offset in the tail of the next cell a state compares, or 0 for
+	 * a state of the double array with children of its own */
+	int32_t _tail_at(int32_t s)
+	{
+		if (s >= _trie->_header->num) return s - _trie->_header->num;
+		return (_trie->_base(s) < 0)?-_trie->_base(s):0;
+	}
+
+	/* the state after reading ch, a byte other than NUL, or 0 */
+	int32_t _goto(int32_t s, int ch)
+	{
+		int32_t p = _tail_at(s);
+
+		if (p == 0) return _trie->_forward(s, ch);
+		return (_trie->_tail[p] == ch)?_trie->_header->num + p + 1:0;
+	}
+
+	/* whether a key ends at s, which has no child then for a tail */
+	bool _ends(int32_t s)
+	{
+		int32_t p = _tail_at(s);
+
+		return (p)?_trie->_tail[p] == 0:_trie->_forward(s, 0) != 0;
+	}
+
+	int _value(int32_t s);
+	void _build();
+
+private:
+	ACAutomaton(ACAutomaton &) {}
+};
+
+} //namespace bamboo
+
+#endif // AC_AUTOMATON_HXX
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2008, detrox@gmail.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <organization> nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY detrox@gmail.com ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL detrox@gmail.com BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+
+#include <cstring>
+#include <stdexcept>
+
+#include "bit_vector.hxx"
+
+namespace bamboo {
+
+
+/* arrays of 4-byte entries are saved padded to 8 bytes */
+static size_t _padded(size_t n)
+{
+	return (n * sizeof(uint32_t) + 7) & ~(size_t)7;
+}
+
+void BitVector::finish(bool select)
+{
+	size_t b, i, zeros;
+
+	/* a spare word at least, so that next0() always meets a zero */
+	_bits.resize((_size >> 6) + 2, 0);
+	_rank_dir.assign(_num_ranks(), 0);
+	for (b = 0, i = 0; b + 1 < _num_ranks(); b++) {
+		_rank_dir[b + 1] = _rank_dir[b];
+		for (; i < _bits.size() && i < (b + 1) * 8; i++)
+			_rank_dir[b + 1] += _popcount(_bits[i]);
+	}
+	_select_dir.clear();
+	for (i = 0, zeros = 0; select && i < _size; i++) {
+		if ((_bits[i >> 6] >> (i & 63)) & 1) continue;
+		if ((zeros++ & 63) == 0) _select_dir.push_back(i);
+	}
+	_num_selects = _select_dir.size();
+	_select_dir.push_back(0);
+	_words = &_bits[0];
+	_ranks = &_rank_dir[0];
+	_selects = &_select_dir[0];
+}
+
+size_t BitVector::bytes()
+{
+	return 3 * sizeof(uint64_t) + ((_size >> 6) + 2) * sizeof(uint64_t)
+		+ _padded(_num_ranks()) + _padded(_num_selects);
+}
+
+void BitVector::save(FILE *fp)
+{
+	static const char zero[8] = {0};
+
+	fwrite(&_size, sizeof(_size), 1, fp);
+	fwrite(&_ones, sizeof(_ones), 1, fp);
+	fwrite(&_num_selects, sizeof(_num_selects), 1, fp);
+	fwrite(_words, sizeof(uint64_t), (_size >> 6) + 2, fp);
+	fwrite(_ranks, sizeof(uint32_t), _num_ranks(), fp);
+	fwrite(zero, _padded(_num_ranks()) - _num_ranks() * sizeof(uint32_t), 1, fp);
+	if (_num_selects)
+		fwrite(_selects, sizeof(uint32_t), _num_selects, fp);
+	fwrite(zero, _padded(_num_selects) - _num_selects * sizeof(uint32_t), 1, fp);
+}
+
+const char *BitVector::map(const char *p)
+{
+	memcpy(&_size, p, sizeof(_size));
+	memcpy(&_ones, p + sizeof(_size), sizeof(_ones));
+	memcpy(&_num_selects, p + 2 * sizeof(_size), sizeof(_num_selects));
+	p += 3 * sizeof(uint64_t);
+	_words = (const uint64_t *)p;
+	p += ((_size >> 6) + 2) * sizeof(uint64_t);
+	_ranks = (const uint32_t *)p;
+	p += _padded(_num_ranks());
+	_selects = (const uint32_t *)p;
+	return p + _padded(_num_selects);
+}
+
+} //namespace bamboo
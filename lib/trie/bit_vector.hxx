@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2008, detrox@gmail.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <organization> nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY detrox@gmail.com ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL detrox@gmail.com BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#ifndef BIT_VECTOR_HXX
+#define BIT_VECTOR_HXX
+
+#include <stdint.h>
+#include <cstdio>
+#include <vector>
+
+namespace bamboo {
+
+
+/*
+ * A bit vector with rank of ones and select of zeros, for succinct
+ * tries. Bits are pushed one by one, then finish() builds the indexes:
+ * the ones before every 512-bit block, a sixteenth more bits, and when
+ * asked for, the position of every 64th zero, for select0(). Saved
+ * vectors are used in place, from a mapped file.
+ */
+class BitVector {
+public:
+	BitVector():_words(NULL), _ranks(NULL), _selects(NULL), _size(0), _ones(0), _num_selects(0) {}
+
+	void push_back(bool bit)
+	{
+		if ((_size & 63) == 0) _bits.push_back(0);
+		if (bit) {
+			_bits.back() |= 1ULL << (_size & 63);
+			_ones++;
+		}
+		_size++;
+	}
+
+	void finish(bool select=false);
+
+	size_t size()
+	{
+		return _size;
+	}
+
+	size_t ones()
+	{
+		return _ones;
+	}
+
+	bool operator[](size_t i)
+	{
+		return (_words[i >> 6] >> (i & 63)) & 1;
+	}
+
+	/* the ones in [0, i) */
+	size_t rank1(size_t i)
+	{
+		size_t r = _ranks[i >> 9], w;
+
+		for (w = (i >> 9) << 3; w < (i >> 6); w++)
+			r += _popcount(_words[w]);
+		if (i & 63)
+			r += _popcount(_words[i >> 6] & ((1ULL << (i & 63)) - 1));
+		return r;
+	}
+
+	/* the position of zero number i, counted from 0; needs finish(true) */
+	size_t select0(size_t i)
+	{
+		size_t pos = _selects[i >> 6], w = pos >> 6, n;
+		uint64_t word = ~_words[w] >> (pos & 63) << (pos & 63);
+
+		for (i &= 63;; word = ~_words[++w]) {
+			n = _popcount(word);
+			if (i < n) break;
+			i -= n;
+		}
+		return (w << 6) + _select(word, i);
+	}
+
+	/* the first zero at i or after it */
+	size_t next0(size_t i)
+	{
+		uint64_t w = ~_words[i >> 6] >> (i & 63);
+
+		if (w) return i + __builtin_ctzll(w);
+		for (i = (i >> 6) + 1; ~_words[i] == 0; i++) ;
+		return (i << 6) + __builtin_ctzll(~_words[i]);
+	}
+
+	/* bytes save() writes */
+	size_t bytes();
+	void save(FILE *fp);
+	/* uses the vector saved at p in place, returns the end of it */
+	const char *map(const char *p);
+
+protected:
+	std::vector<uint64_t> _bits;
+	std::vector<uint32_t> _rank_dir, _select_dir;
+	const uint64_t *_words;
+	const uint32_t *_ranks, *_selects;
+	uint64_t _size, _ones, _num_selects;
+
+	size_t _num_ranks()
+	{
+		return (_size >> 9) + 2;
+	}
+
+	static int _popcount(uint64_t x)
+	{
+#ifdef __POPCNT__
+		return __builtin_popcountll(x);
+#else
+		x = x - ((x >> 1) & 0x5555555555555555ULL);
+		x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+		return (((x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fULL) * 0x0101010101010101ULL) >> 56;
+#endif
+	}
+
+	/*
+	 * The position of set bit number i of word, counted from 0: the
+	 * byte holding it from the prefix sums of the byte counts, then the
+	 * bit inside the byte.
+	 */
+	static int _select(uint64_t word, size_t i)
+	{
+		const uint64_t ones = 0x0101010101010101ULL, highs = 0x8080808080808080ULL;
+		uint64_t s, k = i * ones;
+		int b;
+
+		s = word - ((word >> 1) & 0x5555555555555555ULL);
+		s = (s & 0x3333333333333333ULL) + ((s >> 2) & 0x3333333333333333ULL);
+		s = ((s + (s >> 4)) & 0x0f0f0f0f0f0f0f0fULL) * ones;
+		/* the bytes whose prefix sum is at most i, times 8 */
+		b = ((((((k | highs) - (s & ~highs)) ^ s ^ k) & highs) >> 7) * ones >> 53) & ~7;
+		i -= ((s << 8) >> b) & 0xff;
+		for (word >>= b; i > 0; i--)
+			word &= word - 1;
+		return b + __builtin_ctzll(word);
+	}
+};
+
+} //namespace bamboo
+
+#endif // BIT_VECTOR_HXX
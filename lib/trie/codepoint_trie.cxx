@@ -0,0 +1,681 @@
+/*
+ * Copyright (c) 2008, detrox@gmail.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <organization> nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY detrox@gmail.com ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL detrox@gmail.com BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#include <climits>
+#include <algorithm>
+#include <functional>
+
+#include "codepoint_trie.hxx"
+
+namespace bamboo {
+
+
+CodePointTrie::CodePointTrie(int size)
+	:_header(NULL), _page(NULL), _id(NULL), _char(NULL), _unit(NULL), _tail(NULL),
+	 _mmap(NULL), _dirty(true), _first_free(0), _annotated(false)
+{
+	pthread_mutex_init(&_best_lock, NULL);
+	_header = new _header_t;
+	memset(_header, 0, sizeof(_header_t));
+	strcpy(_header->magic, "codepoint_trie");
+	_header->version = version;
+	_header->min = 0xffffff;
+}
+
+CodePointTrie::CodePointTrie(const char *filename)
+	:_header(NULL), _page(NULL), _id(NULL), _char(NULL), _unit(NULL), _tail(NULL),
+	 _mmap(NULL), _dirty(false), _first_free(0), _annotated(false)
+{
+	pthread_mutex_init(&_best_lock, NULL);
+	size_t off;
+
+	_mmap = new MMap(filename);
+	_header = (_header_t *)_mmap->start();
+	if (strcmp(_header->magic, "codepoint_trie") != 0 || _header->version != version) {
+		delete _mmap;
+		throw std::runtime_error(std::string("unsupported trie version: ") + filename);
+	}
+	off = sizeof(_header_t);
+	_page = (int *)_mmap->start(off);
+	off += num_pages * sizeof(int);
+	_id = (int *)_mmap->start(off);
+	off += (_header->pages << 8) * sizeof(int);
+	_char = (int *)_mmap->start(off);
+	off += _header->alphabet * sizeof(int);
+	_unit = (_unit_t *)_mmap->start(off);
+	off += _header->num * sizeof(_unit_t);
+	_tail = (unsigned char *)_mmap->start(off);
+}
+
+CodePointTrie::~CodePointTrie()
+{
+	pthread_mutex_destroy(&_best_lock);
+	if (_mmap)
+		delete _mmap;
+	else
+		delete _header;
+}
+
+void CodePointTrie::insert(const char *key, int val)
+{
+	if (key == NULL) throw std::runtime_error("Empty Key");
+	if (_mmap) throw std::runtime_error("can not insert into a mapped trie");
+	_keys[key] = val;
+	_dirty = true;
+	_annotated = false;
+	_header->max = (val > _header->max)?val:_header->max;
+	_header->min = (val < _header->min)?val:_header->min;
+	_header->sum += val;
+	_header->num_insert++;
+}
+
+static bool _by_frequency(const std::pair<size_t, int> &a, const std::pair<size_t, int> &b)
+{
+	return (a.first != b.first)?a.first > b.first:a.second < b.second;
+}
+
+/* ids of the code points in the keys, the most frequent first */
+void CodePointTrie::_alphabet()
+{
+	std::map<int, size_t> count;
+	std::map<int, size_t>::iterator c;
+	std::vector<std::pair<size_t, int> > rank;
+	_key_t it;
+	const unsigned char *p;
+	size_t i, n;
+	int ch, page;
+
+	for (it = _keys.begin(); it != _keys.end(); it++) {
+		p = (const unsigned char *)it->first.data();
+		n = it->first.size();
+		for (i = 0; i < n;) {
+			i += _decode(p + i, n - i, false, ch);
+			if (ch >= 0x80) count[ch]++;
+		}
+	}
+	for (c = count.begin(); c != count.end(); c++)
+		rank.push_back(std::make_pair(c->second, c->first));
+	std::sort(rank.begin(), rank.end(), _by_frequency);
+
+	_chars.resize(0x80);
+	for (i = 0; i < 0x80; i++) _chars[i] = i;
+	_pages.assign(num_pages, 0);
+	_ids.assign(0x100, 0);	/* page 0 is the empty one */
+	for (i = 0; i < rank.size(); i++) {
+		ch = rank[i].second;
+		page = ch >> 8;
+		if (_pages[page] == 0) {
+			_pages[page] = _ids.size() >> 8;
+			_ids.resize(_ids.size() + 0x100, 0);
+		}
+		_ids[(_pages[page] << 8) | (ch & 0xff)] = _chars.size();
+		_chars.push_back(ch);
+	}
+
+	_header->alphabet = _chars.size();
+	_header->pages = _ids.size() >> 8;
+	_page = &_pages[0];
+	_id = &_ids[0];
+	_char = &_chars[0];
+}
+
+/* see CompactTrie::_find_base() */
+int CodePointTrie::_find_base(const std::vector<int> &codes)
+{
+	size_t p, b, i, busy;
+	_unit_t zero = {0, 0};
+	int lo = codes[0];
+
+	while (_used[_first_free]) _first_free++;
+	for (p = _first_free, busy = 0;; p++) {
+		if (p + _header->alphabet >= _units.size()) {
+			_units.resize(_units.size() * 2 + _header->alphabet, zero);
+			_used.resize(_units.size(), 0);
+		}
+		if (_used[p]) {
+			busy++;
+			continue;
+		}
+		if (p <= (size_t)lo) continue;
+		b = p - lo;
+		for (i = 0; i < codes.size() && !_used[b + codes[i]]; i++) ;
+		if (i == codes.size()) break;
+	}
+	if (busy * 20 >= (p - _first_free) * 19) _first_free = p;
+	return b;
+}
+
+/*
+ * Groups keys [lo, hi) by their character at depth, down to the single
+ * keys, and returns the node of the group.
+ */
+int CodePointTrie::_split(std::vector<_key_t> &keys, size_t lo, size_t hi, size_t depth,
+		std::vector<_node_t> &nodes)
+{
+	std::vector<std::pair<int, size_t> > order;
+	std::vector<_key_t> range;
+	const std::string *key;
+	_node_t *node;
+	size_t i, len;
+	int n, id;
+
+	/*
+	 * Keys sharing a character at depth are not always adjacent in byte
+	 * order: a raw lead byte sorts around the sequences it may start. So
+	 * group them by id, keeping byte order within each group.
+	 */
+	for (i = lo; i < hi; i++) {
+		key = &keys[i]->first;
+		if (depth < key->size())
+			_next((const unsigned char *)key->data() + depth, key->size() - depth, false, id);
+		else
+			id = 0;
+		order.push_back(std::make_pair(id, i));
+	}
+	std::sort(order.begin(), order.end());
+	range.assign(keys.begin() + lo, keys.begin() + hi);
+
+	n = nodes.size();
+	nodes.push_back(_node_t());
+	node = &nodes[n];
+	for (i = lo; i < hi; i++) {
+		keys[i] = range[order[i - lo].second - lo];
+		id = order[i - lo].first;
+		if (node->codes.empty() || node->codes.back() != id) {
+			key = &keys[i]->first;
+			len = (id)?_next((const unsigned char *)key->data() + depth, key->size() - depth, false, id):0;
+			node->codes.push_back(id);
+			node->starts.push_back(i);
+			node->lengths.push_back(len);
+		}
+	}
+	node->starts.push_back(hi);
+	node->next.assign(node->codes.size(), -1);
+
+	for (i = 0; i < nodes[n].codes.size(); i++) {
+		if (nodes[n].codes[i] == 0 || nodes[n].starts[i + 1] - nodes[n].starts[i] == 1)
+			continue;
+		id = _split(keys, nodes[n].starts[i], nodes[n].starts[i + 1],
+				depth + nodes[n].lengths[i], nodes);
+		nodes[n].next[i] = id;
+	}
+	return n;
+}
+
+/* writes node, placed at s, and the states below it */
+void CodePointTrie::_build(const std::vector<_key_t> &keys, const std::vector<_node_t> &nodes,
+		int node, size_t depth, int s)
+{
+	const _node_t *p = &nodes[node];
+	const std::string *key;
+	size_t i;
+	int t, val;
+
+	_units[s].base = p->base;
+	for (i = 0; i < p->codes.size(); i++) {
+		t = p->base + p->codes[i];
+		_units[t].check = s;
+		if (p->codes[i] == 0) {
+			_units[t].base = keys[p->starts[i]]->second;
+		} else if (p->next[i] >= 0) {
+			_build(keys, nodes, p->next[i], depth + p->lengths[i], t);
+		} else {
+			/* a single key left: the rest of it goes to the tail */
+			key = &keys[p->starts[i]]->first;
+			val = keys[p->starts[i]]->second;
+			_units[t].base = -(int)_tails.size();
+			_tails.insert(_tails.end(), key->begin() + depth + p->lengths[i], key->end());
+			_tails.push_back(0);
+			_tails.insert(_tails.end(), (unsigned char *)&val, (unsigned char *)&val + sizeof(val));
+		}
+	}
+}
+
+static bool _by_children(const std::pair<size_t, int> &a, const std::pair<size_t, int> &b)
+{
+	return (a.first != b.first)?a.first > b.first:a.second < b.second;
+}
+
+void CodePointTrie::_compact()
+{
+	std::vector<_key_t> keys;
+	std::vector<_node_t> nodes;
+	std::vector<std::pair<size_t, int> > order;
+	_key_t it;
+	_unit_t zero = {0, 0};
+	size_t i, j, n;
+
+	_alphabet();
+	for (it = _keys.begin(); it != _keys.end(); it++)
+		keys.push_back(it);
+
+	/* unit 0 is never a child, unit 1 is the root; tail offset 0 is unused
+	 * so that every tail node has a negative base */
+	_units.assign(2 + _header->alphabet, zero);
+	_used.assign(_units.size(), 0);
+	_used[0] = _used[1] = 1;
+	_first_free = 2;
+	_tails.assign(1, 0);
+
+	/* the root is a node even above a single key */
+	if (!keys.empty()) _split(keys, 0, keys.size(), 0, nodes);
+
+	/*
+	 * Children spread over the alphabet fit first fit poorly once the
+	 * array fills up, so the states with the most children are placed
+	 * first, while it is still empty; where a state lies does not depend
+	 * on where its own children go.
+	 */
+	for (i = 0; i < nodes.size(); i++)
+		order.push_back(std::make_pair(nodes[i].codes.size(), (int)i));
+	std::sort(order.begin(), order.end(), _by_children);
+	for (i = 0; i < order.size(); i++) {
+		_node_t &node = nodes[order[i].second];
+		node.base = _find_base(node.codes);
+		for (j = 0; j < node.codes.size(); j++)
+			_used[node.base + node.codes[j]] = 1;
+	}
+	if (!nodes.empty()) _build(keys, nodes, 0, 0, 1);
+
+	for (n = _units.size(); n > 2 && !_used[n - 1]; n--) ;
+	_units.resize(n);
+	std::vector<char>().swap(_used);
+
+	_header->num = _units.size();
+	_header->tail = _tails.size();
+	_unit = &_units[0];
+	_tail = &_tails[0];
+	_dirty = false;
+}
+
+int CodePointTrie::search(const char *key)
+{
+	const unsigned char *p, *q;
+	int s, id;
+
+	if (_dirty) _compact();
+	for (s = 1, p = (const unsigned char *)key;;) {
+		if (_base(s) < 0) {
+			for (q = _tail - _base(s); *q && *q == *p; q++, p++) ;
+			return (*q == 0 && *p == 0)?_tail_value(q + 1):0;
+		}
+		if (*p == 0) {
+			s = _forward(s, 0);
+			return (s)?_base(s):0;
+		}
+		/* the NUL ends a cut character as the end of the key would */
+		p += _next(p, 4, false, id);
+		if ((s = _forward(s, id)) == 0) return 0;
+	}
+}
+
+/* see DoubleArray::common_prefix_search(); matches end between characters */
+size_t CodePointTrie::common_prefix_search(const char *key, size_t len,
+		trie_match_t *matches, size_t size)
+{
+	const unsigned char *p = (const unsigned char *)key, *q;
+	size_t i, j, n;
+	int s, t, id, ch;
+
+	if (_dirty) _compact();
+	for (s = 1, i = 0, n = 0; n < size;) {
+		if (_base(s) < 0) {
+			for (q = _tail - _base(s), j = i; *q && i < len && *q == p[i]; q++, i++) ;
+			/* the tail may end inside a character of key */
+			while (j < i) j += _decode(p + j, len - j, false, ch);
+			if (*q == 0 && j == i) {
+				matches[n].length = i;
+				matches[n++].value = _tail_value(q + 1);
+			}
+			break;
+		}
+		if (i > 0 && (t = _forward(s, 0)) != 0) {
+			matches[n].length = i;
+			matches[n++].value = _base(t);
+		}
+		if (i >= len || p[i] == '\0') break;
+		i += _next(p + i, len - i, false, id);
+		if ((s = _forward(s, id)) == 0) break;
+	}
+	return n;
+}
+
+/*
+ * Moves s, or p inside the tail, along key. Returns the bytes used, less
+ * than len only when more is set and the last character is cut.
+ */
+size_t CodePointTrie::_walk(int &s, int &p, const unsigned char *key, size_t len, bool more)
+{
+	size_t i, n;
+	int id;
+
+	for (i = 0; i < len && s;) {
+		if (key[i] == '\0') {
+			s = 0;
+		} else if (p || _base(s) < 0) {
+			if (p == 0) p = -_base(s);
+			if (_tail[p] == key[i]) {
+				p++;
+				i++;
+			} else {
+				s = 0;
+			}
+		} else {
+			if ((n = _next(key + i, len - i, more, id)) == 0) return i;
+			s = _forward(s, id);
+			i += n;
+		}
+	}
+	return len;
+}
+
+int CodePointTrie::_value(int s, int p)
+{
+	int t;
+
+	if (s == 0) return 0;
+	if (p || _base(s) < 0) {
+		t = (p)?p:-_base(s);
+		return (_tail[t] == 0)?_tail_value(_tail + t + 1):0;
+	}
+	t = _forward(s, 0);
+	return (t)?_base(t):0;
+}
+
+bool CodePointTrie::Cursor::advance(const char *key, size_t len)
+{
+	const unsigned char *k = (const unsigned char *)key;
+	size_t i = 0, n;
+
+	/* finish the character cut by the last call a byte at a time */
+	while (_npend && i < len && _s) {
+		_pend[_npend++] = k[i++];
+		n = _trie->_walk(_s, _p, _pend, _npend, true);
+		memmove(_pend, _pend + n, _npend - n);
+		_npend -= n;
+	}
+	if (_npend == 0 && i < len && _s) {
+		n = _trie->_walk(_s, _p, k + i, len - i, true);
+		memcpy(_pend, k + i + n, len - i - n);
+		_npend = len - i - n;
+	}
+	if (_s == 0) _npend = 0;
+	return _s != 0;
+}
+
+int CodePointTrie::Cursor::value()
+{
+	int s = _s, p = _p;
+
+	if (_npend) _trie->_walk(s, p, _pend, _npend, false);
+	return _trie->_value(s, p);
+}
+
+/* see DoubleArray::_annotate(); the children are kept */
+void CodePointTrie::_annotate()
+{
+	std::vector<int> order;
+	int n, s, t, c;
+	size_t i;
+
+	if (_annotated) return;
+	pthread_mutex_lock(&_best_lock);
+	if (_annotated) {
+		pthread_mutex_unlock(&_best_lock);
+		return;
+	}
+
+	n = _header->num;
+	_first.assign(n + 1, 0);
+	for (t = 2; t < n; t++)
+		if ((c = _unit[t].check) > 0 && c < n) _first[c + 1]++;
+	for (s = 0; s < n; s++)
+		_first[s + 1] += _first[s];
+	_children.resize(_first[n]);
+	order.assign(_first.begin(), _first.end() - 1);
+	for (t = 2; t < n; t++)
+		if ((c = _unit[t].check) > 0 && c < n) _children[order[c]++] = t;
+
+	order.assign(1, 1);
+	for (i = 0; i < order.size(); i++)
+		for (c = _first[order[i]]; c < _first[order[i] + 1]; c++)
+			order.push_back(_children[c]);
+
+	_best.assign(n, INT_MIN);
+	for (i = order.size(); i-- > 1;) {
+		t = order[i];
+		c = _unit[t].check;
+		if (t == _base(c) || _base(t) < 0)
+			_best[t] = _leaf(t, t == _base(c), NULL);
+		if (_best[t] > _best[c]) _best[c] = _best[t];
+	}
+
+	__sync_synchronize();
+	_annotated = true;
+	pthread_mutex_unlock(&_best_lock);
+}
+
+/*
+ * Adds the candidate for unit t below key. Unlike in the byte tries, the
+ * keys below a unit are not all the keys starting with its bytes: those
+ * of a raw 0xe4 may sort after those of the character it starts. So the
+ * key of a leaf is made whole here, for the order of the heap to hold.
+ */
+void CodePointTrie::_candidate(int t, bool end, const std::string &key,
+		std::vector<trie_candidate_t> &candidates)
+{
+	trie_candidate_t next;
+
+	next.s = t;
+	next.key = key;
+	next.end = end || _base(t) < 0;
+	next.bound = (next.end)?_leaf(t, end, &next.key):_best[t];
+	candidates.push_back(next);
+}
+
+/* the candidates for the rest n bytes of a prefix, from s and p */
+void CodePointTrie::_prefix(int s, int p, std::string key, const unsigned char *rest, size_t n,
+		std::vector<trie_candidate_t> &candidates)
+{
+	const unsigned char *q;
+	size_t m, len;
+	int c, t;
+	char buf[4];
+
+	m = _walk(s, p, rest, n, true);
+	if (s == 0) return;
+	key.append((const char *)rest, m);
+	if (p) {
+		/* inside the tail of the only key below s */
+		for (q = _tail + p; *q; q++)
+			key.push_back(*q);
+		candidates.push_back(trie_candidate_t());
+		candidates.back().s = s;
+		candidates.back().end = true;
+		candidates.back().bound = _tail_value(q + 1);
+		candidates.back().key = key;
+		return;
+	}
+	if (m == n) {
+		_candidate(s, false, key, candidates);
+		return;
+	}
+
+	/* the prefix ends inside a character: the characters starting with
+	 * the rest, and those the rest starts with and goes on after */
+	rest += m;
+	n -= m;
+	for (c = _first[s]; c < _first[s + 1]; c++) {
+		t = _children[c];
+		if (t == _base(s)) continue;
+		len = _encode(_char[t - _base(s)], buf);
+		if (len >= n && memcmp(buf, rest, n) == 0)
+			_candidate(t, false, key + std::string(buf, len), candidates);
+		else if (len < n && memcmp(buf, rest, len) == 0)
+			_prefix(t, 0, key + std::string(buf, len), rest + len, n - len, candidates);
+	}
+}
+
+/* see DoubleArray::_predict() */
+size_t CodePointTrie::predictive_search(const char *prefix, size_t limit,
+		on_explore_finish_t cb, void *arg)
+{
+	std::vector<trie_candidate_t> candidates;
+	std::vector<size_t> heap;
+	TrieCandidateOrder order(candidates);
+	trie_candidate_t next;
+	std::vector<int> bounds;
+	size_t i, n;
+	int c, t, cut;
+	char buf[4];
+
+	if (_dirty) _compact();
+	if (limit == 0) return 0;
+	_annotate();
+	_prefix(1, 0, std::string(), (const unsigned char *)prefix, strlen(prefix), candidates);
+	for (i = 0; i < candidates.size(); i++)
+		heap.push_back(i);
+	std::make_heap(heap.begin(), heap.end(), order);
+
+	for (n = 0; n < limit && !heap.empty();) {
+		std::pop_heap(heap.begin(), heap.end(), order);
+		next = candidates[heap.back()];
+		heap.pop_back();
+		if (next.end) {
+			cb(next.key.c_str(), next.bound, arg);
+			n++;
+			continue;
+		}
+		/*
+		 * Every candidate leads to a key of its bound, so children below
+		 * the limit - n best bounds of them are never reached; a busy
+		 * state may have thousands.
+		 */
+		bounds.clear();
+		for (c = _first[next.s]; c < _first[next.s + 1]; c++)
+			bounds.push_back(_best[_children[c]]);
+		cut = INT_MIN;
+		if (bounds.size() > limit - n) {
+			std::nth_element(bounds.begin(), bounds.begin() + (limit - n - 1), bounds.end(),
+					std::greater<int>());
+			cut = bounds[limit - n - 1];
+		}
+		for (c = _first[next.s]; c < _first[next.s + 1]; c++) {
+			t = _children[c];
+			if (_best[t] < cut) continue;
+			if (t == _base(next.s))
+				_candidate(t, true, next.key, candidates);
+			else
+				_candidate(t, false, next.key + std::string(buf,
+						_encode(_char[t - _base(next.s)], buf)), candidates);
+			heap.push_back(candidates.size() - 1);
+			std::push_heap(heap.begin(), heap.end(), order);
+		}
+	}
+	return n;
+}
+
+static bool _by_bytes(const std::pair<std::string, int> &a, const std::pair<std::string, int> &b)
+{
+	return a.first < b.first;
+}
+
+void CodePointTrie::_explore(on_explore_finish_t cb, void *arg, int s, std::string &key,
+		const std::vector<std::vector<int> > &children)
+{
+	std::vector<std::pair<std::string, int> > next;
+	const unsigned char *q;
+	size_t i, n = key.size();
+	int ch, t;
+	char buf[4];
+
+	if (_base(s) < 0) {
+		q = _tail - _base(s);
+		key.append((const char *)q);
+		cb(key.c_str(), _tail_value(q + strlen((const char *)q) + 1), arg);
+		key.resize(n);
+		return;
+	}
+
+	/* children in the byte order of their characters, as the other tries */
+	for (i = 0; i < children[s].size(); i++) {
+		t = children[s][i];
+		ch = _char[t - _base(s)];
+		if (t == _base(s))
+			next.push_back(std::make_pair(std::string(), t));
+		else
+			next.push_back(std::make_pair(std::string(buf, _encode(ch, buf)), t));
+	}
+	std::sort(next.begin(), next.end(), _by_bytes);
+
+	for (i = 0; i < next.size(); i++) {
+		if (next[i].first.empty()) {
+			cb(key.c_str(), _base(next[i].second), arg);
+		} else {
+			key.append(next[i].first);
+			_explore(cb, arg, next[i].second, key, children);
+			key.resize(n);
+		}
+	}
+}
+
+void CodePointTrie::explore(on_explore_finish_t cb, void *arg)
+{
+	std::vector<std::vector<int> > children;
+	std::string key;
+	int t;
+
+	if (_dirty) _compact();
+	/* an array of the size of the alphabet per state would be too slow
+	 * to scan, so list the children of every state at once */
+	children.resize(_header->num);
+	for (t = 2; t < _header->num; t++)
+		if (_unit[t].check > 0) children[_unit[t].check].push_back(t);
+	_explore(cb, arg, 1, key, children);
+}
+
+void CodePointTrie::save(const char *filename)
+{
+	FILE *fp;
+
+	assert(filename);
+	if (_dirty) _compact();
+	fp = fopen(filename, "w+");
+	if (fp == NULL)
+		throw std::runtime_error("Can not write to file");
+	fwrite(_header, sizeof(_header_t), 1, fp);
+	fwrite(_page, num_pages * sizeof(int), 1, fp);
+	fwrite(_id, (_header->pages << 8) * sizeof(int), 1, fp);
+	fwrite(_char, _header->alphabet * sizeof(int), 1, fp);
+	fwrite(_unit, _header->num * sizeof(_unit_t), 1, fp);
+	fwrite(_tail, _header->tail, 1, fp);
+	fclose(fp);
+}
+
+
+} //namespace bamboo
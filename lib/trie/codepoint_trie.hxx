@@ -0,0 +1,368 @@
+/*
+ * Copyright (c) 2008, detrox@gmail.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <organization> nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY detrox@gmail.com ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL detrox@gmail.com BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#ifndef CODEPOINT_TRIE_HXX
+#define CODEPOINT_TRIE_HXX
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "double_array.hxx"
+
+namespace bamboo {
+
+
+/*
+ * A read-only double array like CompactTrie, moving a character rather
+ * than a byte per transition, so that a Chinese character costs one state
+ * lookup instead of three.
+ *
+ *   header   magic "codepoint_trie", version, sizes and value statistics
+ *   pages    id page of each 256 code points, 0 when none is in a key
+ *   ids      256 alphabet ids per page, 0 for a code point in no key
+ *   chars    code point of each id
+ *   units    {base, check} per state; children of s at base(s) + id
+ *   tail     suffix bytes, '\0', then the value as 4 unaligned bytes
+ *
+ * ASCII takes ids 1 to 127 as is, without a table lookup; the other code
+ * points get ids from 128 on by their frequency in the keys, so that the
+ * children of busy states stay dense. Bytes not starting a valid UTF-8
+ * sequence stand for themselves as code points past 0x10ffff, so every
+ * byte string is still a key. Id 0 leads to the value of a key, as the
+ * '\0' byte does in CompactTrie.
+ */
+class CodePointTrie {
+	template<class T, class V> friend void trie_search_batch(T *, const char **, size_t, V *);
+public:
+	static const int magic_size = 32;
+	static const int version = 2;
+	static const int max_char = 0x110100;	/* code points, then raw bytes */
+	static const int num_pages = max_char >> 8;
+
+	CodePointTrie(int size=0);
+	CodePointTrie(const char *filename);
+	~CodePointTrie();
+
+	void explore(on_explore_finish_t cb, void *arg);
+
+	int max_value()
+	{
+		return _header->max;
+	}
+
+	int min_value()
+	{
+		return _header->min;
+	}
+
+	int sum_value()
+	{
+		return _header->sum;
+	}
+
+	int num_insert()
+	{
+		return _header->num_insert;
+	}
+
+	void insert(const char *key, int val);
+	int search(const char *key);
+	/* see DoubleArray::search_batch() */
+	void search_batch(const char **keys, size_t n, int *values)
+	{
+		if (_dirty) _compact();
+		trie_search_batch(this, keys, n, values);
+	}
+	size_t common_prefix_search(const char *key, size_t len, trie_match_t *matches, size_t size);
+	/* see DoubleArray::predictive_search(); prefix may end inside a character */
+	size_t predictive_search(const char *prefix, size_t limit, on_explore_finish_t cb, void *arg);
+	void save(const char *filename);
+
+	/*
+	 * See DoubleArray::Cursor. A character cut at the end of a call waits
+	 * for the next one, keeping the cursor alive until then.
+	 */
+	class Cursor {
+	private:
+		CodePointTrie *_trie;
+		int _s, _p;	/* state, and offset in _tail once past a tail node */
+		unsigned char _pend[4];
+		size_t _npend;
+	public:
+		Cursor(CodePointTrie *trie):_trie(trie), _s(1), _p(0), _npend(0)
+		{
+			if (_trie->_dirty) _trie->_compact();
+		}
+		void reset() {_s = 1; _p = 0; _npend = 0;}
+		bool dead() {return _s == 0;}
+		bool advance(const char *key, size_t len);
+		int value();
+	};
+
+protected:
+	#pragma pack(push, 4)
+	typedef struct {
+		char magic[magic_size];
+		int version;
+		int num;		/* units */
+		int tail;		/* bytes of tail */
+		int alphabet;		/* ids, the end of key included */
+		int pages;		/* pages of ids */
+		int max, min;
+		long long sum;
+		int num_insert;
+	} _header_t;
+
+	typedef struct {
+		int base;
+		int check;
+	} _unit_t;
+	#pragma pack(pop)
+
+	typedef std::map<std::string, int>::const_iterator _key_t;
+
+	/* a state with two keys or more below it, while building */
+	typedef struct {
+		std::vector<int> codes;		/* ids of the children, ascending */
+		std::vector<size_t> starts;	/* first key of each child, then the end */
+		std::vector<size_t> lengths;	/* bytes of the character of each child */
+		std::vector<int> next;		/* node of each child, -1 for a leaf */
+		int base;
+	} _node_t;
+
+	_header_t *_header;
+	int *_page, *_id, *_char;
+	_unit_t *_unit;
+	unsigned char *_tail;
+	MMap *_mmap;
+
+	/* in memory only: the keys, and the tables built from them */
+	std::map<std::string, int> _keys;
+	bool _dirty;
+	std::vector<int> _pages, _ids, _chars;
+	std::vector<_unit_t> _units;
+	std::vector<unsigned char> _tails;
+	std::vector<char> _used;
+	size_t _first_free;
+
+	/*
+	 * The highest value below each unit, see DoubleArray::_annotate(),
+	 * and the children of each unit, units _children[_first[s]] on, as
+	 * the alphabet is too wide to look for them.
+	 */
+	std::vector<int> _best, _first, _children;
+	volatile bool _annotated;
+	pthread_mutex_t _best_lock;
+
+	/*
+	 * The character at p, of at most n bytes: its length, and its code
+	 * point in ch. With more set, 0 for a sequence cut by n that further
+	 * bytes may complete.
+	 */
+	static size_t _decode(const unsigned char *p, size_t n, bool more, int &ch)
+	{
+		static const int min[] = {0, 0x80, 0x800, 0x10000};
+		size_t i, len;
+		int c = p[0];
+
+		if (c < 0x80) {
+			ch = c;
+			return 1;
+		}
+		len = (c >= 0xc2 && c < 0xe0)?2:(c >= 0xe0 && c < 0xf0)?3:(c >= 0xf0 && c < 0xf5)?4:1;
+		ch = c & (0x7f >> len);
+		for (i = 1; i < len; i++) {
+			if (i >= n) {
+				if (more) return 0;
+				break;
+			}
+			if ((p[i] & 0xc0) != 0x80) break;
+			ch = (ch << 6) | (p[i] & 0x3f);
+		}
+		if (len == 1 || i < len || ch < min[len - 1] || ch > 0x10ffff) {
+			ch = 0x110000 + c;
+			return 1;
+		}
+		return len;
+	}
+
+	/* the alphabet id of the character at p, -1 when in no key */
+	size_t _next(const unsigned char *p, size_t n, bool more, int &id)
+	{
+		size_t len;
+		int ch, page;
+
+		if (*p < 0x80) {
+			id = *p;
+			return 1;
+		}
+		/* most keys are CJK, three bytes a character */
+		if ((*p & 0xf0) == 0xe0 && n >= 3 && (p[1] & 0xc0) == 0x80 && (p[2] & 0xc0) == 0x80
+				&& (*p != 0xe0 || p[1] >= 0xa0)) {
+			ch = ((*p & 0x0f) << 12) | ((p[1] & 0x3f) << 6) | (p[2] & 0x3f);
+			len = 3;
+		} else {
+			len = _decode(p, n, more, ch);
+		}
+		page = _page[ch >> 8];
+		id = (page)?_id[(page << 8) | (ch & 0xff)]:0;
+		if (id == 0) id = -1;
+		return len;
+	}
+
+	int _base(int s)
+	{
+		assert(s > 0 && s < _header->num);
+		return _unit[s].base;
+	}
+
+	int _forward(int s, int id)
+	{
+		assert(s > 0 && s < _header->num);
+		int t = _unit[s].base + id;
+		return (id >= 0 && t > 0 && t < _header->num && _unit[t].check == s)?t:0;
+	}
+
+	int _tail_value(const unsigned char *q)
+	{
+		int val;
+
+		memcpy(&val, q, sizeof(val));
+		return val;
+	}
+
+	/* see DoubleArray::_enter() */
+	void _enter(trie_lane_t &lane)
+	{
+		int id;
+
+		if (_unit[lane.s].base < 0) {
+			lane.tail = true;
+			lane.t = -_unit[lane.s].base;
+			__builtin_prefetch(_tail + lane.t);
+			return;
+		}
+		lane.tail = false;
+		if (*lane.p) {
+			lane.len = _next(lane.p, 4, false, id);
+		} else {
+			lane.len = 0;
+			id = 0;
+		}
+		lane.t = (id >= 0)?_unit[lane.s].base + id:0;
+		if (lane.t > 0 && lane.t < _header->num)
+			__builtin_prefetch(&_unit[lane.t]);
+		else
+			lane.t = 0;
+	}
+
+	bool _step(trie_lane_t &lane, int &val)
+	{
+		const unsigned char *q;
+
+		if (lane.tail) {
+			for (q = _tail + lane.t; *q && *q == *lane.p; q++, lane.p++) ;
+			val = (*q == 0 && *lane.p == 0)?_tail_value(q + 1):0;
+			return true;
+		}
+		if (lane.t == 0 || _unit[lane.t].check != lane.s) {
+			val = 0;
+			return true;
+		}
+		if (lane.len == 0) {
+			val = _unit[lane.t].base;
+			return true;
+		}
+		lane.s = lane.t;
+		lane.p += lane.len;
+		_enter(lane);
+		return false;
+	}
+
+	/* the UTF-8 bytes of ch into buf, or the byte it stands for */
+	static size_t _encode(int ch, char *buf)
+	{
+		if (ch >= 0x110000) {
+			buf[0] = ch - 0x110000;
+			return 1;
+		} else if (ch < 0x80) {
+			buf[0] = ch;
+			return 1;
+		} else if (ch < 0x800) {
+			buf[0] = 0xc0 | (ch >> 6);
+			buf[1] = 0x80 | (ch & 0x3f);
+			return 2;
+		} else if (ch < 0x10000) {
+			buf[0] = 0xe0 | (ch >> 12);
+			buf[1] = 0x80 | ((ch >> 6) & 0x3f);
+			buf[2] = 0x80 | (ch & 0x3f);
+			return 3;
+		}
+		buf[0] = 0xf0 | (ch >> 18);
+		buf[1] = 0x80 | ((ch >> 12) & 0x3f);
+		buf[2] = 0x80 | ((ch >> 6) & 0x3f);
+		buf[3] = 0x80 | (ch & 0x3f);
+		return 4;
+	}
+
+	/* the value of the key ending at leaf s, the rest of which goes to rest */
+	int _leaf(int s, bool end, std::string *rest)
+	{
+		const unsigned char *q;
+
+		if (end) return _base(s);
+		for (q = _tail - _base(s); *q; q++)
+			if (rest) rest->push_back((char)*q);
+		return _tail_value(q + 1);
+	}
+
+	size_t _walk(int &s, int &p, const unsigned char *key, size_t len, bool more);
+	int _value(int s, int p);
+
+	void _annotate();
+	void _candidate(int t, bool end, const std::string &key, std::vector<trie_candidate_t> &candidates);
+	void _prefix(int s, int p, std::string key, const unsigned char *rest, size_t n,
+			std::vector<trie_candidate_t> &candidates);
+	void _compact();
+	void _alphabet();
+	int _split(std::vector<_key_t> &keys, size_t lo, size_t hi, size_t depth,
+			std::vector<_node_t> &nodes);
+	void _build(const std::vector<_key_t> &keys, const std::vector<_node_t> &nodes,
+			int node, size_t depth, int s);
+	int _find_base(const std::vector<int> &codes);
+	void _explore(on_explore_finish_t cb, void *arg, int s, std::string &key,
+			const std::vector<std::vector<int> > &children);
+
+private:
+	CodePointTrie(CodePointTrie &) {}
+};
+
+} //namespace bamboo
+
+#endif // CODEPOINT_TRIE_HXX
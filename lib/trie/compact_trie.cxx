@@ -0,0 +1,423 @@
+/*
+ * Copyright (c) 2008, detrox@gmail.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <organization> nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY detrox@gmail.com ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL detrox@gmail.com BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#include <climits>
+#include <algorithm>
+
+#include "compact_trie.hxx"
+
+namespace bamboo {
+
+
+CompactTrie::CompactTrie(int size)
+	:_header(NULL), _unit(NULL), _tail(NULL), _mmap(NULL), _dirty(true), _first_free(0),
+	 _annotated(false)
+{
+	pthread_mutex_init(&_best_lock, NULL);
+	_header = new _header_t;
+	memset(_header, 0, sizeof(_header_t));
+	strcpy(_header->magic, "compact_trie");
+	_header->version = version;
+	_header->min = 0xffffff;
+}
+
+CompactTrie::CompactTrie(const char *filename)
+	:_header(NULL), _unit(NULL), _tail(NULL), _mmap(NULL), _dirty(false), _first_free(0),
+	 _annotated(false)
+{
+	pthread_mutex_init(&_best_lock, NULL);
+	_mmap = new MMap(filename);
+	_header = (_header_t *)_mmap->start();
+	if (strcmp(_header->magic, "compact_trie") != 0 || _header->version != version) {
+		delete _mmap;
+		throw std::runtime_error(std::string("unsupported trie version: ") + filename);
+	}
+	_unit = (_unit_t *)_mmap->start(sizeof(_header_t));
+	_tail = (unsigned char *)_mmap->start(sizeof(_header_t) + _header->num * sizeof(_unit_t));
+}
+
+CompactTrie::~CompactTrie()
+{
+	pthread_mutex_destroy(&_best_lock);
+	if (_mmap)
+		delete _mmap;
+	else
+		delete _header;
+}
+
+void CompactTrie::insert(const char *key, int val)
+{
+	if (key == NULL) throw std::runtime_error("Empty Key");
+	if (_mmap) throw std::runtime_error("can not insert into a mapped trie");
+	_keys[key] = val;
+	_dirty = true;
+	_annotated = false;
+	_header->max = (val > _header->max)?val:_header->max;
+	_header->min = (val < _header->min)?val:_header->min;
+	_header->sum += val;
+	_header->num_insert++;
+}
+
+/*
+ * Free units for the children codes, first fit from the lowest free unit.
+ * A head crowded with units too small for anything is skipped for good,
+ * as darts does, or building large lexicons turns quadratic.
+ */
+int CompactTrie::_find_base(const std::vector<int> &codes)
+{
+	size_t p, b, i, busy;
+	_unit_t zero = {0, 0};
+
+	while (_used[_first_free]) _first_free++;
+	for (p = _first_free, busy = 0;; p++) {
+		if (p + alphabet_size >= _units.size()) {
+			_units.resize(_units.size() * 2 + alphabet_size, zero);
+			_used.resize(_units.size(), 0);
+		}
+		if (_used[p]) {
+			busy++;
+			continue;
+		}
+		if (p <= (size_t)codes[0]) continue;
+		b = p - codes[0];
+		for (i = 1; i < codes.size() && !_used[b + codes[i]]; i++) ;
+		if (i == codes.size()) break;
+	}
+	if (busy * 20 >= (p - _first_free) * 19) _first_free = p;
+	return b;
+}
+
+void CompactTrie::_build(const std::vector<_key_t> &keys, size_t lo, size_t hi,
+		size_t depth, int s)
+{
+	std::vector<int> codes;
+	std::vector<size_t> starts;
+	const std::string *key;
+	size_t i;
+	int b, t, c, val;
+
+	if (hi - lo == 1) {
+		/* a single key left: the rest of it goes to the tail */
+		key = &keys[lo]->first;
+		val = keys[lo]->second;
+		_units[s].base = -(int)_tails.size();
+		_tails.insert(_tails.end(), key->begin() + depth, key->end());
+		_tails.push_back(0);
+		_tails.insert(_tails.end(), (unsigned char *)&val, (unsigned char *)&val + sizeof(val));
+		return;
+	}
+
+	/* keys are sorted, so the ones sharing a byte at depth are adjacent */
+	for (i = lo; i < hi; i++) {
+		key = &keys[i]->first;
+		c = (depth < key->size())?(unsigned char)(*key)[depth] + 1:1;
+		if (codes.empty() || codes.back() != c) {
+			codes.push_back(c);
+			starts.push_back(i);
+		}
+	}
+	starts.push_back(hi);
+
+	b = _find_base(codes);
+	for (i = 0; i < codes.size(); i++) {
+		_units[b + codes[i]].check = s;
+		_used[b + codes[i]] = 1;
+	}
+	_units[s].base = b;
+	for (i = 0; i < codes.size(); i++) {
+		t = b + codes[i];
+		if (codes[i] == 1)
+			_units[t].base = keys[starts[i]]->second;
+		else
+			_build(keys, starts[i], starts[i + 1], depth + 1, t);
+	}
+}
+
+void CompactTrie::_compact()
+{
+	std::vector<_key_t> keys;
+	_key_t it;
+	_unit_t zero = {0, 0};
+	size_t n;
+
+	for (it = _keys.begin(); it != _keys.end(); it++)
+		keys.push_back(it);
+
+	/* unit 0 is never a child, unit 1 is the root; tail offset 0 is unused
+	 * so that every tail node has a negative base */
+	_units.assign(2 + alphabet_size, zero);
+	_used.assign(_units.size(), 0);
+	_used[0] = _used[1] = 1;
+	_first_free = 2;
+	_tails.assign(1, 0);
+	if (!keys.empty()) _build(keys, 0, keys.size(), 0, 1);
+
+	for (n = _units.size(); n > 2 && !_used[n - 1]; n--) ;
+	_units.resize(n);
+	std::vector<char>().swap(_used);
+
+	_header->num = _units.size();
+	_header->tail = _tails.size();
+	_unit = &_units[0];
+	_tail = &_tails[0];
+	_dirty = false;
+}
+
+int CompactTrie::search(const char *key)
+{
+	const unsigned char *p, *q;
+	int s, t;
+
+	if (_dirty) _compact();
+	for (s = 1, p = (const unsigned char *)key;; p++) {
+		if (_base(s) < 0) {
+			for (q = _tail - _base(s); *q && *q == *p; q++, p++) ;
+			return (*q == 0 && *p == 0)?_tail_value(q + 1):0;
+		}
+		t = _forward(s, *p);
+		if (t == 0) return 0;
+		if (*p == 0) return _base(t);
+		s = t;
+	}
+}
+
+/* see DoubleArray::common_prefix_search() */
+size_t CompactTrie::common_prefix_search(const char *key, size_t len,
+		trie_match_t *matches, size_t size)
+{
+	const unsigned char *q;
+	size_t i, n;
+	int s, t;
+
+	if (_dirty) _compact();
+	for (s = 1, i = 0, n = 0; n < size; i++) {
+		if (_base(s) < 0) {
+			for (q = _tail - _base(s); *q && i < len && *q == (unsigned char)key[i]; q++, i++) ;
+			if (*q == 0) {
+				matches[n].length = i;
+				matches[n++].value = _tail_value(q + 1);
+			}
+			break;
+		}
+		if (i > 0 && (t = _forward(s, 0)) != 0) {
+			matches[n].length = i;
+			matches[n++].value = _base(t);
+		}
+		if (i >= len || key[i] == '\0') break;
+		t = _forward(s, (unsigned char)key[i]);
+		if (t == 0) break;
+		s = t;
+	}
+	return n;
+}
+
+bool CompactTrie::Cursor::advance(const char *key, size_t len)
+{
+	size_t i;
+
+	for (i = 0; i < len && _s; i++) {
+		if (key[i] == '\0') {
+			_s = 0;
+		} else if (_p || _trie->_base(_s) < 0) {
+			if (_p == 0) _p = -_trie->_base(_s);
+			if (_trie->_tail[_p] == (unsigned char)key[i]) _p++;
+			else _s = 0;
+		} else {
+			_s = _trie->_forward(_s, (unsigned char)key[i]);
+		}
+	}
+	return _s != 0;
+}
+
+int CompactTrie::Cursor::value()
+{
+	int t;
+
+	if (_s == 0) return 0;
+	if (_p || _trie->_base(_s) < 0) {
+		t = (_p)?_p:-_trie->_base(_s);
+		return (_trie->_tail[t] == 0)?_trie->_tail_value(_trie->_tail + t + 1):0;
+	}
+	t = _trie->_forward(_s, 0);
+	return (t)?_trie->_base(t):0;
+}
+
+void CompactTrie::_annotate()
+{
+	std::vector<int> first, children, order;
+	int n, s, t, c;
+	size_t i;
+
+	if (_annotated) return;
+	pthread_mutex_lock(&_best_lock);
+	if (_annotated) {
+		pthread_mutex_unlock(&_best_lock);
+		return;
+	}
+
+	n = _header->num;
+	first.assign(n + 1, 0);
+	for (t = 2; t < n; t++)
+		if ((c = _unit[t].check) > 0 && c < n) first[c + 1]++;
+	for (s = 0; s < n; s++)
+		first[s + 1] += first[s];
+	children.resize(first[n]);
+	order.assign(first.begin(), first.end() - 1);
+	for (t = 2; t < n; t++)
+		if ((c = _unit[t].check) > 0 && c < n) children[order[c]++] = t;
+
+	order.assign(1, 1);
+	for (i = 0; i < order.size(); i++)
+		for (c = first[order[i]]; c < first[order[i] + 1]; c++)
+			order.push_back(children[c]);
+
+	_best.assign(n, INT_MIN);
+	for (i = order.size(); i-- > 1;) {
+		t = order[i];
+		c = _unit[t].check;
+		if (t == _base(c) + 1 || _base(t) < 0)
+			_best[t] = _leaf(t, t == _base(c) + 1, NULL);
+		if (_best[t] > _best[c]) _best[c] = _best[t];
+	}
+
+	__sync_synchronize();
+	_annotated = true;
+	pthread_mutex_unlock(&_best_lock);
+}
+
+/* see DoubleArray::_predict() */
+size_t CompactTrie::predictive_search(const char *prefix, size_t limit,
+		on_explore_finish_t cb, void *arg)
+{
+	std::vector<trie_candidate_t> candidates;
+	std::vector<size_t> heap;
+	TrieCandidateOrder order(candidates);
+	trie_candidate_t next;
+	const unsigned char *p, *q;
+	std::string rest;
+	int s, t, ch;
+	size_t n;
+
+	if (_dirty) _compact();
+	if (limit == 0) return 0;
+	for (s = 1, p = (const unsigned char *)prefix; *p; p++) {
+		if (_base(s) < 0) {
+			/* the prefix ends inside the tail of the only key below s */
+			for (q = _tail - _base(s); *p && *q == *p; q++, p++) ;
+			if (*p) return 0;
+			rest.assign(prefix).append((const char *)q);
+			cb(rest.c_str(), _tail_value(q + strlen((const char *)q) + 1), arg);
+			return 1;
+		}
+		if ((s = _forward(s, *p)) == 0) return 0;
+	}
+
+	_annotate();
+	next.bound = _best[s];
+	next.s = s;
+	next.end = false;
+	next.key = prefix;
+	candidates.push_back(next);
+	heap.push_back(0);
+
+	for (n = 0; n < limit && !heap.empty();) {
+		std::pop_heap(heap.begin(), heap.end(), order);
+		next = candidates[heap.back()];
+		heap.pop_back();
+		if (next.end || _base(next.s) < 0) {
+			rest.clear();
+			next.bound = _leaf(next.s, next.end, &rest);
+			next.key += rest;
+			cb(next.key.c_str(), next.bound, arg);
+			n++;
+			continue;
+		}
+		for (ch = 0; ch < alphabet_size - 1; ch++) {
+			if ((t = _forward(next.s, ch)) == 0) continue;
+			candidates.push_back(next);
+			candidates.back().s = t;
+			candidates.back().bound = _best[t];
+			candidates.back().end = (ch == 0);
+			if (ch) candidates.back().key.push_back((char)ch);
+			heap.push_back(candidates.size() - 1);
+			std::push_heap(heap.begin(), heap.end(), order);
+		}
+	}
+	return n;
+}
+
+void CompactTrie::_explore(on_explore_finish_t cb, void *arg, int s, std::string &key)
+{
+	const unsigned char *q;
+	size_t n = key.size();
+	int ch, t;
+
+	if (_base(s) < 0) {
+		q = _tail - _base(s);
+		key.append((const char *)q);
+		cb(key.c_str(), _tail_value(q + strlen((const char *)q) + 1), arg);
+		key.resize(n);
+		return;
+	}
+	for (ch = 0; ch < alphabet_size - 1; ch++) {
+		if ((t = _forward(s, ch)) == 0) continue;
+		if (ch == 0) {
+			cb(key.c_str(), _base(t), arg);
+		} else {
+			key.push_back((char)ch);
+			_explore(cb, arg, t, key);
+			key.resize(n);
+		}
+	}
+}
+
+void CompactTrie::explore(on_explore_finish_t cb, void *arg)
+{
+	std::string key;
+
+	if (_dirty) _compact();
+	_explore(cb, arg, 1, key);
+}
+
+void CompactTrie::save(const char *filename)
+{
+	FILE *fp;
+
+	assert(filename);
+	if (_dirty) _compact();
+	fp = fopen(filename, "w+");
+	if (fp == NULL)
+		throw std::runtime_error("Can not write to file");
+	fwrite(_header, sizeof(_header_t), 1, fp);
+	fwrite(_unit, _header->num * sizeof(_unit_t), 1, fp);
+	fwrite(_tail, _header->tail, 1, fp);
+	fclose(fp);
+}
+
+
+} //namespace bamboo
@@ -0,0 +1,243 @@
+/*
+ * Copyright (c) 2008, detrox@gmail.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <organization> nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY detrox@gmail.com ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL detrox@gmail.com BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#ifndef COMPACT_TRIE_HXX
+#define COMPACT_TRIE_HXX
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "double_array.hxx"
+
+namespace bamboo {
+
+
+/*
+ * Version 2 of the trie file format: a read-only double array rebuilt from
+ * the sorted keys, so that no relocation holes are left, with the suffix
+ * of a key below a single-key node packed a byte per character.
+ *
+ *   header   magic "compact_trie", version, sizes and value statistics
+ *   units    {base, check} per state; children of s at base(s) + ch + 1
+ *   tail     suffix bytes, '\0', then the value as 4 unaligned bytes
+ *
+ * A unit reached by '\0' holds the value of its key in base; any other
+ * unit with a negative base stands for a single key, whose suffix starts
+ * at tail[-base]. Values stay next to their key rather than in an array
+ * of their own, so a hit costs no extra cache miss.
+ *
+ * In memory, insert() only collects the keys; the array is built from
+ * them on the next lookup or save().
+ */
+class CompactTrie {
+	template<class T, class V> friend void trie_search_batch(T *, const char **, size_t, V *);
+public:
+	static const int alphabet_size = 257;
+	static const int magic_size = 32;
+	static const int version = 2;
+
+	CompactTrie(int size=0);
+	CompactTrie(const char *filename);
+	~CompactTrie();
+
+	void explore(on_explore_finish_t cb, void *arg);
+
+	int max_value()
+	{
+		return _header->max;
+	}
+
+	int min_value()
+	{
+		return _header->min;
+	}
+
+	int sum_value()
+	{
+		return _header->sum;
+	}
+
+	int num_insert()
+	{
+		return _header->num_insert;
+	}
+
+	void insert(const char *key, int val);
+	int search(const char *key);
+	/* see DoubleArray::search_batch() */
+	void search_batch(const char **keys, size_t n, int *values)
+	{
+		if (_dirty) _compact();
+		trie_search_batch(this, keys, n, values);
+	}
+	size_t common_prefix_search(const char *key, size_t len, trie_match_t *matches, size_t size);
+	/* see DoubleArray::predictive_search() */
+	size_t predictive_search(const char *prefix, size_t limit, on_explore_finish_t cb, void *arg);
+	void save(const char *filename);
+
+	/* see DoubleArray::Cursor */
+	class Cursor {
+	private:
+		CompactTrie *_trie;
+		int _s, _p;	/* state, and offset in _tail once past a tail node */
+	public:
+		Cursor(CompactTrie *trie):_trie(trie), _s(1), _p(0)
+		{
+			if (_trie->_dirty) _trie->_compact();
+		}
+		void reset() {_s = 1; _p = 0;}
+		bool dead() {return _s == 0;}
+		bool advance(const char *key, size_t len);
+		int value();
+	};
+
+protected:
+	#pragma pack(push, 4)
+	typedef struct {
+		char magic[magic_size];
+		int version;
+		int num;		/* units */
+		int tail;		/* bytes of tail */
+		int max, min;
+		long long sum;
+		int num_insert;
+	} _header_t;
+
+	typedef struct {
+		int base;
+		int check;
+	} _unit_t;
+	#pragma pack(pop)
+
+	typedef std::map<std::string, int>::const_iterator _key_t;
+
+	_header_t *_header;
+	_unit_t *_unit;
+	unsigned char *_tail;
+	MMap *_mmap;
+
+	/* in memory only: the keys, and the array built from them */
+	std::map<std::string, int> _keys;
+	bool _dirty;
+	std::vector<_unit_t> _units;
+	std::vector<unsigned char> _tails;
+	std::vector<char> _used;
+	size_t _first_free;
+
+	/* the highest value below each unit, see DoubleArray::_annotate() */
+	std::vector<int> _best;
+	volatile bool _annotated;
+	pthread_mutex_t _best_lock;
+
+	int _base(int s)
+	{
+		assert(s > 0 && s < _header->num);
+		return _unit[s].base;
+	}
+
+	int _forward(int s, int ch)
+	{
+		assert(s > 0 && s < _header->num);
+		int t = _unit[s].base + ch + 1;
+		return (t > 0 && t < _header->num && _unit[t].check == s)?t:0;
+	}
+
+	int _tail_value(const unsigned char *q)
+	{
+		int val;
+
+		memcpy(&val, q, sizeof(val));
+		return val;
+	}
+
+	/* see DoubleArray::_enter() */
+	void _enter(trie_lane_t &lane)
+	{
+		if (_unit[lane.s].base < 0) {
+			lane.tail = true;
+			lane.t = -_unit[lane.s].base;
+			__builtin_prefetch(_tail + lane.t);
+			return;
+		}
+		lane.tail = false;
+		lane.len = (*lane.p)?1:0;
+		lane.t = _unit[lane.s].base + *lane.p + 1;
+		if (lane.t > 0 && lane.t < _header->num)
+			__builtin_prefetch(&_unit[lane.t]);
+		else
+			lane.t = 0;
+	}
+
+	bool _step(trie_lane_t &lane, int &val)
+	{
+		const unsigned char *q;
+
+		if (lane.tail) {
+			for (q = _tail + lane.t; *q && *q == *lane.p; q++, lane.p++) ;
+			val = (*q == 0 && *lane.p == 0)?_tail_value(q + 1):0;
+			return true;
+		}
+		if (lane.t == 0 || _unit[lane.t].check != lane.s) {
+			val = 0;
+			return true;
+		}
+		if (lane.len == 0) {
+			val = _unit[lane.t].base;
+			return true;
+		}
+		lane.s = lane.t;
+		lane.p += lane.len;
+		_enter(lane);
+		return false;
+	}
+
+	/* the value of the key ending at leaf s, the rest of which goes to rest */
+	int _leaf(int s, bool end, std::string *rest)
+	{
+		const unsigned char *q;
+
+		if (end) return _base(s);
+		for (q = _tail - _base(s); *q; q++)
+			if (rest) rest->push_back((char)*q);
+		return _tail_value(q + 1);
+	}
+
+	void _annotate();
+	void _compact();
+	void _build(const std::vector<_key_t> &keys, size_t lo, size_t hi, size_t depth, int s);
+	int _find_base(const std::vector<int> &codes);
+	void _explore(on_explore_finish_t cb, void *arg, int s, std::string &key);
+
+private:
+	CompactTrie(CompactTrie &) {}
+};
+
+} //namespace bamboo
+
+#endif // COMPACT_TRIE_HXX
@@ -31,7 +31,8 @@
 namespace bamboo {
 
 
-void DATrie::_insert_tail(int s, const char *key, int val)
+template<class I>
+void BasicDATrie<I>::_insert_tail(I s, const char *key, I val)
 {
 	const char *p;
 
@@ -48,9 +49,11 @@ void DATrie::_insert_tail(int s, const char *key, int val)
 	_update_header(val);
 }
 
-void DATrie::_branch(int s, const char *suffix, int val)
+template<class I>
+void BasicDATrie<I>::_branch(I s, const char *suffix, I val)
 {
-	int i, j, t, *key, start, base, max, min;
+	int i, j, *key, max, min;
+	I t, start, base;
 
 	assert(suffix); assert(s > 0 && s < _header->num);
 	assert(_base(s) < 0);
@@ -92,9 +95,11 @@ void DATrie::_branch(int s, const char *suffix, int val)
 	}
 }
 
-void DATrie::insert(const char *key, int val)
+template<class I>
+void BasicDATrie<I>::insert(const char *key, I val)
 {
-	int i, s, t;
+	int i;
+	I s, t;
 	const char *p;
 
 	for (p = key, i = 0, s = 1;; p++, i++) {
@@ -119,9 +124,10 @@ void DATrie::insert(const char *key, int val)
 	_set_base(s, val);
 }
 
-int DATrie::search(const char *key)
+template<class I>
+I BasicDATrie<I>::search(const char *key)
 {
-	int s, t, *q;
+	I s, t, *q;
 	const char *p;
 
 	for (s = 1, p = key;; p++) {
@@ -141,7 +147,95 @@ int DATrie::search(const char *key)
 	return (t < 0)?*(_tail - t):_base(s);
 }
 
-void DATrie::save(const char *filename)
+template<class I>
+size_t BasicDATrie<I>::common_prefix_search(const char *key, size_t len,
+		trie_match_t *matches, size_t size)
+{
+	size_t i, n;
+	I s, t, *q;
+
+	for (s = 1, i = 0, n = 0; n < size; i++) {
+		if (_base(s) < 0) {
+			/* a single key below s, the rest of it in the tail */
+			for (q = _tail - _base(s); *q && i < len && *q == (unsigned char)key[i]; q++, i++) ;
+			if (*q == 0) {
+				matches[n].length = i;
+				matches[n++].value = *(q + 1);
+			}
+			break;
+		}
+		if (i > 0 && (t = _forward(s, 0)) != 0) {
+			matches[n].length = i;
+			matches[n++].value = (_base(t) < 0)?*(_tail - _base(t)):_base(t);
+		}
+		if (i >= len || key[i] == '\0') break;
+		t = _forward(s, (unsigned char)key[i]);
+		if (t == 0) break;
+		s = t;
+	}
+	return n;
+}
+
+/* see DoubleArray::predictive_search(); the prefix may end inside a tail */
+template<class I>
+size_t BasicDATrie<I>::predictive_search(const char *prefix, size_t limit,
+		on_explore_finish_t cb, void *arg)
+{
+	const char *p;
+	std::string key;
+	I s, *q;
+
+	for (p = prefix, s = 1; *p; p++) {
+		if (_base(s) < 0) {
+			for (q = _tail - _base(s); *p && *q == (unsigned char)*p; q++, p++) ;
+			if (*p || limit == 0) return 0;
+			for (key = prefix; *q; q++)
+				key.push_back((char)*q);
+			cb(key.c_str(), *(q + 1), arg);
+			return 1;
+		}
+		if ((s = _forward(s, (unsigned char)*p)) == 0) return 0;
+	}
+	return _predict(s, prefix, limit, cb, arg);
+}
+
+template<class I>
+bool BasicDATrie<I>::Cursor::advance(const char *key, size_t len)
+{
+	size_t i;
+
+	for (i = 0; i < len && _s; i++) {
+		if (key[i] == '\0') {
+			_s = 0;
+		} else if (_p || _trie->_base(_s) < 0) {
+			/* the rest of the only key below _s is in the tail */
+			if (_p == 0) _p = -_trie->_base(_s);
+			if (_trie->_tail[_p] == (unsigned char)key[i]) _p++;
+			else _s = 0;
+		} else {
+			_s = _trie->_forward(_s, (unsigned char)key[i]);
+		}
+	}
+	return _s != 0;
+}
+
+template<class I>
+I BasicDATrie<I>::Cursor::value()
+{
+	I t;
+
+	if (_s == 0) return 0;
+	if (_p || _trie->_base(_s) < 0) {
+		t = (_p)?_p:-_trie->_base(_s);
+		return (_trie->_tail[t] == 0)?_trie->_tail[t + 1]:0;
+	}
+	t = _trie->_forward(_s, 0);
+	if (t == 0) return 0;
+	return (_trie->_base(t) < 0)?*(_trie->_tail - _trie->_base(t)):_trie->_base(t);
+}
+
+template<class I>
+void BasicDATrie<I>::save(const char *filename)
 {
 	FILE *fp = NULL;
 
@@ -155,10 +249,12 @@ void DATrie::save(const char *filename)
 	fwrite(_state, _header->num * sizeof(_state_t), 1, fp);
 
 	fwrite(_extra, sizeof(_extra_t), 1, fp);
-	fwrite(_tail, _extra->num * sizeof(int), 1, fp);
+	fwrite(_tail, _extra->num * sizeof(I), 1, fp);
 	fclose(fp);
 }
 
+template class BasicDATrie<int32_t>;
+template class BasicDATrie<int64_t>;
 
 } //namespace bamboo
 
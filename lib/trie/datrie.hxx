@@ -34,16 +34,41 @@
 namespace bamboo {
 
 
-class DATrie: public DoubleArray {
+template<class I> class BasicDATrieBuilder;
+
+/* a double array keeping the rest of a key alone below a state in a tail;
+ * see BasicDoubleArray for I */
+template<class I>
+class BasicDATrie: public BasicDoubleArray<I> {
 	friend class TrieDebugger;
+	friend class ACAutomaton;
+	template<class J> friend class BasicDATrieBuilder;
+	template<class T, class V> friend void trie_search_batch(T *, const char **, size_t, V *);
 private:
-	DATrie(DATrie &trie) {}
+	BasicDATrie(BasicDATrie &trie) {}
 
 protected:
+	typedef BasicDoubleArray<I> _array_t;
+	typedef typename _array_t::_header_t _header_t;
+	typedef typename _array_t::_state_t _state_t;
+	using _array_t::_header;
+	using _array_t::_state;
+	using _array_t::_mmap;
+	using _array_t::_explore_buff;
+	using _array_t::_default_num_state;
+	using _array_t::_base;
+	using _array_t::_check;
+	using _array_t::_set_base;
+	using _array_t::_forward;
+	using _array_t::_find_base;
+	using _array_t::_create_transition;
+	using _array_t::_update_header;
+	using _array_t::_predict;
+
 	#pragma pack(push, 4)
 	typedef struct {
-		int num;
-		int last;
+		I num;
+		I last;
 	} _extra_t;
 
 	typedef struct {
@@ -53,24 +78,25 @@ protected:
 	#pragma pack(pop)
 
 	_extra_t *_extra;
-	int *_tail;
+	I *_tail;
 	_suffix_t _suffix;
 
 	void _inflate_tail(int num)
 	{
-		int neo;
+		long long neo;
 
 		assert(num > 0);
-		neo = (((_extra->num + num) >> 12) + 1) << 12; // align for 32 bits
-		_tail = (int *)realloc(_tail, neo * sizeof(int));
-		memset(_tail + _extra->num, 0, (neo - _extra->num) * sizeof(int));
+		neo = ((((long long)_extra->num + num) >> 12) + 1) << 12; // align for 32 bits
+		trie_check_size<I>(neo);
+		_tail = (I *)realloc(_tail, neo * sizeof(I));
+		memset(_tail + _extra->num, 0, (neo - _extra->num) * sizeof(I));
 		if (_tail == NULL) throw std::bad_alloc();
 		_extra->num = neo;
 	}
 
-	virtual void _explore_finish(on_explore_finish_t cb, void *arg, int s, int off) 
+	virtual void _explore_finish(on_explore_finish_t cb, void *arg, I s, int off) 
 	{
-		int p, val;
+		I p, val;
 
 		if (_explore_buff[off - 1] == '\0') {
 			if (_base(s) < 0) {
@@ -87,12 +113,59 @@ protected:
 		cb(_explore_buff, val, arg);
 	}
 
-	void _insert_tail(int s, const char *key, int val);
-	void _branch(int s, const char *key, int val);
+	virtual I _leaf(I s, bool end, std::string *rest)
+	{
+		I p;
+
+		if (end)
+			return (_base(s) < 0)?*(_tail - _base(s)):_base(s);
+		for (p = -_base(s); _tail[p]; p++)
+			if (rest) rest->push_back((char)_tail[p]);
+		return _tail[p + 1];
+	}
+
+	/* DoubleArray::_enter(), going into the tail at a leaf */
+	void _enter(trie_lane_t &lane)
+	{
+		if (_base(lane.s) < 0) {
+			lane.tail = true;
+			lane.t = -_base(lane.s);
+			__builtin_prefetch(_tail + lane.t);
+			return;
+		}
+		_array_t::_enter(lane);
+	}
+
+	template<class V>
+	bool _step(trie_lane_t &lane, V &val)
+	{
+		I *q;
+
+		if (lane.tail) {
+			for (q = _tail + lane.t; *q == *lane.p && *q; q++, lane.p++) ;
+			val = (*q == *lane.p)?*(q + 1):0;
+			return true;
+		}
+		if (lane.t == 0 || _check(lane.t) != lane.s) {
+			val = 0;
+			return true;
+		}
+		if (lane.len == 0) {
+			val = (_base(lane.t) < 0)?*(_tail - _base(lane.t)):_base(lane.t);
+			return true;
+		}
+		lane.s = lane.t;
+		lane.p++;
+		_enter(lane);
+		return false;
+	}
+
+	void _insert_tail(I s, const char *key, I val);
+	void _branch(I s, const char *key, I val);
 
 public:
-	DATrie(int size=_default_num_state)
-		: DoubleArray(size), _extra(NULL), _tail(NULL)
+	BasicDATrie(int size=_array_t::_default_num_state)
+		: _array_t(size), _extra(NULL), _tail(NULL)
 	{
 		_extra = new _extra_t;
 		_extra->num = 0;
@@ -100,20 +173,20 @@ public:
 		_suffix.s = NULL;
 		_suffix.length = 0;
 		_inflate_tail(size);
-		strcpy(_header->magic, "datrie");
+		strcpy(_header->magic, (sizeof(I) > 4)?"datrie64":"datrie");
 	}
 
-	DATrie(const char *filename)
-		: DoubleArray(filename)
+	BasicDATrie(const char *filename)
+		: _array_t(filename)
 	{
-		int start = sizeof(_header_t) + _header->num * sizeof(_state_t);
+		size_t start = sizeof(_header_t) + _header->num * sizeof(_state_t);
 		_extra = (_extra_t *)_mmap->start(start);
-		_tail = (int *)_mmap->start(start + sizeof(_extra_t));
+		_tail = (I *)_mmap->start(start + sizeof(_extra_t));
 		_suffix.s = NULL;
 		_suffix.length = 0;
 	}
 
-	~DATrie()
+	~BasicDATrie()
 	{
 		if (!_mmap) {
 			delete _extra;
@@ -122,11 +195,34 @@ public:
 			_suffix.s = 0;
 		}
 	}
-	void insert(const char *key, int val);
-	int search(const char *key);
+	void insert(const char *key, I val);
+	I search(const char *key);
+	template<class V>
+	void search_batch(const char **keys, size_t n, V *values)
+	{
+		trie_search_batch(this, keys, n, values);
+	}
+	size_t common_prefix_search(const char *key, size_t len, trie_match_t *matches, size_t size);
+	size_t predictive_search(const char *prefix, size_t limit, on_explore_finish_t cb, void *arg);
 	void save(const char *filename);
+
+	/* DoubleArray::Cursor, which may also stand inside a tail */
+	class Cursor {
+	private:
+		BasicDATrie *_trie;
+		I _s, _p;	/* state, and offset in _tail once past a tail node */
+	public:
+		Cursor(BasicDATrie *trie):_trie(trie), _s(1), _p(0) {};
+		void reset() {_s = 1; _p = 0;}
+		bool dead() {return _s == 0;}
+		bool advance(const char *key, size_t len);
+		I value();
+	};
 };
 
+typedef BasicDATrie<int32_t> DATrie;
+typedef BasicDATrie<int64_t> DATrie64;
+
 } //namespace bamboo
 
 #endif // DATRIE_HPP
@@ -0,0 +1,270 @@
+/*
+ * Copyright (c) 2008, detrox@gmail.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <organization> nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY detrox@gmail.com ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL detrox@gmail.com BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#include <cstring>
+#include <stdexcept>
+
+#include "datrie_builder.hxx"
+
+namespace bamboo {
+
+
+template<class I>
+BasicDATrieBuilder<I>::BasicDATrieBuilder(BasicDATrie<I> *trie)
+	:_trie(trie), _head(-1), _last(-1), _value(0)
+{
+}
+
+template<class I>
+void BasicDATrieBuilder<I>::build(KeySorter &keys)
+{
+	if (_trie->_mmap) throw std::runtime_error("can not build into a mapped trie");
+
+	/* unit 0 is never a child, unit 1 is the root; tail offset 0 is unused */
+	_base.assign(2, 0);
+	_check.assign(2, 0);
+	_cell.assign(2, 1);
+	_next.assign(2, -1);
+	_prev.assign(2, -1);
+	_fails.assign(2, 0);
+	_head = _last = -1;
+	_tail.assign(1, 0);
+	_key.clear();
+	_count.assign(1, 0);
+	_children.assign(1, std::vector<_node_t>());
+
+	_trie->_header->max = 0;
+	_trie->_header->min = 0xffffff;
+	_trie->_header->sum = 0;
+	_trie->_header->num_insert = 0;
+	keys.merge(_on_key, this);
+	_finish();
+}
+
+template<class I>
+void BasicDATrieBuilder<I>::_on_key(const char *key, int val, void *arg)
+{
+	((BasicDATrieBuilder *)arg)->_add(key, val);
+}
+
+template<class I>
+void BasicDATrieBuilder<I>::_add(const char *key, int val)
+{
+	size_t len, lcp, d;
+	_node_t leaf;
+
+	len = strlen(key);
+	for (lcp = 0; lcp < len && lcp < _key.size() && key[lcp] == _key[lcp]; lcp++) ;
+	if (_count[0] > 0 && (lcp == len || (lcp < _key.size()
+			&& (unsigned char)key[lcp] < (unsigned char)_key[lcp])))
+		throw std::runtime_error("keys are not sorted");
+
+	/* the nodes of the last key below the common prefix are complete */
+	for (d = _key.size(); d > lcp; d--)
+		_close(d);
+	if (_count.size() < len + 1) {
+		_count.resize(len + 1);
+		_children.resize(len + 1);
+	}
+	for (d = lcp + 1; d <= len; d++) {
+		_count[d] = 0;
+		_children[d].clear();
+	}
+	for (d = 0; d <= len; d++)
+		_count[d]++;
+
+	leaf.code = 1;
+	leaf.count = 1;
+	leaf.base = 0;
+	leaf.value = val;
+	_children[len].push_back(leaf);
+	_key.assign(key, len);
+	_value = val;
+	_trie->_update_header(val);
+}
+
+template<class I>
+void BasicDATrieBuilder<I>::_close(size_t depth)
+{
+	_children[depth - 1].push_back(_node_t());
+	_node_t &node = _children[depth - 1].back();
+
+	node.code = (unsigned char)_key[depth - 1] + 1;
+	node.count = _count[depth];
+	node.base = 0;
+	node.value = 0;
+	if (node.count == 1) {
+		/* the last key is the only one below: it goes to the tail */
+		node.suffix.assign(_key, depth, std::string::npos);
+		node.value = _value;
+	} else {
+		node.base = _place(_children[depth], node.codes);
+	}
+	_children[depth].clear();
+}
+
+/* units for the children, which are sorted by code */
+template<class I>
+I BasicDATrieBuilder<I>::_place(std::vector<_node_t> &children, std::vector<int> &codes)
+{
+	size_t i, j;
+	I b, t;
+
+	codes.clear();
+	for (i = 0; i < children.size(); i++)
+		codes.push_back(children[i].code);
+	b = _find_base(codes);
+
+	for (i = 0; i < children.size(); i++) {
+		_node_t &child = children[i];
+
+		t = b + child.code;
+		_unlink(t, 1);
+		if (child.code == 1) {
+			_base[t] = child.value;
+		} else if (child.count == 1) {
+			trie_check_size<I>(_tail.size() + child.suffix.size() + 2);
+			_base[t] = -(I)_tail.size();
+			for (j = 0; j < child.suffix.size(); j++)
+				_tail.push_back((unsigned char)child.suffix[j]);
+			_tail.push_back(0);
+			_tail.push_back(child.value);
+		} else {
+			_base[t] = child.base;
+			for (j = 0; j < child.codes.size(); j++)
+				_check[child.base + child.codes[j]] = t;
+		}
+	}
+	return b;
+}
+
+/*
+ * First fit from the free list. A unit failing to host a node too often
+ * leaves the list, or a crowded head would be scanned for every node.
+ */
+template<class I>
+I BasicDATrieBuilder<I>::_find_base(const std::vector<int> &codes)
+{
+	size_t i, n = codes.size();
+	I p, q, b;
+
+	for (p = _head;; p = q) {
+		if (p < 0) {
+			p = _cell.size();
+			_grow(_cell.size() * 2);
+		}
+		b = p - codes[0];
+		if (b + codes[n - 1] >= (I)_cell.size())
+			_grow(_cell.size() * 2 + DoubleArray::alphabet_size);
+		q = _next[p];
+		if (b >= 1) {
+			for (i = 1; i < n && _cell[b + codes[i]] != 1; i++) ;
+			if (i == n) return b;
+		}
+		if (++_fails[p] >= 16) _unlink(p, 2);
+	}
+}
+
+template<class I>
+void BasicDATrieBuilder<I>::_grow(size_t size)
+{
+	size_t i, old = _cell.size();
+
+	if (size <= old) return;
+	trie_check_size<I>(size);
+	_base.resize(size, 0);
+	_check.resize(size, 0);
+	_cell.resize(size, 0);
+	_next.resize(size, -1);
+	_prev.resize(size, -1);
+	_fails.resize(size, 0);
+	for (i = old; i < size; i++) {
+		_prev[i] = _last;
+		if (_last >= 0)
+			_next[_last] = i;
+		else
+			_head = i;
+		_last = i;
+	}
+}
+
+template<class I>
+void BasicDATrieBuilder<I>::_unlink(I p, char cell)
+{
+	if (_cell[p] == 0) {
+		if (_prev[p] >= 0) _next[_prev[p]] = _next[p]; else _head = _next[p];
+		if (_next[p] >= 0) _prev[_next[p]] = _prev[p]; else _last = _prev[p];
+	}
+	_cell[p] = cell;
+}
+
+template<class I>
+void BasicDATrieBuilder<I>::_finish()
+{
+	std::vector<int> codes;
+	size_t d, num, neo;
+	I b;
+
+	if (_count[0] > 0) {
+		for (d = _key.size(); d > 0; d--)
+			_close(d);
+		b = _place(_children[0], codes);
+		_base[1] = b;
+		for (d = 0; d < codes.size(); d++)
+			_check[b + codes[d]] = 1;
+	}
+	for (num = _cell.size(); num > 2 && _cell[num - 1] != 1; num--) ;
+
+	/* in steps of 4096, as DoubleArray::_inflate() grows it */
+	neo = ((num >> 12) + 1) << 12;
+	trie_check_size<I>(neo);
+	_trie->_state = (typename BasicDATrie<I>::_state_t *)realloc(_trie->_state,
+			neo * sizeof(typename BasicDATrie<I>::_state_t));
+	if (_trie->_state == NULL) throw std::bad_alloc();
+	memset(_trie->_state, 0, neo * sizeof(typename BasicDATrie<I>::_state_t));
+	for (d = 0; d < num; d++) {
+		_trie->_state[d].base = _base[d];
+		_trie->_state[d].check = _check[d];
+	}
+	_trie->_header->num = neo;
+	_trie->_last = 1;
+
+	neo = ((_tail.size() >> 12) + 1) << 12;
+	trie_check_size<I>(neo);
+	_trie->_tail = (I *)realloc(_trie->_tail, neo * sizeof(I));
+	if (_trie->_tail == NULL) throw std::bad_alloc();
+	memset(_trie->_tail, 0, neo * sizeof(I));
+	memcpy(_trie->_tail, &_tail[0], _tail.size() * sizeof(I));
+	_trie->_extra->num = neo;
+	_trie->_extra->last = _tail.size();
+}
+
+template class BasicDATrieBuilder<int32_t>;
+template class BasicDATrieBuilder<int64_t>;
+
+} //namespace bamboo
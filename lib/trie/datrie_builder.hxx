@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2008, detrox@gmail.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <organization> nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY detrox@gmail.com ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL detrox@gmail.com BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#ifndef DATRIE_BUILDER_HXX
+#define DATRIE_BUILDER_HXX
+
+#include <string>
+#include <vector>
+
+#include "datrie.hxx"
+#include "key_sorter.hxx"
+
+namespace bamboo {
+
+
+/*
+ * Builds a DATrie from sorted keys in one left to right pass, instead of
+ * inserting them one by one. A node is placed once the keys leave it, when
+ * all of its children are known: their base is taken first fit from a
+ * free list and never relocated. The result is the same file format as
+ * DATrie::insert() gives, with a single key below a node kept in the tail;
+ * DATrieBuilder64 fills a DATrie64.
+ *
+ *   KeySorter keys;
+ *   keys.add("foo", 1); ...
+ *   DATrieBuilder(&trie).build(keys);
+ *   trie.save("foo.idx");
+ */
+template<class I>
+class BasicDATrieBuilder {
+public:
+	BasicDATrieBuilder(BasicDATrie<I> *trie);
+	/* replaces the content of the trie, which must not be mapped */
+	void build(KeySorter &keys);
+
+protected:
+	/* a node whose children are placed, waiting for a place of its own */
+	typedef struct {
+		int code;
+		int count;			/* keys below */
+		I base;				/* count > 1 */
+		std::vector<int> codes;		/* count > 1, to set their check */
+		std::string suffix;		/* count == 1, the rest of the key */
+		int value;			/* count == 1 */
+	} _node_t;
+
+	BasicDATrie<I> *_trie;
+	std::vector<I> _base, _check, _tail;
+	/* units: 0 free, 1 used, 2 free but dropped from the free list */
+	std::vector<char> _cell;
+	std::vector<I> _next, _prev;
+	std::vector<unsigned char> _fails;
+	I _head, _last;
+
+	/* the path of the last key: count and placed children per depth */
+	std::string _key;
+	int _value;
+	std::vector<int> _count;
+	std::vector<std::vector<_node_t> > _children;
+
+	static void _on_key(const char *key, int val, void *arg);
+	void _add(const char *key, int val);
+	void _close(size_t depth);
+	I _place(std::vector<_node_t> &children, std::vector<int> &codes);
+	I _find_base(const std::vector<int> &codes);
+	void _grow(size_t size);
+	void _unlink(I p, char cell);
+	void _finish();
+};
+
+typedef BasicDATrieBuilder<int32_t> DATrieBuilder;
+typedef BasicDATrieBuilder<int64_t> DATrieBuilder64;
+
+} //namespace bamboo
+
+#endif // DATRIE_BUILDER_HXX
@@ -26,42 +26,55 @@
  * 
  */
 
+#include <algorithm>
+
 #include "double_array.hxx"
 
 namespace bamboo {
 
 
-DoubleArray::DoubleArray(int num)
-	:_header(NULL), _state(NULL), _mmap(NULL)
+template<class I>
+BasicDoubleArray<I>::BasicDoubleArray(int num)
+	:_header(NULL), _state(NULL), _mmap(NULL), _annotated(false)
 {
+	pthread_mutex_init(&_best_lock, NULL);
 	_header = new _header_t;
 	_header->max = 0;
 	_header->min = 0xffffff;
 	_header->sum = 0;
 	_header->num = 0;
 	_header->num_insert = 0;
-	strcpy(_header->magic, "double_array");
+	strcpy(_header->magic, (sizeof(I) > 4)?"double_array64":"double_array");
 	_inflate(num);
 	_last = 1;
 }
 
-DoubleArray::DoubleArray(const char *filename)
-	:_header(NULL), _state(NULL), _mmap(NULL)
+template<class I>
+BasicDoubleArray<I>::BasicDoubleArray(const char *filename)
+	:_header(NULL), _state(NULL), _mmap(NULL), _annotated(false)
 {
+	pthread_mutex_init(&_best_lock, NULL);
 	_mmap = new MMap(filename);
 	_header = (_header_t *)_mmap->start();
 	_state = (_state_t *)_mmap->start(sizeof(_header_t));
+	if (_mmap->size() < sizeof(_header_t) || wide(_header->magic) != (sizeof(I) > 4)) {
+		delete _mmap;
+		pthread_mutex_destroy(&_best_lock);
+		throw std::runtime_error(std::string("trie of another width: ") + filename);
+	}
 }
 
-int DoubleArray::_find_base(int *key, int min, int max)
+template<class I>
+I BasicDoubleArray<I>::_find_base(int *key, int min, int max)
 {
 	bool found;
-	int i, *p;
+	int *p;
+	I i;
 
 	for (i = _last, found = false;!found;) {
 		i++;
-		if (i + _key2state(max) >= _header->num) 
-			_inflate(_key2state(max));
+		if (i + alphabet_size >= _header->num) 
+			_inflate(alphabet_size + 1);
 		if (_check(i + _key2state(min)) <= 0 &&
 			_check(i + _key2state(max)) <= 0) {
 			found = true;
@@ -79,16 +92,18 @@ int DoubleArray::_find_base(int *key, int min, int max)
 	return i;
 }
 
-int DoubleArray::_relocate(int stand, int s, int *key, int max, int min)
+template<class I>
+I BasicDoubleArray<I>::_relocate(I stand, I s, int *key, int max, int min)
 {
-	int old, neo, i, *p;
+	I old, neo;
+	int i, *p;
 	int ancestor[alphabet_size] = {0};
 
 	assert(s > 0 && s < _header->num);
 	old = _base(s);
 	neo = _find_base(key, max, min);
 	for (i = 0; key[i] > -1; i++) {
-		int t = _key2state(key[i]);
+		I t = _key2state(key[i]);
 
 		if (_check(old + t) != s) continue;
 		_set_base(neo + t, _base(old + t));
@@ -105,9 +120,11 @@ int DoubleArray::_relocate(int stand, int s, int *key, int max, int min)
 	return stand;
 }
 
-int DoubleArray::_create_transition(int s, int ch)
+template<class I>
+I BasicDoubleArray<I>::_create_transition(I s, int ch)
 {
-	int t, n, m, ns[alphabet_size] = {0}, ms[alphabet_size] = {0};
+	I t;
+	int n, m, ns[alphabet_size] = {0}, ms[alphabet_size] = {0};
 	int max[] = {0, 0}, min[] = {0, 0};
 
 	assert(s > 0 && s < _header->num);
@@ -134,10 +151,11 @@ int DoubleArray::_create_transition(int s, int ch)
 }
 
 
-void DoubleArray::insert(const char *key, int val)
+template<class I>
+void BasicDoubleArray<I>::insert(const char *key, I val)
 {
 	const char *p;
-	int s, t;
+	I s, t;
 
 	if (val < 0) throw std::runtime_error("Invalid value");
 	if (key == NULL) throw std::runtime_error("Empty Key");
@@ -157,10 +175,11 @@ void DoubleArray::insert(const char *key, int val)
 	_update_header(val);
 }
 
-int DoubleArray::search(const char *key)
+template<class I>
+I BasicDoubleArray<I>::search(const char *key)
 {
 	const char *p;
-	int s, t;
+	I s, t;
 	
 	for (p = key, s = 1;; *p++) {
 		t = _forward(s, (unsigned char)*p);
@@ -171,16 +190,41 @@ int DoubleArray::search(const char *key)
 	return s?_base(s):0;
 }
 
-void DoubleArray::_explore(on_explore_finish_t cb, void *arg, int s, int off)
+/*
+ * Every key that is a prefix of the first len bytes of key, shortest
+ * first, in one walk from the root. Stops after size matches.
+ */
+template<class I>
+size_t BasicDoubleArray<I>::common_prefix_search(const char *key, size_t len,
+		trie_match_t *matches, size_t size)
+{
+	size_t i, n;
+	I s, t;
+
+	for (s = 1, i = 0, n = 0; n < size; i++) {
+		if (i > 0 && (t = _forward(s, 0)) != 0) {
+			matches[n].length = i;
+			matches[n++].value = _base(t);
+		}
+		if (i >= len || key[i] == '\0') break;
+		t = _forward(s, (unsigned char)key[i]);
+		if (t == 0) break;
+		s = t;
+	}
+	return n;
+}
+
+template<class I>
+void BasicDoubleArray<I>::_explore(on_explore_finish_t cb, void *arg, I s, int off)
 {
 	int *p, key[alphabet_size];
-	int t;
+	I t;
 
 	assert(s > 0 && s < _header->num);
 	if (_find_accepts(s, key, NULL, NULL) > 0) {
 		for (p = key; *p > -1; p++) {
 			_explore_buff[off] = (char)*p;
-			t = _next(s, *p);
+			t = _forward(s, *p);
 			assert(t < _header->num && t > 0);
 			_explore(cb, arg, t, off + 1);
 		}
@@ -189,7 +233,137 @@ void DoubleArray::_explore(on_explore_finish_t cb, void *arg, int s, int off)
 	}
 }
 
-void DoubleArray::save(const char *filename)
+template<class I>
+bool BasicDoubleArray<I>::Cursor::advance(const char *key, size_t len)
+{
+	size_t i;
+
+	/* '\0' ends a key, it is never a transition inside one */
+	for (i = 0; i < len && _s; i++)
+		_s = (key[i] == '\0')?0:_trie->_forward(_s, (unsigned char)key[i]);
+	return _s != 0;
+}
+
+template<class I>
+I BasicDoubleArray<I>::Cursor::value()
+{
+	I t;
+
+	if (_s == 0) return 0;
+	t = _trie->_forward(_s, 0);
+	return t?_trie->_base(t):0;
+}
+
+/*
+ * Fills _best once: the states are listed parent first from their checks,
+ * then each one passes its best value up to its parent in reverse order.
+ */
+template<class I>
+void BasicDoubleArray<I>::_annotate()
+{
+	std::vector<I> first, children, order;
+	I n, s, t, c;
+	size_t i;
+
+	if (_annotated) return;
+	pthread_mutex_lock(&_best_lock);
+	if (_annotated) {
+		pthread_mutex_unlock(&_best_lock);
+		return;
+	}
+
+	n = _header->num;
+	first.assign(n + 1, 0);
+	for (t = 2; t < n; t++)
+		if ((c = _check(t)) > 0 && c < n) first[c + 1]++;
+	for (s = 0; s < n; s++)
+		first[s + 1] += first[s];
+	children.resize(first[n]);
+	order.assign(first.begin(), first.end() - 1);
+	for (t = 2; t < n; t++)
+		if ((c = _check(t)) > 0 && c < n) children[order[c]++] = t;
+
+	order.assign(1, 1);
+	for (i = 0; i < order.size(); i++)
+		for (c = first[order[i]]; c < first[order[i] + 1]; c++)
+			order.push_back(children[c]);
+
+	_best.assign(n, std::numeric_limits<I>::min());
+	for (i = order.size(); i-- > 1;) {
+		t = order[i];
+		c = _check(t);
+		if (t == _base(c) + _key2state(0) || _base(t) < 0)
+			_best[t] = _leaf(t, t == _base(c) + _key2state(0), NULL);
+		if (_best[t] > _best[c]) _best[c] = _best[t];
+	}
+
+	__sync_synchronize();
+	_annotated = true;
+	pthread_mutex_unlock(&_best_lock);
+}
+
+/* best first from s, whose key is prefix, see predictive_search() */
+template<class I>
+size_t BasicDoubleArray<I>::_predict(I s, const std::string &prefix, size_t limit,
+		on_explore_finish_t cb, void *arg)
+{
+	std::vector<trie_candidate_t> candidates;
+	std::vector<size_t> heap;
+	TrieCandidateOrder order(candidates);
+	trie_candidate_t next;
+	std::string rest;
+	int *p, key[alphabet_size];
+	size_t n;
+
+	if (limit == 0) return 0;
+	_annotate();
+	next.bound = _best[s];
+	next.s = s;
+	next.end = false;
+	next.key = prefix;
+	candidates.push_back(next);
+	heap.push_back(0);
+
+	for (n = 0; n < limit && !heap.empty();) {
+		std::pop_heap(heap.begin(), heap.end(), order);
+		next = candidates[heap.back()];
+		heap.pop_back();
+		if (next.end || _base(next.s) < 0) {
+			rest.clear();
+			next.bound = _leaf(next.s, next.end, &rest);
+			next.key += rest;
+			cb(next.key.c_str(), next.bound, arg);
+			n++;
+			continue;
+		}
+		_find_accepts(next.s, key, NULL, NULL);
+		for (p = key; *p > -1; p++) {
+			candidates.push_back(next);
+			candidates.back().s = _forward(next.s, *p);
+			candidates.back().bound = _best[candidates.back().s];
+			candidates.back().end = (*p == 0);
+			if (*p) candidates.back().key.push_back((char)*p);
+			heap.push_back(candidates.size() - 1);
+			std::push_heap(heap.begin(), heap.end(), order);
+		}
+	}
+	return n;
+}
+
+template<class I>
+size_t BasicDoubleArray<I>::predictive_search(const char *prefix, size_t limit,
+		on_explore_finish_t cb, void *arg)
+{
+	const char *p;
+	I s;
+
+	for (p = prefix, s = 1; *p && s; p++)
+		s = _forward(s, (unsigned char)*p);
+	return (s)?_predict(s, prefix, limit, cb, arg):0;
+}
+
+template<class I>
+void BasicDoubleArray<I>::save(const char *filename)
 {
 	FILE *fp;
 
@@ -202,6 +376,8 @@ void DoubleArray::save(const char *filename)
 	fclose(fp);
 }
 
+template class BasicDoubleArray<int32_t>;
+template class BasicDoubleArray<int64_t>;
 
 } //namespace bamboo
 
@@ -29,9 +29,14 @@
 #ifndef DOUBLE_ARRAY_HXX
 #define DOUBLE_ARRAY_HXX
 
+#include <pthread.h>
+#include <stdint.h>
 #include <cstdlib>
 #include <cassert>
 #include <cstring>
+#include <string>
+#include <vector>
+#include <limits>
 
 #include <exception>
 #include <stdexcept>
@@ -44,18 +49,128 @@ namespace bamboo {
 
 
 typedef void (*on_explore_finish_t)(const char*, int, void *);
-class DoubleArray {
+
+/* a key found by common_prefix_search(): its length in bytes and value */
+typedef struct {
+	size_t length;
+	int value;
+} trie_match_t;
+
+/* a state, or a key, waiting in predictive_search() */
+typedef struct {
+	int64_t bound;		/* the highest value below the state */
+	int64_t s;
+	bool end;		/* s is the end of key, reached by '\0' */
+	std::string key;
+} trie_candidate_t;
+
+/* candidates by bound, then by key for the same bound, as a max heap */
+class TrieCandidateOrder {
+private:
+	const std::vector<trie_candidate_t> &_candidates;
+public:
+	TrieCandidateOrder(const std::vector<trie_candidate_t> &candidates)
+		:_candidates(candidates) {}
+	bool operator()(size_t a, size_t b) const
+	{
+		const trie_candidate_t &x = _candidates[a], &y = _candidates[b];
+
+		return (x.bound != y.bound)?x.bound < y.bound:x.key > y.key;
+	}
+};
+
+/* a key walked by search_batch(), see trie_search_batch() */
+typedef struct {
+	const unsigned char *p;	/* the rest of the key */
+	int64_t s;		/* the state reached */
+	int64_t t;		/* the slot read next: a state, or an offset in the tail */
+	int len;		/* bytes of the key the transition to t reads, 0 at its end */
+	bool tail;		/* t is in the tail */
+	size_t i;		/* the index of the key */
+} trie_lane_t;
+
+static const size_t trie_batch_width = 8;
+
+/*
+ * search() of keys[0, n) into values, interleaving the walks of
+ * trie_batch_width keys: each step of a key prefetches the slot of its
+ * next one, which is read only after the other keys took a step, so the
+ * cache misses of the walks overlap instead of following one another.
+ * The trie gives _enter(lane), which looks up the slot following lane.s
+ * and prefetches it, and _step(lane, val), which reads the slot and
+ * tells whether the walk ended with val.
+ */
+template<class T, class V>
+void trie_search_batch(T *trie, const char **keys, size_t n, V *values)
+{
+	trie_lane_t lanes[trie_batch_width];
+	size_t i, live, next;
+	V val;
+
+	for (live = 0, next = 0; live < trie_batch_width && next < n; live++, next++) {
+		lanes[live].p = (const unsigned char *)keys[next];
+		lanes[live].s = 1;
+		lanes[live].i = next;
+		trie->_enter(lanes[live]);
+	}
+	for (i = 0; live > 0; i = (i + 1 < live)?i + 1:0) {
+		if (!trie->_step(lanes[i], val)) continue;
+		values[lanes[i].i] = val;
+		if (next < n) {
+			lanes[i].p = (const unsigned char *)keys[next];
+			lanes[i].s = 1;
+			lanes[i].i = next++;
+			trie->_enter(lanes[i]);
+		} else {
+			lanes[i] = lanes[--live];
+		}
+	}
+}
+
+/* throws when a trie of index type I needs n states or tail cells, more
+ * than it counts; see trie_needs_64() */
+template<class I>
+inline void trie_check_size(unsigned long long n)
+{
+	if (n > (unsigned long long)std::numeric_limits<I>::max())
+		throw std::runtime_error("trie too large for the 32-bit format, build it in the 64-bit one");
+}
+
+/*
+ * Whether keys of bytes in all are built in the 64-bit format. A double
+ * array takes up to a state per byte and about as many free ones, the
+ * tail a cell per byte and two per key, and the 32-bit format counts up
+ * to 2^31 of each.
+ */
+inline bool trie_needs_64(unsigned long long bytes)
+{
+	return bytes >= (1ULL << 30);
+}
+
+/*
+ * States, tail offsets and values are of type I: int32_t for the
+ * "double_array" and "datrie" files, int64_t for "double_array64" and
+ * "datrie64" ones, which only differ by the width of their fields. Values
+ * past an int are only given by search() and Cursor::value(); the
+ * callbacks and matches, shared with the other tries, take an int.
+ */
+template<class I>
+class BasicDoubleArray {
 	friend class TrieDebugger;
+	template<class T, class V> friend void trie_search_batch(T *, const char **, size_t, V *);
 
 public:	
+	typedef I value_t;
+
 	static const int alphabet_size = 257;
 	static const int endmark = 1;
 	static const int magic_size = 32;
 
-	DoubleArray(int num=_default_num_state);
-	DoubleArray(const char *filename);
-	virtual ~DoubleArray()
+	BasicDoubleArray(int num=_default_num_state);
+	BasicDoubleArray(const char *filename);
+	virtual ~BasicDoubleArray()
 	{
+		pthread_mutex_destroy(&_best_lock);
 		if (_mmap) {
 			delete _mmap;
 		} else {
@@ -69,12 +184,20 @@ public:
 		_explore(cb, arg, 1, 0);
 	}
 
-	int max_value()
+	/* whether magic, as saved, is of a 64-bit file */
+	static bool wide(const char *magic)
+	{
+		size_t n = strnlen(magic, magic_size);
+
+		return n > 2 && strncmp(magic + n - 2, "64", 2) == 0;
+	}
+
+	I max_value()
 	{
 		return _header->max;
 	}
 
-	int min_value()
+	I min_value()
 	{
 		return _header->min;
 	}
@@ -84,15 +207,49 @@ public:
 		return _header->sum;
 	}
 
-	int num_insert()
+	I num_insert()
 	{
 		return _header->num_insert;
 	}
 
-	void insert(const char *key, int val);
-	int search(const char *key);
+	void insert(const char *key, I val);
+	I search(const char *key);
+	/* search() of each of keys[0, n) into values, see trie_search_batch() */
+	template<class V>
+	void search_batch(const char **keys, size_t n, V *values)
+	{
+		trie_search_batch(this, keys, n, values);
+	}
+	size_t common_prefix_search(const char *key, size_t len, trie_match_t *matches, size_t size);
 	void save(const char *filename);
 
+	/*
+	 * The keys starting with prefix, the highest values first and in byte
+	 * order for the same value; cb gets at most limit of them. States are
+	 * visited best first by the highest value below them, annotated over
+	 * the whole trie on the first call, so only the states leading to the
+	 * keys returned and their siblings are looked at.
+	 */
+	size_t predictive_search(const char *prefix, size_t limit, on_explore_finish_t cb, void *arg);
+
+	/*
+	 * A walk from the root that can be resumed: advance() it over a key
+	 * piece by piece, and value() tells whether the bytes read so far
+	 * are a key. Once a piece leads nowhere the cursor is dead and stays
+	 * so until reset().
+	 */
+	class Cursor {
+	private:
+		BasicDoubleArray *_trie;
+		I _s;
+	public:
+		Cursor(BasicDoubleArray *trie):_trie(trie), _s(1) {};
+		void reset() {_s = 1;}
+		bool dead() {return _s == 0;}
+		bool advance(const char *key, size_t len);
+		I value();
+	};
+
 protected:
 	static const int _default_num_state = 1024;
 	static const int _explore_buff_size = 1024;
@@ -100,89 +257,96 @@ protected:
 	#pragma pack(push, 4)
 	typedef struct {
 		char magic[magic_size];
-		int num;
-		int max, min;
+		I num;
+		I max, min;
 		long long sum;
-		int num_insert;
+		I num_insert;
 	}  __attribute__((aligned(4))) _header_t;
 
 	typedef struct {
-		int base;
-		int check;
+		I base;
+		I check;
 	} _state_t;
 	#pragma pack(pop)
 
-	int _last;
+	I _last;
 
 	_header_t *_header;
 	_state_t *_state;
 	MMap *_mmap;
 	char _explore_buff[_explore_buff_size];
 
+	/* the highest value below each state, see _annotate() */
+	std::vector<I> _best;
+	volatile bool _annotated;
+	pthread_mutex_t _best_lock;
+
 	int _key2state(int ch)
 	{
 		return (unsigned int)ch + 1;
 	}
 
-	int _state2key(int s)
+	int _state2key(I s)
 	{
 		assert(s > 0);
 		return s - 1;
 	}
 
-	int _base(int s)
+	I _base(I s)
 	{
 		assert(s > 0 && s < _header->num);
 		return _state[s].base;
 	}
 
-	int _check(int s)
+	I _check(I s)
 	{
 		assert(s > 0 && s < _header->num);
 		return _state[s].check;
 	}
 
-	void _set_base(int s, int val)
+	void _set_base(I s, I val)
 	{
 		assert(s > 0 && s < _header->num);
 		_state[s].base = val;
 	}
 
-	void _set_check(int s, int val)
+	void _set_check(I s, I val)
 	{
 		assert(s > 0 && s < _header->num);
 		_state[s].check = val;
 	}
 
-	int _next(int s, int ch)
+	I _next(I s, int ch)
 	{
 		int in = _key2state(ch);
 
 		assert(s > 0 && s < _header->num); 
-		if (s + in >= _header->num) _inflate(in);
+		if (_base(s) + in >= _header->num) _inflate(_base(s) + in - _header->num + 1);
 		return _base(s) + in;
 	}
 
-	int _forward(int s, int ch)
+	I _forward(I s, int ch)
 	{
-		assert(s > 0 && s < _header->num); 
-		int t = _next(s, ch);
+		/* never inflates: lookups must stay read-only on shared tries */
+		assert(s > 0 && s < _header->num);
+		I t = _base(s) + _key2state(ch);
 		return (t > 0 && t < _header->num && _check(t) == s)?t:0;
 	}
 
 	void _inflate(int num)
 	{
-		int neo;
+		long long neo;
 
 		assert(num > 0);
-		neo = (((_header->num + num) >> 12) + 1) << 12; // align for 4096
+		neo = ((((long long)_header->num + num) >> 12) + 1) << 12; // align for 4096
+		trie_check_size<I>(neo);
 		_state = (_state_t *)realloc(_state, neo * sizeof(_state_t));
 		memset(_state + _header->num, 0, (neo - _header->num) * sizeof(_state_t));
 		if (_state == NULL) throw std::bad_alloc();
 		_header->num = neo;
 	}
 
-	int _find_accepts(int s, int *inputs, int *max, int *min)
+	int _find_accepts(I s, int *inputs, int *max, int *min)
 	{
 		int ch;
 		int *p;
@@ -200,28 +364,68 @@ protected:
 		return p - inputs;
 	}
 
-	void _update_header(int val)
+	void _update_header(I val)
 	{
+		_annotated = false;	/* a new key: _best is stale */
 		_header->max = (val > _header->max)?val:_header->max;
 		_header->min = (val < _header->min)?val:_header->min;
 		_header->sum += val;
 		_header->num_insert++;
 	}
 
-	virtual void _explore_finish(on_explore_finish_t cb, void *arg, int s, int off) 
+	virtual void _explore_finish(on_explore_finish_t cb, void *arg, I s, int off) 
 	{
 		cb(_explore_buff, _base(s), arg);
 	}
 
-	int _find_base(int *key, int max, int min);
-	int _relocate(int stand, int s, int *key, int max, int min);
-	int _create_transition(int s, int ch);
-	void _explore(on_explore_finish_t cb, void *arg, int s, int off);
+	void _enter(trie_lane_t &lane)
+	{
+		lane.len = (*lane.p)?1:0;
+		lane.tail = false;
+		lane.t = _base(lane.s) + _key2state(*lane.p);
+		if (lane.t > 0 && lane.t < _header->num)
+			__builtin_prefetch(&_state[lane.t]);
+		else
+			lane.t = 0;
+	}
+
+	template<class V>
+	bool _step(trie_lane_t &lane, V &val)
+	{
+		if (lane.t == 0 || _check(lane.t) != lane.s) {
+			val = 0;
+			return true;
+		}
+		if (lane.len == 0) {
+			val = _base(lane.t);
+			return true;
+		}
+		lane.s = lane.t;
+		lane.p++;
+		_enter(lane);
+		return false;
+	}
+
+	/* the value of the key ending at leaf s, the rest of which goes to rest */
+	virtual I _leaf(I s, bool end, std::string *rest)
+	{
+		return _base(s);
+	}
+
+	I _find_base(int *key, int max, int min);
+	I _relocate(I stand, I s, int *key, int max, int min);
+	I _create_transition(I s, int ch);
+	void _explore(on_explore_finish_t cb, void *arg, I s, int off);
+	void _annotate();
+	size_t _predict(I s, const std::string &prefix, size_t limit, on_explore_finish_t cb, void *arg);
 private:
-	DoubleArray(DoubleArray &) {}
+	BasicDoubleArray(BasicDoubleArray &) {}
 
 };
 
+typedef BasicDoubleArray<int32_t> DoubleArray;
+typedef BasicDoubleArray<int64_t> DoubleArray64;
+
 } //namespace bamboo
 
 #endif // DOUBLE_ARRAY_HPP
@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2008, detrox@gmail.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <organization> nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY detrox@gmail.com ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL detrox@gmail.com BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+
+#include "key_filter.hxx"
+
+namespace bamboo {
+
+
+KeyFilter::KeyFilter(size_t num_keys, int bits_per_key)
+	:_header(NULL), _blocks(NULL), _mmap(NULL)
+{
+	size_t bits;
+	void *p;
+
+	if (bits_per_key < 1) throw std::runtime_error("a key filter needs a bit per key at least");
+	bits = num_keys * bits_per_key;
+	_header = new _header_t;
+	memset(_header, 0, sizeof(_header_t));
+	strcpy(_header->magic, "key_filter");
+	_header->version = version;
+	/* k = ln 2 * bits per key is the fewest false positives */
+	_header->num_hashes = (bits_per_key * 69 + 50) / 100;
+	if (_header->num_hashes < 1) _header->num_hashes = 1;
+	if (_header->num_hashes > max_hashes) _header->num_hashes = max_hashes;
+	_header->num_blocks = (bits + _block_words * 64 - 1) / (_block_words * 64);
+	if (_header->num_blocks < 1) _header->num_blocks = 1;
+	if (posix_memalign(&p, _block_words * sizeof(uint64_t),
+				(size_t)_header->num_blocks * _block_words * sizeof(uint64_t)) != 0) {
+		delete _header;
+		throw std::bad_alloc();
+	}
+	_blocks = (uint64_t *)p;
+	memset(_blocks, 0, (size_t)_header->num_blocks * _block_words * sizeof(uint64_t));
+}
+
+KeyFilter::KeyFilter(const char *filename)
+	:_header(NULL), _blocks(NULL), _mmap(NULL)
+{
+	_mmap = new MMap(filename);
+	_header = (_header_t *)_mmap->start();
+	if (_mmap->size() < sizeof(_header_t) || strcmp(_header->magic, "key_filter") != 0
+			|| _header->version != version
+			|| _mmap->size() != sizeof(_header_t)
+				+ (size_t)_header->num_blocks * _block_words * sizeof(uint64_t)) {
+		delete _mmap;
+		throw std::runtime_error(std::string("unsupported key filter: ") + filename);
+	}
+	_blocks = (uint64_t *)_mmap->start(sizeof(_header_t));
+}
+
+KeyFilter::~KeyFilter()
+{
+	if (_mmap) {
+		delete _mmap;
+	} else {
+		delete _header;
+		free(_blocks);
+	}
+}
+
+void KeyFilter::insert(const char *key)
+{
+	uint64_t h, *block;
+	int i;
+
+	if (key == NULL) throw std::runtime_error("Empty Key");
+	if (_mmap) throw std::runtime_error("can not insert into a mapped key filter");
+	h = _hash(key);
+	block = _block(h);
+	h *= 0x9e3779b97f4a7c15ULL;
+	for (i = 0; i < _header->num_hashes; i++, h >>= 9)
+		block[(h & 511) >> 6] |= 1ULL << (h & 63);
+}
+
+void KeyFilter::save(const char *filename)
+{
+	FILE *fp;
+
+	assert(filename);
+	fp = fopen(filename, "w+");
+	if (fp == NULL)
+		throw std::runtime_error("Can not write to file");
+	fwrite(_header, sizeof(_header_t), 1, fp);
+	fwrite(_blocks, (size_t)_header->num_blocks * _block_words * sizeof(uint64_t), 1, fp);
+	fclose(fp);
+}
+
+} //namespace bamboo
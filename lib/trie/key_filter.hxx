@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2008, detrox@gmail.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <organization> nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY detrox@gmail.com ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL detrox@gmail.com BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#ifndef KEY_FILTER_HXX
+#define KEY_FILTER_HXX
+
+#include <stdint.h>
+#include <cstring>
+
+#include "mmap.hxx"
+
+namespace bamboo {
+
+
+/*
+ * A blocked Bloom filter over the keys of a lexicon, telling most keys
+ * not in it apart in one cache line: each key sets and tests all its
+ * bits in the 64-byte block its hash picks. contains() may be wrong
+ * about a missing key, never about a present one. Built in memory and
+ * saved beside the index, or mapped from such a file. The stamp records
+ * the index it was built for, so that a stale filter can be told.
+ */
+class KeyFilter {
+public:
+	static const int magic_size = 32;
+	static const int version = 1;
+	static const int max_hashes = 7;	/* 9-bit offsets in a 64-bit hash */
+
+	KeyFilter(size_t num_keys, int bits_per_key=10);
+	KeyFilter(const char *filename);
+	~KeyFilter();
+
+	void insert(const char *key);
+
+	/* false when key is certainly not in the lexicon */
+	bool contains(const char *key)
+	{
+		uint64_t h = _hash(key), *block;
+		int i;
+
+		block = _block(h);
+		h *= 0x9e3779b97f4a7c15ULL;
+		for (i = 0; i < _header->num_hashes; i++, h >>= 9)
+			if ((block[(h & 511) >> 6] & (1ULL << (h & 63))) == 0) return false;
+		return true;
+	}
+
+	/* the index the filter stands for: its size, keys and sum of values */
+	void stamp(long long size, int num, long long sum)
+	{
+		_header->size = size;
+		_header->num = num;
+		_header->sum = sum;
+	}
+
+	bool stamped(long long size, int num, long long sum)
+	{
+		return _header->size == size && _header->num == num && _header->sum == sum;
+	}
+
+	void save(const char *filename);
+
+protected:
+	#pragma pack(push, 4)
+	typedef struct {
+		char magic[magic_size];
+		int version;
+		int num_hashes;
+		unsigned int num_blocks;
+		int num;
+		long long size;
+		long long sum;
+	} _header_t;	/* a block long, keeping blocks aligned in the file */
+	#pragma pack(pop)
+
+	static const int _block_words = 8;
+
+	_header_t *_header;
+	uint64_t *_blocks;
+	MMap *_mmap;
+
+	/* FNV-1a, then the murmur3 finalizer to spread short keys */
+	static uint64_t _hash(const char *key)
+	{
+		const unsigned char *p;
+		uint64_t h = 0xcbf29ce484222325ULL;
+
+		for (p = (const unsigned char *)key; *p; p++)
+			h = (h ^ *p) * 0x100000001b3ULL;
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdULL;
+		h ^= h >> 33;
+		h *= 0xc4ceb9fe1a85ec53ULL;
+		h ^= h >> 33;
+		return h;
+	}
+
+	uint64_t *_block(uint64_t h)
+	{
+		return _blocks + ((h >> 32) * _header->num_blocks >> 32) * _block_words;
+	}
+
+private:
+	KeyFilter(KeyFilter &) {}
+};
+
+} //namespace bamboo
+
+#endif // KEY_FILTER_HXX
@@ -0,0 +1,244 @@
+/*
+ * Copyright (c) 2008, detrox@gmail.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <organization> nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY detrox@gmail.com ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL detrox@gmail.com BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#include <pthread.h>
+#include <unistd.h>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+
+#include "key_sorter.hxx"
+
+namespace bamboo {
+
+
+KeySorter::KeySorter(size_t memory, int threads, bool sum)
+	:_memory(memory), _size(0), _threads(threads), _sum(sum)
+{
+	if (_threads < 1) _threads = sysconf(_SC_NPROCESSORS_ONLN);
+	if (_threads < 1) _threads = 1;
+}
+
+KeySorter::~KeySorter()
+{
+	_clear();
+}
+
+bool KeySorter::_less::operator()(const _entry_t &a, const _entry_t &b) const
+{
+	int c = memcmp(buff + a.off, buff + b.off, (a.len < b.len)?a.len:b.len);
+
+	return (c == 0)?a.len < b.len:c < 0;
+}
+
+void KeySorter::add(const char *key, int val)
+{
+	_entry_t e;
+
+	if (key == NULL) throw std::runtime_error("Empty Key");
+	e.off = _buff.size();
+	e.len = strlen(key);
+	e.val = val;
+	_buff.insert(_buff.end(), key, key + e.len);
+	_entries.push_back(e);
+	_size++;
+	if (_buff.size() + _entries.size() * sizeof(_entry_t) >= _memory)
+		_spill();
+}
+
+void *KeySorter::_sort_chunk(void *arg)
+{
+	_chunk_t *chunk = (_chunk_t *)arg;
+
+	std::stable_sort(chunk->first, chunk->last, _less(chunk->buff));
+	return NULL;
+}
+
+/* stable, so that equal keys stay in the order they were added */
+void KeySorter::_sort()
+{
+	std::vector<_chunk_t> chunks;
+	std::vector<pthread_t> threads;
+	std::vector<bool> started;
+	size_t i, n, num;
+	_entry_t *first;
+
+	n = _entries.size();
+	if (n == 0) return;
+	num = (n < 65536)?1:_threads;
+	first = &_entries[0];
+	chunks.resize(num);
+	threads.resize(num);
+	started.resize(num, false);
+	for (i = 0; i < num; i++) {
+		chunks[i].first = first + n * i / num;
+		chunks[i].last = first + n * (i + 1) / num;
+		chunks[i].buff = &_buff[0];
+	}
+	for (i = 1; i < num; i++)
+		started[i] = (pthread_create(&threads[i], NULL, _sort_chunk, &chunks[i]) == 0);
+	_sort_chunk(&chunks[0]);
+	for (i = 1; i < num; i++) {
+		if (started[i])
+			pthread_join(threads[i], NULL);
+		else
+			_sort_chunk(&chunks[i]);
+	}
+
+	/* the sorted chunks are merged left to right, which keeps it stable */
+	for (i = 1; i < num; i++)
+		std::inplace_merge(first, chunks[i].first, chunks[i].last, _less(&_buff[0]));
+}
+
+/* one key of the run, its duplicates folded in */
+bool KeySorter::_next(_run_t &run)
+{
+	unsigned int len;
+	const _entry_t *e;
+
+	if (run.fp) {
+		if (fread(&len, sizeof(len), 1, run.fp) != 1) return false;
+		run.key.resize(len);
+		if (fread(&run.val, sizeof(run.val), 1, run.fp) != 1
+				|| (len > 0 && fread(&run.key[0], len, 1, run.fp) != 1))
+			throw std::runtime_error("short read from a spilled run");
+		return true;
+	}
+
+	if (run.next >= _entries.size()) return false;
+	e = &_entries[run.next++];
+	run.key.assign(&_buff[e->off], e->len);
+	run.val = e->val;
+	for (; run.next < _entries.size(); run.next++) {
+		e = &_entries[run.next];
+		if (e->len != run.key.size() || memcmp(&_buff[e->off], run.key.data(), e->len) != 0)
+			break;
+		run.val = (_sum)?run.val + e->val:e->val;
+	}
+	return true;
+}
+
+void KeySorter::_spill()
+{
+	_run_t run;
+	unsigned int len;
+	FILE *fp;
+
+	_sort();
+	fp = tmpfile();
+	if (fp == NULL) throw std::runtime_error("can not create a run file");
+	_spilled.push_back(fp);
+	for (run.fp = NULL, run.next = 0; _next(run);) {
+		len = run.key.size();
+		if (fwrite(&len, sizeof(len), 1, fp) != 1
+				|| fwrite(&run.val, sizeof(run.val), 1, fp) != 1
+				|| fwrite(run.key.data(), len, 1, fp) != (len > 0))
+			throw std::runtime_error("can not write a run file");
+	}
+	std::vector<char>().swap(_buff);
+	std::vector<_entry_t>().swap(_entries);
+}
+
+void KeySorter::_clear()
+{
+	size_t i;
+
+	for (i = 0; i < _spilled.size(); i++)
+		fclose(_spilled[i]);
+	_spilled.clear();
+	std::vector<char>().swap(_buff);
+	std::vector<_entry_t>().swap(_entries);
+	_size = 0;
+}
+
+struct _run_greater {
+	const std::vector<std::string *> *keys;
+	_run_greater(const std::vector<std::string *> *k):keys(k) {}
+	bool operator()(size_t a, size_t b) const
+	{
+		return *(*keys)[a] > *(*keys)[b];
+	}
+};
+
+void KeySorter::merge(on_key_t cb, void *arg)
+{
+	std::vector<_run_t> runs;
+	std::vector<std::string *> keys;
+	std::vector<size_t> heap;
+	std::string key;
+	size_t i, j, last;
+	int val;
+
+	/* the spilled runs, oldest first, then the one in memory */
+	_sort();
+	runs.resize(_spilled.size() + 1);
+	for (i = 0; i < runs.size(); i++) {
+		runs[i].fp = (i < _spilled.size())?_spilled[i]:NULL;
+		runs[i].next = 0;
+		if (runs[i].fp && fflush(runs[i].fp) == 0) rewind(runs[i].fp);
+	}
+	for (i = 0; i < runs.size(); i++) {
+		keys.push_back(&runs[i].key);
+		if (_next(runs[i])) heap.push_back(i);
+	}
+	_run_greater greater(&keys);
+	std::make_heap(heap.begin(), heap.end(), greater);
+
+	while (!heap.empty()) {
+		std::pop_heap(heap.begin(), heap.end(), greater);
+		i = heap.back();
+		heap.pop_back();
+		key = runs[i].key;
+		val = runs[i].val;
+		last = i;
+		if (_next(runs[i])) {
+			heap.push_back(i);
+			std::push_heap(heap.begin(), heap.end(), greater);
+		}
+		/* the same key from other runs: the latest run wins, or all add up */
+		while (!heap.empty() && runs[heap.front()].key == key) {
+			std::pop_heap(heap.begin(), heap.end(), greater);
+			j = heap.back();
+			heap.pop_back();
+			if (_sum) {
+				val += runs[j].val;
+			} else if (j > last) {
+				val = runs[j].val;
+				last = j;
+			}
+			if (_next(runs[j])) {
+				heap.push_back(j);
+				std::push_heap(heap.begin(), heap.end(), greater);
+			}
+		}
+		cb(key.c_str(), val, arg);
+	}
+	_clear();
+}
+
+} //namespace bamboo
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2008, detrox@gmail.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <organization> nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY detrox@gmail.com ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL detrox@gmail.com BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#ifndef KEY_SORTER_HXX
+#define KEY_SORTER_HXX
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace bamboo {
+
+
+/*
+ * Collects (key, value) pairs for bulk trie builds and hands them back
+ * once each, in byte order. Runs are sorted on several threads and spilled
+ * to temporary files when they outgrow the memory budget, then merged.
+ * A key added twice keeps its last value, or the sum of its values.
+ */
+class KeySorter {
+public:
+	typedef void (*on_key_t)(const char *key, int val, void *arg);
+
+	KeySorter(size_t memory=(64 << 20), int threads=0, bool sum=false);
+	~KeySorter();
+
+	void add(const char *key, int val);
+	/* every key once, in byte order; the sorter is empty afterwards */
+	void merge(on_key_t cb, void *arg);
+
+	size_t size()
+	{
+		return _size;
+	}
+
+protected:
+	typedef struct {
+		size_t off;
+		unsigned int len;
+		int val;
+	} _entry_t;
+
+	typedef struct {
+		_entry_t *first, *last;
+		const char *buff;
+	} _chunk_t;
+
+	struct _less {
+		const char *buff;
+		_less(const char *b):buff(b) {}
+		bool operator()(const _entry_t &a, const _entry_t &b) const;
+	};
+
+	/* the next distinct key of a run, in memory or spilled */
+	typedef struct {
+		FILE *fp;
+		size_t next;
+		std::string key;
+		int val;
+	} _run_t;
+
+	size_t _memory, _size;
+	int _threads;
+	bool _sum;
+	std::vector<char> _buff;
+	std::vector<_entry_t> _entries;
+	std::vector<FILE *> _spilled;
+
+	static void *_sort_chunk(void *arg);
+	void _sort();
+	void _spill();
+	bool _next(_run_t &run);
+	void _clear();
+};
+
+} //namespace bamboo
+
+#endif // KEY_SORTER_HXX
@@ -29,6 +29,7 @@
 #ifndef KVTRIE_HXX
 #define KVTRIE_HXX
 
+#include <sys/stat.h>
 #include <fstream>
 #include <iostream>
 #include <stdexcept>
@@ -39,25 +40,33 @@
 namespace bamboo {
 
 
+/*
+ * Keys with their data, the trie giving the offset of the data of a key.
+ * Past 2^31 bytes of data the offsets, and so the trie, are 64-bit.
+ */
 class KVTrie {
 protected:
-	DATrie _index;
+	DATrie *_index;
+	DATrie64 *_index64;	/* instead of _index, for a 64-bit index */
 	MMap _data;
 
-public:
-	KVTrie(const char *index, const char *data)
-		:_index(index), _data(data)
+	/* whether the index file is in the 64-bit format */
+	static bool _wide(const char *index)
 	{
+		MMap map(index);
+
+		return map.size() >= (size_t)DATrie::magic_size && DATrie::wide((const char *)map.start());
 	}
 
-	static void build_from_text(const char *index, const char *data, 
-			const char *source, bool verbose = false)
+	template<class T>
+	static void _build(const char *index, const char *data, 
+			const char *source, bool verbose)
 	{
 		std::ifstream ifs;
 		std::ofstream ofs;
 		std::string s;
 		int value_start;
-		DATrie trie;
+		T trie;
 
 		if (verbose)
 			std::cout << "building from " << source << std::endl;
@@ -70,19 +79,51 @@ public:
 			std::getline(ifs, s);
 			if (s.empty()) continue;
 			value_start = s.find(' ') + 1;
-			trie.insert(s.substr(0, value_start - 1).c_str(), ofs.tellp());
+			trie.insert(s.substr(0, value_start - 1).c_str(), (long long)ofs.tellp());
 			ofs << s.substr(value_start);
 			ofs.write("", 1);
 		}
 		trie.save(index);
 	}
 
+private:
+	KVTrie(KVTrie &);
+
+public:
+	KVTrie(const char *index, const char *data)
+		:_index(NULL), _index64(NULL), _data(data)
+	{
+		if (_wide(index))
+			_index64 = new DATrie64(index);
+		else
+			_index = new DATrie(index);
+	}
+
+	~KVTrie()
+	{
+		delete _index;
+		delete _index64;
+	}
+
+	/* the data is no larger than the source: it tells the width */
+	static void build_from_text(const char *index, const char *data, 
+			const char *source, bool verbose = false)
+	{
+		struct stat buf;
+
+		if (stat(source, &buf) == 0 && trie_needs_64(buf.st_size))
+			_build<DATrie64>(index, data, source, verbose);
+		else
+			_build<DATrie>(index, data, source, verbose);
+	}
+
 	
 	const char* operator[](const char * k)
 	{
-		int v = _index.search(k);
+		long long v = (_index)?_index->search(k):_index64->search(k);
+
 		if (v > 0)
-			return (const char *)_data.start(_index.search(k));
+			return (const char *)_data.start(v);
 		else
 			return NULL;
 	}
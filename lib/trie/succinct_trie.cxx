@@ -0,0 +1,425 @@
+/*
+ * Copyright (c) 2008, detrox@gmail.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <organization> nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY detrox@gmail.com ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL detrox@gmail.com BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+
+#include <algorithm>
+
+#include "succinct_trie.hxx"
+
+namespace bamboo {
+
+
+typedef std::pair<int, std::string> _suggestion_t;
+
+/* the keys [lo, hi) sharing depth bytes, a node while building */
+typedef struct {
+	size_t lo, hi, depth;
+} _range_t;
+
+/* higher values first, then keys in byte order */
+static bool _better(const _suggestion_t &a, const _suggestion_t &b)
+{
+	return (a.first != b.first)?a.first > b.first:a.second < b.second;
+}
+
+/* arrays are saved padded to 8 bytes, keeping the next one aligned */
+static size_t _padded(size_t bytes)
+{
+	return (bytes + 7) & ~(size_t)7;
+}
+
+static void _write_padded(const void *p, size_t bytes, FILE *fp)
+{
+	static const char zero[8] = {0};
+
+	if (bytes) fwrite(p, bytes, 1, fp);
+	fwrite(zero, _padded(bytes) - bytes, 1, fp);
+}
+
+SuccinctTrie::SuccinctTrie(int size)
+	:_header(NULL), _label(NULL), _tail(NULL), _tail_index(NULL), _value(NULL),
+	 _mmap(NULL), _dirty(true)
+{
+	_header = new _header_t;
+	memset(_header, 0, sizeof(_header_t));
+	strcpy(_header->magic, "succinct");
+	_header->version = version;
+	_header->min = 0xffffff;
+}
+
+SuccinctTrie::SuccinctTrie(const char *filename)
+	:_header(NULL), _label(NULL), _tail(NULL), _tail_index(NULL), _value(NULL),
+	 _mmap(NULL), _dirty(false)
+{
+	const char *p;
+	size_t num_tails;
+
+	_mmap = new MMap(filename);
+	_header = (_header_t *)_mmap->start();
+	if (strcmp(_header->magic, "succinct") != 0 || _header->version != version) {
+		delete _mmap;
+		throw std::runtime_error(std::string("unsupported trie version: ") + filename);
+	}
+	p = (const char *)_mmap->start(sizeof(_header_t));
+	p = _louds.map(p);
+	p = _terminal.map(p);
+	p = _tails.map(p);
+	num_tails = _tails.ones();
+	_label = (const unsigned char *)p;
+	p += _padded(_header->num_nodes - 1);
+	_tail = (const unsigned char *)p;
+	p += _padded(_header->tail);
+	_tail_index = (const uint32_t *)p;
+	p += _padded((num_tails + _tail_step - 1) / _tail_step * sizeof(uint32_t));
+	_value = (const uint64_t *)p;
+}
+
+SuccinctTrie::~SuccinctTrie()
+{
+	if (_mmap)
+		delete _mmap;
+	else
+		delete _header;
+}
+
+void SuccinctTrie::insert(const char *key, int val)
+{
+	if (key == NULL) throw std::runtime_error("Empty Key");
+	if (_mmap) throw std::runtime_error("can not insert into a mapped trie");
+	_keys[key] = val;
+	_dirty = true;
+	_header->max = (val > _header->max)?val:_header->max;
+	_header->min = (val < _header->min)?val:_header->min;
+	_header->sum += val;
+	_header->num_insert++;
+}
+
+/*
+ * The nodes level by level: each range of keys sharing depth bytes is a
+ * node, and its keys grouped by the next byte are its children, queued
+ * behind the nodes already there.
+ */
+void SuccinctTrie::_build()
+{
+	std::vector<const std::pair<const std::string, int> *> keys;
+	std::map<std::string, int>::const_iterator it;
+	std::vector<_range_t> queue;
+	std::vector<int> values;
+	_range_t r, child;
+	uint32_t range;
+	size_t i, j, bit;
+	int min, max;
+
+	for (it = _keys.begin(); it != _keys.end(); ++it)
+		keys.push_back(&*it);
+	_louds = BitVector();
+	_terminal = BitVector();
+	_tails = BitVector();
+	_labels.clear();
+	_tail_bytes.assign(1, '\0');	/* no tail at 0, see Cursor */
+	_tail_offsets.clear();
+
+	r.lo = 0;
+	r.hi = keys.size();
+	r.depth = 0;
+	queue.push_back(r);
+	for (i = 0; i < queue.size(); i++) {
+		r = queue[i];
+		if (r.hi - r.lo == 1 && keys[r.lo]->first.size() > r.depth) {
+			/* a single key left: the rest of it goes to the tail */
+			if (_tails.ones() % _tail_step == 0)
+				_tail_offsets.push_back(_tail_bytes.size());
+			_tails.push_back(true);
+			_terminal.push_back(false);
+			_tail_bytes.insert(_tail_bytes.end(), keys[r.lo]->first.begin() + r.depth,
+					keys[r.lo]->first.end());
+			_tail_bytes.push_back('\0');
+			values.push_back(keys[r.lo]->second);
+			_louds.push_back(false);
+			continue;
+		}
+		_tails.push_back(false);
+		if (r.lo < r.hi && keys[r.lo]->first.size() == r.depth) {
+			_terminal.push_back(true);
+			values.push_back(keys[r.lo]->second);
+			r.lo++;
+		} else {
+			_terminal.push_back(false);
+		}
+		for (j = r.lo; j < r.hi; j = child.hi) {
+			child.lo = j;
+			child.depth = r.depth + 1;
+			for (child.hi = j + 1; child.hi < r.hi
+					&& keys[child.hi]->first[r.depth] == keys[j]->first[r.depth]; child.hi++) ;
+			_louds.push_back(true);
+			_labels.push_back(keys[j]->first[r.depth]);
+			queue.push_back(child);
+		}
+		_louds.push_back(false);
+	}
+	_louds.finish(true);
+	_terminal.finish();
+	_tails.finish();
+
+	/* values less the smallest, in as few bits as the largest needs */
+	min = max = (values.empty())?0:values[0];
+	for (i = 0; i < values.size(); i++) {
+		min = std::min(min, values[i]);
+		max = std::max(max, values[i]);
+	}
+	range = (uint32_t)max - (uint32_t)min;
+	_header->value_min = min;
+	for (_header->value_bits = 0; _header->value_bits < 32
+			&& (range >> _header->value_bits); _header->value_bits++) ;
+	_values.assign((values.size() * _header->value_bits + 63) / 64 + 1, 0);
+	for (i = 0; i < values.size(); i++) {
+		range = (uint32_t)values[i] - (uint32_t)min;
+		bit = i * _header->value_bits;
+		_values[bit >> 6] |= (uint64_t)range << (bit & 63);
+		if ((bit & 63) + _header->value_bits > 64)
+			_values[(bit >> 6) + 1] |= (uint64_t)range >> (64 - (bit & 63));
+	}
+
+	_header->num_keys = values.size();
+	_header->num_nodes = queue.size();
+	_header->tail = _tail_bytes.size();
+	_labels.push_back('\0');
+	_tail_offsets.push_back(0);
+	_label = &_labels[0];
+	_tail = &_tail_bytes[0];
+	_tail_index = &_tail_offsets[0];
+	_value = &_values[0];
+	_dirty = false;
+}
+
+int SuccinctTrie::search(const char *key)
+{
+	const unsigned char *p, *q;
+	int v, first, last;
+
+	if (_dirty) _build();
+	for (v = 0, p = (const unsigned char *)key;; p++) {
+		_children(v, first, last);
+		if (_tail_node(v, first, last)) {
+			for (q = _tail_of(v); *q && *q == *p; q++, p++) ;
+			return (*q == 0 && *p == 0)?_value_of(v):0;
+		}
+		if (*p == 0) return (_terminal[v])?_value_of(v):0;
+		if ((v = _find(first, last, *p)) < 0) return 0;
+	}
+}
+
+void SuccinctTrie::search_batch(const char **keys, size_t n, int *values)
+{
+	size_t i;
+
+	for (i = 0; i < n; i++)
+		values[i] = search(keys[i]);
+}
+
+/* see DoubleArray::common_prefix_search() */
+size_t SuccinctTrie::common_prefix_search(const char *key, size_t len,
+		trie_match_t *matches, size_t size)
+{
+	const unsigned char *q;
+	size_t i, n;
+	int v, first, last;
+
+	if (_dirty) _build();
+	for (v = 0, i = 0, n = 0; n < size; i++) {
+		_children(v, first, last);
+		if (_tail_node(v, first, last)) {
+			for (q = _tail_of(v); *q && i < len && *q == (unsigned char)key[i]; q++, i++) ;
+			if (*q == 0) {
+				matches[n].length = i;
+				matches[n++].value = _value_of(v);
+			}
+			break;
+		}
+		if (i > 0 && _terminal[v]) {
+			matches[n].length = i;
+			matches[n++].value = _value_of(v);
+		}
+		if (i >= len || key[i] == '\0') break;
+		if ((v = _find(first, last, (unsigned char)key[i])) < 0) break;
+	}
+	return n;
+}
+
+/* keeps the limit best keys below v in best, a heap with the worst on top */
+void SuccinctTrie::_collect(int v, std::string &key, size_t limit,
+		std::vector<_suggestion_t> &best)
+{
+	size_t n = key.size();
+	int val, c, first, last;
+	bool tail;
+
+	_children(v, first, last);
+	tail = _tail_node(v, first, last);
+	if (tail || _terminal[v]) {
+		val = _value_of(v);
+		if (best.size() < limit || val >= best.front().first) {
+			if (tail) key.append((const char *)_tail_of(v));
+			if (best.size() < limit) {
+				best.push_back(_suggestion_t(val, key));
+				std::push_heap(best.begin(), best.end(), _better);
+			} else if (_better(_suggestion_t(val, key), best.front())) {
+				std::pop_heap(best.begin(), best.end(), _better);
+				best.back() = _suggestion_t(val, key);
+				std::push_heap(best.begin(), best.end(), _better);
+			}
+			key.resize(n);
+		}
+	}
+	for (c = first; c < last; c++) {
+		key.push_back((char)_label[c - 1]);
+		_collect(c, key, limit, best);
+		key.resize(n);
+	}
+}
+
+size_t SuccinctTrie::predictive_search(const char *prefix, size_t limit,
+		on_explore_finish_t cb, void *arg)
+{
+	std::vector<_suggestion_t> best;
+	const unsigned char *p, *q;
+	std::string key;
+	size_t i;
+	int v, first, last;
+
+	if (_dirty) _build();
+	if (limit == 0) return 0;
+	for (v = 0, p = (const unsigned char *)prefix; *p; p++) {
+		_children(v, first, last);
+		if (_tail_node(v, first, last)) {
+			/* the prefix ends inside the tail of the only key below v */
+			for (q = _tail_of(v); *p && *q == *p; q++, p++) ;
+			if (*p) return 0;
+			key.assign(prefix).append((const char *)q);
+			cb(key.c_str(), _value_of(v), arg);
+			return 1;
+		}
+		if ((v = _find(first, last, *p)) < 0) return 0;
+	}
+
+	key.assign(prefix);
+	_collect(v, key, limit, best);
+	std::sort_heap(best.begin(), best.end(), _better);
+	for (i = 0; i < best.size(); i++)
+		cb(best[i].second.c_str(), best[i].first, arg);
+	return best.size();
+}
+
+bool SuccinctTrie::Cursor::advance(const char *key, size_t len)
+{
+	size_t i;
+	int first, last;
+
+	for (i = 0; i < len && _s >= 0; i++) {
+		if (key[i] == '\0') {
+			_s = -1;
+			break;
+		}
+		if (_p == 0) {
+			_trie->_children(_s, first, last);
+			if (!_trie->_tail_node(_s, first, last)) {
+				_s = _trie->_find(first, last, (unsigned char)key[i]);
+				continue;
+			}
+			_p = _trie->_tail_of(_s) - _trie->_tail;
+		}
+		if (_trie->_tail[_p] == (unsigned char)key[i]) _p++;
+		else _s = -1;
+	}
+	return _s >= 0;
+}
+
+int SuccinctTrie::Cursor::value()
+{
+	int t, first, last;
+
+	if (_s < 0) return 0;
+	if (_p == 0) _trie->_children(_s, first, last);
+	if (_p || _trie->_tail_node(_s, first, last)) {
+		t = (_p)?_p:_trie->_tail_of(_s) - _trie->_tail;
+		return (_trie->_tail[t] == 0)?_trie->_value_of(_s):0;
+	}
+	return (_trie->_terminal[_s])?_trie->_value_of(_s):0;
+}
+
+void SuccinctTrie::_explore(on_explore_finish_t cb, void *arg, int v, std::string &key)
+{
+	size_t n = key.size();
+	int c, first, last;
+
+	_children(v, first, last);
+	if (_tail_node(v, first, last)) {
+		key.append((const char *)_tail_of(v));
+		cb(key.c_str(), _value_of(v), arg);
+		key.resize(n);
+		return;
+	}
+	if (_terminal[v])
+		cb(key.c_str(), _value_of(v), arg);
+	for (c = first; c < last; c++) {
+		key.push_back((char)_label[c - 1]);
+		_explore(cb, arg, c, key);
+		key.resize(n);
+	}
+}
+
+void SuccinctTrie::explore(on_explore_finish_t cb, void *arg)
+{
+	std::string key;
+
+	if (_dirty) _build();
+	_explore(cb, arg, 0, key);
+}
+
+void SuccinctTrie::save(const char *filename)
+{
+	FILE *fp;
+
+	assert(filename);
+	if (_dirty) _build();
+	fp = fopen(filename, "w+");
+	if (fp == NULL)
+		throw std::runtime_error("Can not write to file");
+	fwrite(_header, sizeof(_header_t), 1, fp);
+	_louds.save(fp);
+	_terminal.save(fp);
+	_tails.save(fp);
+	_write_padded(_label, _header->num_nodes - 1, fp);
+	_write_padded(_tail, _header->tail, fp);
+	_write_padded(_tail_index, (_tails.ones() + _tail_step - 1) / _tail_step * sizeof(uint32_t), fp);
+	fwrite(_value, sizeof(uint64_t),
+			((size_t)_header->num_keys * _header->value_bits + 63) / 64 + 1, fp);
+	fclose(fp);
+}
+
+} //namespace bamboo
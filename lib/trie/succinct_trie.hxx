@@ -0,0 +1,226 @@
+/*
+ * Copyright (c) 2008, detrox@gmail.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <organization> nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY detrox@gmail.com ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL detrox@gmail.com BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#ifndef SUCCINCT_TRIE_HXX
+#define SUCCINCT_TRIE_HXX
+
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "double_array.hxx"
+#include "bit_vector.hxx"
+
+namespace bamboo {
+
+
+/*
+ * A read-only trie for very large lexicons, a few times smaller than
+ * a double array at the price of slower lookups. Nodes are numbered
+ * level by level from the root, 0; node v is told by its position
+ * alone, through rank and select on bit vectors:
+ *
+ *   louds     per node, a one per child then a zero; the children of v
+ *             are the nodes from select0(v - 1) - v + 2 to select0(v) - v
+ *   labels    the byte leading to each node but the root
+ *   terminal  the nodes a key ends at
+ *   tails     the nodes below which a single key is left, the rest of
+ *             it being in tail as bytes up to a '\0'
+ *   values    per key, in node order, value - min packed in just the
+ *             bits the lexicon needs
+ *
+ * The n-th tail is found from the offset of every 16th one, skipping
+ * the tails in between. In memory, insert() only collects the keys; the
+ * trie is built from them on the next lookup or save().
+ */
+class SuccinctTrie {
+public:
+	static const int magic_size = 32;
+	static const int version = 2;
+
+	SuccinctTrie(int size=0);
+	SuccinctTrie(const char *filename);
+	~SuccinctTrie();
+
+	void explore(on_explore_finish_t cb, void *arg);
+
+	int max_value()
+	{
+		return _header->max;
+	}
+
+	int min_value()
+	{
+		return _header->min;
+	}
+
+	int sum_value()
+	{
+		return _header->sum;
+	}
+
+	int num_insert()
+	{
+		return _header->num_insert;
+	}
+
+	void insert(const char *key, int val);
+	int search(const char *key);
+	/* see DoubleArray::search_batch(); the walks are not interleaved */
+	void search_batch(const char **keys, size_t n, int *values);
+	size_t common_prefix_search(const char *key, size_t len, trie_match_t *matches, size_t size);
+	/*
+	 * See DoubleArray::predictive_search(). No bounds are kept below the
+	 * nodes, which would cost more than the trie itself: every key below
+	 * the prefix is looked at.
+	 */
+	size_t predictive_search(const char *prefix, size_t limit, on_explore_finish_t cb, void *arg);
+	void save(const char *filename);
+
+	/* see DoubleArray::Cursor */
+	class Cursor {
+	private:
+		SuccinctTrie *_trie;
+		int _s;		/* node, -1 once dead */
+		int _p;		/* offset in _tail once past a tail node */
+	public:
+		Cursor(SuccinctTrie *trie):_trie(trie), _s(0), _p(0)
+		{
+			if (_trie->_dirty) _trie->_build();
+		}
+		void reset() {_s = 0; _p = 0;}
+		bool dead() {return _s < 0;}
+		bool advance(const char *key, size_t len);
+		int value();
+	};
+
+protected:
+	#pragma pack(push, 4)
+	typedef struct {
+		char magic[magic_size];
+		int version;
+		int max, min;
+		long long sum;
+		int num_insert;
+		int num_keys;
+		int value_min;		/* values are saved less this */
+		int value_bits;
+		unsigned int num_nodes;
+		unsigned int tail;	/* bytes of tail */
+		int reserved;		/* keeps the arrays after it 8-byte aligned */
+	} _header_t;
+	#pragma pack(pop)
+
+	static const int _tail_step = 16;
+
+	_header_t *_header;
+	BitVector _louds, _terminal, _tails;
+	const unsigned char *_label, *_tail;
+	const uint32_t *_tail_index;
+	const uint64_t *_value;
+	MMap *_mmap;
+
+	/* in memory only: the keys, and the arrays built from them */
+	std::map<std::string, int> _keys;
+	bool _dirty;
+	std::vector<unsigned char> _labels, _tail_bytes;
+	std::vector<uint32_t> _tail_offsets;
+	std::vector<uint64_t> _values;
+
+	/* the children of v are the nodes [first, last) */
+	void _children(int v, int &first, int &last)
+	{
+		size_t p = (v == 0)?0:_louds.select0(v - 1) + 1;
+
+		first = p - v + 1;
+		last = _louds.next0(p) - v + 1;
+	}
+
+	/* the child among [first, last) by byte ch, or -1; labels ascend */
+	int _find(int first, int last, unsigned char ch)
+	{
+		int lo, hi, mid;
+
+		for (lo = first, hi = last; lo < hi;) {
+			mid = (lo + hi) >> 1;
+			if (_label[mid - 1] < ch)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		return (lo < last && _label[lo - 1] == ch)?lo:-1;
+	}
+
+	/* only leaves may have a tail: the bit is not looked up for others */
+	bool _tail_node(int v, int first, int last)
+	{
+		return first == last && _tails[v];
+	}
+
+	/* the value of the key at v, a terminal or tail node */
+	int _value_of(int v)
+	{
+		size_t i, bit, w, off;
+		uint64_t val;
+
+		if (_header->value_bits == 0) return _header->value_min;
+		i = _terminal.rank1(v) + _tails.rank1(v);
+		bit = i * _header->value_bits;
+		w = bit >> 6;
+		off = bit & 63;
+		val = _value[w] >> off;
+		if (off + _header->value_bits > 64)
+			val |= _value[w + 1] << (64 - off);
+		val &= (1ULL << _header->value_bits) - 1;
+		return (int)(uint32_t)(val + (uint32_t)_header->value_min);
+	}
+
+	/* the rest of the only key below tail node v */
+	const unsigned char *_tail_of(int v)
+	{
+		size_t i = _tails.rank1(v);
+		const unsigned char *q = _tail + _tail_index[i / _tail_step];
+
+		for (i %= _tail_step; i > 0; i--)
+			q += strlen((const char *)q) + 1;
+		return q;
+	}
+
+	void _build();
+	void _explore(on_explore_finish_t cb, void *arg, int v, std::string &key);
+	void _collect(int v, std::string &key, size_t limit,
+			std::vector<std::pair<int, std::string> > &best);
+
+private:
+	SuccinctTrie(SuccinctTrie &) {}
+};
+
+} //namespace bamboo
+
+#endif // SUCCINCT_TRIE_HXX
@@ -27,9 +27,19 @@
  */
 
 #include "utf8.hxx"
+#include <stdint.h>
 #include <iostream>
 #include <cstdlib>
 
+#if defined(__GNUC__) && (defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__)))
+#define UTF8_SSE2
+#include <emmintrin.h>
+#if defined(__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)
+#define UTF8_AVX2
+#include <immintrin.h>
+#endif
+#endif
+
 namespace bamboo {
 
 
@@ -91,6 +101,330 @@ const char utf8::_map[] = {
 	4, 4, 4, 4,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1
 };
 
+/*
+ * Block kernels of the walks. A block starts on a character boundary of
+ * the byte walk; its classifier returns two bit masks, the bytes starting
+ * a character (_map > 0) and the bytes inside the span of a multi-byte
+ * lead of the block. When no lead lies inside a span the block is clean:
+ * the byte walk visits exactly the bytes outside spans, and leaves it
+ * where the span of its last lead ends. The kernels run over clean blocks
+ * and return at the first other one, which the byte walk takes over.
+ */
+class utf8_simd {
+public:
+	typedef struct {
+		const char *name;
+		size_t width;
+		void (*length)(const unsigned char *p, size_t n, size_t &i, size_t &j);
+		bool (*check)(const unsigned char *p, size_t n, size_t &i);
+		void (*index)(const unsigned char *p, size_t n, size_t &i, size_t &j, size_t *index);
+		void (*locate)(const unsigned char *p, size_t n, size_t &i, size_t &j, size_t start);
+	} kernel_t;
 
-} //namespace bamboo
+	static const kernel_t *get()
+	{
+		static const kernel_t *kernel = _select();
+		return kernel;
+	}
+
+	static int step(const unsigned char *p, size_t i)
+	{
+		return utf8::_map[p[i]];
+	}
+
+	/* bytes the last lead of a clean block spans past its end */
+	static size_t overflow(const unsigned char *end)
+	{
+		int k, m;
+
+		for (k = 1; k <= 3; k++) {
+			m = utf8::_map[end[-k]];
+			if (m > k) return m - k;
+		}
+		return 0;
+	}
+
+private:
+	static const kernel_t *_select();
+};
+
+/*
+ * The walks are inlined into per kernel functions built for the kernel's
+ * target with flatten, which always_inline would refuse across targets.
+ */
+#define UTF8_INLINE inline
+
+static UTF8_INLINE size_t _popcount(uint32_t mask)
+{
+#ifdef __POPCNT__
+	return __builtin_popcount(mask);
+#else
+	mask = mask - ((mask >> 1) & 0x55555555u);
+	mask = (mask & 0x33333333u) + ((mask >> 2) & 0x33333333u);
+	return (((mask + (mask >> 4)) & 0x0f0f0f0fu) * 0x01010101u) >> 24;
+#endif
+}
+
+template <class K>
+static UTF8_INLINE void _length(const unsigned char *p, size_t n, size_t &i, size_t &j)
+{
+	uint32_t lead, inside;
+
+	for (; i + K::width <= n; i += K::width + utf8_simd::overflow(p + i + K::width)) {
+		K::classify(p + i, lead, inside);
+		if (lead & inside) return;
+		j += K::popcount(lead);
+	}
+}
+
+template <class K>
+static UTF8_INLINE bool _check(const unsigned char *p, size_t n, size_t &i)
+{
+	uint32_t lead, inside;
+
+	for (; i + K::width <= n; i += K::width + utf8_simd::overflow(p + i + K::width)) {
+		K::classify(p + i, lead, inside);
+		if (lead & inside) return true;
+		/* a byte outside spans not starting a character */
+		if (~(lead | inside) & K::mask) return false;
+	}
+	return true;
+}
+
+template <class K>
+static UTF8_INLINE void _index(const unsigned char *p, size_t n, size_t &i, size_t &j, size_t *index)
+{
+	uint32_t lead, inside, visit;
+
+	for (; i + K::width <= n; i += K::width + utf8_simd::overflow(p + i + K::width)) {
+		K::classify(p + i, lead, inside);
+		if (lead & inside) return;
+		for (visit = ~inside & K::mask; visit; visit &= visit - 1)
+			index[j++] = i + __builtin_ctz(visit);
+	}
+}
+
+template <class K>
+static UTF8_INLINE void _locate(const unsigned char *p, size_t n, size_t &i, size_t &j, size_t start)
+{
+	uint32_t lead, inside;
+
+	for (; i + K::width <= n; i += K::width + utf8_simd::overflow(p + i + K::width)) {
+		K::classify(p + i, lead, inside);
+		if ((lead & inside) || j + K::popcount(lead) >= start) return;
+		j += K::popcount(lead);
+	}
+}
+
+/* the four walks of classifier K, flattened and compiled for TARGET */
+#define UTF8_KERNEL(NAME, K, TARGET) \
+	TARGET __attribute__((flatten)) static void _length_##NAME(const unsigned char *p, size_t n, size_t &i, size_t &j) \
+	{ _length<K>(p, n, i, j); } \
+	TARGET __attribute__((flatten)) static bool _check_##NAME(const unsigned char *p, size_t n, size_t &i) \
+	{ return _check<K>(p, n, i); } \
+	TARGET __attribute__((flatten)) static void _index_##NAME(const unsigned char *p, size_t n, size_t &i, size_t &j, size_t *index) \
+	{ _index<K>(p, n, i, j, index); } \
+	TARGET __attribute__((flatten)) static void _locate_##NAME(const unsigned char *p, size_t n, size_t &i, size_t &j, size_t start) \
+	{ _locate<K>(p, n, i, j, start); } \
+	static const utf8_simd::kernel_t _kernel_##NAME = { \
+		#NAME, K::width, _length_##NAME, _check_##NAME, _index_##NAME, _locate_##NAME \
+	};
+
+#ifdef UTF8_SSE2
+struct _sse2_t {
+	static const size_t width = 16;
+	static const uint32_t mask = 0xffff;
+
+	static UTF8_INLINE size_t popcount(uint32_t mask)
+	{
+		return _popcount(mask);
+	}
+
+	static UTF8_INLINE void classify(const unsigned char *p, uint32_t &lead, uint32_t &inside)
+	{
+		__m128i v, ascii, ge_c0, ge_e0, ge_f0, bad, l2, l3, l4, in;
 
+		/* signed compares: ASCII is >= 0, 0x80-0xff run from -128 to -1 */
+		v = _mm_loadu_si128((const __m128i *)p);
+		ascii = _mm_cmpgt_epi8(v, _mm_set1_epi8(-1));
+		ge_c0 = _mm_andnot_si128(ascii, _mm_cmpgt_epi8(v, _mm_set1_epi8(-65)));
+		ge_e0 = _mm_andnot_si128(ascii, _mm_cmpgt_epi8(v, _mm_set1_epi8(-33)));
+		ge_f0 = _mm_andnot_si128(ascii, _mm_cmpgt_epi8(v, _mm_set1_epi8(-17)));
+		bad = _mm_andnot_si128(ascii, _mm_cmpgt_epi8(v, _mm_set1_epi8(-13)));
+		l2 = _mm_andnot_si128(bad, ge_c0);
+		l3 = _mm_andnot_si128(bad, ge_e0);
+		l4 = _mm_andnot_si128(bad, ge_f0);
+		in = _mm_or_si128(_mm_slli_si128(l2, 1),
+			_mm_or_si128(_mm_slli_si128(l3, 2), _mm_slli_si128(l4, 3)));
+		lead = _mm_movemask_epi8(_mm_or_si128(ascii, l2));
+		inside = _mm_movemask_epi8(in);
+	}
+};
+
+UTF8_KERNEL(sse2, _sse2_t, /* baseline */)
+#endif
+
+#ifdef UTF8_AVX2
+#define UTF8_AVX2_TARGET __attribute__((target("avx2,popcnt")))
+
+struct _avx2_t {
+	static const size_t width = 32;
+	static const uint32_t mask = 0xffffffffu;
+
+	static UTF8_INLINE UTF8_AVX2_TARGET size_t popcount(uint32_t mask)
+	{
+		return __builtin_popcount(mask);
+	}
+
+	static UTF8_INLINE UTF8_AVX2_TARGET void classify(const unsigned char *p,
+			uint32_t &lead, uint32_t &inside)
+	{
+		__m256i v, ascii, ge_c0, ge_e0, ge_f0, bad, l2, l3, l4, in;
+
+		v = _mm256_loadu_si256((const __m256i *)p);
+		ascii = _mm256_cmpgt_epi8(v, _mm256_set1_epi8(-1));
+		ge_c0 = _mm256_andnot_si256(ascii, _mm256_cmpgt_epi8(v, _mm256_set1_epi8(-65)));
+		ge_e0 = _mm256_andnot_si256(ascii, _mm256_cmpgt_epi8(v, _mm256_set1_epi8(-33)));
+		ge_f0 = _mm256_andnot_si256(ascii, _mm256_cmpgt_epi8(v, _mm256_set1_epi8(-17)));
+		bad = _mm256_andnot_si256(ascii, _mm256_cmpgt_epi8(v, _mm256_set1_epi8(-13)));
+		l2 = _mm256_andnot_si256(bad, ge_c0);
+		l3 = _mm256_andnot_si256(bad, ge_e0);
+		l4 = _mm256_andnot_si256(bad, ge_f0);
+
+		/* byte shifts across the two lanes: alignr against [0, low lane] */
+		in = _mm256_or_si256(
+			_mm256_alignr_epi8(l2, _mm256_permute2x128_si256(l2, l2, 0x08), 15),
+			_mm256_or_si256(
+			_mm256_alignr_epi8(l3, _mm256_permute2x128_si256(l3, l3, 0x08), 14),
+			_mm256_alignr_epi8(l4, _mm256_permute2x128_si256(l4, l4, 0x08), 13)));
+		lead = _mm256_movemask_epi8(_mm256_or_si256(ascii, l2));
+		inside = _mm256_movemask_epi8(in);
+	}
+};
+
+UTF8_KERNEL(avx2, _avx2_t, UTF8_AVX2_TARGET)
+#endif
+
+const utf8_simd::kernel_t *utf8_simd::_select()
+{
+	const char *want = getenv("BAMBOO_UTF8_KERNEL");
+
+	/* BAMBOO_UTF8_KERNEL=scalar or sse2 caps the choice, for comparisons */
+	if (want && strcmp(want, "scalar") == 0) return NULL;
+#ifdef UTF8_AVX2
+	__builtin_cpu_init();
+	if (!(want && strcmp(want, "sse2") == 0)
+			&& __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt"))
+		return &_kernel_avx2;
+#endif
+#ifdef UTF8_SSE2
+	return &_kernel_sse2;
+#else
+	return NULL;
+#endif
+}
+
+const char *utf8::kernel()
+{
+	const utf8_simd::kernel_t *k = utf8_simd::get();
+
+	return (k)?k->name:"scalar";
+}
+
+int utf8::locate(const char *s, size_t start)
+{
+	const unsigned char *p = (const unsigned char *)s;
+	const utf8_simd::kernel_t *k = utf8_simd::get();
+	size_t i = 0, j = 0, n, end;
+	int m;
+
+	if (s == NULL) return 0;
+	n = strlen(s);
+	for (end = 0; j < start && i < n;) {
+		if (k && i >= end) {
+			k->locate(p, n, i, j, start);
+			end = i + k->width;
+		}
+		m = utf8_simd::step(p, i);
+		if (m > 0) {
+			i += m;
+			j++;
+		} else {
+			++i;
+		}
+	}
+	return (i < n)?i:n;
+}
+
+int utf8::check(const char *s)
+{
+	const unsigned char *p = (const unsigned char *)s;
+	const utf8_simd::kernel_t *k = utf8_simd::get();
+	size_t i = 0, n, end;
+	int m;
+
+	if (s == NULL) return 0;
+	n = strlen(s);
+	for (end = 0; i < n;) {
+		if (k && i >= end) {
+			if (!k->check(p, n, i)) return -1;
+			if (i >= n) break;
+			end = i + k->width;
+		}
+		m = utf8_simd::step(p, i);
+		if (m <= 0) return -1;
+		i += m;
+	}
+	return 0;
+}
+
+int utf8::index(const char *s, size_t *index)
+{
+	const unsigned char *p = (const unsigned char *)s;
+	const utf8_simd::kernel_t *k = utf8_simd::get();
+	size_t i = 0, j = 0, n, end;
+	int m;
+
+	if (s == NULL) return 0;
+	n = strlen(s);
+	for (end = 0; i < n;) {
+		if (k && i >= end) {
+			k->index(p, n, i, j, index);
+			if (i >= n) break;
+			end = i + k->width;
+		}
+		index[j++] = i;
+		m = utf8_simd::step(p, i);
+		i += (m > 0)?m:1;
+	}
+	return j;
+}
+
+size_t utf8::length(const char *s)
+{
+	const unsigned char *p = (const unsigned char *)s;
+	const utf8_simd::kernel_t *k = utf8_simd::get();
+	size_t i = 0, j = 0, n, end;
+	int m;
+
+	if (s == NULL) return 0;
+	n = strlen(s);
+	for (end = 0; i < n;) {
+		/* the byte walk takes a block the kernel stopped at */
+		if (k && i >= end) {
+			k->length(p, n, i, j);
+			if (i >= n) break;
+			end = i + k->width;
+		}
+		m = utf8_simd::step(p, i);
+		if (m > 0) {
+			i += m;
+			++j;
+		} else {
+			++i;
+		}
+	}
+	return j;
+}
+
+} //namespace bamboo
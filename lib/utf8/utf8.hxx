@@ -37,6 +37,7 @@ namespace bamboo {
 
 
 class utf8 {
+	friend class utf8_simd;
 protected:
 	static const char _map[], _map_ignore[];
 public:
@@ -49,36 +50,20 @@ public:
 		return i;
 	}
 
-	static int locate(const char *s, size_t start)
-	{
-		size_t i, j;
-
-		if (s == NULL) return 0; 
-		for (i = 0, j = 0; j < start && s[i];) {
-			if (_map[(unsigned char)s[i]] > 0) {
-				i += _map[(unsigned char)s[i]];
-				j++;
-			} else { 
-				++i;
-			}
-		}
-		return i;
-	}
-
-	static int check(const char *s)
-	{
-		size_t i;
-
-		if (s == NULL) return 0; 
-		for (i = 0; s[i];) {
-			if (_map[(unsigned char)s[i]] > 0) {
-				i += _map[(unsigned char)s[i]];
-			} else { 
-				return -1;
-			}
-		}
-		return 0;
-	}
+	/*
+	 * The walks below skip the bytes following a lead byte whatever they
+	 * are, as first() does. They run on blocks of 16 or 32 bytes with
+	 * SSE2 or AVX2 when the CPU has them, falling back to the byte walk
+	 * where a block does not decode cleanly, and stop at the terminating
+	 * NUL even when the last character is truncated.
+	 */
+	static int locate(const char *s, size_t start);
+	static int check(const char *s);
+	static int index(const char *s, size_t *index);
+	static size_t length(const char *s);
+
+	/* the kernel in use: "avx2", "sse2" or "scalar" */
+	static const char *kernel();
 
 	static int strstr(const char *haystack, const char *needle)
 	{
@@ -94,40 +79,6 @@ public:
 		return -1;
 	}
 
-	static int index(const char *s, size_t *index)
-	{
-		size_t i, j;
-
-		if (s == NULL) return 0; 
-		for (i = 0, j = 0; s[i];) {
-			index[j++] = i;
-			if (_map[(unsigned char)s[i]] > 0) {
-				i += _map[(unsigned char)s[i]];
-			} else { 
-				++i;
-				continue;
-			}
-		}
-		return j;
-	}
-
-	static size_t length(const char *s)
-	{
-		size_t i, j;
-
-		if (s == NULL) return 0; 
-		for (i = 0, j = 0; s[i];) {
-			if (_map[(unsigned char)s[i]] > 0) {
-				i += _map[(unsigned char)s[i]];
-				++j;
-			} else { 
-				++i;
-				continue;
-			}
-		}
-		return j;
-	}
-
 	static size_t sub(char *t, const char *s, size_t start, size_t length)
 	{
 		register size_t i;
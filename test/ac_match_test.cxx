@@ -0,0 +1,113 @@
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "parser_fixture.hxx"
+using namespace bamboo;
+
+static bool _expect(Parser *parser, const char *text, const char *expect) {
+	std::string got = ParserFixture::parse(parser, text);
+
+	if (got != expect) {
+		fprintf(stderr, "%s\n  gives  %s\n  not    %s\n", text, got.c_str(), expect);
+		return false;
+	}
+	return true;
+}
+
+/* the longest phrase leftmost wins, on token boundaries only */
+bool test_merge(ParserFixture &fixture) {
+	Parser *parser;
+	bool ok = true;
+
+	parser = fixture.parser(fixture.config("merge.conf", "prepare, ac_match", "prepare_characterize = 1"));
+	ok = ok && _expect(parser, "北京天安门", "北京天安门");
+	ok = ok && _expect(parser, "北京大学", "北京 大 学");
+	ok = ok && _expect(parser, "天气很好人", "天气很好 人");
+	ok = ok && _expect(parser, "很好人", "很 好人");
+	ok = ok && _expect(parser, "天安门", "天 安 门");
+	delete parser;
+
+	parser = fixture.parser(fixture.config("merge_ugm.conf", "prepare, ugm_seg, single_combine, ac_match"));
+	ok = ok && _expect(parser, fixture_text[0], "我 爱 北京天安门 ， 中华人民共和国 万岁 ！");
+	ok = ok && _expect(parser, fixture_text[1], "今天 天气很好 ， 北京大学 学生生活 。 3个 月");
+	ok = ok && _expect(parser, fixture_text[2], "Hello world 123 abc - def 　 ＡＢＣ");
+	delete parser;
+	return ok;
+}
+
+bool test_tag(ParserFixture &fixture) {
+	Parser *parser;
+	bool ok = true;
+
+	parser = fixture.parser(fixture.config("tag.conf", "prepare, ugm_seg, single_combine, ac_match",
+		"ac_match_mode = tag\nac_match_pos = nz"));
+	ok = ok && _expect(parser, fixture_text[0], "我 爱 北京/nz 天安门/nz ， 中华人民共和国 万/nz 岁/nz ！");
+	ok = ok && _expect(parser, fixture_text[1], "今天 天气/nz 很好/nz ， 北京大学 学生/nz 生活/nz 。 3个 月");
+	delete parser;
+	return ok;
+}
+
+static bool _before(const ACAutomaton::match_t &a, const ACAutomaton::match_t &b) {
+	if (a.begin != b.begin) return a.begin < b.begin;
+	return a.end < b.end;
+}
+
+static unsigned int g_seed = 1;
+
+static unsigned int _rand(unsigned int n) {
+	g_seed = g_seed * 1664525u + 1013904223u;
+	return (g_seed >> 8) % n;
+}
+
+/* every occurrence of every phrase, against a search for each one */
+bool test_automaton(ParserFixture &fixture) {
+	static const char *pieces[] = {"北", "京", "天", "安", "门", "万", "岁", "好", "人", "很", "a", "\xe4"};
+	std::vector<ACAutomaton::match_t> got, expect;
+	ACAutomaton automaton(fixture.path("phrase.idx").c_str());
+	ACAutomaton::match_t m;
+	std::string text, key;
+	size_t i, j, n, pos;
+
+	if (!automaton.mapped()) return false;
+	for (i = 0; i < 2000; i++) {
+		text.clear();
+		for (n = _rand(40), j = 0; j < n; j++) text += pieces[_rand(sizeof(pieces) / sizeof(pieces[0]))];
+		got.clear();
+		automaton.match(text.data(), text.size(), got);
+		expect.clear();
+		for (j = 0; fixture_phrase[j]; j++) {
+			key = strchr(fixture_phrase[j], ' ') + 1;
+			for (pos = text.find(key); pos != std::string::npos; pos = text.find(key, pos + 1)) {
+				m.begin = pos;
+				m.end = pos + key.size();
+				m.value = atoi(fixture_phrase[j]);
+				expect.push_back(m);
+			}
+		}
+		for (j = 1; j < got.size(); j++) {
+			if (got[j].end < got[j - 1].end) return false;
+		}
+		std::sort(got.begin(), got.end(), _before);
+		std::sort(expect.begin(), expect.end(), _before);
+		if (got.size() != expect.size()) {
+			fprintf(stderr, "%s: %zu matches, not %zu\n", text.c_str(), got.size(), expect.size());
+			return false;
+		}
+		for (j = 0; j < got.size(); j++) {
+			if (got[j].begin != expect[j].begin || got[j].end != expect[j].end
+				|| got[j].value != expect[j].value) return false;
+		}
+	}
+	return true;
+}
+
+int main() {
+	ParserFixture fixture;
+
+	if (!test_automaton(fixture)) return EXIT_FAILURE;
+	if (!test_merge(fixture)) return EXIT_FAILURE;
+	if (!test_tag(fixture)) return EXIT_FAILURE;
+	return EXIT_SUCCESS;
+}
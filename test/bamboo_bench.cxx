@@ -0,0 +1,379 @@
+/*
+ * Copyright (c) 2008, detrox@gmail.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <organization> nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY detrox@gmail.com ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL detrox@gmail.com BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+/*
+ * End-to-end benchmark of every parser over a generated corpus, for
+ * comparing runs across commits. The corpus is a deterministic function
+ * of the seed and scale. Each parser runs in a child process of its own,
+ * so that its peak RSS is its own and a parser failing to load does not
+ * stop the others. Results go to stdout as JSON.
+ */
+
+#include <sys/types.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "bamboo.hxx"
+#include "bench_corpus.hxx"
+
+static const char *g_all_parsers[] = {
+	"ugm_seg", "mfm_seg", "crf_seg", "crf_pos",
+	"crf_ner_nr", "crf_ner_ns", "crf_ner_nt", "crf_ner_np", "keyword"
+};
+
+static double _now()
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static size_t _rss_kb()
+{
+	FILE *fp;
+	unsigned long size, resident = 0;
+
+	fp = fopen("/proc/self/statm", "r");
+	if (fp == NULL) return 0;
+	if (fscanf(fp, "%lu %lu", &size, &resident) != 2) resident = 0;
+	fclose(fp);
+	return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+static size_t _peak_rss_kb()
+{
+	struct rusage usage;
+
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_maxrss;
+}
+
+static std::string _json_string(const char *s)
+{
+	std::string out("\"");
+	char buf[8];
+
+	for (; *s; s++) {
+		if (*s == '"' || *s == '\\') {
+			out += '\\';
+			out += *s;
+		} else if ((unsigned char)*s < 0x20) {
+			snprintf(buf, sizeof(buf), "\\u%04x", *s);
+			out += buf;
+		} else {
+			out += *s;
+		}
+	}
+	return out + "\"";
+}
+
+static double _percentile(std::vector<double> &v, double pct)
+{
+	size_t i;
+
+	if (v.empty()) return 0;
+	i = (size_t)(pct / 100 * (v.size() - 1) + 0.5);
+	std::nth_element(v.begin(), v.begin() + i, v.end());
+	return v[i];
+}
+
+static void _throughput(std::ostream &os, size_t docs, size_t bytes, size_t tokens,
+		double seconds, std::vector<double> &latencies)
+{
+	char buf[512];
+
+	if (seconds <= 0) seconds = 1e-9;
+	snprintf(buf, sizeof(buf),
+			"{\"docs\": %lu, \"bytes\": %lu, \"tokens\": %lu, \"seconds\": %.6f, "
+			"\"mb_per_s\": %.3f, \"tokens_per_s\": %.1f, \"p50_us\": %.1f, \"p99_us\": %.1f}",
+			(unsigned long)docs, (unsigned long)bytes, (unsigned long)tokens, seconds,
+			bytes / seconds / 1048576, tokens / seconds,
+			_percentile(latencies, 50) * 1e6, _percentile(latencies, 99) * 1e6);
+	os << buf;
+}
+
+static size_t g_batch_tokens;
+
+static void _on_batch_result(size_t i, std::vector<bamboo::Token *> &tokens, void *arg)
+{
+	size_t j;
+
+	__sync_fetch_and_add(&g_batch_tokens, tokens.size());
+	for (j = 0; j < tokens.size(); j++)
+		delete tokens[j];
+}
+
+/* benchmarks one parser in the calling process, writes its JSON to os */
+static void _bench_parser(std::ostream &os, const char *name, const char *cfg,
+		std::vector<category_t> &corpus, std::vector<int> &threads, int rounds)
+{
+	bamboo::ParserFactory *factory;
+	bamboo::Parser *parser;
+	std::vector<bamboo::Token *> tokens;
+	std::vector<double> latencies, all;
+	std::vector<const char *> texts;
+	size_t cat, i, j, ntokens, total_docs = 0, total_bytes = 0, total_tokens = 0;
+	double start, t, seconds, total_seconds = 0, base = 0, load;
+	size_t base_rss;
+	char buf[256];
+	int r;
+
+	base_rss = _rss_kb();
+	start = _now();
+	factory = bamboo::ParserFactory::get_instance();
+	parser = factory->create(name, cfg);
+	if (parser == NULL)
+		throw std::runtime_error(std::string("unknown parser ") + name);
+	load = _now() - start;
+
+	/* warm up caches and the token pool */
+	for (cat = 0; cat < corpus.size(); cat++) {
+		for (i = 0; i < corpus[cat].docs.size() && i < 10; i++) {
+			tokens.clear();
+			parser->setopt(BAMBOO_OPTION_TEXT, corpus[cat].docs[i].c_str());
+			parser->parse(tokens);
+			for (j = 0; j < tokens.size(); j++) delete tokens[j];
+		}
+	}
+
+	os << "\"categories\": {";
+	for (cat = 0; cat < corpus.size(); cat++) {
+		latencies.clear();
+		ntokens = 0;
+		seconds = 0;
+		for (r = 0; r < rounds; r++) {
+			for (i = 0; i < corpus[cat].docs.size(); i++) {
+				tokens.clear();
+				t = _now();
+				parser->setopt(BAMBOO_OPTION_TEXT, corpus[cat].docs[i].c_str());
+				parser->parse(tokens);
+				t = _now() - t;
+				seconds += t;
+				latencies.push_back(t);
+				ntokens += tokens.size();
+				for (j = 0; j < tokens.size(); j++) delete tokens[j];
+			}
+		}
+		os << (cat?", ":"") << "\"" << g_categories[cat] << "\": ";
+		_throughput(os, corpus[cat].docs.size() * rounds, corpus[cat].bytes * rounds,
+				ntokens, seconds, latencies);
+		all.insert(all.end(), latencies.begin(), latencies.end());
+		total_docs += corpus[cat].docs.size() * rounds;
+		total_bytes += corpus[cat].bytes * rounds;
+		total_tokens += ntokens;
+		total_seconds += seconds;
+	}
+	os << "},\n    \"total\": ";
+	_throughput(os, total_docs, total_bytes, total_tokens, total_seconds, all);
+
+	/* the whole corpus through parse_batch on growing pools */
+	for (cat = 0; cat < corpus.size(); cat++)
+		for (i = 0; i < corpus[cat].docs.size(); i++)
+			texts.push_back(corpus[cat].docs[i].c_str());
+	os << ",\n    \"scaling\": [";
+	for (i = 0; i < threads.size(); i++) {
+		parser->setopt(BAMBOO_OPTION_THREADS, &threads[i]);
+		g_batch_tokens = 0;
+		start = _now();
+		for (r = 0; r < rounds; r++)
+			parser->parse_batch(&texts[0], texts.size(), _on_batch_result, NULL);
+		seconds = _now() - start;
+		if (i == 0) base = seconds;
+		snprintf(buf, sizeof(buf),
+				"%s{\"threads\": %d, \"seconds\": %.6f, \"mb_per_s\": %.3f, "
+				"\"tokens_per_s\": %.1f, \"speedup\": %.3f}",
+				i?", ":"", threads[i], seconds, total_bytes / seconds / 1048576,
+				g_batch_tokens / seconds, base / seconds);
+		os << buf;
+	}
+	os << "],\n";
+
+	delete parser;
+	snprintf(buf, sizeof(buf), "    \"load_seconds\": %.6f, \"base_rss_kb\": %lu, \"peak_rss_kb\": %lu",
+			load, (unsigned long)base_rss, (unsigned long)_peak_rss_kb());
+	os << buf;
+}
+
+/* runs _bench_parser in a child process, returns its JSON object */
+static std::string _run_child(const char *name, const char *cfg,
+		std::vector<category_t> &corpus, std::vector<int> &threads, int rounds)
+{
+	std::string out, head;
+	char buf[4096];
+	ssize_t n;
+	int fd[2], status;
+	pid_t pid;
+
+	head = std::string("  {\"parser\": ") + _json_string(name) + ", ";
+	if (pipe(fd) != 0 || (pid = fork()) < 0)
+		return head + "\"status\": \"error\", \"error\": \"can not fork\"}";
+
+	if (pid == 0) {
+		std::ostringstream oss;
+
+		close(fd[0]);
+		try {
+			_bench_parser(oss, name, cfg, corpus, threads, rounds);
+			out = "\"status\": \"ok\",\n    " + oss.str() + "}";
+		} catch (std::exception &e) {
+			out = std::string("\"status\": \"error\", \"error\": ") + _json_string(e.what()) + "}";
+		}
+		if (write(fd[1], out.c_str(), out.size()) < 0) _exit(1);
+		close(fd[1]);
+		_exit(0);
+	}
+
+	close(fd[1]);
+	while ((n = read(fd[0], buf, sizeof(buf))) > 0)
+		out.append(buf, n);
+	close(fd[0]);
+	waitpid(pid, &status, 0);
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != 0 || out.empty()) {
+		snprintf(buf, sizeof(buf), "\"status\": \"error\", \"error\": \"parser process died with status %d\"}", status);
+		return head + buf;
+	}
+	return head + out;
+}
+
+static void _help_message()
+{
+	printf("Usage: bamboo_bench [OPTIONS]\n"
+		   "OPTIONS:\n"
+		   "        -c|--config-dir DIR   read DIR/<parser>.conf, default: search as usual\n"
+		   "        -h|--help             help message\n"
+		   "        -l|--label LABEL      label of this run, e.g. the commit\n"
+		   "        -p|--parser NAME      benchmark only NAME, may be repeated\n"
+		   "        -r|--rounds N         passes over the corpus, default: 1\n"
+		   "        -s|--scale X          corpus size, about X MB, default: 1\n"
+		   "        -S|--seed N           corpus seed\n"
+		   "        -t|--threads N        largest pool of the scaling curve, default: CPUs\n"
+		   "\n"
+		   "Report bugs to detrox@gmail.com\n");
+}
+
+int main(int argc, char *argv[])
+{
+	std::vector<const char *> parsers;
+	std::vector<category_t> corpus;
+	std::vector<int> threads;
+	const char *config_dir = NULL, *label = "";
+	std::string cfg;
+	struct stat st;
+	double scale = 1;
+	unsigned int seed;
+	size_t i, bytes = 0;
+	int c, max_threads, rounds = 1, cpus;
+
+	cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	max_threads = (cpus > 0)?cpus:1;
+	seed = g_seed;
+	while (true) {
+		static struct option long_options[] =
+		{
+			{"config-dir", required_argument, 0, 'c'},
+			{"help", no_argument, 0, 'h'},
+			{"label", required_argument, 0, 'l'},
+			{"parser", required_argument, 0, 'p'},
+			{"rounds", required_argument, 0, 'r'},
+			{"scale", required_argument, 0, 's'},
+			{"seed", required_argument, 0, 'S'},
+			{"threads", required_argument, 0, 't'},
+			{0, 0, 0, 0}
+		};
+		int option_index;
+
+		c = getopt_long(argc, argv, "c:hl:p:r:s:S:t:", long_options, &option_index);
+		if (c == -1) break;
+
+		switch (c) {
+			case 'c': config_dir = optarg; break;
+			case 'h': _help_message(); return 0;
+			case 'l': label = optarg; break;
+			case 'p': parsers.push_back(optarg); break;
+			case 'r': rounds = atoi(optarg); break;
+			case 's': scale = atof(optarg); break;
+			case 'S': seed = strtoul(optarg, NULL, 10); break;
+			case 't': max_threads = atoi(optarg); break;
+			default: _help_message(); return 1;
+		}
+	}
+	if (rounds < 1) rounds = 1;
+	if (max_threads < 1) max_threads = 1;
+	if (parsers.empty())
+		parsers.assign(g_all_parsers, g_all_parsers + sizeof(g_all_parsers) / sizeof(g_all_parsers[0]));
+
+	for (c = 1; c < max_threads; c <<= 1)
+		threads.push_back(c);
+	threads.push_back(max_threads);
+
+	g_seed = seed;
+	_generate(scale, corpus);
+
+	printf("{\"benchmark\": \"bamboo\", ");
+#ifdef PACKAGE_VERSION
+	printf("\"version\": \"%s\", ", PACKAGE_VERSION);
+#endif
+	printf("\"label\": %s, \"seed\": %u, \"scale\": %g, \"rounds\": %d, \"cpus\": %d,\n",
+			_json_string(label).c_str(), seed, scale, rounds, cpus);
+	printf(" \"corpus\": {");
+	for (i = 0; i < corpus.size(); i++) {
+		printf("%s\"%s\": {\"docs\": %lu, \"bytes\": %lu}", i?", ":"", g_categories[i],
+				(unsigned long)corpus[i].docs.size(), (unsigned long)corpus[i].bytes);
+		bytes += corpus[i].bytes;
+	}
+	printf(", \"bytes\": %lu},\n \"parsers\": [\n", (unsigned long)bytes);
+	fflush(stdout);
+
+	for (i = 0; i < parsers.size(); i++) {
+		cfg.clear();
+		if (config_dir) {
+			cfg = std::string(config_dir) + "/" + parsers[i] + ".conf";
+			if (stat(cfg.c_str(), &st) != 0) cfg.clear();
+		}
+		fprintf(stderr, "benchmarking %s ...\n", parsers[i]);
+		printf("%s%s", i?",\n":"", _run_child(parsers[i], cfg.empty()?NULL:cfg.c_str(),
+					corpus, threads, rounds).c_str());
+		fflush(stdout);
+	}
+	printf("\n ]\n}\n");
+
+	return 0;
+}
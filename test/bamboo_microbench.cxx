@@ -0,0 +1,773 @@
+/*
+ * Copyright (c) 2008, detrox@gmail.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <organization> nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY detrox@gmail.com ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL detrox@gmail.com BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+/*
+ * Micro-benchmarks of the hot components below the parsers, so that an
+ * optimisation of one of them can be measured on its own. Every
+ * benchmark times a number of operations per repetition, calibrated to
+ * last at least -m milliseconds, runs -w warmup repetitions and reports
+ * the per operation time over -r measured ones. With -P the cycles and
+ * cache misses of the timed sections are read from perf_event_open(2).
+ */
+
+#include <sys/types.h>
+#include <sys/time.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#include "config_finder.hxx"
+#include "datrie.hxx"
+#include "compact_trie.hxx"
+#include "codepoint_trie.hxx"
+#include "utf8.hxx"
+#include "token_impl.hxx"
+#include "processor_factory.hxx"
+#include "graph_ranker.hxx"
+#include "bench_corpus.hxx"
+
+using namespace bamboo;
+
+/* hardware counters of the timed sections, when the kernel allows them */
+class PerfCounters {
+protected:
+	int _cycles, _misses;
+
+	static int _open(uint32_t type, uint64_t config, int group)
+	{
+#ifdef __linux__
+		struct perf_event_attr attr;
+
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = type;
+		attr.config = config;
+		attr.disabled = (group == -1);
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		return syscall(__NR_perf_event_open, &attr, 0, -1, group, 0);
+#else
+		errno = ENOSYS;
+		return -1;
+#endif
+	}
+
+	static uint64_t _read(int fd)
+	{
+		uint64_t v = 0;
+
+		if (read(fd, &v, sizeof(v)) != sizeof(v)) return 0;
+		return v;
+	}
+public:
+	PerfCounters():_cycles(-1), _misses(-1) {}
+	~PerfCounters()
+	{
+		if (_misses >= 0) close(_misses);
+		if (_cycles >= 0) close(_cycles);
+	}
+
+	void open()
+	{
+#ifdef __linux__
+		_cycles = _open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, -1);
+		if (_cycles >= 0)
+			_misses = _open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, _cycles);
+#endif
+		if (_cycles < 0 || _misses < 0)
+			throw std::runtime_error(std::string("perf_event_open: ") + strerror(errno));
+	}
+
+	bool enabled() {return _cycles >= 0;}
+
+	void start()
+	{
+#ifdef __linux__
+		ioctl(_cycles, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+		ioctl(_cycles, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+	}
+
+	void stop(uint64_t &cycles, uint64_t &misses)
+	{
+#ifdef __linux__
+		ioctl(_cycles, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+#endif
+		cycles += _read(_cycles);
+		misses += _read(_misses);
+	}
+};
+
+/* one repetition: n operations, of which the benchmark times the hot part */
+typedef struct {
+	size_t n;
+	size_t bytes;
+	double usec;
+	uint64_t cycles, misses;
+	double start;
+} rep_t;
+
+typedef void (*bench_fn_t)(rep_t &rep);
+
+static PerfCounters g_perf;
+static volatile size_t g_sink;
+
+static double _now()
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec * 1e6 + tv.tv_usec;
+}
+
+static void _begin(rep_t &rep)
+{
+	if (g_perf.enabled()) g_perf.start();
+	rep.start = _now();
+}
+
+static void _end(rep_t &rep)
+{
+	rep.usec += _now() - rep.start;
+	if (g_perf.enabled()) g_perf.stop(rep.cycles, rep.misses);
+}
+
+/*
+ * Inputs shared by the benchmarks, loaded on first use so that -b runs
+ * only need what the chosen benchmarks do.
+ */
+static const char *g_config_top = NULL;
+static IConfig *g_config = NULL;
+static std::vector<std::string> g_docs;
+static DATrie *g_trie = NULL;
+static CompactTrie *g_compact = NULL;
+static CodePointTrie *g_codepoint = NULL;
+static std::vector<std::string> g_hit_keys, g_miss_keys;
+static Processor *g_prepare = NULL, *g_ugm_seg = NULL, *g_single_combine = NULL;
+static std::vector<std::vector<TokenImpl *> > g_prepared, g_segmented;
+
+static IConfig *_config()
+{
+	if (g_config == NULL)
+		g_config = ConfigFinder::get_instance()->find("ugm_seg.conf", g_config_top);
+	return g_config;
+}
+
+static void _on_key(const char *key, int val, void *arg)
+{
+	std::vector<std::string> *keys = (std::vector<std::string> *)arg;
+
+	if (keys->size() < 65536) keys->push_back(key);
+}
+
+static void _shuffle(std::vector<std::string> &v)
+{
+	size_t i;
+
+	for (i = v.size(); i > 1; i--)
+		std::swap(v[i - 1], v[_rand(i)]);
+}
+
+static void _utf8_char(std::string &s, unsigned int cp)
+{
+	s += (char)(0xE0 | (cp >> 12));
+	s += (char)(0x80 | ((cp >> 6) & 0x3F));
+	s += (char)(0x80 | (cp & 0x3F));
+}
+
+template <class T>
+static void _on_any_key(const char *key, int val, void *arg)
+{
+	((T *)arg)->insert(key, val);
+}
+
+static const char *_unigram(char *magic)
+{
+	const char *filename;
+	FILE *fp;
+
+	_config()->get_value("unigram_lexicon", filename);
+	fp = fopen(filename, "r");
+	if (fp == NULL)
+		throw std::runtime_error(std::string("can not open lexicon ") + filename);
+	fread(magic, 32, 1, fp);
+	fclose(fp);
+	return filename;
+}
+
+/* hits from the trie, and misses sharing a prefix with it or random CJK */
+template <class T>
+static void _keys(T *trie, const char *filename)
+{
+	std::string key;
+	size_t i, n;
+
+	if (!g_hit_keys.empty()) return;
+	trie->explore(_on_key, &g_hit_keys);
+	if (g_hit_keys.empty())
+		throw std::runtime_error(std::string(filename) + " is empty");
+	_shuffle(g_hit_keys);
+
+	n = g_hit_keys.size();
+	for (i = 0; g_miss_keys.size() < n && i < 4 * n; i++) {
+		if (i & 1) {
+			key = g_hit_keys[i % n] + "\xe9\xbe\x98";
+		} else {
+			key.clear();
+			for (size_t j = 0, m = 2 + _rand(3); j < m; j++)
+				_utf8_char(key, 0x4E00 + _rand(0x51A5));
+		}
+		if (trie->search(key.c_str()) == 0)
+			g_miss_keys.push_back(key);
+	}
+}
+
+static DATrie *_trie()
+{
+	const char *filename;
+	char magic[32] = "";
+
+	if (g_trie) return g_trie;
+	filename = _unigram(magic);
+	if (strcmp(magic, "datrie") != 0)
+		throw std::runtime_error(std::string(filename) + " is not a datrie");
+	g_trie = new DATrie(filename);
+	_keys(g_trie, filename);
+	return g_trie;
+}
+
+/* the unigram lexicon in the v2 format, converted in memory from v1 */
+static CompactTrie *_compact()
+{
+	const char *filename;
+	char magic[32] = "";
+
+	if (g_compact) return g_compact;
+	filename = _unigram(magic);
+	if (strcmp(magic, "compact_trie") == 0) {
+		g_compact = new CompactTrie(filename);
+	} else {
+		g_compact = new CompactTrie();
+		_trie()->explore(_on_any_key<CompactTrie>, g_compact);
+		/* build the array now, not in the first timed search */
+		g_compact->search("");
+	}
+	_keys(g_compact, filename);
+	return g_compact;
+}
+
+/* the unigram lexicon with a character alphabet, converted as above */
+static CodePointTrie *_codepoint()
+{
+	const char *filename;
+	char magic[32] = "";
+
+	if (g_codepoint) return g_codepoint;
+	filename = _unigram(magic);
+	if (strcmp(magic, "codepoint_trie") == 0) {
+		g_codepoint = new CodePointTrie(filename);
+	} else {
+		g_codepoint = new CodePointTrie();
+		_trie()->explore(_on_any_key<CodePointTrie>, g_codepoint);
+		g_codepoint->search("");
+	}
+	_keys(g_codepoint, filename);
+	return g_codepoint;
+}
+
+static void _process(Processor *proc, std::vector<TokenImpl *> &in,
+		std::vector<TokenImpl *> &out)
+{
+	out.clear();
+	proc->process(in, out);
+	in.clear();
+}
+
+static void _copy(const std::vector<TokenImpl *> &from, std::vector<TokenImpl *> &to)
+{
+	size_t i;
+
+	to.clear();
+	for (i = 0; i < from.size(); i++)
+		to.push_back(new TokenImpl(*from[i]));
+}
+
+static void _free(std::vector<TokenImpl *> &tokens)
+{
+	size_t i;
+
+	for (i = 0; i < tokens.size(); i++)
+		delete tokens[i];
+	tokens.clear();
+}
+
+/* the processors of the ugm_seg chain, with each stage's input per document */
+static void _chain()
+{
+	ProcessorFactory *factory;
+	std::vector<TokenImpl *> in, out;
+	size_t i;
+
+	if (g_single_combine) return;
+	factory = ProcessorFactory::get_instance();
+	factory->set_config(_config());
+	g_prepare = factory->create("prepare");
+	g_ugm_seg = factory->create("ugm_seg");
+	g_single_combine = factory->create("single_combine");
+
+	g_prepared.resize(g_docs.size());
+	g_segmented.resize(g_docs.size());
+	for (i = 0; i < g_docs.size(); i++) {
+		in.push_back(new TokenImpl(g_docs[i].c_str()));
+		_process(g_prepare, in, out);
+		g_prepared[i] = out;
+		_copy(g_prepared[i], in);
+		_process(g_ugm_seg, in, out);
+		g_segmented[i] = out;
+	}
+}
+
+template <class T>
+static void _search_hit(T *trie, rep_t &rep)
+{
+	size_t i, n, sum = 0;
+
+	n = g_hit_keys.size();
+	_begin(rep);
+	for (i = 0; i < rep.n; i++)
+		sum += trie->search(g_hit_keys[i % n].c_str());
+	_end(rep);
+	g_sink = sum;
+}
+
+template <class T>
+static void _search_miss(T *trie, rep_t &rep)
+{
+	size_t i, n, sum = 0;
+
+	n = g_miss_keys.size();
+	if (n == 0) throw std::runtime_error("no miss keys");
+	_begin(rep);
+	for (i = 0; i < rep.n; i++)
+		sum += trie->search(g_miss_keys[i % n].c_str());
+	_end(rep);
+	g_sink = sum;
+}
+
+template <class T>
+static void _search_mixed(T *trie, rep_t &rep)
+{
+	size_t i, sum = 0;
+
+	if (g_miss_keys.empty()) throw std::runtime_error("no miss keys");
+	_begin(rep);
+	for (i = 0; i < rep.n; i++) {
+		/* one hit in four, as segmenters probing candidate words see */
+		if (i & 3)
+			sum += trie->search(g_miss_keys[i % g_miss_keys.size()].c_str());
+		else
+			sum += trie->search(g_hit_keys[i % g_hit_keys.size()].c_str());
+	}
+	_end(rep);
+	g_sink = sum;
+}
+
+/* the hit keys looked up 256 at a time, as the vocabulary of a document */
+template <class T>
+static void _search_batch(T *trie, rep_t &rep)
+{
+	std::vector<const char *> keys;
+	int values[256];
+	size_t i, j, m, n, sum = 0;
+
+	n = g_hit_keys.size();
+	for (i = 0; i < n; i++)
+		keys.push_back(g_hit_keys[i].c_str());
+	_begin(rep);
+	for (i = 0; i < rep.n; i += m) {
+		m = (rep.n - i < 256)?rep.n - i:256;
+		if (m > n - i % n) m = n - i % n;
+		trie->search_batch(&keys[i % n], m, values);
+		for (j = 0; j < m; j++)
+			sum += values[j];
+	}
+	_end(rep);
+	g_sink = sum;
+}
+
+static void _bench_datrie_hit(rep_t &rep) {_search_hit(_trie(), rep);}
+static void _bench_datrie_miss(rep_t &rep) {_search_miss(_trie(), rep);}
+static void _bench_datrie_mixed(rep_t &rep) {_search_mixed(_trie(), rep);}
+static void _bench_datrie_batch(rep_t &rep) {_search_batch(_trie(), rep);}
+static void _bench_compact_hit(rep_t &rep) {_search_hit(_compact(), rep);}
+static void _bench_compact_miss(rep_t &rep) {_search_miss(_compact(), rep);}
+static void _bench_compact_mixed(rep_t &rep) {_search_mixed(_compact(), rep);}
+static void _bench_compact_batch(rep_t &rep) {_search_batch(_compact(), rep);}
+static void _bench_codepoint_hit(rep_t &rep) {_search_hit(_codepoint(), rep);}
+static void _bench_codepoint_miss(rep_t &rep) {_search_miss(_codepoint(), rep);}
+static void _bench_codepoint_mixed(rep_t &rep) {_search_mixed(_codepoint(), rep);}
+static void _bench_codepoint_batch(rep_t &rep) {_search_batch(_codepoint(), rep);}
+
+static void _bench_utf8_length(rep_t &rep)
+{
+	size_t i, n = g_docs.size(), sum = 0;
+
+	_begin(rep);
+	for (i = 0; i < rep.n; i++)
+		sum += utf8::length(g_docs[i % n].c_str());
+	_end(rep);
+	for (i = 0; i < rep.n; i++)
+		rep.bytes += g_docs[i % n].size();
+	g_sink = sum;
+}
+
+static void _bench_utf8_sub(rep_t &rep)
+{
+	std::vector<size_t> start(g_docs.size());
+	size_t i, n = g_docs.size(), sum = 0;
+	char buf[64];
+
+	for (i = 0; i < n; i++) {
+		start[i] = utf8::length(g_docs[i].c_str());
+		start[i] = (start[i] > 4)?_rand(start[i] - 4):0;
+	}
+	_begin(rep);
+	for (i = 0; i < rep.n; i++)
+		sum += utf8::sub(buf, g_docs[i % n].c_str(), start[i % n], 4);
+	_end(rep);
+	g_sink = sum;
+}
+
+static void _bench_utf8_first(rep_t &rep)
+{
+	size_t i, n = g_docs.size(), sum = 0, doc = 0;
+	const char *s = g_docs[0].c_str();
+	char buf[8];
+
+	_begin(rep);
+	for (i = 0; i < rep.n; i++) {
+		if (*s == '\0') s = g_docs[++doc % n].c_str();
+		s += utf8::first(s, buf);
+		sum += buf[0];
+	}
+	_end(rep);
+	g_sink = sum;
+}
+
+/* one operation is one document through the processor */
+static void _bench_processor(rep_t &rep, Processor *proc,
+		std::vector<std::vector<TokenImpl *> > *input)
+{
+	std::vector<std::vector<TokenImpl *> > in(rep.n), out(rep.n);
+	size_t i, n = g_docs.size();
+
+	for (i = 0; i < rep.n; i++) {
+		if (input)
+			_copy((*input)[i % n], in[i]);
+		else
+			in[i].push_back(new TokenImpl(g_docs[i % n].c_str()));
+		rep.bytes += g_docs[i % n].size();
+	}
+	_begin(rep);
+	for (i = 0; i < rep.n; i++)
+		proc->process(in[i], out[i]);
+	_end(rep);
+	/* process() has consumed the input tokens */
+	for (i = 0; i < rep.n; i++)
+		_free(out[i]);
+}
+
+static void _bench_prepare(rep_t &rep)
+{
+	_chain();
+	_bench_processor(rep, g_prepare, NULL);
+}
+
+static void _bench_ugm_seg(rep_t &rep)
+{
+	_chain();
+	_bench_processor(rep, g_ugm_seg, &g_prepared);
+}
+
+static void _bench_single_combine(rep_t &rep)
+{
+	_chain();
+	_bench_processor(rep, g_single_combine, &g_segmented);
+}
+
+/*
+ * Documents for the graph ranker, drawn from a Zipf-like vocabulary the
+ * way the text parser would index them. No token affinity dictionary is
+ * loaded, so TokenAffDict::get_aff() answers 0 and the time is that of
+ * the graph and the iterations themselves.
+ */
+static kea::YCDoc *_ranker_doc(std::vector<std::string> &vocab, std::map<int, double> &rank)
+{
+	kea::YCDoc *doc = new kea::YCDoc();
+	kea::YCSentence *sent;
+	kea::YCToken *token;
+	size_t i, j, sentences, words;
+	int id;
+
+	for (i = 0, sentences = 20 + _rand(40); i < sentences; i++) {
+		sent = new kea::YCSentence();
+		for (j = 0, words = 5 + _rand(15); j < words; j++) {
+			id = _rand(_rand(vocab.size()) + 1);
+			token = new kea::YCToken();
+			token->set_token(vocab[id].c_str());
+			token->set_id(id);
+			sent->token_list.push_back(token);
+			sent->token_id_list[id]++;
+			doc->token_id_map[id] = token->get_token();
+			rank[id] = 1.0;
+		}
+		doc->sent_list.push_back(sent);
+	}
+	return doc;
+}
+
+static void _bench_graph_ranker(rep_t &rep)
+{
+	static kea::GraphRanker *ranker = NULL;
+	static std::vector<std::string> vocab;
+	std::vector<kea::YCDoc *> docs(rep.n);
+	std::vector<std::map<int, double> > ranks(rep.n);
+	SimpleConfig config;
+	size_t i;
+
+	if (ranker == NULL) {
+		config << "ke_wordrank_eta = 0.00015" << "ke_wordrank_alpha = 0.7"
+			<< "ke_wordrank_beta = 0.3" << "ke_wordrank_maxiter = 5";
+		ranker = new kea::GraphRanker(&config);
+		_split(g_words, vocab);
+	}
+	for (i = 0; i < rep.n; i++)
+		docs[i] = _ranker_doc(vocab, ranks[i]);
+	_begin(rep);
+	for (i = 0; i < rep.n; i++)
+		ranker->rank(*docs[i], ranks[i], 10);
+	_end(rep);
+	for (i = 0; i < rep.n; i++)
+		delete docs[i];
+}
+
+static const struct {
+	const char *name;
+	bench_fn_t fn;
+} g_benches[] = {
+	{"datrie.search.hit", _bench_datrie_hit},
+	{"datrie.search.miss", _bench_datrie_miss},
+	{"datrie.search.mixed", _bench_datrie_mixed},
+	{"datrie.search.batch", _bench_datrie_batch},
+	{"compact_trie.search.hit", _bench_compact_hit},
+	{"compact_trie.search.miss", _bench_compact_miss},
+	{"compact_trie.search.mixed", _bench_compact_mixed},
+	{"compact_trie.search.batch", _bench_compact_batch},
+	{"codepoint_trie.search.hit", _bench_codepoint_hit},
+	{"codepoint_trie.search.miss", _bench_codepoint_miss},
+	{"codepoint_trie.search.mixed", _bench_codepoint_mixed},
+	{"codepoint_trie.search.batch", _bench_codepoint_batch},
+	{"utf8.length", _bench_utf8_length},
+	{"utf8.sub", _bench_utf8_sub},
+	{"utf8.first", _bench_utf8_first},
+	{"processor.prepare", _bench_prepare},
+	{"processor.ugm_seg", _bench_ugm_seg},
+	{"processor.single_combine", _bench_single_combine},
+	{"kea.graph_ranker.rank", _bench_graph_ranker},
+};
+static const size_t g_num_benches = sizeof(g_benches) / sizeof(g_benches[0]);
+
+static void _rep(bench_fn_t fn, size_t n, rep_t &rep)
+{
+	memset(&rep, 0, sizeof(rep));
+	rep.n = n;
+	fn(rep);
+}
+
+/* the per operation times of the measured repetitions */
+static void _summary(const char *name, size_t n, std::vector<rep_t> &reps)
+{
+	std::vector<double> ns;
+	double mean = 0, var = 0, usec = 0, bytes = 0, cycles = 0, misses = 0, ops;
+	size_t i;
+
+	for (i = 0; i < reps.size(); i++) {
+		ns.push_back(reps[i].usec * 1000 / n);
+		mean += ns.back();
+		usec += reps[i].usec;
+		bytes += reps[i].bytes;
+		cycles += reps[i].cycles;
+		misses += reps[i].misses;
+	}
+	mean /= ns.size();
+	for (i = 0; i < ns.size(); i++)
+		var += (ns[i] - mean) * (ns[i] - mean);
+	if (ns.size() > 1) var /= ns.size() - 1;
+	std::sort(ns.begin(), ns.end());
+	ops = (double)n * reps.size();
+
+	printf("%-26s %10lu %10.1f %10.1f %10.1f %7.1f%% %10.1f",
+			name, (unsigned long)n, ns.front(), ns[ns.size() / 2], mean,
+			(mean > 0)?100 * sqrt(var) / mean:0, ns.back());
+	if (bytes > 0)
+		printf(" %9.1f", bytes / usec);
+	else
+		printf(" %9s", "-");
+	if (g_perf.enabled())
+		printf(" %10.1f %10.2f", cycles / ops, misses / ops);
+	printf("\n");
+	fflush(stdout);
+}
+
+static void _run(size_t b, size_t warmup, size_t rounds, double min_usec)
+{
+	std::vector<rep_t> reps;
+	rep_t rep;
+	size_t i, n;
+
+	try {
+		/* double the operations per repetition until one is long enough */
+		for (n = 1; ; n *= 2) {
+			_rep(g_benches[b].fn, n, rep);
+			if (rep.usec >= min_usec || n >= ((size_t)1 << 30)) break;
+		}
+		for (i = 0; i < warmup; i++)
+			_rep(g_benches[b].fn, n, rep);
+		for (i = 0; i < rounds; i++) {
+			_rep(g_benches[b].fn, n, rep);
+			reps.push_back(rep);
+		}
+	} catch (std::exception &e) {
+		printf("%-26s error: %s\n", g_benches[b].name, e.what());
+		fflush(stdout);
+		return;
+	}
+	_summary(g_benches[b].name, n, reps);
+}
+
+static void _usage()
+{
+	size_t i;
+
+	fprintf(stderr,
+		"usage: bamboo_microbench [options]\n"
+		"  -c, --config=FILE   ugm_seg configuration with the lexicons\n"
+		"  -b, --bench=PREFIX  run the benchmarks starting with PREFIX, repeatable\n"
+		"  -w, --warmup=N      warmup repetitions, default 3\n"
+		"  -r, --rounds=N      measured repetitions, default 15\n"
+		"  -m, --min-ms=N      minimum time of one repetition, default 20\n"
+		"  -s, --scale=X       corpus size, 1.0 is about 1MB, default 0.1\n"
+		"  -S, --seed=N        corpus seed\n"
+		"  -P, --perf          read cycles and cache misses from perf_event_open\n"
+		"  -h, --help          this message\n"
+		"benchmarks:\n");
+	for (i = 0; i < g_num_benches; i++)
+		fprintf(stderr, "  %s\n", g_benches[i].name);
+}
+
+int main(int argc, char **argv)
+{
+	static struct option long_options[] = {
+		{"config", required_argument, NULL, 'c'},
+		{"bench", required_argument, NULL, 'b'},
+		{"warmup", required_argument, NULL, 'w'},
+		{"rounds", required_argument, NULL, 'r'},
+		{"min-ms", required_argument, NULL, 'm'},
+		{"scale", required_argument, NULL, 's'},
+		{"seed", required_argument, NULL, 'S'},
+		{"perf", no_argument, NULL, 'P'},
+		{"help", no_argument, NULL, 'h'},
+		{NULL, 0, NULL, 0}
+	};
+	std::vector<std::string> prefixes;
+	std::vector<category_t> corpus;
+	size_t warmup = 3, rounds = 15, i, j;
+	double scale = 0.1, min_ms = 20;
+	bool perf = false, selected;
+	int c;
+
+	while ((c = getopt_long(argc, argv, "c:b:w:r:m:s:S:Ph", long_options, NULL)) != -1) {
+		switch (c) {
+			case 'c': g_config_top = optarg; break;
+			case 'b': prefixes.push_back(optarg); break;
+			case 'w': warmup = atoi(optarg); break;
+			case 'r': rounds = atoi(optarg); break;
+			case 'm': min_ms = atof(optarg); break;
+			case 's': scale = atof(optarg); break;
+			case 'S': g_seed = strtoul(optarg, NULL, 10); break;
+			case 'P': perf = true; break;
+			default: _usage(); return (c == 'h')?0:1;
+		}
+	}
+	if (rounds < 1) rounds = 1;
+
+	if (perf) {
+		try {
+			g_perf.open();
+		} catch (std::exception &e) {
+			fprintf(stderr, "%s, counting time only\n", e.what());
+		}
+	}
+
+	/* long runs would dominate the per document figures */
+	_generate(scale, corpus);
+	for (i = 0; i < corpus.size(); i++)
+		if (strcmp(g_categories[i], "long_runs") != 0)
+			g_docs.insert(g_docs.end(), corpus[i].docs.begin(), corpus[i].docs.end());
+
+	printf("# utf8 kernel: %s\n", utf8::kernel());
+	printf("%-26s %10s %10s %10s %10s %8s %10s %9s", "benchmark", "ops/rep",
+			"min ns", "median ns", "mean ns", "rsd", "max ns", "MB/s");
+	if (g_perf.enabled())
+		printf(" %10s %10s", "cycles/op", "misses/op");
+	printf("\n");
+
+	for (i = 0; i < g_num_benches; i++) {
+		selected = prefixes.empty();
+		for (j = 0; j < prefixes.size() && !selected; j++)
+			selected = (strncmp(g_benches[i].name, prefixes[j].c_str(), prefixes[j].size()) == 0);
+		if (selected)
+			_run(i, warmup, rounds, min_ms * 1000);
+	}
+
+	return 0;
+}
@@ -0,0 +1,191 @@
+/*
+ * Copyright (c) 2008, detrox@gmail.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <organization> nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY detrox@gmail.com ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL detrox@gmail.com BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#ifndef BENCH_CORPUS_HXX
+#define BENCH_CORPUS_HXX
+
+/*
+ * Deterministic synthetic corpus shared by the benchmarks: the same
+ * seed and scale give the same documents on every platform.
+ */
+
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static const char *g_categories[] = {
+	"queries", "titles", "news", "long_runs", "latin"
+};
+static const size_t g_num_categories = sizeof(g_categories) / sizeof(g_categories[0]);
+
+static const char g_words[] =
+	"我们 他们 今天 明天 北京 上海 广州 深圳 中国 美国 日本 欧洲 政府 企业 公司 "
+	"市场 经济 发展 建设 改革 开放 社会 文化 教育 科技 技术 互联网 手机 电脑 "
+	"软件 网络 用户 服务 产品 价格 销售 增长 下降 提高 记者 报道 表示 认为 "
+	"指出 介绍 会议 召开 举行 活动 项目 投资 银行 股票 基金 房价 汽车 交通 "
+	"天气 气温 大学 学生 老师 医院 医生 健康 体育 比赛 足球 篮球 冠军 球队 "
+	"电影 音乐 演员 导演 新闻 时间 问题 工作 生活 城市 农村 环境 保护 能源 "
+	"的 了 在 是 和 与 对 将 已经 正在 进行 通过 关于 以及 一个 这个 "
+	"中华人民共和国 天安门 长城 黄河 长江 人民币 研究生 计算机 自然语言 处理 分词";
+
+static const char g_latin_words[] =
+	"the of and to in is for on with Apple Google iPhone Windows Linux Android "
+	"USB-C SGM-H108 GPS WiFi 4G LTE CPU GPU Intel AMD Nokia N95 Sony PS3 "
+	"Today I bought a new phone price review download free online version";
+
+/* numerical recipes LCG: the same corpus on every platform */
+static unsigned int g_seed = 20101222;
+
+static unsigned int _rand(unsigned int n)
+{
+	g_seed = g_seed * 1664525u + 1013904223u;
+	return (g_seed >> 8) % n;
+}
+
+static void _split(const char *s, std::vector<std::string> &out)
+{
+	std::istringstream iss(s);
+	std::string w;
+
+	while (iss >> w) out.push_back(w);
+}
+
+static const std::string &_pick(const std::vector<std::string> &v)
+{
+	return v[_rand(v.size())];
+}
+
+static void _number(std::string &s)
+{
+	char buf[64];
+
+	switch (_rand(4)) {
+		case 0: snprintf(buf, sizeof(buf), "%u", _rand(10000)); break;
+		case 1: snprintf(buf, sizeof(buf), "%u.%u%%", _rand(100), _rand(10)); break;
+		case 2: snprintf(buf, sizeof(buf), "%u年%u月%u日", 1990 + _rand(30), 1 + _rand(12), 1 + _rand(28)); break;
+		default: snprintf(buf, sizeof(buf), "%u个", 1 + _rand(99)); break;
+	}
+	s += buf;
+}
+
+static void _sentence(std::string &s, const std::vector<std::string> &zh,
+		const std::vector<std::string> &en, size_t words)
+{
+	size_t i;
+
+	for (i = 0; i < words; i++) {
+		if (i && _rand(7) == 0) s += "，";
+		if (_rand(15) == 0) _number(s);
+		else if (_rand(25) == 0) s += _pick(en);
+		else s += _pick(zh);
+	}
+}
+
+/* one document of category cat */
+static std::string _document(size_t cat, const std::vector<std::string> &zh,
+		const std::vector<std::string> &en)
+{
+	std::string s;
+	size_t i, n;
+
+	switch (cat) {
+	case 0:	/* short search queries */
+		for (i = 0, n = 1 + _rand(4); i < n; i++) {
+			if (i && _rand(3) == 0) s += " ";
+			s += (_rand(8) == 0)?_pick(en):_pick(zh);
+		}
+		break;
+	case 1:	/* titles */
+		_sentence(s, zh, en, 6 + _rand(10));
+		if (_rand(2)) {
+			s += "：";
+			_sentence(s, zh, en, 3 + _rand(6));
+		}
+		break;
+	case 2:	/* news articles of several paragraphs */
+		for (i = 0, n = 5 + _rand(25); i < n; i++) {
+			_sentence(s, zh, en, 8 + _rand(22));
+			s += (_rand(10) == 0)?"！":"。";
+			if (_rand(5) == 0) s += "\n";
+		}
+		break;
+	case 3:	/* long unpunctuated runs, like test/large_token */
+		n = 2000 + _rand(8000);
+		if (_rand(2)) {
+			s = "我爱";
+			s.append(n, 'a' + _rand(26));
+		} else {
+			while (s.size() < n) s += _pick(zh);
+		}
+		break;
+	default: /* Latin heavy, like test/latins */
+		for (i = 0, n = 4 + _rand(12); i < n; i++) {
+			if (i) s += " ";
+			s += _pick(en);
+			if (_rand(6) == 0) {
+				s += "(";
+				_sentence(s, zh, en, 1 + _rand(3));
+				s += ")";
+			}
+		}
+		s += ".";
+		break;
+	}
+
+	return s;
+}
+
+/* per category document counts at scale 1, about 1 MB in all */
+static const size_t g_docs_per_scale[] = {2000, 1000, 250, 25, 1000};
+
+typedef struct {
+	std::vector<std::string> docs;
+	size_t bytes;
+} category_t;
+
+static void _generate(double scale, std::vector<category_t> &corpus)
+{
+	std::vector<std::string> zh, en;
+	size_t cat, i, n;
+
+	_split(g_words, zh);
+	_split(g_latin_words, en);
+	corpus.resize(g_num_categories);
+	for (cat = 0; cat < g_num_categories; cat++) {
+		n = (size_t)(g_docs_per_scale[cat] * scale);
+		if (n < 1) n = 1;
+		corpus[cat].bytes = 0;
+		for (i = 0; i < n; i++) {
+			corpus[cat].docs.push_back(_document(cat, zh, en));
+			corpus[cat].bytes += corpus[cat].docs.back().size();
+		}
+	}
+}
+
+#endif // BENCH_CORPUS_HXX
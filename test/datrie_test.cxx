@@ -0,0 +1,115 @@
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <vector>
+#include "double_array.hxx"
+#include "datrie.hxx"
+using namespace bamboo;
+
+typedef std::map<std::string, int> dict_t;
+
+static unsigned int g_seed = 1;
+
+static unsigned int _rand(unsigned int n) {
+	g_seed = g_seed * 1664525u + 1013904223u;
+	return (g_seed >> 8) % n;
+}
+
+/* CJK words over a few hundred characters with ASCII mixed in, so keys
+ * share prefixes and the states branch over most of the byte alphabet */
+static std::string _random_key() {
+	size_t i, n = 1 + _rand(5);
+	unsigned int cp;
+	std::string s;
+
+	for (i = 0; i < n; i++) {
+		if (_rand(8) == 0) {
+			s += (char)(0x21 + _rand(0x5e));
+			continue;
+		}
+		cp = 0x4e00 + _rand(400) * 13;
+		s += (char)(0xe0 | (cp >> 12));
+		s += (char)(0x80 | ((cp >> 6) & 0x3f));
+		s += (char)(0x80 | (cp & 0x3f));
+	}
+	return s;
+}
+
+static void _random_dict(dict_t &dict, size_t n) {
+	while (dict.size() < n) dict[_random_key()] = 1 + _rand(1000000);
+}
+
+static void _count(const char *key, int val, void *arg) {
+	dict_t *seen = (dict_t *)arg;
+	(*seen)[key] = val;
+}
+
+template<class T>
+static bool _check(T &trie, const dict_t &dict, const char *what) {
+	dict_t::const_iterator it;
+	dict_t seen;
+	std::string absent;
+	int i;
+
+	for (it = dict.begin(); it != dict.end(); ++it) {
+		if ((int)trie.search(it->first.c_str()) != it->second) {
+			fprintf(stderr, "%s: %s gives %d, not %d\n", what, it->first.c_str(),
+				(int)trie.search(it->first.c_str()), it->second);
+			return false;
+		}
+	}
+	for (i = 0; i < 10000; i++) {
+		absent = _random_key() + _random_key();
+		if (dict.find(absent) == dict.end() && trie.search(absent.c_str()) != 0) {
+			fprintf(stderr, "%s: %s is found but never inserted\n", what, absent.c_str());
+			return false;
+		}
+	}
+	trie.explore(_count, &seen);
+	if (seen != dict) {
+		fprintf(stderr, "%s: explore gives %zu keys, not %zu\n", what, seen.size(), dict.size());
+		return false;
+	}
+	return true;
+}
+
+/* inserts one by one in random order, then again from the saved file */
+template<class T>
+bool test_insert(const dict_t &dict, const char *what) {
+	std::vector<dict_t::const_iterator> order;
+	dict_t::const_iterator it;
+	char path[] = "/tmp/datrie_test.XXXXXX";
+	size_t i, j;
+	bool ok;
+	int fd;
+
+	for (it = dict.begin(); it != dict.end(); ++it) order.push_back(it);
+	for (i = order.size(); i > 1; i--) {
+		j = _rand(i);
+		std::swap(order[i - 1], order[j]);
+	}
+	T trie;
+	for (i = 0; i < order.size(); i++) trie.insert(order[i]->first.c_str(), order[i]->second);
+	if (!_check(trie, dict, what)) return false;
+
+	if ((fd = mkstemp(path)) < 0) return false;
+	close(fd);
+	trie.save(path);
+	T mapped(path);
+	ok = _check(mapped, dict, what);
+	unlink(path);
+	return ok;
+}
+
+int main() {
+	dict_t dict;
+
+	_random_dict(dict, 16000);
+	if (!test_insert<DoubleArray>(dict, "double_array")) return EXIT_FAILURE;
+	if (!test_insert<DATrie>(dict, "datrie")) return EXIT_FAILURE;
+	if (!test_insert<DoubleArray64>(dict, "double_array64")) return EXIT_FAILURE;
+	if (!test_insert<DATrie64>(dict, "datrie64")) return EXIT_FAILURE;
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,392 @@
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+#include "lexicon_factory.hxx"
+#include "key_sorter.hxx"
+#include "key_filter.hxx"
+using namespace bamboo;
+
+typedef std::map<std::string, int> dict_t;
+
+static const char *types[] = {"datrie", "double_array", "compact_trie", "codepoint_trie", "succinct", "datrie64", "double_array64", NULL};
+
+static unsigned int g_seed = 1;
+
+static unsigned int _rand(unsigned int n) {
+	g_seed = g_seed * 1664525u + 1013904223u;
+	return (g_seed >> 8) % n;
+}
+
+/* CJK words over a few hundred characters with ASCII mixed in */
+static std::string _random_key() {
+	size_t i, n = 1 + _rand(5);
+	unsigned int cp;
+	std::string s;
+
+	for (i = 0; i < n; i++) {
+		if (_rand(8) == 0) {
+			s += (char)(0x21 + _rand(0x5e));
+			continue;
+		}
+		cp = 0x4e00 + _rand(300) * 17;
+		s += (char)(0xe0 | (cp >> 12));
+		s += (char)(0x80 | ((cp >> 6) & 0x3f));
+		s += (char)(0x80 | (cp & 0x3f));
+	}
+	return s;
+}
+
+static void _collect(const char *key, int val, void *arg) {
+	(*(dict_t *)arg)[key] = val;
+}
+
+/* keys of the dictionary, keys missing from it, and texts starting with either */
+static std::string _random_text(const std::vector<std::string> &keys) {
+	std::string s = (_rand(4) == 0)?_random_key():keys[_rand(keys.size())];
+
+	return (_rand(2) == 0)?s:s + _random_key();
+}
+
+static bool _check_search(ILexicon *lexicon, const dict_t &dict, const std::vector<std::string> &keys,
+		const char *what) {
+	dict_t::const_iterator it;
+	std::string key;
+	size_t i;
+
+	for (it = dict.begin(); it != dict.end(); ++it) {
+		if (lexicon->search(it->first.c_str()) != it->second) {
+			fprintf(stderr, "%s: search of %s gives %d, not %d\n", what, it->first.c_str(),
+				lexicon->search(it->first.c_str()), it->second);
+			return false;
+		}
+	}
+	for (i = 0; i < 5000; i++) {
+		key = _random_text(keys);
+		it = dict.find(key);
+		if (lexicon->search(key.c_str()) != ((it == dict.end())?0:it->second)) {
+			fprintf(stderr, "%s: search of %s\n", what, key.c_str());
+			return false;
+		}
+	}
+	return true;
+}
+
+/* batches of every size up to a few hundred, keys and misses mixed */
+static bool _check_batch(ILexicon *lexicon, const dict_t &dict, const std::vector<std::string> &keys,
+		const char *what) {
+	std::vector<std::string> texts;
+	std::vector<const char *> batch;
+	std::vector<int> values;
+	size_t i, j, n;
+
+	for (i = 0; i < 200; i++) {
+		n = (i < 20)?i:1 + _rand(300);
+		texts.resize(n);
+		batch.resize(n + 1);
+		values.assign(n + 1, -1);
+		for (j = 0; j < n; j++) {
+			texts[j] = _random_text(keys);
+			batch[j] = texts[j].c_str();
+		}
+		lexicon->search_batch(&batch[0], n, &values[0]);
+		for (j = 0; j < n; j++) {
+			dict_t::const_iterator it = dict.find(texts[j]);
+			if (values[j] != ((it == dict.end())?0:it->second)) {
+				fprintf(stderr, "%s: key %zu of a batch of %zu, %s\n", what, j, n, batch[j]);
+				return false;
+			}
+		}
+		if (values[n] != -1) {
+			fprintf(stderr, "%s: a batch of %zu writes past its end\n", what, n);
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool _check_prefix(ILexicon *lexicon, const dict_t &dict, const std::vector<std::string> &keys,
+		const char *what) {
+	std::vector<std::pair<size_t, int> > expect;
+	trie_match_t matches[64];
+	dict_t::const_iterator it;
+	std::string text;
+	size_t i, j, n, size;
+
+	for (i = 0; i < 5000; i++) {
+		text = _random_text(keys);
+		expect.clear();
+		for (j = 1; j <= text.size(); j++) {
+			it = dict.find(text.substr(0, j));
+			if (it != dict.end()) expect.push_back(std::make_pair(j, it->second));
+		}
+		size = (i % 2)?64:1;
+		n = lexicon->common_prefix_search(text.c_str(), text.size(), matches, size);
+		if (n != std::min(size, expect.size())) {
+			fprintf(stderr, "%s: %zu prefixes of %s, not %zu\n", what, n, text.c_str(),
+				std::min(size, expect.size()));
+			return false;
+		}
+		for (j = 0; j < n; j++) {
+			if (matches[j].length != expect[j].first || matches[j].value != expect[j].second) {
+				fprintf(stderr, "%s: prefix %zu of %s\n", what, j, text.c_str());
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+static void _append(const char *key, int val, void *arg) {
+	((std::vector<std::pair<std::string, int> > *)arg)->push_back(std::make_pair(std::string(key), val));
+}
+
+/*
+ * completions of prefixes cut anywhere in a text, even inside a character;
+ * the values must come highest first, and keys of the same value may come
+ * in any order
+ */
+static bool _check_predict(ILexicon *lexicon, const dict_t &dict, const std::vector<std::string> &keys,
+		const char *what) {
+	static const size_t limits[] = {1, 5, 100};
+	std::vector<std::pair<std::string, int> > got;
+	std::vector<int> expect;
+	dict_t::const_iterator it;
+	std::string prefix;
+	size_t i, j, limit;
+
+	for (i = 0; i < 2000; i++) {
+		prefix = _random_text(keys);
+		prefix.resize((i % 100 == 0)?0:1 + _rand(prefix.size()));
+		limit = limits[i % 3];
+		expect.clear();
+		for (it = dict.lower_bound(prefix); it != dict.end()
+				&& it->first.compare(0, prefix.size(), prefix) == 0; ++it)
+			expect.push_back(it->second);
+		std::sort(expect.begin(), expect.end(), std::greater<int>());
+		if (expect.size() > limit) expect.resize(limit);
+
+		got.clear();
+		if (lexicon->predictive_search(prefix.c_str(), limit, _append, &got) != got.size()
+				|| got.size() != expect.size()) {
+			fprintf(stderr, "%s: %zu completions of %s, not %zu\n", what, got.size(), prefix.c_str(),
+				expect.size());
+			return false;
+		}
+		for (j = 0; j < got.size(); j++) {
+			it = dict.find(got[j].first);
+			if (it == dict.end() || it->second != got[j].second || got[j].second != expect[j]
+					|| got[j].first.compare(0, prefix.size(), prefix) != 0
+					|| (j > 0 && got[j].first == got[j - 1].first)) {
+				fprintf(stderr, "%s: completion %zu of %s is %s\n", what, j, prefix.c_str(),
+					got[j].first.c_str());
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+/* a cursor advanced piece by piece stays alive while the bytes read start a key */
+static bool _check_cursor(ILexicon *lexicon, const dict_t &dict, const std::vector<std::string> &keys,
+		const char *what) {
+	ILexicon::Cursor *cursor = lexicon->cursor();
+	dict_t::const_iterator it;
+	std::string text, read;
+	size_t i, j, n;
+	bool alive, expect;
+	bool ok = true;
+
+	for (i = 0; i < 3000 && ok; i++) {
+		text = _random_text(keys);
+		cursor->reset();
+		for (j = 0, alive = true; j < text.size() && ok; j += n) {
+			n = std::min(text.size() - j, (size_t)1 + _rand(4));
+			alive = cursor->advance(text.data() + j, n);
+			/* a character cut mid-piece may keep a code point trie alive */
+			if (alive && j + n < text.size() && (text[j + n] & 0xc0) == 0x80) continue;
+			read = text.substr(0, j + n);
+			it = dict.lower_bound(read);
+			expect = it != dict.end() && it->first.compare(0, read.size(), read) == 0;
+			if (alive != expect) {
+				fprintf(stderr, "%s: cursor over %s is %s\n", what, read.c_str(), alive?"alive":"dead");
+				ok = false;
+			} else if (cursor->value() != ((it != dict.end() && it->first == read)?it->second:0)) {
+				fprintf(stderr, "%s: cursor value at %s\n", what, read.c_str());
+				ok = false;
+			}
+			if (!alive) break;
+		}
+	}
+	delete cursor;
+	return ok;
+}
+
+static bool _check_explore(ILexicon *lexicon, const dict_t &dict, const char *what) {
+	dict_t::const_iterator it;
+	dict_t seen;
+	long long sum = 0;
+	int max = 0, min = 0;
+
+	lexicon->explore(_collect, &seen);
+	if (seen != dict) {
+		fprintf(stderr, "%s: explore gives %zu keys, not %zu\n", what, seen.size(), dict.size());
+		return false;
+	}
+	for (it = dict.begin(); it != dict.end(); ++it) {
+		if (it == dict.begin() || it->second > max) max = it->second;
+		if (it == dict.begin() || it->second < min) min = it->second;
+		sum += it->second;
+	}
+	if (lexicon->num_insert() != (int)dict.size() || lexicon->max_value() != max
+			|| lexicon->min_value() != min || lexicon->sum_value() != (int)sum) {
+		fprintf(stderr, "%s: statistics\n", what);
+		return false;
+	}
+	return true;
+}
+
+static bool _check(ILexicon *lexicon, const dict_t &dict, const std::vector<std::string> &keys,
+		const std::string &what) {
+	return _check_search(lexicon, dict, keys, what.c_str())
+		&& _check_batch(lexicon, dict, keys, what.c_str())
+		&& _check_prefix(lexicon, dict, keys, what.c_str())
+		&& _check_cursor(lexicon, dict, keys, what.c_str())
+		&& _check_predict(lexicon, dict, keys, what.c_str())
+		&& _check_explore(lexicon, dict, what.c_str());
+}
+
+/*
+ * checks lexicon, then again mapped from the file it saves to path, and
+ * mapped with a key filter saved beside it; deletes it
+ */
+static bool _check_saved(ILexicon *lexicon, const char *path, const dict_t &dict,
+		const std::vector<std::string> &keys, const std::string &what) {
+	bool ok;
+
+	ok = _check(lexicon, dict, keys, what);
+	if (ok) lexicon->save(path);
+	delete lexicon;
+	if (!ok) return false;
+	lexicon = LexiconFactory::load(path);
+	ok = _check(lexicon, dict, keys, what + " mapped");
+	if (ok) LexiconFactory::save_filter(lexicon, path, 10);
+	delete lexicon;
+	if (!ok) return false;
+	lexicon = LexiconFactory::load(path);
+	ok = lexicon->has_filter() && _check(lexicon, dict, keys, what + " filtered");
+	if (!lexicon->has_filter()) fprintf(stderr, "%s: the key filter is not loaded\n", what.c_str());
+	delete lexicon;
+	unlink(LexiconFactory::filter_path(path).c_str());
+	return ok;
+}
+
+/*
+ * a filter holds every key inserted, mapped back from its file too, and
+ * rules out most others; one stamped for another index is not loaded
+ */
+bool test_filter(const dict_t &dict, const std::vector<std::string> &keys) {
+	char path[] = "/tmp/lexicon_test.XXXXXX";
+	std::string filter_path;
+	dict_t::const_iterator it;
+	std::string key;
+	ILexicon *lexicon;
+	size_t i, misses, passed;
+	bool ok = true;
+	int fd;
+
+	if ((fd = mkstemp(path)) < 0) return false;
+	close(fd);
+	filter_path = LexiconFactory::filter_path(path);
+	KeyFilter *filter = new KeyFilter(dict.size(), 10);
+	for (it = dict.begin(); it != dict.end(); ++it)
+		filter->insert(it->first.c_str());
+	filter->save(filter_path.c_str());
+	for (i = 0; i < 2 && ok; i++) {
+		for (it = dict.begin(); it != dict.end() && ok; ++it) {
+			if (!filter->contains(it->first.c_str())) {
+				fprintf(stderr, "filter: %s is missing\n", it->first.c_str());
+				ok = false;
+			}
+		}
+		for (misses = passed = 0; misses < 20000 && ok;) {
+			key = _random_text(keys);
+			if (dict.count(key)) continue;
+			misses++;
+			if (filter->contains(key.c_str())) passed++;
+		}
+		if (ok && passed > misses / 20) {
+			fprintf(stderr, "filter: %zu of %zu missing keys pass\n", passed, misses);
+			ok = false;
+		}
+		delete filter;
+		filter = (i == 0)?new KeyFilter(filter_path.c_str()):NULL;
+	}
+	delete filter;
+
+	lexicon = LexiconFactory::create("datrie");
+	for (i = 0; i < keys.size() && ok; i++)
+		lexicon->insert(keys[i].c_str(), dict.find(keys[i])->second);
+	lexicon->save(path);
+	delete lexicon;
+	if (ok) {
+		lexicon = LexiconFactory::load(path);
+		if (lexicon->has_filter()) {
+			fprintf(stderr, "filter: a stale filter is loaded\n");
+			ok = false;
+		}
+		delete lexicon;
+	}
+	unlink(filter_path.c_str());
+	unlink(path);
+	return ok;
+}
+
+/* each type filled by insert(), and by build() from a sorter spilling to disk */
+bool test_types(const dict_t &dict, const std::vector<std::string> &keys) {
+	char path[] = "/tmp/lexicon_test.XXXXXX";
+	ILexicon *lexicon;
+	size_t i, j;
+	bool ok = true;
+	int fd;
+
+	if ((fd = mkstemp(path)) < 0) return false;
+	close(fd);
+	for (i = 0; types[i] && ok; i++) {
+		lexicon = LexiconFactory::create(types[i]);
+		for (j = 0; j < keys.size(); j++)
+			lexicon->insert(keys[j].c_str(), dict.find(keys[j])->second);
+		ok = _check_saved(lexicon, path, dict, keys, std::string(types[i]) + " inserted");
+		if (!ok) break;
+
+		KeySorter sorter(16 << 10);
+		for (j = 0; j < keys.size(); j += 3)
+			sorter.add(keys[j].c_str(), 1);
+		for (j = keys.size(); j > 0; j--)
+			sorter.add(keys[j - 1].c_str(), dict.find(keys[j - 1])->second);
+		lexicon = LexiconFactory::create(types[i]);
+		lexicon->build(sorter);
+		ok = _check_saved(lexicon, path, dict, keys, std::string(types[i]) + " built");
+	}
+	unlink(path);
+	return ok;
+}
+
+int main() {
+	std::vector<std::string> keys;
+	dict_t dict;
+
+	while (dict.size() < 8000) {
+		std::string key = _random_key();
+		if (dict.count(key)) continue;
+		dict[key] = 1 + _rand(100000);
+		keys.push_back(key);
+	}
+	if (!test_filter(dict, keys)) return EXIT_FAILURE;
+	if (!test_types(dict, keys)) return EXIT_FAILURE;
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) 2008, detrox@gmail.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <organization> nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY detrox@gmail.com ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL detrox@gmail.com BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ */
+
+#ifndef PARSER_FIXTURE_HXX
+#define PARSER_FIXTURE_HXX
+
+/*
+ * A temporary root holding small lexicons and custom parser
+ * configurations, so the parser tests run without the trained models
+ * and indices of a release. The CRF processors are left out.
+ */
+
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "datrie.hxx"
+#include "ac_automaton.hxx"
+#include "parser_factory.hxx"
+#include "token.hxx"
+
+/* "VALUE KEY" entries of each lexicon, ended by NULL */
+static const char *fixture_unigram[] = {
+	"100 中华", "80 人民", "120 共和国", "50 中华人民共和国", "300 我", "200 爱",
+	"90 北京", "70 天安门", "40 北京大学", "60 大学", "55 学生", "30 生活",
+	"20 今天", "25 天气", "15 很好", NULL
+};
+static const char *fixture_combine[] = {"10 北京大学", "5 中华人民", NULL};
+static const char *fixture_trailing[] = {"3 个", "3 年", "3 月", NULL};
+static const char *fixture_break[] = {"41 中华人民共和国", NULL};
+static const char *fixture_phrase[] = {
+	"1 北京天安门", "2 学生生活", "4 天气很好", "5 万岁", "6 京天", "7 北京", "8 好人",
+	"0 天安", NULL
+};
+
+static const char *fixture_text[] = {
+	"我爱北京天安门，中华人民共和国万岁！",
+	"今天天气很好，北京大学学生生活。3个月",
+	"Hello world 123 abc-def　ＡＢＣ",
+	"北京大学的学生说：“今天天气很好。”",
+	"２０１０年3月，我爱中华人民共和国",
+	"",
+	"天安门天安门天安门天安门天安门天安门天安门天安门",
+	NULL
+};
+
+class ParserFixture {
+public:
+	std::string root;
+
+	ParserFixture()
+	{
+		char dir[] = "/tmp/bamboo_test.XXXXXX";
+
+		if (mkdtemp(dir) == NULL)
+			throw std::runtime_error("can not create a temporary directory");
+		root = dir;
+		_lexicon("unigram.idx", fixture_unigram);
+		_lexicon("combine.idx", fixture_combine);
+		_lexicon("trailing.idx", fixture_trailing);
+		_lexicon("break.idx", fixture_break);
+		_lexicon("phrase.idx", fixture_phrase);
+		bamboo::ACAutomaton automaton(path("phrase.idx").c_str());
+		automaton.save(_file(bamboo::ACAutomaton::path(path("phrase.idx").c_str())).c_str());
+	}
+
+	~ParserFixture()
+	{
+		size_t i;
+
+		for (i = 0; i < _files.size(); i++) unlink(_files[i].c_str());
+		rmdir(root.c_str());
+	}
+
+	std::string path(const char *name)
+	{
+		return root + "/" + name;
+	}
+
+	/* writes a configuration running chain, extra holds more "key = value" lines */
+	std::string config(const char *name, const char *chain, const char *extra = "")
+	{
+		std::string filename = _file(path(name));
+		FILE *fp = fopen(filename.c_str(), "w");
+
+		if (fp == NULL)
+			throw std::runtime_error("can not write " + filename);
+		fprintf(fp,
+			"root = %s\n"
+			"process_chain = %s\n"
+			"verbose = 0\n"
+			"max_token_length = 8\n"
+			"min_token_length = 1\n"
+			"unigram_lexicon = $root/unigram.idx\n"
+			"maxforward_combination_lexicon = $root/combine.idx\n"
+			"single_combination_lexicon = $root/combine.idx\n"
+			"number_trailing_lexicon = $root/trailing.idx\n"
+			"break_lexicon = $root/break.idx\n"
+			"ac_match_lexicon = $root/phrase.idx\n"
+			"use_single_combine = 1\n"
+			"use_break = 1\n"
+			"combine_koko = 0\n"
+			"combine_forward = 1\n"
+			"combine_backward = 1\n"
+			"combine_neighbor = 1\n"
+			"break_min_length = 5\n"
+			"ele_lambda = 0.5\n"
+			"pipeline_chunk = 0\n"
+			"pipeline_threads = 0\n"
+			"%s\n", root.c_str(), chain, extra);
+		fclose(fp);
+		return filename;
+	}
+
+	bamboo::Parser *parser(const std::string &config)
+	{
+		bamboo::Parser *parser = bamboo::ParserFactory::get_instance()->create("custom", config.c_str());
+
+		if (parser == NULL)
+			throw std::runtime_error("the custom parser can not be found");
+		return parser;
+	}
+
+	/* the tokens as bamboo prints them, "TOKEN/POS" joined by spaces; deletes them */
+	static std::string join(std::vector<bamboo::Token *> &tokens)
+	{
+		std::string s;
+		unsigned short pos;
+		size_t i;
+
+		for (i = 0; i < tokens.size(); i++) {
+			if (i > 0) s += " ";
+			s += tokens[i]->get_orig_token();
+			if ((pos = tokens[i]->get_pos()) != 0) {
+				s += "/";
+				if (pos / 256) s += (char)(pos / 256);
+				if (pos % 256) s += (char)(pos % 256);
+			}
+			delete tokens[i];
+		}
+		tokens.clear();
+		return s;
+	}
+
+	/* parses text alone and joins its tokens */
+	static std::string parse(bamboo::Parser *parser, const char *text)
+	{
+		std::vector<bamboo::Token *> tokens;
+
+		parser->setopt(BAMBOO_OPTION_TEXT, text);
+		parser->parse(tokens);
+		return join(tokens);
+	}
+
+private:
+	std::vector<std::string> _files;
+
+	std::string _file(const std::string &filename)
+	{
+		_files.push_back(filename);
+		return filename;
+	}
+
+	void _lexicon(const char *name, const char **entries)
+	{
+		bamboo::DATrie trie;
+		const char *p;
+
+		for (; *entries; entries++) {
+			p = strchr(*entries, ' ');
+			trie.insert(p + 1, atoi(*entries));
+		}
+		trie.save(_file(path(name)).c_str());
+	}
+};
+
+#endif // PARSER_FIXTURE_HXX
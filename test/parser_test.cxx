@@ -0,0 +1,476 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "parser_fixture.hxx"
+#include "bamboo.hxx"
+#include "lexicon_factory.hxx"
+#include "record_lexicon.hxx"
+#include "stream_parser.hxx"
+#include "token_impl.hxx"
+using namespace bamboo;
+
+static const char *chains[] = {
+	"prepare, ugm_seg, single_combine, break",
+	"prepare, maxforward, maxforward_combine, single_combine",
+	NULL
+};
+
+static unsigned int g_seed = 1;
+
+static unsigned int _rand(unsigned int n) {
+	g_seed = g_seed * 1664525u + 1013904223u;
+	return (g_seed >> 8) % n;
+}
+
+/* the fixture texts, then texts of a few of them glued together */
+static void _texts(std::vector<std::string> &texts, size_t n) {
+	std::string text;
+	size_t i, j;
+
+	for (i = 0; fixture_text[i]; i++) texts.push_back(fixture_text[i]);
+	while (texts.size() < n) {
+		text.clear();
+		for (j = 1 + _rand(5); j > 0; j--) {
+			text += fixture_text[_rand(7)];
+			if (_rand(2)) text += " ";
+		}
+		texts.push_back(text);
+	}
+}
+
+/* parse_batch() and bamboo_parse_batch() give what parsing one text after another gives */
+bool test_batch(ParserFixture &fixture) {
+	static const int threads[] = {1, 4, 0, -1};
+	std::vector<std::vector<Token *> > out;
+	std::vector<std::string> texts, expect;
+	std::vector<const char *> batch;
+	std::vector<char *> results;
+	std::string got;
+	Parser *parser;
+	char *result;
+	size_t i, j, k;
+	bool ok = true;
+
+	_texts(texts, 300);
+	for (i = 0; i < texts.size(); i++) batch.push_back(texts[i].c_str());
+	results.resize(texts.size());
+	for (i = 0; chains[i] && ok; i++) {
+		parser = fixture.parser(fixture.config("batch.conf", chains[i]));
+		expect.clear();
+		for (j = 0; j < texts.size(); j++) expect.push_back(ParserFixture::parse(parser, batch[j]));
+		for (j = 0; threads[j] >= 0 && ok; j++) {
+			parser->setopt(BAMBOO_OPTION_THREADS, &threads[j]);
+			if (parser->parse_batch(&batch[0], batch.size(), out) != 0 || out.size() != batch.size()) {
+				fprintf(stderr, "%s: parse_batch with %d threads fails\n", chains[i], threads[j]);
+				ok = false;
+			}
+			for (k = 0; k < out.size() && ok; k++) {
+				got = ParserFixture::join(out[k]);
+				if (got != expect[k]) {
+					fprintf(stderr, "%s: text %zu of a batch on %d threads\n  gives  %.200s\n  not    %.200s\n",
+						chains[i], k, threads[j], got.c_str(), expect[k].c_str());
+					ok = false;
+				}
+			}
+			for (k = 0; k < out.size(); k++) ParserFixture::join(out[k]);
+
+			if (!ok || bamboo_parse_batch(parser, &batch[0], batch.size(), &results[0]) != 0) {
+				if (ok) fprintf(stderr, "%s: bamboo_parse_batch fails: %s\n", chains[i], bamboo_strerror());
+				ok = false;
+				break;
+			}
+			for (k = 0; k < results.size(); k++) {
+				parser->setopt(BAMBOO_OPTION_TEXT, batch[k]);
+				result = bamboo_parse(parser);
+				if (ok && (result == NULL || strcmp(result, results[k]) != 0)) {
+					fprintf(stderr, "%s: bamboo_parse_batch of text %zu on %d threads\n",
+						chains[i], k, threads[j]);
+					ok = false;
+				}
+				free(result);
+				free(results[k]);
+			}
+		}
+		delete parser;
+	}
+	return ok;
+}
+
+/* a token counting the live ones */
+class LiveToken: public TokenImpl {
+public:
+	static int live;
+
+	LiveToken(const char *s):TokenImpl(s) {live++;}
+	~LiveToken() {live--;}
+};
+
+int LiveToken::live = 0;
+
+/* a parser giving the title and the text as tokens, failing on the text "fail" */
+class TitleParser: public Parser {
+public:
+	int parse(std::vector<Token *> &out) {
+		const char *title = (const char *)getopt(BAMBOO_OPTION_TITLE);
+		const char *text = (const char *)getopt(BAMBOO_OPTION_TEXT);
+
+		if (strcmp(text, "fail") == 0) throw std::runtime_error("parse fails");
+		out.push_back(new LiveToken((title)?title:""));
+		out.push_back(new LiveToken(text));
+		return 2;
+	}
+
+	Parser *spawn() {
+		return new TitleParser();
+	}
+};
+
+/*
+ * the workers of parse_batch(), kept from one batch to the next, parse
+ * with the title set before each; a failing document throws and leaves
+ * no tokens behind
+ */
+bool test_batch_options() {
+	static const char *titles[] = {"first", "second", NULL};
+	static const int threads = 4;
+	std::vector<std::vector<Token *> > out;
+	std::vector<std::string> texts;
+	std::vector<const char *> batch;
+	TitleParser parser;
+	bool ok = true, thrown;
+	size_t i, j, k;
+	char buf[32];
+
+	for (i = 0; i < 200; i++) {
+		snprintf(buf, sizeof(buf), "text %zu", i);
+		texts.push_back(buf);
+	}
+	for (i = 0; i < texts.size(); i++) batch.push_back(texts[i].c_str());
+	parser.setopt(BAMBOO_OPTION_THREADS, &threads);
+	for (i = 0; titles[i] && ok; i++) {
+		parser.setopt(BAMBOO_OPTION_TITLE, titles[i]);
+		parser.parse_batch(&batch[0], batch.size(), out);
+		for (j = 0; j < out.size() && ok; j++) {
+			if (out[j].size() != 2 || strcmp(out[j][0]->get_orig_token(), titles[i]) != 0
+					|| texts[j] != out[j][1]->get_orig_token()) {
+				fprintf(stderr, "text %zu of the batch titled %s\n", j, titles[i]);
+				ok = false;
+			}
+		}
+		for (j = 0; j < out.size(); j++)
+			for (k = 0; k < out[j].size(); k++) delete out[j][k];
+	}
+
+	batch[batch.size() / 2] = "fail";
+	thrown = false;
+	try {
+		parser.parse_batch(&batch[0], batch.size(), out);
+	} catch (std::runtime_error &e) {
+		thrown = true;
+	}
+	if (ok && (!thrown || !out.empty() || LiveToken::live != 0)) {
+		fprintf(stderr, "a failed batch %s, leaving %zu results and %d tokens\n",
+			(thrown)?"throws":"does not throw", out.size(), LiveToken::live);
+		ok = false;
+	}
+	return ok;
+}
+
+/* single_combine with a key filter on its lexicon gives the tokens it gives without */
+bool test_filter(ParserFixture &fixture) {
+	std::vector<std::string> texts, expect;
+	std::string index = fixture.path("combine.idx"), got;
+	ILexicon *lexicon;
+	Parser *parser;
+	size_t i, j;
+	bool ok = true;
+
+	_texts(texts, 100);
+	for (i = 0; chains[i] && ok; i++) {
+		parser = fixture.parser(fixture.config("filter.conf", chains[i]));
+		expect.clear();
+		for (j = 0; j < texts.size(); j++) expect.push_back(ParserFixture::parse(parser, texts[j].c_str()));
+		delete parser;
+
+		lexicon = LexiconFactory::load(index.c_str());
+		LexiconFactory::save_filter(lexicon, index.c_str(), 10);
+		delete lexicon;
+		parser = fixture.parser(fixture.config("filter.conf", chains[i]));
+		lexicon = LexiconFactory::acquire(index.c_str());
+		if (!lexicon->has_filter()) {
+			fprintf(stderr, "%s: the filter of %s is not loaded\n", chains[i], index.c_str());
+			ok = false;
+		}
+		LexiconFactory::release(lexicon);
+		for (j = 0; j < texts.size() && ok; j++) {
+			got = ParserFixture::parse(parser, texts[j].c_str());
+			if (got != expect[j]) {
+				fprintf(stderr, "%s: text %zu with a filter\n  gives  %.200s\n  not    %.200s\n",
+					chains[i], j, got.c_str(), expect[j].c_str());
+				ok = false;
+			}
+		}
+		delete parser;
+		unlink(LexiconFactory::filter_path(index.c_str()).c_str());
+	}
+	return ok;
+}
+
+/* writes "VALUE KEY" entries as a text source of a lexicon */
+static std::string _source(ParserFixture &fixture, const char *name, const char **entries) {
+	std::string filename = fixture.path(name);
+	FILE *fp = fopen(filename.c_str(), "w");
+
+	for (; *entries; entries++) fprintf(fp, "%s\n", *entries);
+	fclose(fp);
+	return filename;
+}
+
+/*
+ * a chain reading fields of one record lexicon, each processor taking
+ * the records the ones before kept on the tokens, gives what the
+ * lexicons of each field give
+ */
+bool test_records(ParserFixture &fixture) {
+	static const char *extra =
+		"unigram_lexicon = $root/records.rec:freq\n"
+		"maxforward_combination_lexicon = $root/records.rec:combine\n"
+		"single_combination_lexicon = $root/records.rec:combine\n"
+		"number_trailing_lexicon = $root/records.rec:trailing\n"
+		"break_lexicon = $root/records.rec:break";
+	std::string index = fixture.path("records.rec"), expect, got;
+	std::vector<std::string> texts, sources;
+	RecordLexiconBuilder builder;
+	Parser *parser, *records;
+	size_t i, j;
+	bool ok = true;
+
+	sources.push_back(_source(fixture, "unigram.txt", fixture_unigram));
+	sources.push_back(_source(fixture, "combine.txt", fixture_combine));
+	sources.push_back(_source(fixture, "trailing.txt", fixture_trailing));
+	sources.push_back(_source(fixture, "break.txt", fixture_break));
+	builder.add(RecordLexicon::field_freq, sources[0].c_str(), false);
+	builder.add(RecordLexicon::field_combine, sources[1].c_str(), false);
+	builder.add(RecordLexicon::field_trailing, sources[2].c_str(), false);
+	builder.add(RecordLexicon::field_break, sources[3].c_str(), false);
+	builder.save(index.c_str(), "datrie", 1 << 20, false);
+
+	_texts(texts, 100);
+	for (i = 0; chains[i] && ok; i++) {
+		parser = fixture.parser(fixture.config("lexicons.conf", chains[i]));
+		records = fixture.parser(fixture.config("records.conf", chains[i], extra));
+		for (j = 0; j < texts.size() && ok; j++) {
+			expect = ParserFixture::parse(parser, texts[j].c_str());
+			got = ParserFixture::parse(records, texts[j].c_str());
+			if (got != expect) {
+				fprintf(stderr, "%s: text %zu with a record lexicon\n  gives  %.200s\n  not    %.200s\n",
+					chains[i], j, got.c_str(), expect.c_str());
+				ok = false;
+			}
+		}
+		delete parser;
+		delete records;
+	}
+	for (i = 0; i < sources.size(); i++) unlink(sources[i].c_str());
+	unlink(index.c_str());
+	unlink(RecordLexicon::keys_path(index.c_str()).c_str());
+	return ok;
+}
+
+/* characters in s[0, n) */
+static size_t _chars(const char *s, size_t n) {
+	size_t i, chars = 0;
+
+	for (i = 0; i < n; i++) {
+		if ((s[i] & 0xc0) != 0x80) chars++;
+	}
+	return chars;
+}
+
+/*
+ * bamboo_parse_spans() of a text with no NUL after it: a span for each
+ * token parse() gives, cut from the text at its byte and character
+ * offsets, in order; a short out gets the head of them
+ */
+bool test_spans(ParserFixture &fixture) {
+	std::vector<std::string> texts;
+	std::vector<bamboo_span_t> spans;
+	std::vector<Token *> tokens;
+	std::string text, got;
+	const bamboo_span_t *span;
+	Parser *parser;
+	size_t i, j, k, end;
+	ssize_t n;
+	bool ok = true;
+
+	_texts(texts, 100);
+	for (i = 0; chains[i] && ok; i++) {
+		parser = fixture.parser(fixture.config("spans.conf", chains[i]));
+		for (j = 0; j < texts.size() && ok; j++) {
+			parser->setopt(BAMBOO_OPTION_TEXT, texts[j].c_str());
+			parser->parse(tokens);
+			text = texts[j] + "天安门 junk";
+			spans.assign(tokens.size() + 1, bamboo_span_t());
+			n = bamboo_parse_spans(parser, text.data(), texts[j].size(), &spans[0], spans.size());
+			if (n != (ssize_t)tokens.size()) {
+				fprintf(stderr, "%s: %zd spans of text %zu, not %zu\n", chains[i], n, j, tokens.size());
+				ok = false;
+			}
+			for (k = 0, end = 0; k < tokens.size() && ok; k++) {
+				span = &spans[k];
+				got = text.substr(span->offset, span->length);
+				if (span->offset < end || span->offset + span->length > texts[j].size()
+						|| got != tokens[k]->get_orig_token() || span->pos != tokens[k]->get_pos()
+						|| span->char_offset != _chars(text.data(), span->offset)
+						|| span->char_length != _chars(got.data(), got.size())) {
+					fprintf(stderr, "%s: span %zu of text %zu is %s, not %s\n", chains[i], k, j,
+						got.c_str(), tokens[k]->get_orig_token());
+					ok = false;
+				}
+				end = span->offset + span->length;
+			}
+			if (ok && tokens.size() > 1) {
+				spans.assign(tokens.size(), bamboo_span_t());
+				spans[1].length = 12345;
+				n = bamboo_parse_spans(parser, text.data(), texts[j].size(), &spans[0], 1);
+				if (n != (ssize_t)tokens.size() || spans[0].offset != tokens[0]->get_begin()
+						|| spans[0].length != tokens[0]->get_end() - tokens[0]->get_begin()
+						|| spans[1].length != 12345) {
+					fprintf(stderr, "%s: spans of text %zu into a short out\n", chains[i], j);
+					ok = false;
+				}
+			}
+			ParserFixture::join(tokens);
+		}
+		delete parser;
+	}
+	return ok;
+}
+
+typedef struct {
+	std::string token;
+	bamboo_span_t span;
+} _streamed_t;
+
+static void _on_token(const char *token, const bamboo_span_t *span, void *arg) {
+	_streamed_t streamed;
+
+	streamed.token = token;
+	streamed.span = *span;
+	((std::vector<_streamed_t> *)arg)->push_back(streamed);
+}
+
+static void _on_tokens(std::vector<Token *> &tokens, void *arg) {
+	bamboo_span_t span;
+	size_t i;
+
+	for (i = 0; i < tokens.size(); i++) {
+		span.offset = tokens[i]->get_begin();
+		span.length = tokens[i]->get_end() - tokens[i]->get_begin();
+		span.char_offset = tokens[i]->get_char_begin();
+		span.char_length = tokens[i]->get_char_end() - tokens[i]->get_char_begin();
+		span.pos = tokens[i]->get_pos();
+		_on_token(tokens[i]->get_orig_token(), &span, arg);
+		delete tokens[i];
+	}
+	tokens.clear();
+}
+
+/* document fed in pieces of up to max bytes, cut anywhere, even inside a character */
+static void _feed(const std::string &document, size_t max, void *stream, StreamParser *parser) {
+	size_t i, n;
+
+	for (i = 0; i < document.size(); i += n) {
+		n = std::min(document.size() - i, (size_t)_rand(max + 1));
+		if (stream) bamboo_stream_feed(stream, document.data() + i, n);
+		else parser->feed(document.data() + i, n);
+	}
+	if (stream) bamboo_stream_flush(stream);
+	else parser->flush();
+}
+
+static bool _same_stream(const char *what, const std::string &document,
+		const std::vector<bamboo_span_t> &expect, const std::vector<_streamed_t> &got) {
+	const bamboo_span_t *span;
+	size_t i;
+
+	if (got.size() != expect.size()) {
+		fprintf(stderr, "%s: %zu tokens streamed, not %zu\n", what, got.size(), expect.size());
+		return false;
+	}
+	for (i = 0; i < got.size(); i++) {
+		span = &got[i].span;
+		if (got[i].token != document.substr(expect[i].offset, expect[i].length)
+				|| span->offset != expect[i].offset || span->length != expect[i].length
+				|| span->char_offset != expect[i].char_offset
+				|| span->char_length != expect[i].char_length || span->pos != expect[i].pos) {
+			fprintf(stderr, "%s: token %zu streamed is %s at %zu, not %s at %zu\n", what, i,
+				got[i].token.c_str(), span->offset,
+				document.substr(expect[i].offset, expect[i].length).c_str(), expect[i].offset);
+			return false;
+		}
+	}
+	return true;
+}
+
+/*
+ * a document streamed in random pieces, through bamboo_stream_feed() and
+ * through StreamParser cutting every few bytes, gives the tokens of a
+ * whole-document parse, offsets counted from the start of the stream
+ */
+bool test_stream(ParserFixture &fixture) {
+	static const size_t chunks[] = {1, 16, 100, 0};
+	std::vector<bamboo_span_t> expect;
+	std::vector<_streamed_t> got;
+	std::vector<std::string> texts;
+	std::string document;
+	StreamParser *stream_parser;
+	Parser *parser;
+	void *stream;
+	size_t i, j;
+	ssize_t n;
+	bool ok = true;
+
+	_texts(texts, 100);
+	while (document.size() < 200000) {
+		document += texts[_rand(texts.size())];
+		document += (_rand(2))?"\n":" ";
+	}
+	for (i = 0; chains[i] && ok; i++) {
+		parser = fixture.parser(fixture.config("stream.conf", chains[i]));
+		expect.resize(document.size());
+		n = bamboo_parse_spans(parser, document.data(), document.size(), &expect[0], expect.size());
+		expect.resize((n > 0)?n:0);
+
+		got.clear();
+		stream = bamboo_stream_new(parser, _on_token, &got);
+		_feed(document, 5000, stream, NULL);
+		bamboo_stream_free(stream);
+		ok = _same_stream(chains[i], document, expect, got);
+
+		for (j = 0; chunks[j] && ok; j++) {
+			got.clear();
+			stream_parser = new StreamParser(parser, _on_tokens, &got, chunks[j]);
+			_feed(document, 3 * chunks[j], NULL, stream_parser);
+			delete stream_parser;
+			ok = _same_stream(chains[i], document, expect, got);
+		}
+		delete parser;
+	}
+	return ok;
+}
+
+int main() {
+	ParserFixture fixture;
+
+	if (!test_batch(fixture)) return EXIT_FAILURE;
+	if (!test_batch_options()) return EXIT_FAILURE;
+	if (!test_filter(fixture)) return EXIT_FAILURE;
+	if (!test_records(fixture)) return EXIT_FAILURE;
+	if (!test_spans(fixture)) return EXIT_FAILURE;
+	if (!test_stream(fixture)) return EXIT_FAILURE;
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,133 @@
+#include <dirent.h>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "parser_fixture.hxx"
+#include "custom_parser.hxx"
+using namespace bamboo;
+
+/* chains of every processor but the CRF ones */
+static const char *chains[] = {
+	"prepare, ugm_seg, single_combine, break",
+	"prepare, maxforward, maxforward_combine, single_combine",
+	"prepare, ugm_seg, single_combine, ac_match",
+	NULL
+};
+
+static const char *chunks[] = {
+	"pipeline_chunk = 1", "pipeline_chunk = 3", "pipeline_chunk = 256",
+	"pipeline_chunk = 1\npipeline_threads = 1", "pipeline_chunk = 3\npipeline_threads = 1",
+	"pipeline_chunk = 256\npipeline_threads = 1", NULL
+};
+
+/*
+ * the fixture texts one by one, then all of them many times as one text,
+ * prepared in many pieces, with and without whitespace to cut it at
+ */
+static void _texts(std::vector<std::string> &texts) {
+	std::string document;
+	size_t i, j;
+
+	for (i = 0; fixture_text[i]; i++) texts.push_back(fixture_text[i]);
+	for (j = 0; j < 50; j++) {
+		for (i = 0; fixture_text[i]; i++) {
+			document += fixture_text[i];
+			document += (j % 2)?"\n":"";
+		}
+	}
+	texts.push_back(document);
+	for (i = 0; i < document.size(); i++) {
+		if (document[i] == ' ' || document[i] == '\n') document[i] = '-';
+	}
+	texts.push_back(document);
+	document.clear();
+	for (j = 0; document.size() < 20000; j++) {
+		document += fixture_text[j % 7];
+		document += (j % 3)?" ":"\t";
+	}
+	texts.push_back(document);
+}
+
+static bool _same(ParserFixture &fixture, const char *chain, const char *extra,
+		const std::vector<std::string> &texts, const std::vector<std::string> &expect) {
+	Parser *parser = fixture.parser(fixture.config("pipeline.conf", chain, extra));
+	std::string got;
+	size_t i;
+	bool ok = true;
+
+	for (i = 0; i < texts.size() && ok; i++) {
+		got = ParserFixture::parse(parser, texts[i].c_str());
+		if (got != expect[i]) {
+			fprintf(stderr, "%s with %s, text %zu\n  gives  %.200s\n  not    %.200s\n",
+				chain, extra, i, got.c_str(), expect[i].c_str());
+			ok = false;
+		}
+	}
+	delete parser;
+	return ok;
+}
+
+/* the chain run pipeline_chunk tokens at a time gives the tokens of a whole-text run */
+bool test_chunks(ParserFixture &fixture) {
+	std::vector<std::string> texts, expect;
+	Parser *parser;
+	size_t i, j;
+
+	_texts(texts);
+	for (i = 0; chains[i]; i++) {
+		parser = fixture.parser(fixture.config("serial.conf", chains[i]));
+		expect.clear();
+		for (j = 0; j < texts.size(); j++) expect.push_back(ParserFixture::parse(parser, texts[j].c_str()));
+		delete parser;
+		for (j = 0; chunks[j]; j++) {
+			if (!_same(fixture, chains[i], chunks[j], texts, expect)) return false;
+		}
+	}
+	return true;
+}
+
+/* threads of the process, or 0 when they can not be told */
+static size_t _threads() {
+	DIR *dir = opendir("/proc/self/task");
+	struct dirent *entry;
+	size_t n = 0;
+
+	if (dir == NULL) return 0;
+	while ((entry = readdir(dir)) != NULL) {
+		if (entry->d_name[0] != '.') n++;
+	}
+	closedir(dir);
+	return n;
+}
+
+/* a thread per stage after prepare, started once and kept between parses */
+bool test_threads(ParserFixture &fixture) {
+	Parser *parser;
+	size_t before, during;
+	int i;
+
+	before = _threads();
+	parser = fixture.parser(fixture.config("threads.conf", chains[0],
+		"pipeline_chunk = 3\npipeline_threads = 1"));
+	ParserFixture::parse(parser, fixture_text[0]);
+	during = _threads();
+	for (i = 0; i < 100; i++) {
+		ParserFixture::parse(parser, fixture_text[i % 7]);
+		if (_threads() != during) return false;
+	}
+	if (before > 0 && during != before + 3) return false;
+	((CustomParser *)parser)->reload();
+	ParserFixture::parse(parser, fixture_text[1]);
+	if (_threads() != during) return false;
+	delete parser;
+	return _threads() == before;
+}
+
+int main() {
+	ParserFixture fixture;
+
+	if (!test_chunks(fixture)) return EXIT_FAILURE;
+	if (!test_threads(fixture)) return EXIT_FAILURE;
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,273 @@
+#include <unistd.h>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <vector>
+#include "lexicon_factory.hxx"
+#include "record_lexicon.hxx"
+#include "token_impl.hxx"
+using namespace bamboo;
+
+typedef std::map<std::string, int> dict_t;
+
+static const char *types[] = {"datrie", "double_array", "compact_trie", "codepoint_trie", "succinct", NULL};
+static const char *fields[] = {"freq", "pos", "combine", "trailing", "break", NULL};
+static const char *tags[] = {"n", "v", "vn", "n,vn", "a,ad", "nr", NULL};
+
+static unsigned int g_seed = 1;
+
+static unsigned int _rand(unsigned int n) {
+	g_seed = g_seed * 1664525u + 1013904223u;
+	return (g_seed >> 8) % n;
+}
+
+/* few characters, so that many keys are prefixes of others */
+static std::string _random_key() {
+	static const char *pieces[] = {"中", "华", "人", "民", "国", "北", "京", "a", "b", "1"};
+	size_t i, n = 1 + _rand(6);
+	std::string s;
+
+	for (i = 0; i < n; i++) s += pieces[_rand(sizeof(pieces) / sizeof(pieces[0]))];
+	return s;
+}
+
+class RecordFixture {
+public:
+	std::string root;
+	std::vector<std::string> keys;
+	dict_t dicts[5];
+
+	RecordFixture() {
+		char dir[] = "/tmp/record_lexicon_test.XXXXXX";
+		std::map<std::string, bool> seen;
+		std::string key, chain;
+		size_t i, j;
+
+		if (mkdtemp(dir) == NULL) throw std::runtime_error("can not create a temporary directory");
+		root = dir;
+		while (keys.size() < 5000) {
+			key = _random_key();
+			if (!seen[key]) keys.push_back(key);
+			seen[key] = true;
+		}
+		/* a chain of prefixes where only the longest is a combination */
+		for (i = 0; i < 12; i++) {
+			chain += "长";
+			if (!seen[chain]) keys.push_back(chain);
+			seen[chain] = true;
+			dicts[0][chain] = 1 + i;
+		}
+		dicts[2][chain] = 1;
+		for (i = 0; i < keys.size(); i++) {
+			if (_rand(10) < 7 && !dicts[0].count(keys[i])) dicts[0][keys[i]] = 1 + _rand(1000);
+			if (_rand(10) < 2) dicts[1][keys[i]] = _rand(6);
+			if (_rand(10) < 2 && keys[i].find("长") == std::string::npos) dicts[2][keys[i]] = 1;
+			if (_rand(10) < 1) dicts[3][keys[i]] = 1;
+			if (_rand(10) < 1) dicts[4][keys[i]] = 1 + _rand(1000);
+		}
+		for (j = 0; fields[j]; j++) {
+			FILE *fp = fopen(path(fields[j]).c_str(), "w");
+			for (dict_t::iterator it = dicts[j].begin(); it != dicts[j].end(); ++it) {
+				if (j == 1)
+					fprintf(fp, "%s %s\n", tags[it->second], it->first.c_str());
+				else
+					fprintf(fp, "%d %s\n", it->second, it->first.c_str());
+			}
+			fclose(fp);
+		}
+		/* what the fields give: pos as its mask, flags as 0 or 1, no 0 */
+		for (dict_t::iterator it = dicts[1].begin(); it != dicts[1].end(); ++it)
+			it->second = RecordLexicon::pos_mask(tags[it->second]);
+	}
+
+	~RecordFixture() {
+		size_t i;
+
+		for (i = 0; fields[i]; i++) unlink(path(fields[i]).c_str());
+		unlink(path("lexicon.rec").c_str());
+		unlink(RecordLexicon::keys_path(path("lexicon.rec").c_str()).c_str());
+		rmdir(root.c_str());
+	}
+
+	std::string path(const char *name) {
+		return root + "/" + name;
+	}
+};
+
+static void _collect(const char *key, int val, void *arg) {
+	(*(dict_t *)arg)[key] = val;
+}
+
+static bool _check_field(RecordFixture &fixture, ILexicon *lexicon, const dict_t &dict, const char *what) {
+	std::vector<const char *> batch;
+	std::vector<int> values;
+	trie_match_t matches[64];
+	dict_t::const_iterator it;
+	std::vector<std::pair<size_t, int> > expect;
+	dict_t seen;
+	std::string text;
+	size_t i, j, n, size;
+	long long sum = 0;
+	int max = 0, min = 0;
+
+	for (i = 0; i < fixture.keys.size(); i++) {
+		it = dict.find(fixture.keys[i]);
+		if (lexicon->search(fixture.keys[i].c_str()) != ((it == dict.end())?0:it->second)) {
+			fprintf(stderr, "%s: search of %s\n", what, fixture.keys[i].c_str());
+			return false;
+		}
+		batch.push_back(fixture.keys[i].c_str());
+	}
+	values.resize(batch.size());
+	lexicon->search_batch(&batch[0], batch.size(), &values[0]);
+	for (i = 0; i < batch.size(); i++) {
+		if (values[i] != lexicon->search(batch[i])) {
+			fprintf(stderr, "%s: search_batch of %s\n", what, batch[i]);
+			return false;
+		}
+	}
+
+	lexicon->explore(_collect, &seen);
+	if (seen != dict) {
+		fprintf(stderr, "%s: explore gives %zu keys, not %zu\n", what, seen.size(), dict.size());
+		return false;
+	}
+	for (it = dict.begin(); it != dict.end(); ++it) {
+		if (it == dict.begin() || it->second > max) max = it->second;
+		if (it == dict.begin() || it->second < min) min = it->second;
+		sum += it->second;
+	}
+	if (lexicon->num_insert() != (int)dict.size() || (!dict.empty()
+			&& (lexicon->max_value() != max || lexicon->min_value() != min || lexicon->sum_value() != sum))) {
+		fprintf(stderr, "%s: statistics\n", what);
+		return false;
+	}
+
+	/* the prefixes where the field is not 0, however many where it is */
+	for (i = 0; i < 3000; i++) {
+		text = (i % 10 == 0)?"长长长长长长长长长长长长长":fixture.keys[_rand(fixture.keys.size())] + _random_key();
+		expect.clear();
+		for (j = 1; j <= text.size(); j++) {
+			it = dict.find(text.substr(0, j));
+			if (it != dict.end()) expect.push_back(std::make_pair(j, it->second));
+		}
+		size = (i % 3 == 0)?1:(i % 3 == 1)?2:64;
+		n = lexicon->common_prefix_search(text.c_str(), text.size(), matches, size);
+		if (n != std::min(size, expect.size())) {
+			fprintf(stderr, "%s: %zu prefixes of %s, not %zu\n", what, n, text.c_str(),
+				std::min(size, expect.size()));
+			return false;
+		}
+		for (j = 0; j < n; j++) {
+			if (matches[j].length != expect[j].first || matches[j].value != expect[j].second) {
+				fprintf(stderr, "%s: prefix %zu of %s\n", what, j, text.c_str());
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+bool test_fields(RecordFixture &fixture) {
+	std::string filename = fixture.path("lexicon.rec"), what;
+	RecordLexiconBuilder builder;
+	ILexicon *lexicon;
+	size_t i, j;
+	bool ok;
+
+	for (j = 0; fields[j]; j++)
+		builder.add(RecordLexicon::field(fields[j]), fixture.path(fields[j]).c_str(), false);
+	for (i = 0; types[i]; i++) {
+		builder.save(filename.c_str(), types[i], 1 << 20, false);
+		for (j = 0; fields[j]; j++) {
+			what = std::string(types[i]) + " " + fields[j];
+			lexicon = LexiconFactory::load((filename + ":" + fields[j]).c_str());
+			ok = _check_field(fixture, lexicon, fixture.dicts[j], what.c_str());
+			delete lexicon;
+			if (!ok) return false;
+		}
+	}
+	return true;
+}
+
+/* lookup() and lookup_batch() give the records, resolve() keeps them on the tokens */
+bool test_lookup(RecordFixture &fixture) {
+	std::string filename = fixture.path("lexicon.rec");
+	std::vector<const RecordLexicon::record_t *> found;
+	std::vector<const char *> batch;
+	std::vector<TokenImpl *> tokens;
+	const RecordLexicon::record_t *record;
+	RecordLexiconBuilder builder(0.5);
+	RecordLexicon *records;
+	dict_t::const_iterator it;
+	long long sum = 0;
+	double logp;
+	size_t i;
+	bool ok = true;
+
+	builder.add(RecordLexicon::field_freq, fixture.path("freq").c_str(), false);
+	builder.add(RecordLexicon::field_break, fixture.path("break").c_str(), false);
+	builder.save(filename.c_str(), "compact_trie", 1 << 20, false);
+	records = RecordLexicon::acquire(filename.c_str());
+	for (it = fixture.dicts[0].begin(); it != fixture.dicts[0].end(); ++it) sum += it->second;
+
+	for (i = 0; i < fixture.keys.size() && ok; i++) {
+		record = records->lookup(fixture.keys[i].c_str());
+		it = fixture.dicts[0].find(fixture.keys[i]);
+		if (it == fixture.dicts[0].end()) {
+			if (record && record->freq != 0) ok = false;
+			continue;
+		}
+		logp = log(it->second + 0.5) - log((int)sum + records->num_insert(RecordLexicon::field_freq) * 0.5);
+		if (record == NULL || record->freq != it->second || record->logp != logp) {
+			fprintf(stderr, "lookup of %s\n", fixture.keys[i].c_str());
+			ok = false;
+		}
+		batch.push_back(fixture.keys[i].c_str());
+	}
+	batch.push_back("不在");
+	found.resize(batch.size());
+	records->lookup_batch(&batch[0], batch.size(), &found[0]);
+	for (i = 0; i < batch.size() && ok; i++) {
+		if (found[i] != records->lookup(batch[i])) {
+			fprintf(stderr, "lookup_batch of %s\n", batch[i]);
+			ok = false;
+		}
+	}
+	if (ok && records->lambda() != 0.5) ok = false;
+
+	/* a record kept on a token is taken as it is, without a walk */
+	for (i = 0; i < batch.size(); i++) tokens.push_back(new TokenImpl(batch[i]));
+	if (ok && (records->resolve(tokens[0]) != found[0] || tokens[0]->get_record(records) <= 0))
+		ok = false;
+	tokens[1]->set_record(records, tokens[0]->get_record(records));
+	found.assign(batch.size(), NULL);
+	records->resolve_batch(&tokens[0], tokens.size(), &found[0]);
+	if (ok && (found[1] != found[0] || found.back() != NULL || tokens.back()->get_record(records) != 0))
+		ok = false;
+	for (i = 2; i < tokens.size() && ok; i++)
+		if (found[i] != records->lookup(batch[i])) ok = false;
+	tokens[1]->set_token(batch[1]);
+	if (ok && (tokens[1]->get_record(records) != -1 || records->resolve(tokens[1]) != records->lookup(batch[1])))
+		ok = false;
+	if (!ok) fprintf(stderr, "resolve of the tokens\n");
+	for (i = 0; i < tokens.size(); i++) delete tokens[i];
+	RecordLexicon::release(records);
+	return ok;
+}
+
+bool test_pos_mask() {
+	return RecordLexicon::pos_mask("n,vn") == ((1U << ('n' - 'a')) | (1U << ('v' - 'a')))
+		&& RecordLexicon::pos_mask("") == 0;
+}
+
+int main() {
+	RecordFixture fixture;
+
+	if (!test_pos_mask()) return EXIT_FAILURE;
+	if (!test_fields(fixture)) return EXIT_FAILURE;
+	if (!test_lookup(fixture)) return EXIT_FAILURE;
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,126 @@
+#include <pthread.h>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "parser_fixture.hxx"
+#include "token_pool.hxx"
+using namespace bamboo;
+
+static unsigned int g_seed = 1;
+
+static unsigned int _rand(unsigned int n) {
+	g_seed = g_seed * 1664525u + 1013904223u;
+	return (g_seed >> 8) % n;
+}
+
+static void *_alloc_chunks(void *arg) {
+	std::vector<void *> *chunks = (std::vector<void *> *)arg;
+	size_t i;
+
+	for (i = 0; i < chunks->size(); i++)
+		(*chunks)[i] = TokenPool::alloc(1 + i * 37 % 4096);
+	return NULL;
+}
+
+static void *_free_chunks(void *arg) {
+	std::vector<void *> *chunks = (std::vector<void *> *)arg;
+	size_t i;
+
+	for (i = 0; i < chunks->size(); i++) TokenPool::free((*chunks)[i]);
+	return NULL;
+}
+
+/* chunks allocated by one thread and freed by another go back to the first one's lists */
+bool test_threads() {
+	std::vector<void *> chunks(5000);
+	size_t round, warm = 0;
+	pthread_t thread;
+
+	for (round = 0; round < 100; round++) {
+		if (round == 5) warm = TokenPool::allocations();
+		pthread_create(&thread, NULL, _alloc_chunks, &chunks);
+		pthread_join(thread, NULL);
+		_free_chunks(&chunks);
+
+		_alloc_chunks(&chunks);
+		pthread_create(&thread, NULL, _free_chunks, &chunks);
+		pthread_join(thread, NULL);
+	}
+	if (TokenPool::allocations() != warm) {
+		fprintf(stderr, "chunks freed across threads: %zu heap allocations after warm-up\n",
+			TokenPool::allocations() - warm);
+		return false;
+	}
+	return true;
+}
+
+/* a few KB of the fixture texts glued together */
+static std::string _text() {
+	std::string text;
+
+	while (text.size() < 4096) text += fixture_text[_rand(7)];
+	return text;
+}
+
+/* tokens made by the stage threads of a pipelined chain and deleted by the caller */
+bool test_pipeline(ParserFixture &fixture) {
+	Parser *parser = fixture.parser(fixture.config("pool.conf",
+		"prepare, ugm_seg, single_combine, break", "pipeline_chunk = 3\npipeline_threads = 1"));
+	std::string text = _text();
+	size_t round, warm = 0;
+
+	for (round = 0; round < 100; round++) {
+		if (round == 10) warm = TokenPool::allocations();
+		ParserFixture::parse(parser, text.c_str());
+	}
+	delete parser;
+	if (TokenPool::allocations() != warm) {
+		fprintf(stderr, "pipelined parses: %zu heap allocations after warm-up\n",
+			TokenPool::allocations() - warm);
+		return false;
+	}
+	return true;
+}
+
+/*
+ * tokens made by the worker threads of parse_batch() and deleted by the
+ * caller; which thread parses which document varies, so the pools may
+ * still grow a little until every thread met its largest share, but
+ * far less than they did warming up
+ */
+bool test_batch(ParserFixture &fixture) {
+	static const int threads = 4;
+	Parser *parser = fixture.parser(fixture.config("pool.conf",
+		"prepare, ugm_seg, single_combine, break"));
+	std::vector<std::vector<Token *> > out;
+	std::vector<std::string> texts;
+	std::vector<const char *> batch;
+	size_t i, round, start, warm = 0;
+
+	for (i = 0; i < 16; i++) texts.push_back(_text());
+	for (i = 0; i < texts.size(); i++) batch.push_back(texts[i].c_str());
+	parser->setopt(BAMBOO_OPTION_THREADS, &threads);
+	start = TokenPool::allocations();
+	for (round = 0; round < 200; round++) {
+		if (round == 50) warm = TokenPool::allocations();
+		parser->parse_batch(&batch[0], batch.size(), out);
+		for (i = 0; i < out.size(); i++) ParserFixture::join(out[i]);
+	}
+	delete parser;
+	if (TokenPool::allocations() - warm > (warm - start) / 2) {
+		fprintf(stderr, "batches: %zu heap allocations after a warm-up of %zu\n",
+			TokenPool::allocations() - warm, warm - start);
+		return false;
+	}
+	return true;
+}
+
+int main() {
+	ParserFixture fixture;
+
+	if (!test_threads()) return EXIT_FAILURE;
+	if (!test_pipeline(fixture)) return EXIT_FAILURE;
+	if (!test_batch(fixture)) return EXIT_FAILURE;
+	return EXIT_SUCCESS;
+}
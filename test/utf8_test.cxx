@@ -1,3 +1,9 @@
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <cstdio>
+#include <string>
+#include <vector>
 #include "utf8.hxx"
 using namespace bamboo;
 
@@ -22,6 +28,125 @@ bool test_dbc2sbc() {
     }
 }
 
+/* the byte walks the block kernels must agree with */
+static int _map(const std::string &s, size_t i) {
+    unsigned char c = s[i];
+    if (c < 0x80) return 1;
+    if (c < 0xc0) return -1;
+    if (c < 0xe0) return 2;
+    if (c < 0xf0) return 3;
+    return (c < 0xf4) ? 4 : -1;
+}
+
+static size_t ref_length(const std::string &s) {
+    size_t i, j;
+    for (i = 0, j = 0; i < s.size();) {
+        if (_map(s, i) > 0) { i += _map(s, i); ++j; } else ++i;
+    }
+    return j;
+}
+
+static int ref_check(const std::string &s) {
+    size_t i;
+    for (i = 0; i < s.size();) {
+        if (_map(s, i) <= 0) return -1;
+        i += _map(s, i);
+    }
+    return 0;
+}
+
+static void ref_index(const std::string &s, std::vector<size_t> &index) {
+    size_t i;
+    for (i = 0; i < s.size();) {
+        index.push_back(i);
+        i += (_map(s, i) > 0) ? _map(s, i) : 1;
+    }
+}
+
+static size_t ref_locate(const std::string &s, size_t start) {
+    size_t i, j;
+    for (i = 0, j = 0; j < start && i < s.size();) {
+        if (_map(s, i) > 0) { i += _map(s, i); ++j; } else ++i;
+    }
+    return (i < s.size()) ? i : s.size();
+}
+
+static unsigned int g_seed = 1;
+
+static unsigned int _rand(unsigned int n) {
+    g_seed = g_seed * 1664525u + 1013904223u;
+    return (g_seed >> 8) % n;
+}
+
+/* mostly CJK with ASCII, other widths and broken sequences mixed in */
+static std::string _random_text() {
+    static const char *pieces[] = {
+        "\xe4\xb8\xad", "\xe6\x96\x87", "\xe5\x88\x86\xe8\xaf\x8d", "a", "Bamboo ", "2010",
+        "\xc3\xa9", "\xf0\x9f\x98\x80", "\xf4\x80\x80\x80", "\x80", "\xbf\xbf", "\xff",
+        "\xe4\xb8", "\xc3", "\xf0\x9f"
+    };
+    size_t i, n = _rand(80), weight;
+    std::string s;
+
+    for (i = 0; i < n; i++) {
+        weight = _rand(100);
+        if (weight < 60) s += pieces[_rand(3)];
+        else if (weight < 85) s += pieces[3 + _rand(5)];
+        else s += pieces[8 + _rand(7)];
+    }
+    return s;
+}
+
+bool test_walks() {
+    std::vector<size_t> expect, index;
+    std::string s;
+    size_t i, start, n;
+
+    for (i = 0; i < 20000; i++) {
+        s = _random_text();
+        if (utf8::length(s.c_str()) != ref_length(s)) return false;
+        if (utf8::check(s.c_str()) != ref_check(s)) return false;
+        expect.clear();
+        ref_index(s, expect);
+        index.resize(s.size() + 1);
+        n = utf8::index(s.c_str(), &index[0]);
+        index.resize(n);
+        if (index != expect) return false;
+        for (start = 0; start <= expect.size() + 1; start += 1 + _rand(5))
+            if ((size_t)utf8::locate(s.c_str(), start) != ref_locate(s, start)) return false;
+    }
+    return true;
+}
+
+/* runs the walks again under each narrower kernel */
+bool test_kernels(const char *self) {
+    static const char *kernels[] = {"sse2", "scalar"};
+    size_t i;
+    pid_t pid;
+    int status;
+
+    for (i = 0; i < sizeof(kernels) / sizeof(kernels[0]); i++) {
+        pid = fork();
+        if (pid == 0) {
+            setenv("BAMBOO_UTF8_KERNEL", kernels[i], 1);
+            execl(self, self, (char *)NULL);
+            _exit(127);
+        }
+        if (pid < 0 || waitpid(pid, &status, 0) != pid
+            || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            fprintf(stderr, "walks failed with the %s kernel\n", kernels[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
 int main(int argc, char **argv) {
-    return test_dbc2sbc() ? EXIT_SUCCESS : EXIT_FAILURE;
+    if (!test_dbc2sbc()) return EXIT_FAILURE;
+    if (!test_walks()) {
+        fprintf(stderr, "walks failed with the %s kernel\n", utf8::kernel());
+        return EXIT_FAILURE;
+    }
+    if (getenv("BAMBOO_UTF8_KERNEL") == NULL && !test_kernels(argv[0])) return EXIT_FAILURE;
+    return EXIT_SUCCESS;
 }